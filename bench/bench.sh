@@ -0,0 +1,104 @@
+#!/bin/bash
+#
+# bench.sh -- capture throughput per mode on a veth pair in a scratch netns
+#
+# Usage: bench/bench.sh [MODE...]
+#
+# Traffic from helpers/flow-gen is sent at a fixed rate into one end of a
+# veth pair and captured on the other end once per mode. One tab separated
+# row is printed per mode:
+#
+#   mode sent captured dropped pps cpu_user cpu_sys
+#
+# where dropped is sent less captured (less the estimate when sampling), pps
+# is captured per second of the run, and cpu_user/cpu_sys are the capture's
+# cpu seconds.
+#
+# Tunables (environment):
+#   BENCH_RATE      packets per second to send (default 100000)
+#   BENCH_DURATION  seconds to send for (default 5)
+#   BENCH_QUEUES    rx and tx queues on each veth end (default 4)
+#   BENCH_FLOWS     source ports to cycle through (default 256)
+
+set -e
+
+cd "$(dirname "$0")/.."
+
+[[ "$EUID" -ne 0 ]] && {
+  echo >&2 "This script must be run as root."
+  exit 1
+}
+
+rate="${BENCH_RATE:-100000}"
+duration="${BENCH_DURATION:-5}"
+queues="${BENCH_QUEUES:-4}"
+flows="${BENCH_FLOWS:-256}"
+
+ns="rxtxbench-$$"
+tmp="$(mktemp -d)"
+
+declare -A modes=(
+  [rxtxcpu]="./rxtxcpu -d rx"
+  [rxtxcpu-write]="./rxtxcpu -d rx -w $tmp/cpu.pcap"
+  [rxtxcpu-write-unbuffered]="./rxtxcpu -d rx -U -w $tmp/cpu.pcap"
+  [rxtxcpu-sample]="./rxtxcpu -d rx -s 10"
+  [rxtxcpu-rollover]="./rxtxcpu -d rx -R"
+  [rxtxqueue]="./rxtxqueue -d rx"
+  [rxtxhash]="./rxtxhash -d rx"
+)
+order=(rxtxcpu rxtxcpu-write rxtxcpu-write-unbuffered rxtxcpu-sample
+       rxtxcpu-rollover rxtxqueue rxtxhash)
+
+cleanup() {
+  ip netns del "$ns" 2>/dev/null || true
+  rm -rf "$tmp"
+}
+trap cleanup EXIT
+
+(( $# )) && order=("$@")
+for mode in "${order[@]}"; do
+  [[ -n "${modes[$mode]}" ]] || {
+    echo >&2 "Unknown mode '$mode'; choose from: ${!modes[*]}"
+    exit 1
+  }
+done
+
+ip netns add "$ns"
+ip -n "$ns" link add bench0 numtxqueues "$queues" numrxqueues "$queues" \
+  type veth peer name bench1 numtxqueues "$queues" numrxqueues "$queues"
+ip -n "$ns" link set bench0 up
+ip -n "$ns" link set bench1 up
+
+printf 'mode\tsent\tcaptured\tdropped\tpps\tcpu_user\tcpu_sys\n'
+
+for mode in "${order[@]}"; do
+  rm -f "$tmp"/cpu*.pcap
+
+  # Capture for a little longer than we send so the tail of the burst lands.
+  {
+    TIMEFORMAT='%U %S'
+    time ip netns exec "$ns" timeout -s INT "$((duration + 2))" \
+      ${modes[$mode]} bench1 >"$tmp/capture.out" 2>"$tmp/capture.err"
+  } 2>"$tmp/cpu" &
+  capture=$!
+  sleep 1
+
+  ip netns exec "$ns" timeout -s INT "$duration" \
+    helpers/flow-gen -n 0 -r "$rate" \
+      -s 10.0.0.1 -S "1024-$((1024 + flows - 1))" \
+      -d 10.0.0.2 -D 80 bench0 2>"$tmp/gen.err" || true
+  wait "$capture" || true
+
+  sent="$(awk '/packets sent for/ {print $1}' "$tmp/gen.err")"
+  captured="$(awk '/packets captured total/ {print $1}' "$tmp/capture.out")"
+  [[ -n "$sent" && -n "$captured" ]] || {
+    echo >&2 "$mode: run failed"
+    cat >&2 "$tmp/gen.err" "$tmp/capture.err"
+    exit 1
+  }
+  seen="$(awk '/packets estimated total/ {print $1}' "$tmp/capture.out")"
+  read -r cpu_user cpu_sys <"$tmp/cpu"
+
+  printf '%s\t%s\t%s\t%s\t%s\t%s\t%s\n' "$mode" "$sent" "$captured" \
+    "$((sent - ${seen:-$captured}))" "$((captured / duration))" "$cpu_user" "$cpu_sys"
+done
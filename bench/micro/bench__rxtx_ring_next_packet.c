@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2019-present StackPath, LLC
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "helper.h"
+
+#include "../../ring_set.h"
+#include "../../rxtx.h"
+#include "../../rxtx_error.h"
+#include "../../rxtx_ring.h"
+#include "../../rxtx_stats.h"
+
+#include <assert.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+/*
+ * Packets are queued in batches on a seqpacket socketpair (which keeps
+ * message boundaries without the small datagram queue limit of unix dgram
+ * sockets) and only the rxtx_ring_next_packet() calls are timed.
+ */
+#define BATCH_SIZE 64
+
+static void run(const char *name, size_t size, uintmax_t packets) {
+  struct rxtx_desc rtd;
+  struct rxtx_ring ring;
+  struct rxtx_stats stats;
+  struct bench_clock total = {0, 0};
+  struct bench_clock batch;
+  struct pcap_pkthdr header;
+  char errbuf[RXTX_ERRBUF_SIZE];
+  static u_char in[65535];
+  u_char out[1500];
+  uintmax_t done = 0;
+  int sv[2];
+  int status;
+  int i;
+
+  memset(out, 0xa5, sizeof(out));
+
+  status = socketpair(AF_UNIX, SOCK_SEQPACKET, 0, sv);
+  assert(status == 0);
+
+  rxtx_init(&rtd, errbuf);
+
+  memset(&stats, 0, sizeof(stats));
+  rxtx_stats_init(&stats, errbuf);
+
+  memset(&ring, 0, sizeof(ring));
+  ring.rtd = &rtd;
+  ring.stats = &stats;
+  ring.fd = sv[0];
+  ring.errbuf = errbuf;
+
+  while (done < packets) {
+    for (i = 0; i < BATCH_SIZE; i++) {
+      status = send(sv[1], out, size, 0);
+      assert(status == (int)size);
+    }
+
+    bench_start(&batch);
+    for (i = 0; i < BATCH_SIZE; i++) {
+      status = rxtx_ring_next_packet(&ring, &header, in);
+      assert(status == (int)size);
+    }
+    bench_stop(&batch);
+
+    total.ns += batch.ns;
+    total.cycles += batch.cycles;
+    done += BATCH_SIZE;
+  }
+
+  assert(rxtx_stats_get_packets_received(&stats) == done);
+
+  bench_report(name, 1, done, &total);
+
+  rxtx_stats_destroy(&stats);
+  ring_set_destroy(&(rtd.ring_set));
+  close(sv[0]);
+  close(sv[1]);
+}
+
+int main(int argc, char **argv) {
+  uintmax_t packets = bench_packets(argc, argv);
+
+  run("rxtx_ring_next_packet/64", 64, packets);
+  run("rxtx_ring_next_packet/1500", 1500, packets);
+
+  return 0;
+}
@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2019-present StackPath, LLC
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "helper.h"
+
+#include "../../rxtx_error.h"
+#include "../../rxtx_savefile.h"
+
+#include <assert.h>
+#include <string.h>
+
+/*
+ * Dumps go to /dev/null so the numbers are libpcap and stdio cost (plus a
+ * write() per packet when flushing, as with -U) rather than the disk's.
+ */
+#define SAVEFILE "/dev/null"
+
+static void run(const char *name, size_t size, int flush, uintmax_t packets) {
+  struct rxtx_savefile savefile;
+  struct bench_clock clock;
+  struct pcap_pkthdr header;
+  char errbuf[RXTX_ERRBUF_SIZE];
+  u_char packet[1500];
+  uintmax_t i;
+  int status;
+
+  memset(packet, 0xa5, sizeof(packet));
+  memset(&header, 0, sizeof(header));
+  header.caplen = size;
+  header.len = size;
+
+  status = rxtx_savefile_open(&savefile, SAVEFILE, errbuf);
+  assert(status == 0);
+
+  bench_start(&clock);
+  for (i = 0; i < packets; i++) {
+    status = rxtx_savefile_dump(&savefile, &header, packet, flush);
+    assert(status == 0);
+  }
+  bench_stop(&clock);
+
+  bench_report(name, 1, packets, &clock);
+
+  status = rxtx_savefile_close(&savefile);
+  assert(status == 0);
+}
+
+int main(int argc, char **argv) {
+  uintmax_t packets = bench_packets(argc, argv);
+
+  run("rxtx_savefile_dump/64", 64, 0, packets);
+  run("rxtx_savefile_dump/1500", 1500, 0, packets);
+  run("rxtx_savefile_dump/64/flush", 64, 1, packets);
+  run("rxtx_savefile_dump/1500/flush", 1500, 1, packets);
+
+  return 0;
+}
@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) 2019-present StackPath, LLC
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "helper.h"
+
+#include "../../rxtx_error.h"
+#include "../../rxtx_stats.h"
+
+#include <assert.h>
+#include <pthread.h>
+#include <string.h>
+#include <unistd.h>
+
+/*
+ * Per-ring stats have no mutex; the shared rxtx_desc stats every worker
+ * bumps through rxtx_increment_packets_received() do. The shared runs start
+ * every thread at a barrier and report wall clock cost per increment across
+ * all threads, so rising numbers with more threads are contention.
+ */
+
+struct worker {
+  struct rxtx_stats *stats;
+  pthread_barrier_t *barrier;
+  uintmax_t packets;
+};
+
+static void *loop(void *arg) {
+  struct worker *w = arg;
+  uintmax_t i;
+  int status;
+
+  pthread_barrier_wait(w->barrier);
+
+  for (i = 0; i < w->packets; i++) {
+    status = rxtx_stats_increment_packets_received(w->stats, 1);
+    assert(status == 0);
+  }
+
+  return NULL;
+}
+
+static void run(const char *name, int threads, int with_mutex,
+                                                           uintmax_t packets) {
+  struct rxtx_stats stats;
+  struct bench_clock clock;
+  struct worker w;
+  pthread_barrier_t barrier;
+  pthread_t tids[threads];
+  char errbuf[RXTX_ERRBUF_SIZE];
+  int status;
+  int i;
+
+  memset(&stats, 0, sizeof(stats));
+  if (with_mutex) {
+    status = rxtx_stats_init_with_mutex(&stats, errbuf);
+    assert(status == 0);
+  } else {
+    rxtx_stats_init(&stats, errbuf);
+  }
+
+  status = pthread_barrier_init(&barrier, NULL, threads + 1);
+  assert(status == 0);
+
+  w.stats = &stats;
+  w.barrier = &barrier;
+  w.packets = packets;
+
+  for (i = 0; i < threads; i++) {
+    status = pthread_create(&tids[i], NULL, loop, &w);
+    assert(status == 0);
+  }
+
+  pthread_barrier_wait(&barrier);
+  bench_start(&clock);
+
+  for (i = 0; i < threads; i++) {
+    pthread_join(tids[i], NULL);
+  }
+
+  bench_stop(&clock);
+
+  assert(rxtx_stats_get_packets_received(&stats) == packets * threads);
+
+  bench_report(name, threads, packets * threads, &clock);
+
+  pthread_barrier_destroy(&barrier);
+  if (with_mutex) {
+    rxtx_stats_destroy_with_mutex(&stats);
+  } else {
+    rxtx_stats_destroy(&stats);
+  }
+}
+
+int main(int argc, char **argv) {
+  uintmax_t packets = bench_packets(argc, argv);
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  int threads;
+
+  /*
+   * Always include two threads, so lock handoff shows up even on a single
+   * cpu.
+   */
+  if (cpus < 2) {
+    cpus = 2;
+  }
+
+  run("rxtx_stats_increment/ring", 1, 0, packets);
+
+  for (threads = 1; threads <= cpus; threads *= 2) {
+    run("rxtx_stats_increment/shared", threads, 1, packets);
+  }
+
+  if (threads / 2 != cpus) {
+    run("rxtx_stats_increment/shared", (int)cpus, 1, packets);
+  }
+
+  return 0;
+}
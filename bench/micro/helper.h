@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2019-present StackPath, LLC
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#ifndef _BENCH_MICRO_HELPER_H_
+#define _BENCH_MICRO_HELPER_H_
+
+#include <inttypes.h> // for strtoumax()
+#include <stdint.h>   // for uint64_t, uintmax_t
+#include <stdio.h>    // for fprintf(), printf(), stderr
+#include <stdlib.h>   // for exit()
+#include <time.h>     // for clock_gettime(), CLOCK_MONOTONIC, timespec
+
+#if defined(__x86_64__) || defined(__i386__)
+  #include <x86intrin.h> // for __rdtsc()
+  #define bench_cycles() ((uint64_t)__rdtsc())
+#else
+  #define bench_cycles() ((uint64_t)0)
+#endif
+
+#define BENCH_PACKETS 1000000
+
+struct bench_clock {
+  uint64_t ns;
+  uint64_t cycles;
+};
+
+/* ========================================================================= */
+static inline uint64_t bench_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* ========================================================================= */
+static inline void bench_start(struct bench_clock *p) {
+  p->ns = bench_ns();
+  p->cycles = bench_cycles();
+}
+
+/* ========================================================================= */
+static inline void bench_stop(struct bench_clock *p) {
+  p->cycles = bench_cycles() - p->cycles;
+  p->ns = bench_ns() - p->ns;
+}
+
+/* ========================================================================= */
+static inline uintmax_t bench_packets(int argc, char **argv) {
+  uintmax_t packets = BENCH_PACKETS;
+  char *end = NULL;
+
+  if (argc > 1) {
+    packets = strtoumax(argv[1], &end, 10);
+    if (*end || !packets) {
+      fprintf(stderr, "%s: Invalid packet count '%s'.\n", argv[0], argv[1]);
+      exit(1);
+    }
+  }
+
+  return packets;
+}
+
+/* ========================================================================= */
+static inline void bench_report(const char *name, int threads,
+                              uintmax_t packets, const struct bench_clock *p) {
+  /*
+   * Cycles are tsc ticks, so they only match core cycles when the tsc runs at
+   * the core clock, and are 0 on architectures without a tsc.
+   */
+  printf("%s\t%d\t%ju\t%.1f\t%.1f\n", name, threads, packets,
+                                         (double)p->ns / packets,
+                                         (double)p->cycles / packets);
+}
+
+#endif // _BENCH_MICRO_HELPER_H_
@@ -0,0 +1,28 @@
+/*
+ * Copyright (c) 2019-present StackPath, LLC
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ * vlan.c -- example rxtxebpf fanout program steering by vlan id
+ */
+
+#include <linux/bpf.h> // for __sk_buff
+
+#define SEC(name) __attribute__((section(name), used))
+
+/*
+ * Untagged packets go to ring 0; tagged packets go to ring (vlan id % ring
+ * count), the modulo being applied by the kernel.
+ */
+SEC("socket")
+int fanout_vlan(struct __sk_buff *skb) {
+  if (!skb->vlan_present) {
+    return 0;
+  }
+
+  return skb->vlan_tci & 0x0fff;
+}
+
+char _license[] SEC("license") = "Dual MIT/GPL";
@@ -1,32 +1,5 @@
 #!/bin/bash
 
-each_lpr_port() {
-  first="$1"
-
-  read lpr_start lpr_end < /proc/sys/net/ipv4/ip_local_port_range
-
-  if ((first < lpr_start)) || (( first > lpr_end)); then
-    first="$lpr_start"
-  fi
-
-  lpr_reserved=($(
-    cat /proc/sys/net/ipv4/ip_local_reserved_ports \
-      | expand_klist
-  ))
-
-  {
-    if ((first == lpr_start)); then
-      seq "$lpr_start" "$lpr_end"
-    else
-      seq "$first"     "$lpr_end"
-      seq "$lpr_start" "$((first - 1))"
-    fi
-  } | while read line; do
-        [[ " ${lpr_reserved[@]} " =~ " ${line} " ]] \
-          || echo "$line"
-      done
-}
-
 expand_klist() {
   sed 's/,/\n/g' | while read line; do
     if echo "$line" | grep -Pq '^[0-9]+$'; then
@@ -145,42 +118,26 @@ queue="$(
 
 echo "queue: $queue"
 
-ethtool_x="$(
-  ethtool -x "$interface"
-)"
-
-read lpr_start lpr_end < /proc/sys/net/ipv4/ip_local_port_range
+# One pass over the ephemeral port range (less reserved ports) lists the
+# ports whose replies land on each queue; any port on our queue will do. The
+# nic's rss key and indirection table are read straight from the interface.
+read _ ports < <(
+  ../rss-hash/rss-hash --erqs "$interface" \
+    "$dst_ip" "$dst_port" "$src_ip" \
+    | grep "^queue $queue:"
+)
 
-lpr_cardinality="$((
-  lpr_end + 1 - lpr_start
-))"
+ports=($ports)
 
-random_lpr_port="$((
-  RANDOM % lpr_cardinality + lpr_start
-))"
+echo "queue_ports: ${#ports[@]}"
 
-src_port=0
-for i in `each_lpr_port "$random_lpr_port"`; do
-  rss_sh="$(
-    echo "$ethtool_x" \
-      | ../rss/rss.sh "$dst_ip" "$dst_port" "$src_ip" "$i"
-  )"
-
-  echo "$rss_sh" \
-    | grep -q '^queue: '"$queue"'$' \
-    && {
-         echo "$rss_sh" \
-           | sed 's/^/rss_/;s/  */ /g'
-         src_port="$i"
-         break
-       }
-done
-
-((src_port)) || {
+((${#ports[@]})) || {
   echo >&2 "failed to find suitable src_port"
   exit 1
 }
 
+src_port="${ports[(RANDOM * 32768 + RANDOM) % ${#ports[@]}]}"
+
 echo "src_port: $src_port"
 
 curl --local-port "$src_port" --resolve "$hostname:$dst_port:$dst_ip" "$url"
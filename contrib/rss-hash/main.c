@@ -25,9 +25,34 @@
 #include <arpa/inet.h>
 #include <netdb.h>
 #include <err.h>
+#include <stdint.h>
+#include <time.h>
+#include <errno.h>
+#include <net/if.h>
+#include <linux/ethtool.h>
+
+#include "ethtool.h"
+#include "rxtx_error.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
 
 #define DEFAULT_RSS_KEYSTR "6d:5a:56:da:25:5b:0e:c2:41:67:25:3d:43:a3:8f:b0:d0:ca:2b:cb:ae:7b:30:b4:77:cb:2d:a3:80:30:f2:0c:6a:42:b7:3b:be:ac:01:fa"
 
+/*
+ * The longest input we hash; an ipv6 4-tuple.
+ */
+#define TOEPLITZ_INPUT_MAX 36
+
+struct toeplitz {
+        u_int keylen;
+        const uint8_t *key;
+        uint32_t table[TOEPLITZ_INPUT_MAX][256];
+        uint64_t clmul_key[TOEPLITZ_INPUT_MAX / 4];
+        uint32_t (*hash)(const struct toeplitz *, u_int, const uint8_t *);
+};
+
 int parse_rss_key(char *rss_keystr, uint8_t *rss_key, u_int rss_keysize) {
         char *tofree, *p;
 
@@ -80,11 +105,219 @@ toeplitz_hash(u_int keylen, const uint8_t *key, u_int datalen,
         return (hash);
 }
 
+
+/*
+ * Fast paths. Both fold the input into the hash a byte (table) or a 32 bit
+ * word (clmul) at a time using state derived from the key up front, so the
+ * key is only walked bit by bit once rather than once per flow.
+ */
+
+/*
+ * The 32 key bits starting at bit 'bit'; bits past the end of the key are 0,
+ * as in toeplitz_hash().
+ */
+static uint32_t
+key_window(u_int keylen, const uint8_t *key, u_int bit)
+{
+        uint64_t v = 0;
+        u_int i, byte = bit / 8;
+
+        for (i = 0; i < 5; i++) {
+                v <<= 8;
+                if (byte + i < keylen)
+                        v |= key[byte + i];
+        }
+        return ((uint32_t)(v >> (8 - bit % 8)));
+}
+
+/*
+ * table[i][v] is the hash contribution of byte value v at input offset i, so
+ * a hash is one lookup and xor per input byte.
+ */
+static uint32_t
+toeplitz_hash_table(const struct toeplitz *t, u_int datalen,
+    const uint8_t *data)
+{
+        uint32_t hash = 0;
+        u_int i;
+
+        for (i = 0; i < datalen; i++)
+                hash ^= t->table[i][data[i]];
+        return (hash);
+}
+
+static uint32_t
+bitrev32(uint32_t v)
+{
+        v = ((v >> 1) & 0x55555555) | ((v & 0x55555555) << 1);
+        v = ((v >> 2) & 0x33333333) | ((v & 0x33333333) << 2);
+        v = ((v >> 4) & 0x0f0f0f0f) | ((v & 0x0f0f0f0f) << 4);
+        return (__builtin_bswap32(v));
+}
+
+static uint64_t
+bitrev64(uint64_t v)
+{
+        return (((uint64_t)bitrev32((uint32_t)v) << 32) |
+            bitrev32((uint32_t)(v >> 32)));
+}
+
+#if defined(__x86_64__)
+/*
+ * For the 32 bit input word W at word offset j, and S the 64 key bits
+ * starting at bit 32 * j, the contribution to the hash is the low 32 bits of
+ * the xor of (S >> (w + 1)) over every bit w set in W. Mirroring S turns
+ * those right shifts into left shifts, i.e. a carry-less multiply of the
+ * mirrored S by W, so the contribution of each word is one pclmulqdq; the
+ * products are summed (xor) and mirrored back once at the end.
+ */
+__attribute__((target("pclmul,sse2")))
+static uint32_t
+toeplitz_hash_clmul(const struct toeplitz *t, u_int datalen,
+    const uint8_t *data)
+{
+        __m128i sum = _mm_setzero_si128();
+        uint8_t buf[TOEPLITZ_INPUT_MAX];
+        uint32_t w;
+        u_int i;
+
+        if (datalen % 4) {
+                memset(buf, 0, sizeof(buf));
+                memcpy(buf, data, datalen);
+                data = buf;
+        }
+
+        for (i = 0; i < datalen; i += 4) {
+                w = ((uint32_t)data[i] << 24) | (data[i+1] << 16) |
+                    (data[i+2] << 8) | data[i+3];
+                sum = _mm_xor_si128(sum, _mm_clmulepi64_si128(
+                    _mm_cvtsi64_si128((long long)t->clmul_key[i / 4]),
+                    _mm_cvtsi64_si128(w), 0));
+        }
+
+        return (bitrev32((uint32_t)(((uint64_t)_mm_cvtsi128_si64(sum) << 1)
+            >> 32)));
+}
+#endif
+
+/*
+ * Precompute the table and clmul state for a key and pick the fastest
+ * implementation the cpu supports.
+ */
+void
+toeplitz_init(struct toeplitz *t, u_int keylen, const uint8_t *key)
+{
+        uint32_t w[8];
+        u_int i, b, v;
+
+        t->keylen = keylen;
+        t->key = key;
+
+        for (i = 0; i < TOEPLITZ_INPUT_MAX; i++) {
+                for (b = 0; b < 8; b++)
+                        w[b] = key_window(keylen, key, i * 8 + b);
+                t->table[i][0] = 0;
+                for (v = 1; v < 256; v++)
+                        t->table[i][v] = t->table[i][v & (v - 1)] ^
+                            w[7 - __builtin_ctz(v)];
+        }
+
+        for (i = 0; i < TOEPLITZ_INPUT_MAX / 4; i++)
+                t->clmul_key[i] = bitrev64(
+                    ((uint64_t)key_window(keylen, key, i * 32) << 32) |
+                    key_window(keylen, key, i * 32 + 32));
+
+        t->hash = toeplitz_hash_table;
+#if defined(__x86_64__)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("pclmul"))
+                t->hash = toeplitz_hash_clmul;
+#endif
+}
+
+static uint32_t
+toeplitz_hash_reference(const struct toeplitz *t, u_int datalen,
+    const uint8_t *data)
+{
+        return (toeplitz_hash(t->keylen, t->key, datalen, data));
+}
+
+/*
+ * Hash 'count' random ipv4 and ipv6 sized inputs with every implementation
+ * and compare them to the bitwise reference, reporting the cost of each.
+ */
+int
+toeplitz_check(const struct toeplitz *t, u_long count)
+{
+        static const struct {
+                const char *name;
+                uint32_t (*hash)(const struct toeplitz *, u_int,
+                    const uint8_t *);
+        } impls[] = {
+                { "reference", toeplitz_hash_reference },
+                { "table", toeplitz_hash_table },
+#if defined(__x86_64__)
+                { "clmul", toeplitz_hash_clmul },
+#endif
+        };
+        static const u_int lens[] = { 12, 36 };
+        uint8_t *data;
+        uint32_t *want, got, sum;
+        struct timespec start, end;
+        u_long i;
+        u_int j, l;
+        double ns;
+        int failures = 0;
+
+        data = malloc(count * TOEPLITZ_INPUT_MAX);
+        want = malloc(count * sizeof(*want));
+        if (data == NULL || want == NULL)
+                err(1, "malloc");
+
+        srandom(1);
+        for (i = 0; i < count * TOEPLITZ_INPUT_MAX; i++)
+                data[i] = random();
+
+        for (l = 0; l < sizeof(lens) / sizeof(lens[0]); l++) {
+                for (j = 0; j < sizeof(impls) / sizeof(impls[0]); j++) {
+#if defined(__x86_64__)
+                        if (impls[j].hash == toeplitz_hash_clmul &&
+                            !__builtin_cpu_supports("pclmul"))
+                                continue;
+#endif
+                        sum = 0;
+                        clock_gettime(CLOCK_MONOTONIC, &start);
+                        for (i = 0; i < count; i++) {
+                                got = impls[j].hash(t, lens[l],
+                                    &data[i * TOEPLITZ_INPUT_MAX]);
+                                if (j == 0)
+                                        want[i] = got;
+                                else if (got != want[i] && !failures++)
+                                        fprintf(stderr, "%s: %u byte input"
+                                            " %lu hashed to %08x, expected"
+                                            " %08x\n", impls[j].name,
+                                            lens[l], i, got, want[i]);
+                                sum ^= got;
+                        }
+                        clock_gettime(CLOCK_MONOTONIC, &end);
+                        ns = (end.tv_sec - start.tv_sec) * 1e9 +
+                            (end.tv_nsec - start.tv_nsec);
+                        printf("%-9s %2u bytes: %lu hashes, %.1f ns/hash"
+                            " (%08x)\n", impls[j].name, lens[l], count,
+                            ns / count, sum);
+                }
+        }
+
+        free(data);
+        free(want);
+        return (failures);
+}
+
 /*
  * Hash an IPv4 4-tuple.
  */
 uint32_t
-rss_hash_ip4_4tuple(uint8_t *rss_key, u_int rss_keysize, struct in_addr src, u_short srcport, struct in_addr dst,
+rss_hash_ip4_4tuple(const struct toeplitz *t, struct in_addr src, u_short srcport, struct in_addr dst,
     u_short dstport)
 {
         uint8_t data[sizeof(src) + sizeof(dst) + sizeof(srcport) +
@@ -100,14 +333,14 @@ rss_hash_ip4_4tuple(uint8_t *rss_key, u_int rss_keysize, struct in_addr src, u_s
         datalen += sizeof(srcport);
         bcopy(&dstport, &data[datalen], sizeof(dstport));
         datalen += sizeof(dstport);
-        return (toeplitz_hash(rss_keysize, rss_key, datalen, data));
+        return (t->hash(t, datalen, data));
 }
 
 /*
  * Hash an IPv6 4-tuple.
  */
 uint32_t
-rss_hash_ip6_4tuple(uint8_t *rss_key, u_int rss_keysize, struct in6_addr src, u_short srcport,
+rss_hash_ip6_4tuple(const struct toeplitz *t, struct in6_addr src, u_short srcport,
     struct in6_addr dst, u_short dstport)
 {
         uint8_t data[sizeof(src) + sizeof(dst) + sizeof(srcport) +
@@ -123,11 +356,596 @@ rss_hash_ip6_4tuple(uint8_t *rss_key, u_int rss_keysize, struct in6_addr src, u_
         datalen += sizeof(srcport);
         bcopy(&dstport, &data[datalen], sizeof(dstport));
         datalen += sizeof(dstport);
-        return (toeplitz_hash(rss_keysize, rss_key, datalen, data));
+        return (t->hash(t, datalen, data));
 }
 
-int
-main(int argc, char *argv[])
+/*
+ * Batch prediction. Packets from a pcap file (or flows from stdin) are
+ * hashed and counted against the indirection table entry, and so the queue,
+ * the nic would have picked.
+ */
+
+#define INDIR_DEFAULT_SIZE 128
+#define INDIR_MAX 65536
+
+#define PCAP_MAGIC 0xa1b2c3d4
+#define PCAP_MAGIC_NS 0xa1b23c4d
+
+#define LINKTYPE_ETHERNET 1
+#define LINKTYPE_RAW 101
+#define LINKTYPE_LINUX_SLL 113
+
+#define SNAPLEN_MAX 262144
+
+struct prediction {
+        const struct toeplitz *t;
+        uint32_t indir[INDIR_MAX];
+        u_int indir_size;
+        u_int queue_count;
+        uint64_t queue_packets[INDIR_MAX];
+        uint64_t packets;
+        uint64_t unhashed;
+        int udp_2tuple;
+};
+
+static uint16_t
+rd16(const uint8_t *p)
+{
+        return ((p[0] << 8) | p[1]);
+}
+
+/*
+ * Read the indirection table, key and udp hashing straight from a nic, as
+ * 'ethtool -x' and 'ethtool -n <iface> rx-flow-hash udp4' would.
+ */
+static void
+prediction_query(struct prediction *p, const char *ifname, char **keystr)
+{
+        static char key[3 * ETHTOOL_RSS_KEY_MAX];
+        char errbuf[RXTX_ERRBUF_SIZE];
+        struct ethtool_rss rss;
+        uint64_t fields;
+        u_int i;
+
+        if (ethtool_rss_get(&rss, ifname, errbuf) == RXTX_ERROR)
+                errx(1, "%s", errbuf);
+
+        if (rss.indir_size == 0 || rss.indir_size > INDIR_MAX ||
+            (rss.indir_size & (rss.indir_size - 1)))
+                errx(1, "%s: no indirection table with a power of 2 entries"
+                    " reported", ifname);
+
+        p->indir_size = rss.indir_size;
+        p->queue_count = rss.ring_count < INDIR_MAX ? rss.ring_count : 0;
+        for (i = 0; i < rss.indir_size; i++) {
+                if (rss.indir[i] >= INDIR_MAX)
+                        errx(1, "%s: invalid queue %u in indirection table",
+                            ifname, rss.indir[i]);
+                p->indir[i] = rss.indir[i];
+                if (p->indir[i] >= p->queue_count)
+                        p->queue_count = p->indir[i] + 1;
+        }
+
+        if (*keystr == NULL && rss.key_len) {
+                for (i = 0; i < rss.key_len; i++)
+                        sprintf(key + 3 * i, "%02x:", rss.key[i]);
+                key[3 * rss.key_len - 1] = '\0';
+                *keystr = key;
+        }
+
+        /* nics hash udp by its 4-tuple only when both ports are enabled */
+        if (ethtool_rx_flow_hash_get(ifname, UDP_V4_FLOW, &fields,
+            errbuf) == 0 && (fields & (RXH_L4_B_0_1 | RXH_L4_B_2_3)) !=
+            (RXH_L4_B_0_1 | RXH_L4_B_2_3))
+                p->udp_2tuple = 1;
+
+        ethtool_rss_destroy(&rss);
+}
+
+/*
+ * Fill in the indirection table either as ethtool's default spread over
+ * 'queues' (given as a number), from saved 'ethtool -x' output, which may
+ * also carry the key, or from the nic of that name.
+ */
+static void
+prediction_init(struct prediction *p, const char *queues, char **keystr)
+{
+        static char key[3 * 256];
+        char line[1024], *s, *end;
+        u_long v;
+        u_int i;
+        FILE *f;
+
+        memset(p, 0, sizeof(*p));
+
+        v = strtoul(queues, &end, 10);
+        if (*queues && !*end) {
+                if (v == 0 || v > INDIR_DEFAULT_SIZE)
+                        errx(1, "invalid queue count '%s'", queues);
+                p->indir_size = INDIR_DEFAULT_SIZE;
+                for (i = 0; i < p->indir_size; i++)
+                        p->indir[i] = i % v;
+                p->queue_count = v;
+                return;
+        }
+
+        f = fopen(queues, "r");
+        if (f == NULL && errno == ENOENT && if_nametoindex(queues) != 0) {
+                prediction_query(p, queues, keystr);
+                return;
+        }
+        if (f == NULL)
+                err(1, "%s", queues);
+
+        while (fgets(line, sizeof(line), f)) {
+                if (strncmp(line, "RSS hash key:", 13) == 0) {
+                        if (fgets(line, sizeof(line), f) &&
+                            strlen(line) < sizeof(key)) {
+                                strcpy(key, line);
+                                key[strcspn(key, " \n")] = '\0';
+                                if (*keystr == NULL && key[0])
+                                        *keystr = key;
+                        }
+                        continue;
+                }
+
+                /* "    8:      0     1     2     3 ..." */
+                s = line + strspn(line, " ");
+                v = strtoul(s, &end, 10);
+                if (end == s || *end != ':' || v != p->indir_size)
+                        continue;
+                for (s = end + 1;; s = end) {
+                        v = strtoul(s, &end, 10);
+                        if (end == s)
+                                break;
+                        if (p->indir_size == INDIR_MAX)
+                                errx(1, "%s: indirection table too big",
+                                    queues);
+                        if (v >= INDIR_MAX)
+                                errx(1, "%s: invalid queue %lu in"
+                                    " indirection table", queues, v);
+                        p->indir[p->indir_size++] = v;
+                        if (v >= p->queue_count)
+                                p->queue_count = v + 1;
+                }
+        }
+        fclose(f);
+
+        if (p->indir_size == 0 || (p->indir_size & (p->indir_size - 1)))
+                errx(1, "%s: no indirection table with a power of 2 entries"
+                    " found", queues);
+}
+
+static void
+predict(struct prediction *p, const uint8_t *data, u_int len)
+{
+        uint32_t hash = p->t->hash(p->t, len, data);
+
+        p->queue_packets[p->indir[hash & (p->indir_size - 1)]]++;
+        p->packets++;
+}
+
+/*
+ * Hash an ip packet the way nics do by default; the 4-tuple for tcp and udp,
+ * addresses only for anything else (including fragments). Fields are copied
+ * in the order they're hashed, which for ipv4 and ipv6 is the order they
+ * appear in the headers. Anything we can't hash lands on the queue of the
+ * first indirection table entry, as with a hash of 0.
+ */
+static void
+predict_ip(struct prediction *p, const uint8_t *pkt, u_int len)
+{
+        uint8_t data[TOEPLITZ_INPUT_MAX];
+        u_int hlen, alen, proto, off;
+        int frag = 0;
+
+        if (len < 1)
+                goto unhashed;
+
+        if ((pkt[0] >> 4) == 4) {
+                hlen = (pkt[0] & 0xf) * 4;
+                if (len < 20 || hlen < 20)
+                        goto unhashed;
+                proto = pkt[9];
+                frag = (rd16(pkt + 6) & 0x3fff) != 0;
+                alen = 4;
+                memcpy(data, pkt + 12, 8);
+        } else if ((pkt[0] >> 4) == 6) {
+                if (len < 40)
+                        goto unhashed;
+                proto = pkt[6];
+                hlen = 40;
+                alen = 16;
+                memcpy(data, pkt + 8, 32);
+                /* skip hop-by-hop, routing and destination options */
+                while ((proto == 0 || proto == 43 || proto == 60) &&
+                    len >= hlen + 8) {
+                        proto = pkt[hlen];
+                        hlen += (pkt[hlen + 1] + 1) * 8;
+                }
+                if (proto == 44)
+                        frag = 1;
+        } else {
+                goto unhashed;
+        }
+
+        off = 2 * alen;
+        if (!frag && (proto == IPPROTO_TCP ||
+            (proto == IPPROTO_UDP && !p->udp_2tuple)) && len >= hlen + 4) {
+                memcpy(data + off, pkt + hlen, 4);
+                off += 4;
+        }
+
+        predict(p, data, off);
+        return;
+
+unhashed:
+        p->unhashed++;
+        p->queue_packets[p->indir[0]]++;
+        p->packets++;
+}
+
+static void
+predict_frame(struct prediction *p, u_int linktype, const uint8_t *pkt,
+    u_int len)
+{
+        u_int off, type;
+
+        switch (linktype) {
+        case LINKTYPE_RAW:
+                predict_ip(p, pkt, len);
+                return;
+        case LINKTYPE_LINUX_SLL:
+                off = 16;
+                break;
+        default:
+                off = 14;
+                break;
+        }
+
+        if (len < off) {
+                predict_ip(p, pkt, 0);
+                return;
+        }
+        type = rd16(pkt + off - 2);
+
+        /* 802.1q and 802.1ad tags */
+        while ((type == 0x8100 || type == 0x88a8) && len >= off + 4) {
+                type = rd16(pkt + off + 2);
+                off += 4;
+        }
+
+        if (type == 0x0800 || type == 0x86dd)
+                predict_ip(p, pkt + off, len - off);
+        else
+                predict_ip(p, pkt, 0);
+}
+
+static void
+predict_pcap(struct prediction *p, const char *prog, FILE *f, uint32_t magic)
+{
+        static uint8_t pkt[SNAPLEN_MAX];
+        uint8_t hdr[20], rec[16];
+        uint32_t caplen, linktype;
+        int swap;
+
+        swap = magic != PCAP_MAGIC && magic != PCAP_MAGIC_NS;
+
+#define rd32(b) (swap ? __builtin_bswap32(*(const uint32_t *)(b)) : \
+    *(const uint32_t *)(b))
+
+        /* the rest of the global header, after the magic */
+        if (fread(hdr, sizeof(hdr), 1, f) != 1)
+                errx(1, "truncated pcap header");
+        linktype = rd32(hdr + 16) & 0xffff;
+        if (linktype != LINKTYPE_ETHERNET && linktype != LINKTYPE_RAW &&
+            linktype != LINKTYPE_LINUX_SLL)
+                errx(1, "unsupported pcap link type %u", linktype);
+
+        while (fread(rec, sizeof(rec), 1, f) == 1) {
+                caplen = rd32(rec + 8);
+                if (caplen > sizeof(pkt))
+                        errx(1, "pcap record of %u bytes is too big", caplen);
+                if (fread(pkt, 1, caplen, f) != caplen) {
+                        fprintf(stderr, "%s: truncated pcap record\n", prog);
+                        break;
+                }
+                predict_frame(p, linktype, pkt, caplen);
+        }
+
+#undef rd32
+}
+
+/*
+ * Lines of "src-ip src-port dst-ip dst-port", as printed by flow-gen -v.
+ */
+static void
+predict_flows(struct prediction *p, FILE *f)
+{
+        uint8_t data[TOEPLITZ_INPUT_MAX];
+        char line[256], *sip, *sport, *dip, *dport;
+        uint16_t port;
+        u_int alen;
+
+        while (fgets(line, sizeof(line), f)) {
+                sip = strtok(line, " \t\n");
+                sport = strtok(NULL, " \t\n");
+                dip = strtok(NULL, " \t\n");
+                dport = strtok(NULL, " \t\n");
+                if (dport == NULL)
+                        errx(1, "expected 4 fields per line");
+
+                if (inet_pton(AF_INET, sip, data) == 1 &&
+                    inet_pton(AF_INET, dip, data + 4) == 1) {
+                        alen = 4;
+                } else if (inet_pton(AF_INET6, sip, data) == 1 &&
+                    inet_pton(AF_INET6, dip, data + 16) == 1) {
+                        alen = 16;
+                } else {
+                        errx(1, "invalid flow '%s %s %s %s'", sip, sport,
+                            dip, dport);
+                }
+
+                port = htons(atoi(sport));
+                memcpy(data + 2 * alen, &port, 2);
+                port = htons(atoi(dport));
+                memcpy(data + 2 * alen + 2, &port, 2);
+
+                predict(p, data, 2 * alen + 4);
+        }
+}
+
+/*
+ * rss-hash --count <queues|ethtool-x-file|iface> <pcap-file|-> [rss-key]
+ */
+static int
+count_main(const char *prog, char *queues, char *input, char *keystr)
+{
+        static struct prediction p;
+        static struct toeplitz t;
+        static char buf[1 << 20];
+        struct timespec start, end;
+        uint32_t magic;
+        double secs;
+        u_int q;
+        FILE *f;
+        int c;
+
+        prediction_init(&p, queues, &keystr);
+
+        if (!keystr) {
+                keystr = DEFAULT_RSS_KEYSTR;
+        }
+        u_int rss_keysize = (strlen(keystr) + 1) / 3;
+        uint8_t rss_key[rss_keysize];
+
+        if (parse_rss_key(keystr, rss_key, rss_keysize) < 0) {
+                fprintf(stderr, "%s: failed to parse rss key!\n", prog);
+                exit(1);
+        }
+
+        toeplitz_init(&t, rss_keysize, rss_key);
+        p.t = &t;
+
+        if (strcmp(input, "-") == 0) {
+                f = stdin;
+        } else if ((f = fopen(input, "r")) == NULL) {
+                err(1, "%s", input);
+        }
+        setvbuf(f, buf, _IOFBF, sizeof(buf));
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+
+        /*
+         * A pcap starts with its magic, whose first byte (in either byte
+         * order) can't start a flow line; peek at it so stdin works too.
+         */
+        c = getc(f);
+        if (c != EOF)
+                ungetc(c, f);
+        if (c == 0xa1 || c == 0xd4 || c == 0x4d) {
+                if (fread(&magic, sizeof(magic), 1, f) != 1 ||
+                    (magic != PCAP_MAGIC && magic != PCAP_MAGIC_NS &&
+                    magic != __builtin_bswap32(PCAP_MAGIC) &&
+                    magic != __builtin_bswap32(PCAP_MAGIC_NS)))
+                        errx(1, "%s: not a pcap file (pcapng isn't"
+                            " supported)", input);
+                predict_pcap(&p, prog, f, magic);
+        } else {
+                predict_flows(&p, f);
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        if (f != stdin)
+                fclose(f);
+
+        for (q = 0; q < p.queue_count; q++)
+                printf("%ju packets predicted on queue %u.\n",
+                    (uintmax_t)p.queue_packets[q], q);
+        printf("%ju packets predicted total (%ju not hashed).\n",
+            (uintmax_t)p.packets, (uintmax_t)p.unhashed);
+
+        secs = (end.tv_sec - start.tv_sec) +
+            (end.tv_nsec - start.tv_nsec) / 1e9;
+        fprintf(stderr, "%s: %ju packets in %.3f seconds (%.0f pps)\n", prog,
+            (uintmax_t)p.packets, secs, secs > 0 ? p.packets / secs : 0);
+
+        return (0);
+}
+
+/*
+ * Ephemeral port receive queue steering (erqs). For replies from a remote
+ * address and port to a local address, find which rx queue each local port
+ * steers to.
+ */
+
+#define PORT_RANGE_PATH "/proc/sys/net/ipv4/ip_local_port_range"
+#define PORT_RESERVED_PATH "/proc/sys/net/ipv4/ip_local_reserved_ports"
+
+/*
+ * Linux's own default, should the range not be readable.
+ */
+#define PORT_RANGE_DEFAULT_FIRST 32768
+#define PORT_RANGE_DEFAULT_LAST 60999
+
+/*
+ * Take the ephemeral port range from the kernel, less any reserved ports
+ * (e.g. "8080,9000-9010"), unless a "first-last" range was given.
+ */
+static void
+erqs_ports(const char *range, uint8_t *usable)
+{
+        char line[4096], *s, *end;
+        u_long first, last, p;
+        FILE *f;
+
+        first = PORT_RANGE_DEFAULT_FIRST;
+        last = PORT_RANGE_DEFAULT_LAST;
+
+        if (range) {
+                first = strtoul(range, &end, 10);
+                last = *end == '-' ? strtoul(end + 1, &end, 10) : first;
+                if (*end || end == range || first > last || last > 65535)
+                        errx(1, "invalid port range '%s'", range);
+        } else if ((f = fopen(PORT_RANGE_PATH, "r")) != NULL) {
+                if (fscanf(f, "%lu %lu", &first, &last) != 2 ||
+                    first > last || last > 65535)
+                        errx(1, "%s: invalid port range", PORT_RANGE_PATH);
+                fclose(f);
+        }
+
+        for (p = first; p <= last; p++)
+                usable[p] = 1;
+
+        if (range || (f = fopen(PORT_RESERVED_PATH, "r")) == NULL)
+                return;
+
+        if (fgets(line, sizeof(line), f)) {
+                for (s = line; *s && *s != '\n'; s = end + (*end == ',')) {
+                        first = strtoul(s, &end, 10);
+                        last = *end == '-' ? strtoul(end + 1, &end, 10) :
+                            first;
+                        if (end == s || (*end && *end != ',' && *end != '\n'))
+                                break;
+                        for (p = first; p <= last && p <= 65535; p++)
+                                usable[p] = 0;
+                }
+        }
+        fclose(f);
+}
+
+/*
+ * rss-hash --erqs <queues|ethtool-x-file|iface> <remote-ip> <remote-port>
+ *     <local-ip> [first-last] [rss-key]
+ *
+ * Prints one "queue N: port port ..." line per queue, listing the local
+ * ports whose replies land there, so picking a port for a queue is a random
+ * index into its line.
+ */
+static int
+erqs_main(char **argv, int argc)
+{
+        static struct prediction p;
+        static struct toeplitz t;
+        static uint8_t usable[65536];
+        static uint16_t ports[65536];
+        static uint32_t start[INDIR_MAX + 1];
+        static uint32_t queue_of[65536];
+        uint8_t data[TOEPLITZ_INPUT_MAX];
+        uint32_t base, hash;
+        u_int alen, off, port, q, i;
+        u_long remote_port;
+        char *range, *keystr, *end;
+
+        range = NULL;
+        keystr = NULL;
+        for (i = 6; i < (u_int)argc; i++) {
+                if (strchr(argv[i], ':'))
+                        keystr = argv[i];
+                else
+                        range = argv[i];
+        }
+
+        prediction_init(&p, argv[2], &keystr);
+
+        if (!keystr) {
+                keystr = DEFAULT_RSS_KEYSTR;
+        }
+        u_int rss_keysize = (strlen(keystr) + 1) / 3;
+        uint8_t rss_key[rss_keysize];
+
+        if (parse_rss_key(keystr, rss_key, rss_keysize) < 0) {
+                fprintf(stderr, "%s: failed to parse rss key!\n", argv[0]);
+                exit(1);
+        }
+
+        toeplitz_init(&t, rss_keysize, rss_key);
+
+        /*
+         * Replies are hashed as received; remote address, local address,
+         * remote port, local port.
+         */
+        memset(data, 0, sizeof(data));
+        if (inet_pton(AF_INET, argv[3], data) == 1 &&
+            inet_pton(AF_INET, argv[5], data + 4) == 1) {
+                alen = 4;
+        } else if (inet_pton(AF_INET6, argv[3], data) == 1 &&
+            inet_pton(AF_INET6, argv[5], data + 16) == 1) {
+                alen = 16;
+        } else {
+                errx(1, "invalid address pair '%s' and '%s'", argv[3],
+                    argv[5]);
+        }
+
+        remote_port = strtoul(argv[4], &end, 10);
+        if (*end || end == argv[4] || remote_port > 65535)
+                errx(1, "invalid port '%s'", argv[4]);
+        off = 2 * alen;
+        data[off] = remote_port >> 8;
+        data[off + 1] = remote_port & 0xff;
+
+        erqs_ports(range, usable);
+
+        /*
+         * Toeplitz is linear over xor, so with the local port zeroed the
+         * rest of the tuple hashes once, and each port only adds the table
+         * entries of its two bytes.
+         */
+        base = t.hash(&t, off + 4, data);
+
+        for (port = 0; port < 65536; port++) {
+                if (!usable[port])
+                        continue;
+                hash = base ^ t.table[off + 2][port >> 8] ^
+                    t.table[off + 3][port & 0xff];
+                queue_of[port] = p.indir[hash & (p.indir_size - 1)];
+                start[queue_of[port] + 1]++;
+        }
+
+        for (q = 0; q < p.queue_count; q++)
+                start[q + 1] += start[q];
+
+        for (port = 0; port < 65536; port++)
+                if (usable[port])
+                        ports[start[queue_of[port]]++] = port;
+
+        for (q = 0, i = 0; q < p.queue_count; q++) {
+                printf("queue %u:", q);
+                for (; i < start[q]; i++)
+                        printf(" %u", ports[i]);
+                putchar('\n');
+        }
+
+        return (0);
+}
+
+/*
+ * Parse and hash one flow (src-ip, src-port, dst-ip, dst-port) and print the
+ * hash.
+ */
+static void
+hash_flow(const char *prog, const struct toeplitz *t, char **flow)
 {
         struct in_addr src, dst;
         struct in6_addr src6, dst6;
@@ -144,13 +962,13 @@ main(int argc, char *argv[])
         a.ai_flags = AI_NUMERICHOST;
         a.ai_family = AF_UNSPEC;
 
-        r = getaddrinfo(argv[1], NULL, &a, &ai);
+        r = getaddrinfo(flow[0], NULL, &a, &ai);
         if (r < 0) {
-                err(1, "%s: getaddrinfo(src)", argv[0]);
+                err(1, "%s: getaddrinfo(src)", prog);
         }
 
         if (ai == NULL) {
-                fprintf(stderr, "%s: src (%s) couldn't be decoded!\n", argv[0], argv[1]);
+                fprintf(stderr, "%s: src (%s) couldn't be decoded!\n", prog, flow[0]);
                 exit(1);
         }
 
@@ -162,40 +980,96 @@ main(int argc, char *argv[])
                 af_family = AF_INET6;
                 src6 = ((struct sockaddr_in6 *) ai->ai_addr)->sin6_addr;
         } else {
-                fprintf(stderr, "%s: src (%s) isn't ipv4 or ipv6!\n", argv[0], argv[1]);
+                fprintf(stderr, "%s: src (%s) isn't ipv4 or ipv6!\n", prog, flow[0]);
         }
+        freeaddrinfo(ai);
 
-        srcport = htons(atoi(argv[2]));
+        srcport = htons(atoi(flow[1]));
 
-        r = getaddrinfo(argv[3], NULL, &a, &ai);
+        r = getaddrinfo(flow[2], NULL, &a, &ai);
         if (r < 0) {
-                err(1, "%s: getaddrinfo(dst)", argv[0]);
+                err(1, "%s: getaddrinfo(dst)", prog);
         }
 
         if (ai == NULL) {
-                fprintf(stderr, "%s: dst (%s) couldn't be decoded!\n", argv[0], argv[3]);
+                fprintf(stderr, "%s: dst (%s) couldn't be decoded!\n", prog, flow[2]);
                 exit(1);
         }
 
         if (ai->ai_family == AF_INET) {
                 if (af_family != AF_INET) {
-                        fprintf(stderr, "%s: ipv6 src (%s) and ipv4 dst (%s) is not a valid flow!\n", argv[0], argv[1], argv[3]);
+                        fprintf(stderr, "%s: ipv6 src (%s) and ipv4 dst (%s) is not a valid flow!\n", prog, flow[0], flow[2]);
                         exit(1);
                 }
                 dst = ((struct sockaddr_in *) ai->ai_addr)->sin_addr;
         } else if (ai->ai_family == AF_INET6) {
                 if (af_family != AF_INET6) {
-                        fprintf(stderr, "%s: ipv4 src (%s) and ipv6 dst (%s) is not a valid flow!\n", argv[0], argv[1], argv[3]);
+                        fprintf(stderr, "%s: ipv4 src (%s) and ipv6 dst (%s) is not a valid flow!\n", prog, flow[0], flow[2]);
                         exit(1);
                 }
                 dst6 = ((struct sockaddr_in6 *) ai->ai_addr)->sin6_addr;
         } else {
-                fprintf(stderr, "%s: dst (%s) isn't ipv4 or ipv6!\n", argv[0], argv[3]);
+                fprintf(stderr, "%s: dst (%s) isn't ipv4 or ipv6!\n", prog, flow[2]);
         }
+        freeaddrinfo(ai);
+
+        dstport = htons(atoi(flow[3]));
 
-        dstport = htons(atoi(argv[4]));
+        if (af_family == AF_INET) {
+                printf("%08x\n",
+                    rss_hash_ip4_4tuple(t, src, srcport, dst, dstport));
+        } else if (af_family == AF_INET6) {
+                printf("%08x\n",
+                    rss_hash_ip6_4tuple(t, src6, srcport, dst6, dstport));
+        }
+}
+
+int
+main(int argc, char *argv[])
+{
+        static struct toeplitz t;
+        char *rss_keystr;
+        char line[256], *flow[4];
+        u_long count = 1000000;
+        int check = 0, batch = 0, i;
+
+        /*
+         * rss-hash --check [count] [rss-key] compares the fast hashes against
+         * the bitwise reference; rss-hash - [rss-key] hashes one
+         * "src-ip src-port dst-ip dst-port" flow per line of stdin;
+         * rss-hash --count predicts per-queue packet counts for a pcap file or
+         * flow list; rss-hash --erqs lists the local ports steered to each
+         * queue.
+         */
+        if (argc > 3 && strcmp(argv[1], "--count") == 0) {
+                exit(count_main(argv[0], argv[2], argv[3], argv[4]));
+        }
+
+        if (argc > 5 && strcmp(argv[1], "--erqs") == 0) {
+                exit(erqs_main(argv, argc));
+        }
+
+        if (argc > 1 && strcmp(argv[1], "--check") == 0) {
+                check = 1;
+                if (argc > 2)
+                        count = strtoul(argv[2], NULL, 10);
+                rss_keystr = argc > 3 ? argv[3] : NULL;
+        } else if (argc > 1 && strcmp(argv[1], "-") == 0) {
+                batch = 1;
+                rss_keystr = argv[2];
+        } else {
+                if (argc < 5) {
+                        fprintf(stderr, "usage: %s <src-ip> <src-port> <dst-ip> <dst-port> [rss-key]\n"
+                            "       %s - [rss-key]\n"
+                            "       %s --check [count] [rss-key]\n"
+                            "       %s --count <queues|ethtool-x-file|iface> <pcap-file|-> [rss-key]\n"
+                            "       %s --erqs <queues|ethtool-x-file|iface> <remote-ip> <remote-port> <local-ip> [first-last] [rss-key]\n",
+                            argv[0], argv[0], argv[0], argv[0], argv[0]);
+                        exit(1);
+                }
+                rss_keystr = argv[5];
+        }
 
-        char *rss_keystr = argv[5];
         if (!rss_keystr) {
                 rss_keystr = DEFAULT_RSS_KEYSTR;
         }
@@ -207,12 +1081,26 @@ main(int argc, char *argv[])
                 exit(1);
         }
 
-        if (af_family == AF_INET) {
-                printf("%08x\n",
-                    rss_hash_ip4_4tuple(rss_key, rss_keysize, src, srcport, dst, dstport));
-        } else if (af_family == AF_INET6) {
-                printf("%08x\n",
-                    rss_hash_ip6_4tuple(rss_key, rss_keysize, src6, srcport, dst6, dstport));
+        toeplitz_init(&t, rss_keysize, rss_key);
+
+        if (check) {
+                exit(toeplitz_check(&t, count) ? 1 : 0);
+        }
+
+        if (!batch) {
+                hash_flow(argv[0], &t, &argv[1]);
+                exit(0);
+        }
+
+        while (fgets(line, sizeof(line), stdin)) {
+                flow[0] = strtok(line, " \t\n");
+                for (i = 1; i < 4 && flow[i - 1]; i++)
+                        flow[i] = strtok(NULL, " \t\n");
+                if (i < 4 || !flow[3]) {
+                        fprintf(stderr, "%s: expected 4 fields per line!\n", argv[0]);
+                        exit(1);
+                }
+                hash_flow(argv[0], &t, flow);
         }
 
         exit(0);
@@ -8,8 +8,10 @@
 key="6d:5a:56:da:25:5b:0e:c2:41:67:25:3d:43:a3:8f:b0:d0:ca:2b:cb:ae:7b:30:b4:77:cb:2d:a3:80:30:f2:0c:6a:42:b7:3b:be:ac:01:fa"
 
 failures=0
+flows=""
 
 _test() {
+  flows+="$1 $2 $3 $4"$'\n'
   stdout="$(
     ./rss-hash "$1" "$2" "$3" "$4" "$key"
   )"
@@ -41,4 +43,55 @@ _test 3ffe:501:8::260:97ff:fe40:efab      14230 ff02::1                   4739 0
 _test 3ffe:1900:4545:3:200:f8ff:fe21:67cf     0 fe80::200:f8ff:fe21:67cf     0 0x4b61e985
 _test 3ffe:1900:4545:3:200:f8ff:fe21:67cf 44251 fe80::200:f8ff:fe21:67cf 38024 0x02d1feef
 
+# With 4 queues spread over the default 128 entry indirection table, each
+# flow above lands on the queue given by the low 2 bits of its hash.
+stdout="$(
+  echo -n "$flows" | ./rss-hash --count 4 - "$key" 2>/dev/null
+)"
+expected="2 packets predicted on queue 0.
+4 packets predicted on queue 1.
+7 packets predicted on queue 2.
+3 packets predicted on queue 3.
+16 packets predicted total (0 not hashed)."
+if [[ "$stdout" == "$expected" ]]; then
+  echo "success: --count"
+else
+  ((failures++))
+  echo " failure: --count"
+  echo "expected: $expected"
+  echo "     got: $stdout"
+fi
+
+# Each port --erqs lists for a queue must be predicted on that queue when its
+# reply is hashed on its own.
+stdout="$(
+  ./rss-hash --erqs 4 66.9.149.187 2794 161.142.100.80 1024-2047 "$key" \
+    | while read _ queue ports; do
+        for port in $ports; do
+          echo "66.9.149.187 2794 161.142.100.80 $port"
+        done | ./rss-hash --count 4 - "$key" 2>/dev/null \
+             | grep "queue ${queue%:}\."
+      done
+)"
+expected="256 packets predicted on queue 0.
+256 packets predicted on queue 1.
+256 packets predicted on queue 2.
+256 packets predicted on queue 3."
+if [[ "$stdout" == "$expected" ]]; then
+  echo "success: --erqs"
+else
+  ((failures++))
+  echo " failure: --erqs"
+  echo "expected: $expected"
+  echo "     got: $stdout"
+fi
+
+# The table and clmul hashes must agree with the bitwise reference.
+if ./rss-hash --check 100000 "$key"; then
+  echo "success: --check"
+else
+  ((failures++))
+  echo " failure: --check"
+fi
+
 exit $failures
@@ -12,8 +12,9 @@
 
 #include "cpu.h"
 
-#include <sched.h>  // for CPU_SET(), CPU_ZERO()
-#include <stdio.h>  // for fclose(), feof(), fgets(), FILE, fopen()
+#include "ring_set.h" // for RING_SET(), ring_set_t, RING_ZERO()
+
+#include <stdio.h>  // for asprintf(), fclose(), FILE, fopen(), getline()
 #include <stdlib.h> // for free(), strtol()
 #include <string.h> // for strcspn(), strdup(), strlen(), strsep()
 
@@ -22,68 +23,51 @@
 
 #define CPU_LIST_BASE 10
 
-/*
- * The linux kernel currently supports up to 4096 cpus which will be indexed
- * from 0 to 4095. `/sys/devices/system/cpu/online` contains a cpu list of all
- * online cpus.
- *
- * Groups of 3 or more contiguous cpus will shorten the cpu list string length
- * versus the real maximum due to the efficiency of the range format. To find
- * the real maximum we need 1 out of every 3 cpus offline and no contiguous
- * groups of 3 or more cpus.
- *
- * There are 3 possible cpu lists meeting this criteria; we need to find the
- * length of the longest among them.
- *
- *   1-2,4-5,...,4090-4091,4093-4094
- *   0-1,3-4,...,4089-4090,4092-4093,4095
- *   0,2-3,5-6,...,4091-4092,4094-4095
- *
- * The following bash script produces the string length of each. The dot
- * represents a comma or a dash. The trailing dot could easily represent the
- * newline character as well, but I decided to replace it for clarity.
- *
- *   for offset in {0..2}; do
- *     for i in {0..4095}; do
- *       [[ $(((i+offset)%3)) -eq 0 ]] || echo -n "$i."
- *     done | sed 's/.$/\n/' | wc -c
- *   done
- *
- * This script produces the following output.
- *
- *   12912
- *   12914
- *   12914
- *
- * Add room for a null byte and we've got our maximum.
- */
-#define MAX_ONLINE_CPU_LIST_LENGTH 12915 // 12914 + '\0'
-
 /* ========================================================================= */
-int get_online_cpu_set(cpu_set_t *cpu_set) {
-  CPU_ZERO(cpu_set);
+static int read_cpu_list(const char *path, ring_set_t *cpu_set) {
+  RING_ZERO(cpu_set);
+
+  int status = 0;
+
+  /*
+   * The length of a cpu list grows with the number of cpus (and with how
+   * fragmented the list is), so let getline() size the buffer for us rather
+   * than assuming a maximum cpu count.
+   */
+  char *cpu_list = NULL;
+  size_t len = 0;
+
+  FILE *f = fopen(path, "r");
+  if (!f) {
+    return RETURN_BAD;
+  }
 
-  char cpu_list[MAX_ONLINE_CPU_LIST_LENGTH];
-  FILE *f = fopen("/sys/devices/system/cpu/online", "r");
-  if (!f || feof(f) || !fgets(cpu_list, sizeof(cpu_list), f)) {
+  if (getline(&cpu_list, &len, f) == -1) {
+    free(cpu_list);
     fclose(f);
     return RETURN_BAD;
   }
   fclose(f);
 
   cpu_list[strcspn(cpu_list, "\n")] = 0;
-  parse_cpu_list(cpu_list, cpu_set);
+  status = parse_cpu_list(cpu_list, cpu_set);
 
-  return RETURN_GOOD;
+  free(cpu_list);
+
+  return status;
+}
+
+/* ========================================================================= */
+int get_online_cpu_set(ring_set_t *cpu_set) {
+  return read_cpu_list("/sys/devices/system/cpu/online", cpu_set);
 }
 
 /* ========================================================================= */
-int get_numa_cpu_set(cpu_set_t *cpu_set, int numa_node) {
-  CPU_ZERO(cpu_set);
+int get_numa_cpu_set(ring_set_t *cpu_set, int numa_node) {
+  RING_ZERO(cpu_set);
 
   int status = 0;
 
-  char cpu_list[MAX_ONLINE_CPU_LIST_LENGTH];
   char *path = NULL;
 
   status = asprintf(&path, "/sys/devices/system/node/node%i/cpulist",
@@ -92,19 +76,11 @@ int get_numa_cpu_set(cpu_set_t *cpu_set, int numa_node) {
     return RETURN_BAD;
   }
 
-  FILE *f = fopen(path, "r");
-  if (!f || feof(f) || !fgets(cpu_list, sizeof(cpu_list), f)) {
-    fclose(f);
-    return RETURN_BAD;
-  }
-  fclose(f);
+  status = read_cpu_list(path, cpu_set);
 
   free(path);
 
-  cpu_list[strcspn(cpu_list, "\n")] = 0;
-  parse_cpu_list(cpu_list, cpu_set);
-
-  return RETURN_GOOD;
+  return status;
 }
 
 /* ========================================================================= */
@@ -119,8 +95,8 @@ static int hex2int(char c) {
 }
 
 /* ========================================================================= */
-int parse_cpu_list(char *cpu_list, cpu_set_t *cpu_set) {
-  CPU_ZERO(cpu_set);
+int parse_cpu_list(const char *cpu_list, ring_set_t *cpu_set) {
+  RING_ZERO(cpu_set);
 
   /*
    * When supplied cpu list is an empty string there is nothing to parse.
@@ -133,6 +109,9 @@ int parse_cpu_list(char *cpu_list, cpu_set_t *cpu_set) {
   char *tofree, *string, *range;
 
   tofree = string = strdup(cpu_list);
+  if (!tofree) {
+    return RETURN_BAD;
+  }
 
   while ((range = strsep(&string, ",")) != NULL) {
     int first = strtol(range, &endptr, CPU_LIST_BASE);
@@ -141,7 +120,10 @@ int parse_cpu_list(char *cpu_list, cpu_set_t *cpu_set) {
      * range.
      */
     if (!*endptr) {
-      CPU_SET(first, cpu_set);
+      if (RING_SET(first, cpu_set) == -1) {
+        free(tofree);
+        return RETURN_BAD;
+      }
       continue;
     }
     char *save = endptr;
@@ -157,11 +139,23 @@ int parse_cpu_list(char *cpu_list, cpu_set_t *cpu_set) {
      *       where last equals first, so we will too).
      */
     if (save[0] != '-' || *endptr || last < first) {
+      free(tofree);
       return RETURN_BAD;
     }
 
+    /*
+     * Members beyond RING_SETSIZE_MAX are ignored by RING_SET(), so there is
+     * no point in walking a range past it.
+     */
+    if (last >= RING_SETSIZE_MAX) {
+      last = RING_SETSIZE_MAX - 1;
+    }
+
     for (int i = first; i <= last; i++) {
-      CPU_SET(i, cpu_set);
+      if (RING_SET(i, cpu_set) == -1) {
+        free(tofree);
+        return RETURN_BAD;
+      }
     }
   }
   free(tofree);
@@ -169,8 +163,8 @@ int parse_cpu_list(char *cpu_list, cpu_set_t *cpu_set) {
 }
 
 /* ========================================================================= */
-int parse_cpu_mask(char *cpu_mask, cpu_set_t *cpu_set) {
-  CPU_ZERO(cpu_set);
+int parse_cpu_mask(char *cpu_mask, ring_set_t *cpu_set) {
+  RING_ZERO(cpu_set);
 
   int len = strlen(cpu_mask);
   int nybbles = 0;
@@ -188,16 +182,24 @@ int parse_cpu_mask(char *cpu_mask, cpu_set_t *cpu_set) {
       return RETURN_BAD;
     }
     if (nybble & 0x01) {
-      CPU_SET(0 + (nybbles * 4), cpu_set);
+      if (RING_SET(0 + (nybbles * 4), cpu_set) == -1) {
+        return RETURN_BAD;
+      }
     }
     if (nybble & 0x02) {
-      CPU_SET(1 + (nybbles * 4), cpu_set);
+      if (RING_SET(1 + (nybbles * 4), cpu_set) == -1) {
+        return RETURN_BAD;
+      }
     }
     if (nybble & 0x04) {
-      CPU_SET(2 + (nybbles * 4), cpu_set);
+      if (RING_SET(2 + (nybbles * 4), cpu_set) == -1) {
+        return RETURN_BAD;
+      }
     }
     if (nybble & 0x08) {
-      CPU_SET(3 + (nybbles * 4), cpu_set);
+      if (RING_SET(3 + (nybbles * 4), cpu_set) == -1) {
+        return RETURN_BAD;
+      }
     }
     nybbles++;
   }
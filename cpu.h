@@ -13,11 +13,11 @@
 
 #define _GNU_SOURCE
 
-#include <sched.h> // for cpu_set_t
+#include "ring_set.h" // for ring_set_t
 
-int get_numa_cpu_set(cpu_set_t *cpu_set, int numa_node);
-int get_online_cpu_set(cpu_set_t *cpu_set);
-int parse_cpu_list(char *cpu_list, cpu_set_t *cpu_set);
-int parse_cpu_mask(char *cpu_mask, cpu_set_t *cpu_set);
+int get_numa_cpu_set(ring_set_t *cpu_set, int numa_node);
+int get_online_cpu_set(ring_set_t *cpu_set);
+int parse_cpu_list(const char *cpu_list, ring_set_t *cpu_set);
+int parse_cpu_mask(char *cpu_mask, ring_set_t *cpu_set);
 
 #endif // _CPU_H_
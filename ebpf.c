@@ -0,0 +1,616 @@
+/*
+ * Copyright (c) 2019-present StackPath, LLC
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ * ebpf.c -- bpf(2) wrappers and a minimal loader for BPF ELF objects
+ */
+
+#define _GNU_SOURCE
+
+#include "ebpf.h"
+
+#include "rxtx_error.h" // for RXTX_ERROR, rxtx_fill_errbuf()
+
+#include <linux/bpf.h>    // for bpf_attr, bpf_insn, BPF_LD, BPF_DW, BPF_IMM,
+                          //     BPF_MAP_CREATE, BPF_MAP_UPDATE_ELEM,
+                          //     BPF_PROG_LOAD, BPF_PROG_TYPE_SOCKET_FILTER,
+                          //     BPF_PSEUDO_MAP_FD
+#include <linux/unistd.h> // for __NR_bpf
+
+#include <elf.h>    // for ELF64_R_SYM(), Elf64_Ehdr, Elf64_Rel, Elf64_Shdr,
+                    //     Elf64_Sym, ELFCLASS64, ELFMAG, EI_CLASS, SELFMAG,
+                    //     SHF_EXECINSTR, SHT_PROGBITS, SHT_REL, SHT_SYMTAB
+#include <errno.h>  // for EIO, errno
+#include <stdint.h> // for uint64_t
+#include <stdio.h>  // for fclose(), FILE, fopen(), fread(), fseek(),
+                    //     ftell(), SEEK_END, SEEK_SET
+#include <stdlib.h> // for calloc(), free(), malloc()
+#include <string.h> // for memcmp(), memcpy(), memset(), strcmp(), strdup(),
+                    //     strerror(), strndup()
+#include <unistd.h> // for close(), syscall()
+
+#ifndef EM_BPF
+  #define EM_BPF 247
+#endif
+
+#define EBPF_DEFAULT_LICENSE "Dual MIT/GPL"
+#define EBPF_LEGACY_MAPS_SECTION "maps"
+#define EBPF_BTF_MAPS_SECTION ".maps"
+#define EBPF_LICENSE_SECTION "license"
+
+/*
+ * The legacy map definition emitted into the 'maps' section; anything after
+ * map_flags (inner_map_idx, numa_node, ...) is ignored.
+ */
+struct ebpf_map_def {
+  unsigned int type;
+  unsigned int key_size;
+  unsigned int value_size;
+  unsigned int max_entries;
+  unsigned int map_flags;
+};
+
+#define EBPF_MAP_DEF_MIN_SIZE (4 * sizeof(unsigned int))
+
+struct ebpf_elf {
+  unsigned char *buf;
+  size_t        len;
+  Elf64_Ehdr    *ehdr;
+  Elf64_Shdr    *shdrs;
+  const char    *shstrtab;
+  size_t        shstrtab_len;
+};
+
+/* ========================================================================= */
+static long ebpf_syscall(int cmd, union bpf_attr *attr) {
+  return syscall(__NR_bpf, cmd, attr, sizeof(*attr));
+}
+
+/* ========================================================================= */
+int ebpf_map_create(unsigned int type, unsigned int key_size,
+                unsigned int value_size, unsigned int max_entries,
+                                                  unsigned int map_flags) {
+  union bpf_attr attr;
+  memset(&attr, 0, sizeof(attr));
+
+  attr.map_type = type;
+  attr.key_size = key_size;
+  attr.value_size = value_size;
+  attr.max_entries = max_entries;
+  attr.map_flags = map_flags;
+
+  return ebpf_syscall(BPF_MAP_CREATE, &attr);
+}
+
+/* ========================================================================= */
+int ebpf_map_update_elem(int fd, const void *key, const void *value,
+                                                unsigned long long flags) {
+  union bpf_attr attr;
+  memset(&attr, 0, sizeof(attr));
+
+  attr.map_fd = fd;
+  attr.key = (uint64_t)(unsigned long)key;
+  attr.value = (uint64_t)(unsigned long)value;
+  attr.flags = flags;
+
+  return ebpf_syscall(BPF_MAP_UPDATE_ELEM, &attr);
+}
+
+/* ========================================================================= */
+int ebpf_prog_load(const struct bpf_insn *insns, unsigned int insn_cnt,
+                   const char *license, char *log_buf, size_t log_size) {
+  union bpf_attr attr;
+  memset(&attr, 0, sizeof(attr));
+
+  attr.prog_type = BPF_PROG_TYPE_SOCKET_FILTER;
+  attr.insns = (uint64_t)(unsigned long)insns;
+  attr.insn_cnt = insn_cnt;
+  attr.license = (uint64_t)(unsigned long)license;
+
+  if (log_buf && log_size) {
+    log_buf[0] = '\0';
+    attr.log_buf = (uint64_t)(unsigned long)log_buf;
+    attr.log_size = log_size;
+    attr.log_level = 1;
+  }
+
+  return ebpf_syscall(BPF_PROG_LOAD, &attr);
+}
+
+/* ========================================================================= */
+static const char *ebpf_elf_section_name(struct ebpf_elf *e, int idx) {
+  size_t off = e->shdrs[idx].sh_name;
+
+  if (off >= e->shstrtab_len) {
+    return "";
+  }
+
+  return e->shstrtab + off;
+}
+
+/* ========================================================================= */
+static const void *ebpf_elf_section_data(struct ebpf_elf *e, int idx) {
+  Elf64_Shdr *sh = &(e->shdrs[idx]);
+
+  if (sh->sh_offset > e->len || sh->sh_size > e->len - sh->sh_offset) {
+    return NULL;
+  }
+
+  return e->buf + sh->sh_offset;
+}
+
+/* ========================================================================= */
+static int ebpf_elf_find_section(struct ebpf_elf *e, const char *name) {
+  int i;
+
+  for (i = 1; i < e->ehdr->e_shnum; i++) {
+    if (strcmp(ebpf_elf_section_name(e, i), name) == 0) {
+      return i;
+    }
+  }
+
+  return -1;
+}
+
+/* ========================================================================= */
+static int ebpf_elf_read(struct ebpf_elf *e, const char *path) {
+  long size = 0;
+  FILE *f = fopen(path, "r");
+
+  memset(e, 0, sizeof(*e));
+
+  if (!f) {
+    return -1;
+  }
+
+  if (fseek(f, 0, SEEK_END) == -1 || (size = ftell(f)) < 0 ||
+                                               fseek(f, 0, SEEK_SET) == -1) {
+    fclose(f);
+    return -1;
+  }
+
+  e->len = size;
+  e->buf = malloc(e->len ? e->len : 1);
+  if (!e->buf) {
+    fclose(f);
+    return -1;
+  }
+
+  if (fread(e->buf, 1, e->len, f) != e->len) {
+    fclose(f);
+    errno = EIO;
+    return -1;
+  }
+
+  fclose(f);
+
+  return 0;
+}
+
+/* ========================================================================= */
+static int ebpf_elf_parse(struct ebpf_elf *e) {
+  e->ehdr = (Elf64_Ehdr *)e->buf;
+
+  if (e->len < sizeof(Elf64_Ehdr) ||
+                          memcmp(e->ehdr->e_ident, ELFMAG, SELFMAG) != 0 ||
+                               e->ehdr->e_ident[EI_CLASS] != ELFCLASS64) {
+    return -1;
+  }
+
+  if (e->ehdr->e_machine != EM_BPF) {
+    return -1;
+  }
+
+  if (e->ehdr->e_shoff > e->len || e->ehdr->e_shnum == 0 ||
+          e->ehdr->e_shentsize != sizeof(Elf64_Shdr) ||
+          (e->len - e->ehdr->e_shoff) / sizeof(Elf64_Shdr) <
+                                                       e->ehdr->e_shnum ||
+                                  e->ehdr->e_shstrndx >= e->ehdr->e_shnum) {
+    return -1;
+  }
+
+  e->shdrs = (Elf64_Shdr *)(e->buf + e->ehdr->e_shoff);
+
+  e->shstrtab = ebpf_elf_section_data(e, e->ehdr->e_shstrndx);
+  if (!e->shstrtab) {
+    return -1;
+  }
+  e->shstrtab_len = e->shdrs[e->ehdr->e_shstrndx].sh_size;
+
+  return 0;
+}
+
+/* ========================================================================= */
+static int ebpf_object_create_maps(struct ebpf_object *p, struct ebpf_elf *e,
+                     int maps_idx, const Elf64_Sym *syms, size_t sym_count,
+                              const char *strtab, size_t strtab_len,
+                                                        uint64_t *offsets) {
+  size_t i;
+  int m = 0;
+  struct ebpf_map_def def;
+  const unsigned char *data = ebpf_elf_section_data(e, maps_idx);
+  size_t data_len = e->shdrs[maps_idx].sh_size;
+
+  if (!data) {
+    rxtx_fill_errbuf(p->errbuf, "error loading '%s': malformed maps"
+                                                        " section", p->path);
+    return RXTX_ERROR;
+  }
+
+  for (i = 0; i < sym_count; i++) {
+    if (syms[i].st_shndx == maps_idx && syms[i].st_name) {
+      p->map_count++;
+    }
+  }
+
+  p->maps = calloc(p->map_count ? p->map_count : 1, sizeof(*p->maps));
+  if (!p->maps) {
+    rxtx_fill_errbuf(p->errbuf, "error loading '%s': %s", p->path,
+                                                              strerror(errno));
+    return RXTX_ERROR;
+  }
+
+  for (m = 0; m < p->map_count; m++) {
+    p->maps[m].fd = -1;
+  }
+
+  m = 0;
+  for (i = 0; i < sym_count; i++) {
+    const Elf64_Sym *sym = &(syms[i]);
+    size_t def_len = 0;
+    const char *name = "";
+
+    if (sym->st_shndx != maps_idx || !sym->st_name) {
+      continue;
+    }
+
+    if (sym->st_name < strtab_len) {
+      name = strtab + sym->st_name;
+    }
+
+    def_len = sym->st_size ? sym->st_size : sizeof(def);
+    if (def_len > sizeof(def)) {
+      def_len = sizeof(def);
+    }
+
+    if (def_len < EBPF_MAP_DEF_MIN_SIZE || sym->st_value > data_len ||
+                                       def_len > data_len - sym->st_value) {
+      rxtx_fill_errbuf(p->errbuf, "error loading '%s': malformed definition"
+                                           " for map '%s'", p->path, name);
+      return RXTX_ERROR;
+    }
+
+    memset(&def, 0, sizeof(def));
+    memcpy(&def, data + sym->st_value, def_len);
+
+    p->maps[m].name = strdup(name);
+    if (!p->maps[m].name) {
+      rxtx_fill_errbuf(p->errbuf, "error loading '%s': %s", p->path,
+                                                              strerror(errno));
+      return RXTX_ERROR;
+    }
+
+    p->maps[m].type = def.type;
+    p->maps[m].key_size = def.key_size;
+    p->maps[m].value_size = def.value_size;
+    p->maps[m].max_entries = def.max_entries;
+    p->maps[m].map_flags = def.map_flags;
+    offsets[m] = sym->st_value;
+
+    p->maps[m].fd = ebpf_map_create(def.type, def.key_size, def.value_size,
+                                             def.max_entries, def.map_flags);
+    if (p->maps[m].fd < 0) {
+      rxtx_fill_errbuf(p->errbuf, "error loading '%s': failed to create map"
+                                " '%s': %s", p->path, name, strerror(errno));
+      return RXTX_ERROR;
+    }
+
+    m++;
+  }
+
+  return 0;
+}
+
+/* ========================================================================= */
+static int ebpf_object_relocate(struct ebpf_object *p, struct ebpf_elf *e,
+                    int prog_idx, int maps_idx, struct bpf_insn *insns,
+                              size_t insn_cnt, const Elf64_Sym *syms,
+                       size_t sym_count, const char *strtab, size_t strtab_len,
+                                                  const uint64_t *offsets) {
+  int i, m;
+  size_t r;
+
+  for (i = 1; i < e->ehdr->e_shnum; i++) {
+    Elf64_Shdr *sh = &(e->shdrs[i]);
+    const Elf64_Rel *rels;
+
+    if (sh->sh_type != SHT_REL || sh->sh_info != (unsigned int)prog_idx) {
+      continue;
+    }
+
+    rels = ebpf_elf_section_data(e, i);
+    if (!rels) {
+      rxtx_fill_errbuf(p->errbuf, "error loading '%s': malformed relocation"
+                                                       " section", p->path);
+      return RXTX_ERROR;
+    }
+
+    for (r = 0; r < sh->sh_size / sizeof(Elf64_Rel); r++) {
+      size_t sym_idx = ELF64_R_SYM(rels[r].r_info);
+      size_t insn_idx = rels[r].r_offset / sizeof(struct bpf_insn);
+      const char *name = "";
+
+      if (sym_idx >= sym_count || insn_idx >= insn_cnt) {
+        rxtx_fill_errbuf(p->errbuf, "error loading '%s': malformed"
+                                                   " relocation", p->path);
+        return RXTX_ERROR;
+      }
+
+      if (syms[sym_idx].st_name < strtab_len) {
+        name = strtab + syms[sym_idx].st_name;
+      }
+
+      /*
+       * Map references are the only relocations we know how to resolve; calls
+       * to other functions and global data need a full featured loader.
+       */
+      if (maps_idx < 0 || syms[sym_idx].st_shndx != maps_idx ||
+                        insns[insn_idx].code != (BPF_LD | BPF_IMM | BPF_DW)) {
+        rxtx_fill_errbuf(p->errbuf, "error loading '%s': unsupported"
+                             " relocation against '%s'", p->path, name);
+        return RXTX_ERROR;
+      }
+
+      for (m = 0; m < p->map_count; m++) {
+        if (offsets[m] == syms[sym_idx].st_value) {
+          break;
+        }
+      }
+
+      if (m == p->map_count) {
+        rxtx_fill_errbuf(p->errbuf, "error loading '%s': relocation against"
+                                   " unknown map '%s'", p->path, name);
+        return RXTX_ERROR;
+      }
+
+      insns[insn_idx].src_reg = BPF_PSEUDO_MAP_FD;
+      insns[insn_idx].imm = p->maps[m].fd;
+    }
+  }
+
+  return 0;
+}
+
+/* ========================================================================= */
+int ebpf_object_open(struct ebpf_object *p, const char *path,
+                                      const char *section, char *errbuf) {
+  int i;
+  int status = RXTX_ERROR;
+  int prog_idx = -1;
+  int maps_idx = -1;
+  int symtab_idx = -1;
+  int license_idx = -1;
+
+  const Elf64_Sym *syms = NULL;
+  size_t sym_count = 0;
+  const char *strtab = NULL;
+  size_t strtab_len = 0;
+
+  struct bpf_insn *insns = NULL;
+  size_t insn_cnt = 0;
+  uint64_t *offsets = NULL;
+
+  struct ebpf_elf e;
+  memset(&e, 0, sizeof(e));
+
+  memset(p, 0, sizeof(*p));
+  p->errbuf = errbuf;
+  p->prog_fd = -1;
+
+  p->path = strdup(path);
+  if (!p->path) {
+    rxtx_fill_errbuf(p->errbuf, "error loading '%s': %s", path,
+                                                              strerror(errno));
+    return RXTX_ERROR;
+  }
+
+  if (ebpf_elf_read(&e, path) == -1) {
+    rxtx_fill_errbuf(p->errbuf, "error loading '%s': %s", path,
+                                                              strerror(errno));
+    goto out;
+  }
+
+  if (ebpf_elf_parse(&e) == -1) {
+    rxtx_fill_errbuf(p->errbuf, "error loading '%s': not a 64-bit BPF ELF"
+                                                             " object", path);
+    goto out;
+  }
+
+  for (i = 1; i < e.ehdr->e_shnum; i++) {
+    const char *name = ebpf_elf_section_name(&e, i);
+    Elf64_Shdr *sh = &(e.shdrs[i]);
+
+    if (sh->sh_type == SHT_SYMTAB) {
+      symtab_idx = i;
+    } else if (strcmp(name, EBPF_LEGACY_MAPS_SECTION) == 0) {
+      maps_idx = i;
+    } else if (strcmp(name, EBPF_LICENSE_SECTION) == 0) {
+      license_idx = i;
+    } else if (prog_idx < 0 && sh->sh_type == SHT_PROGBITS &&
+                          (sh->sh_flags & SHF_EXECINSTR) && sh->sh_size &&
+                               (!section || strcmp(name, section) == 0)) {
+      prog_idx = i;
+    }
+  }
+
+  if (maps_idx < 0 && ebpf_elf_find_section(&e, EBPF_BTF_MAPS_SECTION) > 0) {
+    rxtx_fill_errbuf(p->errbuf, "error loading '%s': BTF defined maps ('"
+                      EBPF_BTF_MAPS_SECTION "') are not supported, use a '"
+                      EBPF_LEGACY_MAPS_SECTION "' section instead", path);
+    goto out;
+  }
+
+  if (prog_idx < 0) {
+    if (section) {
+      rxtx_fill_errbuf(p->errbuf, "error loading '%s': no program in section"
+                                                   " '%s'", path, section);
+    } else {
+      rxtx_fill_errbuf(p->errbuf, "error loading '%s': no program found",
+                                                                         path);
+    }
+    goto out;
+  }
+
+  p->section = strdup(ebpf_elf_section_name(&e, prog_idx));
+
+  if (license_idx > 0 && ebpf_elf_section_data(&e, license_idx)) {
+    p->license = strndup(ebpf_elf_section_data(&e, license_idx),
+                                                e.shdrs[license_idx].sh_size);
+  } else {
+    p->license = strdup(EBPF_DEFAULT_LICENSE);
+  }
+
+  if (!p->section || !p->license) {
+    rxtx_fill_errbuf(p->errbuf, "error loading '%s': %s", path,
+                                                              strerror(errno));
+    goto out;
+  }
+
+  if (symtab_idx > 0) {
+    Elf64_Shdr *sh = &(e.shdrs[symtab_idx]);
+
+    syms = ebpf_elf_section_data(&e, symtab_idx);
+    sym_count = sh->sh_size / sizeof(Elf64_Sym);
+
+    if (sh->sh_link < e.ehdr->e_shnum) {
+      strtab = ebpf_elf_section_data(&e, sh->sh_link);
+      strtab_len = e.shdrs[sh->sh_link].sh_size;
+    }
+
+    if (!syms || !strtab) {
+      rxtx_fill_errbuf(p->errbuf, "error loading '%s': malformed symbol"
+                                                          " table", path);
+      goto out;
+    }
+  }
+
+  offsets = calloc(sym_count ? sym_count : 1, sizeof(*offsets));
+  if (!offsets) {
+    rxtx_fill_errbuf(p->errbuf, "error loading '%s': %s", path,
+                                                              strerror(errno));
+    goto out;
+  }
+
+  if (maps_idx > 0) {
+    status = ebpf_object_create_maps(p, &e, maps_idx, syms, sym_count,
+                                              strtab, strtab_len, offsets);
+    if (status == RXTX_ERROR) {
+      goto out;
+    }
+    status = RXTX_ERROR;
+  }
+
+  /*
+   * The program is relocated in a private copy since section data isn't
+   * guaranteed to be aligned for struct bpf_insn.
+   */
+  if (!ebpf_elf_section_data(&e, prog_idx)) {
+    rxtx_fill_errbuf(p->errbuf, "error loading '%s': malformed program"
+                                                          " section", path);
+    goto out;
+  }
+
+  insn_cnt = e.shdrs[prog_idx].sh_size / sizeof(struct bpf_insn);
+  insns = malloc(insn_cnt * sizeof(*insns));
+  if (!insns) {
+    rxtx_fill_errbuf(p->errbuf, "error loading '%s': %s", path,
+                                                              strerror(errno));
+    goto out;
+  }
+  memcpy(insns, ebpf_elf_section_data(&e, prog_idx),
+                                                insn_cnt * sizeof(*insns));
+
+  status = ebpf_object_relocate(p, &e, prog_idx, maps_idx, insns, insn_cnt,
+                             syms, sym_count, strtab, strtab_len, offsets);
+  if (status == RXTX_ERROR) {
+    goto out;
+  }
+  status = RXTX_ERROR;
+
+  p->log_buf = malloc(EBPF_LOG_BUF_SIZE);
+  if (!p->log_buf) {
+    rxtx_fill_errbuf(p->errbuf, "error loading '%s': %s", path,
+                                                              strerror(errno));
+    goto out;
+  }
+
+  p->prog_fd = ebpf_prog_load(insns, insn_cnt, p->license, p->log_buf,
+                                                           EBPF_LOG_BUF_SIZE);
+  if (p->prog_fd < 0) {
+    rxtx_fill_errbuf(p->errbuf, "error loading '%s': program in section '%s'"
+                         " rejected: %s", path, p->section, strerror(errno));
+    goto out;
+  }
+
+  status = 0;
+
+out:
+  free(offsets);
+  free(insns);
+  free(e.buf);
+
+  return status;
+}
+
+/* ========================================================================= */
+int ebpf_object_close(struct ebpf_object *p) {
+  int i;
+
+  for (i = 0; i < p->map_count; i++) {
+    if (p->maps[i].fd >= 0) {
+      close(p->maps[i].fd);
+    }
+    free(p->maps[i].name);
+  }
+  free(p->maps);
+  p->maps = NULL;
+  p->map_count = 0;
+
+  if (p->prog_fd >= 0) {
+    close(p->prog_fd);
+  }
+  p->prog_fd = -1;
+
+  free(p->log_buf);
+  p->log_buf = NULL;
+  free(p->license);
+  p->license = NULL;
+  free(p->section);
+  p->section = NULL;
+  free(p->path);
+  p->path = NULL;
+  p->errbuf = NULL;
+
+  return 0;
+}
+
+/* ========================================================================= */
+int ebpf_object_get_map_fd(struct ebpf_object *p, const char *name) {
+  int i;
+
+  for (i = 0; i < p->map_count; i++) {
+    if (p->maps[i].name && strcmp(p->maps[i].name, name) == 0) {
+      return p->maps[i].fd;
+    }
+  }
+
+  return -1;
+}
+
+/* ========================================================================= */
+int ebpf_object_get_prog_fd(struct ebpf_object *p) {
+  return p->prog_fd;
+}
@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2019-present StackPath, LLC
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ * ebpf.h -- header file to use ebpf.c
+ */
+
+#ifndef _EBPF_H_
+#define _EBPF_H_
+
+#include <linux/bpf.h> // for bpf_insn
+
+#include <stddef.h> // for size_t
+
+#define EBPF_LOG_BUF_SIZE 65536
+
+struct ebpf_map {
+  char         *name;
+  int          fd;
+  unsigned int type;
+  unsigned int key_size;
+  unsigned int value_size;
+  unsigned int max_entries;
+  unsigned int map_flags;
+};
+
+struct ebpf_object {
+  char            *path;
+  char            *section;
+  char            *license;
+  struct ebpf_map *maps;
+  int             map_count;
+  int             prog_fd;
+  char            *log_buf;
+  char            *errbuf;
+};
+
+int ebpf_map_create(unsigned int type, unsigned int key_size,
+               unsigned int value_size, unsigned int max_entries,
+                                                   unsigned int map_flags);
+int ebpf_map_update_elem(int fd, const void *key, const void *value,
+                                                 unsigned long long flags);
+int ebpf_prog_load(const struct bpf_insn *insns, unsigned int insn_cnt,
+                  const char *license, char *log_buf, size_t log_size);
+
+int ebpf_object_open(struct ebpf_object *p, const char *path,
+                                       const char *section, char *errbuf);
+int ebpf_object_close(struct ebpf_object *p);
+int ebpf_object_get_map_fd(struct ebpf_object *p, const char *name);
+int ebpf_object_get_prog_fd(struct ebpf_object *p);
+
+#endif // _EBPF_H_
@@ -0,0 +1,213 @@
+/*
+ * Copyright (c) 2019-present StackPath, LLC
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ * ethtool.c -- read rss settings from a nic via SIOCETHTOOL
+ */
+
+#define _GNU_SOURCE
+
+#include "ethtool.h"
+
+#include "rxtx_error.h" // for RXTX_ERROR, rxtx_fill_errbuf()
+
+#include <linux/ethtool.h> // for ETHTOOL_GRSSH, ETHTOOL_GRXFH,
+                           //     ETHTOOL_GRXFHINDIR, ETHTOOL_GRXRINGS,
+                           //     ethtool_rxfh, ethtool_rxfh_indir,
+                           //     ethtool_rxnfc
+#include <linux/sockios.h> // for SIOCETHTOOL
+#include <net/if.h>        // for IFNAMSIZ, ifreq
+#include <sys/ioctl.h>     // for ioctl()
+#include <sys/socket.h>    // for AF_INET, SOCK_DGRAM, socket()
+
+#include <errno.h>  // for ENODEV, EOPNOTSUPP, errno
+#include <stdlib.h> // for calloc(), free()
+#include <string.h> // for memcpy(), memset(), strerror(), strlen()
+#include <unistd.h> // for close()
+
+/* ========================================================================= */
+static int ethtool_ioctl(const char *ifname, void *cmd) {
+  struct ifreq ifr;
+  int fd = -1;
+  int status = 0;
+  int saved = 0;
+
+  if (strlen(ifname) >= IFNAMSIZ) {
+    errno = ENODEV;
+    return -1;
+  }
+
+  memset(&ifr, 0, sizeof(ifr));
+  memcpy(ifr.ifr_name, ifname, strlen(ifname));
+  ifr.ifr_data = cmd;
+
+  /*
+   * Any socket will do; SIOCETHTOOL only uses it to reach the device.
+   */
+  fd = socket(AF_INET, SOCK_DGRAM, 0);
+  if (fd == -1) {
+    return -1;
+  }
+
+  status = ioctl(fd, SIOCETHTOOL, &ifr);
+  saved = errno;
+  close(fd);
+  errno = saved;
+
+  return status;
+}
+
+/* ========================================================================= */
+static int ethtool_rss_get_indir(struct ethtool_rss *p, const char *ifname) {
+  struct ethtool_rxfh_indir head;
+  struct ethtool_rxfh_indir *indir = NULL;
+
+  /*
+   * Drivers without ETHTOOL_GRSSH (or older kernels) may still report the
+   * table alone; the key then has to come from elsewhere.
+   */
+  memset(&head, 0, sizeof(head));
+  head.cmd = ETHTOOL_GRXFHINDIR;
+  if (ethtool_ioctl(ifname, &head) == -1) {
+    rxtx_fill_errbuf(p->errbuf, "error reading rss config of '%s': %s",
+                                                     ifname, strerror(errno));
+    return RXTX_ERROR;
+  }
+
+  indir = calloc(1, sizeof(*indir) + head.size * sizeof(indir->ring_index[0]));
+  p->indir = calloc(head.size ? head.size : 1, sizeof(*(p->indir)));
+  if (!indir || !p->indir) {
+    rxtx_fill_errbuf(p->errbuf, "error reading rss config of '%s': %s",
+                                                     ifname, strerror(errno));
+    free(indir);
+    ethtool_rss_destroy(p);
+    return RXTX_ERROR;
+  }
+
+  indir->cmd = ETHTOOL_GRXFHINDIR;
+  indir->size = head.size;
+  if (ethtool_ioctl(ifname, indir) == -1) {
+    rxtx_fill_errbuf(p->errbuf, "error reading rss config of '%s': %s",
+                                                     ifname, strerror(errno));
+    free(indir);
+    ethtool_rss_destroy(p);
+    return RXTX_ERROR;
+  }
+
+  memcpy(p->indir, indir->ring_index, indir->size * sizeof(*(p->indir)));
+  p->indir_size = indir->size;
+
+  free(indir);
+
+  return 0;
+}
+
+/* ========================================================================= */
+int ethtool_rss_get(struct ethtool_rss *p, const char *ifname, char *errbuf) {
+  struct ethtool_rxfh head;
+  struct ethtool_rxfh *rxfh = NULL;
+  struct ethtool_rxnfc rings;
+
+  memset(p, 0, sizeof(*p));
+  p->errbuf = errbuf;
+
+  /*
+   * This is what 'ethtool -x' does; the ring count, then the table and key
+   * sizes, then the table and key themselves.
+   */
+  memset(&rings, 0, sizeof(rings));
+  rings.cmd = ETHTOOL_GRXRINGS;
+  if (ethtool_ioctl(ifname, &rings) == -1) {
+    rxtx_fill_errbuf(p->errbuf, "error reading rx ring count of '%s': %s",
+                                                     ifname, strerror(errno));
+    return RXTX_ERROR;
+  }
+  p->ring_count = rings.data;
+
+  memset(&head, 0, sizeof(head));
+  head.cmd = ETHTOOL_GRSSH;
+  if (ethtool_ioctl(ifname, &head) == -1) {
+    if (errno == EOPNOTSUPP) {
+      return ethtool_rss_get_indir(p, ifname);
+    }
+    rxtx_fill_errbuf(p->errbuf, "error reading rss config of '%s': %s",
+                                                     ifname, strerror(errno));
+    return RXTX_ERROR;
+  }
+
+  if (head.key_size > ETHTOOL_RSS_KEY_MAX) {
+    rxtx_fill_errbuf(p->errbuf, "error reading rss config of '%s': %u byte"
+                                 " key is too long", ifname, head.key_size);
+    return RXTX_ERROR;
+  }
+
+  rxfh = calloc(1, sizeof(*rxfh) + head.indir_size * sizeof(uint32_t)
+                                                             + head.key_size);
+  p->indir = calloc(head.indir_size ? head.indir_size : 1,
+                                                        sizeof(*(p->indir)));
+  if (!rxfh || !p->indir) {
+    rxtx_fill_errbuf(p->errbuf, "error reading rss config of '%s': %s",
+                                                     ifname, strerror(errno));
+    free(rxfh);
+    ethtool_rss_destroy(p);
+    return RXTX_ERROR;
+  }
+
+  rxfh->cmd = ETHTOOL_GRSSH;
+  rxfh->indir_size = head.indir_size;
+  rxfh->key_size = head.key_size;
+  if (ethtool_ioctl(ifname, rxfh) == -1) {
+    rxtx_fill_errbuf(p->errbuf, "error reading rss config of '%s': %s",
+                                                     ifname, strerror(errno));
+    free(rxfh);
+    ethtool_rss_destroy(p);
+    return RXTX_ERROR;
+  }
+
+  /*
+   * rss_config holds the table, followed by the key.
+   */
+  memcpy(p->indir, rxfh->rss_config, rxfh->indir_size * sizeof(uint32_t));
+  p->indir_size = rxfh->indir_size;
+  memcpy(p->key, (uint8_t *)&rxfh->rss_config[rxfh->indir_size],
+                                                              rxfh->key_size);
+  p->key_len = rxfh->key_size;
+  p->hfunc = rxfh->hfunc;
+
+  free(rxfh);
+
+  return 0;
+}
+
+/* ========================================================================= */
+void ethtool_rss_destroy(struct ethtool_rss *p) {
+  free(p->indir);
+  p->indir = NULL;
+  p->indir_size = 0;
+}
+
+/* ========================================================================= */
+int ethtool_rx_flow_hash_get(const char *ifname, uint32_t flow_type,
+                                              uint64_t *fields, char *errbuf) {
+  struct ethtool_rxnfc nfc;
+
+  /*
+   * The fields hashed for a flow type (e.g. UDP_V4_FLOW), as RXH_* bits;
+   * what 'ethtool -n IFACE rx-flow-hash udp4' prints.
+   */
+  memset(&nfc, 0, sizeof(nfc));
+  nfc.cmd = ETHTOOL_GRXFH;
+  nfc.flow_type = flow_type;
+  if (ethtool_ioctl(ifname, &nfc) == -1) {
+    rxtx_fill_errbuf(errbuf, "error reading rx flow hash of '%s': %s",
+                                                     ifname, strerror(errno));
+    return RXTX_ERROR;
+  }
+
+  *fields = nfc.data;
+
+  return 0;
+}
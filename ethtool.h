@@ -0,0 +1,39 @@
+/*
+ * Copyright (c) 2019-present StackPath, LLC
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ * ethtool.h -- header file to use ethtool.c
+ */
+
+#ifndef _ETHTOOL_H_
+#define _ETHTOOL_H_
+
+#include <stdint.h> // for uint8_t, uint32_t, uint64_t
+
+#define ETHTOOL_RSS_KEY_MAX 256
+
+/*
+ * hfunc is a bitmap indexed by the kernel's ETH_SS_RSS_HASH_FUNCS strings,
+ * which uapi headers don't carry; toeplitz is always the first.
+ */
+#define ETHTOOL_RSS_HASH_TOP 0x1
+
+struct ethtool_rss {
+  uint8_t  key[ETHTOOL_RSS_KEY_MAX];
+  uint32_t key_len;
+  uint32_t *indir;
+  uint32_t indir_size;
+  uint32_t ring_count;
+  uint8_t  hfunc;
+  char     *errbuf;
+};
+
+int ethtool_rss_get(struct ethtool_rss *p, const char *ifname, char *errbuf);
+void ethtool_rss_destroy(struct ethtool_rss *p);
+int ethtool_rx_flow_hash_get(const char *ifname, uint32_t flow_type,
+                                              uint64_t *fields, char *errbuf);
+
+#endif // _ETHTOOL_H_
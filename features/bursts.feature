@@ -0,0 +1,34 @@
+Feature: `--bursts` option
+
+  Use the `--bursts` option to report the busiest window on each cpu and the
+  bursts of consecutive windows which reached a packet threshold.
+
+  Windows are placed by kernel timestamp, so the peak's time and size vary
+  from run to run; we check what doesn't. Three pings a fifth of a second
+  apart never put 100 packets in a millisecond.
+
+  Scenario: With `--bursts`
+    When I run `sudo ../../rxtxcpu --count 6 --bursts 1000,100 lo` in background
+    And I run `ping -i0.2 -c3 127.0.0.1` on cpu 0
+    Then the output from "sudo ../../rxtxcpu --count 6 --bursts 1000,100 lo" should contain:
+    """
+    6 packets captured on cpu0.
+    0 packets captured on cpu1.
+    6 packets captured total.
+    Bursts on cpu0:
+      peak of
+    """
+    And the output from "sudo ../../rxtxcpu --count 6 --bursts 1000,100 lo" should contain:
+    """
+      0 bursts of at least 100 packets in 1000 us.
+    Bursts on cpu1:
+      no packets.
+    """
+
+  Scenario: With `-B` and a threshold every window reaches
+    When I run `sudo ../../rxtxcpu -c6 -B 1000000,1 lo` in background
+    And I run `ping -i0.2 -c3 127.0.0.1` on cpu 0
+    Then the output from "sudo ../../rxtxcpu -c6 -B 1000000,1 lo" should contain:
+    """
+    bursts of at least 1 packets in 1000000 us.
+    """
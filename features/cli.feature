@@ -28,6 +28,48 @@ Feature: cli
     And the stderr should contain "rxtxcpu: Invalid direction '10j'."
     And the stderr should contain "Usage: rxtxcpu [--help]"
 
+  Scenario: invalid sample rate
+    When I run `./rxtxcpu -s 10j`
+    Then the exit status should be 2
+    And the stdout should not contain anything
+    And the stderr should contain "rxtxcpu: Invalid sample rate '10j'."
+    And the stderr should contain "Usage: rxtxcpu [--help]"
+
+  Scenario: zero sample rate
+    When I run `./rxtxcpu -s 0`
+    Then the exit status should be 2
+    And the stdout should not contain anything
+    And the stderr should contain "rxtxcpu: Invalid sample rate '0'."
+    And the stderr should contain "Usage: rxtxcpu [--help]"
+
+  Scenario: invalid flow count
+    When I run `./rxtxcpu -F 10j`
+    Then the exit status should be 2
+    And the stdout should not contain anything
+    And the stderr should contain "rxtxcpu: Invalid flow count '10j'."
+    And the stderr should contain "Usage: rxtxcpu [--help]"
+
+  Scenario: zero flow count
+    When I run `./rxtxcpu -F 0`
+    Then the exit status should be 2
+    And the stdout should not contain anything
+    And the stderr should contain "rxtxcpu: Invalid flow count '0'."
+    And the stderr should contain "Usage: rxtxcpu [--help]"
+
+  Scenario: bursts without a threshold
+    When I run `./rxtxcpu -B 100`
+    Then the exit status should be 2
+    And the stdout should not contain anything
+    And the stderr should contain "rxtxcpu: Invalid bursts '100'."
+    And the stderr should contain "Usage: rxtxcpu [--help]"
+
+  Scenario: zero bursts window
+    When I run `./rxtxcpu -B 0,10`
+    Then the exit status should be 2
+    And the stdout should not contain anything
+    And the stderr should contain "rxtxcpu: Invalid bursts '0,10'."
+    And the stderr should contain "Usage: rxtxcpu [--help]"
+
   Scenario: write file argument '-' with more than one cpu
     When I run `./rxtxcpu -w -`
     Then the exit status should be 2
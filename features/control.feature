@@ -0,0 +1,49 @@
+Feature: `--control=PATH` option
+
+  Use the `--control=PATH` option to enable and disable capturing on cpus at
+  runtime via a unix socket at PATH.
+
+  Rings keep their place in the fanout group while disabled, so packets on
+  other cpus are still counted against the right cpu. Packets which queue up
+  on a disabled cpu are discarded when it is enabled again.
+
+  Scenario: Disabling a cpu stops counting its packets
+    Given I wait 0.2 seconds for a command to start up
+    When I run `sudo timeout -s INT 3 ../../rxtxcpu --control rxtxcpu.sock lo` in background
+    And I run `ping -i0.2 -c3 localhost` on cpu 0
+    And I run `bash -c 'echo disable 0 | sudo nc -U rxtxcpu.sock'`
+    And I run `ping -i0.2 -c3 localhost` on cpu 0
+    Then the output from "bash -c 'echo disable 0 | sudo nc -U rxtxcpu.sock'" should contain exactly "ok"
+    And the stdout from "sudo timeout -s INT 3 ../../rxtxcpu --control rxtxcpu.sock lo" should contain exactly:
+    """
+    12 packets captured on cpu0.
+    0 packets captured on cpu1.
+    12 packets captured total.
+    """
+
+  Scenario: Enabling a cpu starts counting its packets
+    Given I wait 0.2 seconds for a command to start up
+    When I run `sudo timeout -s INT 3 ../../rxtxcpu -l1 -C rxtxcpu.sock lo` in background
+    And I run `ping -i0.2 -c3 localhost` on cpu 0
+    And I run `bash -c 'echo enable 0 | sudo nc -U rxtxcpu.sock'`
+    And I run `ping -i0.2 -c3 localhost` on cpu 0
+    Then the output from "bash -c 'echo enable 0 | sudo nc -U rxtxcpu.sock'" should contain exactly "ok"
+    And the stdout from "sudo timeout -s INT 3 ../../rxtxcpu -l1 -C rxtxcpu.sock lo" should contain exactly:
+    """
+    12 packets captured on cpu0.
+    0 packets captured on cpu1.
+    12 packets captured total.
+    """
+
+  Scenario: Status reports per-cpu state
+    Given I wait 0.2 seconds for a command to start up
+    When I run `sudo timeout -s INT 2 ../../rxtxcpu -l0 -C rxtxcpu.sock lo` in background
+    And I run `bash -c 'echo status | sudo nc -U rxtxcpu.sock'`
+    Then the output from "bash -c 'echo status | sudo nc -U rxtxcpu.sock'" should contain "cpu0 enabled"
+    And the output from "bash -c 'echo status | sudo nc -U rxtxcpu.sock'" should contain "cpu1 disabled"
+
+  Scenario: Enabling a second cpu is refused when writing to stdout
+    Given I wait 0.2 seconds for a command to start up
+    When I run `sudo timeout -s INT 2 ../../rxtxcpu -l0 -w - -C rxtxcpu.sock lo` in background
+    And I run `bash -c 'echo enable 1 | sudo nc -U rxtxcpu.sock'`
+    Then the output from "bash -c 'echo enable 1 | sudo nc -U rxtxcpu.sock'" should contain "error: write file '-' (stdout) is only permitted when capturing on a single cpu"
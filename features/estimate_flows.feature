@@ -0,0 +1,34 @@
+Feature: `--estimate-flows` option
+
+  Use the `--estimate-flows` option to report an estimate of the distinct
+  flows seen on each cpu and in total.
+
+  Pinging 127.0.0.1 is a single flow (see flow_check.feature), and a sketch
+  holding one flow estimates exactly one.
+
+  Scenario: With `--estimate-flows`
+    When I run `sudo ../../rxtxcpu --count 6 --estimate-flows lo` in background
+    And I run `ping -i0.2 -c3 127.0.0.1` on cpu 0
+    Then the output from "sudo ../../rxtxcpu --count 6 --estimate-flows lo" should contain exactly:
+    """
+    6 packets captured on cpu0.
+    0 packets captured on cpu1.
+    6 packets captured total.
+    1 flows estimated on cpu0.
+    0 flows estimated on cpu1.
+    1 flows estimated total.
+    """
+
+  Scenario: With `-E` and a flow on two cpus
+    When I run `sudo ../../rxtxcpu -c12 -E lo` in background
+    And I run `ping -i0.2 -c3 127.0.0.1` on cpu 0
+    And I run `ping -i0.2 -c3 127.0.0.1` on cpu 1
+    Then the output from "sudo ../../rxtxcpu -c12 -E lo" should contain exactly:
+    """
+    6 packets captured on cpu0.
+    6 packets captured on cpu1.
+    12 packets captured total.
+    1 flows estimated on cpu0.
+    1 flows estimated on cpu1.
+    1 flows estimated total.
+    """
@@ -0,0 +1,31 @@
+Feature: `--flow-check` option
+
+  Use the `--flow-check` option to track flows per cpu and report every flow
+  seen on more than one cpu, with its per-cpu packet counts.
+
+  icmp has no ports, so every echo request and reply between 127.0.0.1 and
+  itself is the same flow.
+
+  Scenario: With `--flow-check` and a flow on one cpu
+    When I run `sudo ../../rxtxcpu --count 6 --flow-check 16 lo` in background
+    And I run `ping -i0.2 -c3 127.0.0.1` on cpu 0
+    Then the output from "sudo ../../rxtxcpu --count 6 --flow-check 16 lo" should contain exactly:
+    """
+    6 packets captured on cpu0.
+    0 packets captured on cpu1.
+    6 packets captured total.
+    0 of 1 flows seen on more than one cpu.
+    """
+
+  Scenario: With `-F` and a flow on two cpus
+    When I run `sudo ../../rxtxcpu -c12 -F16 lo` in background
+    And I run `ping -i0.2 -c3 127.0.0.1` on cpu 0
+    And I run `ping -i0.2 -c3 127.0.0.1` on cpu 1
+    Then the output from "sudo ../../rxtxcpu -c12 -F16 lo" should contain exactly:
+    """
+    6 packets captured on cpu0.
+    6 packets captured on cpu1.
+    12 packets captured total.
+    Flow proto 1 127.0.0.1 > 127.0.0.1 seen on 2 cpus: cpu 0 (6 packets), cpu 1 (6 packets).
+    1 of 1 flows seen on more than one cpu.
+    """
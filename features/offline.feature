@@ -86,6 +86,25 @@ Feature: offline cpu
     20 packets captured total.
     """
 
+  Scenario: Packets sent on cpu1 are counted again when cpu1 is flipped offline and back online
+    Given I wait 0.2 seconds for a command to start up
+    When I run `sudo timeout -s INT 4 ../../rxtxcpu lo` in background
+    And I run `ping -i0.2 -c3 localhost` on cpu 1
+    And I disable cpu 1
+    And I run `sleep 0.5`
+    And I enable cpu 1
+    And I run `sleep 0.5`
+    And I run `ping -i0.2 -c3 localhost` on cpu 1
+    Then the stdout from "sudo timeout -s INT 4 ../../rxtxcpu lo" should contain exactly:
+    """
+    0 packets captured on cpu0.
+    24 packets captured on cpu1.
+    24 packets captured total.
+    """
+    And the stderr from "sudo timeout -s INT 4 ../../rxtxcpu lo" should contain "cpu '1' went offline after 12 packets; parking its worker."
+    And the stderr from "sudo timeout -s INT 4 ../../rxtxcpu lo" should contain "cpu '1' came online; resuming capture."
+    And the stderr from "sudo timeout -s INT 4 ../../rxtxcpu lo" should contain "2 cpu hotplug events during capture"
+
   Scenario: Enable cpus after all tests in this file
     Given I enable cpu 0
     And I enable cpu 1
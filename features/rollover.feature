@@ -0,0 +1,34 @@
+Feature: `--rollover` option
+
+  Use the `--rollover` option to have the kernel hand packets to the next
+  cpu's socket when the socket for the cpu they arrived on is full, instead of
+  dropping them.
+
+  A lightly loaded lo never fills a socket, so we only check that the option
+  is accepted and the rollover report follows the usual per-cpu counts.
+
+  Scenario: With `--rollover`
+    When I run `sudo ../../rxtxcpu --count 6 --rollover lo` in background
+    And I run `ping -i0.2 -c3 localhost` on cpu 0
+    Then the output from "sudo ../../rxtxcpu --count 6 --rollover lo" should contain exactly:
+    """
+    6 packets captured on cpu0.
+    0 packets captured on cpu1.
+    6 packets captured total.
+    0 packets rolled over from cpu0 (0 huge flow, 0 failed).
+    0 packets rolled over from cpu1 (0 huge flow, 0 failed).
+    0 packets rolled over total.
+    """
+
+  Scenario: With `-R`
+    When I run `sudo ../../rxtxcpu -c6 -R lo` in background
+    And I run `ping -i0.2 -c3 localhost` on cpu 0
+    Then the output from "sudo ../../rxtxcpu -c6 -R lo" should contain exactly:
+    """
+    6 packets captured on cpu0.
+    0 packets captured on cpu1.
+    6 packets captured total.
+    0 packets rolled over from cpu0 (0 huge flow, 0 failed).
+    0 packets rolled over from cpu1 (0 huge flow, 0 failed).
+    0 packets rolled over total.
+    """
@@ -0,0 +1,24 @@
+Feature: `--softnet-stat` option
+
+  Use the `--softnet-stat` option to report what each cpu's softnet did while
+  capturing, per /proc/net/softnet_stat.
+
+  Anything else the host is doing shows up in softnet_stat too, so we only
+  check that the report follows the usual per-cpu counts.
+
+  Scenario: With `--softnet-stat`
+    When I run `sudo ../../rxtxcpu --count 6 --softnet-stat lo` in background
+    And I run `ping -i0.2 -c3 127.0.0.1` on cpu 0
+    Then the output from "sudo ../../rxtxcpu --count 6 --softnet-stat lo" should contain:
+    """
+    6 packets captured on cpu0.
+    0 packets captured on cpu1.
+    6 packets captured total.
+    """
+    And the output from "sudo ../../rxtxcpu --count 6 --softnet-stat lo" should match /packets processed, \d+ dropped, \d+ time squeezes, \d+ rps received by softnet on cpu0\./
+    And the output from "sudo ../../rxtxcpu --count 6 --softnet-stat lo" should match /rps received by softnet total\./
+
+  Scenario: With `-S`
+    When I run `sudo ../../rxtxcpu -c6 -S lo` in background
+    And I run `ping -i0.2 -c3 127.0.0.1` on cpu 0
+    Then the output from "sudo ../../rxtxcpu -c6 -S lo" should contain "rps received by softnet on cpu1."
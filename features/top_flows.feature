@@ -0,0 +1,25 @@
+Feature: `--top-flows` option
+
+  Use the `--top-flows` option to report the top flows on each cpu by packets
+  and by bytes.
+
+  Pinging 127.0.0.1 gives one flow to rank (see flow_check.feature), made up
+  of six 98 byte packets on lo.
+
+  Scenario: With `--top-flows`
+    When I run `sudo ../../rxtxcpu --count 6 --top-flows 2 lo` in background
+    And I run `ping -i0.2 -c3 127.0.0.1` on cpu 0
+    Then the output from "sudo ../../rxtxcpu --count 6 --top-flows 2 lo" should contain exactly:
+    """
+    6 packets captured on cpu0.
+    0 packets captured on cpu1.
+    6 packets captured total.
+    Top flows by packets on cpu0:
+      1. proto 1 127.0.0.1 > 127.0.0.1, 6 packets.
+    Top flows by bytes on cpu0:
+      1. proto 1 127.0.0.1 > 127.0.0.1, 588 bytes.
+    Top flows by packets on cpu1:
+      no flows.
+    Top flows by bytes on cpu1:
+      no flows.
+    """
@@ -0,0 +1,564 @@
+#define _GNU_SOURCE
+
+#include "tx_ring.h"
+
+#include "rxtx_error.h"
+
+#include <arpa/inet.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <net/if.h>
+
+#include <getopt.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define EXIT_OK          0
+#define EXIT_FAIL        1
+#define EXIT_FAIL_OPTION 2
+
+#define BATCH_SIZE 64
+
+#define ETHERNET_HEADER_LEN 14
+#define IPV4_HEADER_LEN     20
+#define UDP_HEADER_LEN       8
+#define TCP_HEADER_LEN      20
+
+#define MAC_ADDR_LEN 6
+
+#define IPV4_HEADER_OFFSET ETHERNET_HEADER_LEN
+#define L4_HEADER_OFFSET   (ETHERNET_HEADER_LEN + IPV4_HEADER_LEN)
+
+#define IPV4_TOTAL_LEN_OFFSET (IPV4_HEADER_OFFSET +  2)
+#define IPV4_IDENT_OFFSET     (IPV4_HEADER_OFFSET +  4)
+#define IPV4_CKSM_OFFSET      (IPV4_HEADER_OFFSET + 10)
+#define IPV4_SADDR_OFFSET     (IPV4_HEADER_OFFSET + 12)
+#define IPV4_DADDR_OFFSET     (IPV4_HEADER_OFFSET + 16)
+
+#define L4_SPORT_OFFSET L4_HEADER_OFFSET
+#define L4_DPORT_OFFSET (L4_HEADER_OFFSET + 2)
+#define UDP_LEN_OFFSET  (L4_HEADER_OFFSET + 4)
+#define UDP_CKSM_OFFSET (L4_HEADER_OFFSET + 6)
+#define TCP_CKSM_OFFSET (L4_HEADER_OFFSET + 16)
+
+#define PAYLOAD_LEN_DEFAULT 18
+#define PAYLOAD_LEN_MAX     1400
+
+char *program_basename;
+
+volatile sig_atomic_t keep_running = 1;
+
+/*
+ * An inclusive range of host order values; addresses and ports are both
+ * walked this way.
+ */
+struct range {
+  uint32_t first;
+  uint32_t last;
+};
+
+static void sigint_handler(int signal) {
+  keep_running = 0;
+  write(STDERR_FILENO, "\n", 1);
+}
+
+static int setup_signals() {
+  struct sigaction sa;
+  sa.sa_handler = &sigint_handler;
+  sa.sa_flags = SA_RESTART;
+  sigfillset(&sa.sa_mask);
+  if (sigaction(SIGINT, &sa, NULL) == -1) {
+    fprintf(
+      stderr,
+      "%s: Failed to setup signal handler for SIGINT.\n",
+      program_basename
+    );
+    return -1;
+  }
+  return 0;
+}
+
+static void usage_short(void) {
+  fprintf(
+    stderr,
+    "Usage: %s [-t] [-v] [-n count] [-r pps] [-l payload-len]"
+    " [-m src-mac] [-M dst-mac]\n"
+    "       %*s -s src-ip[-src-ip] -S src-port[-src-port]\n"
+    "       %*s -d dst-ip[-dst-ip] -D dst-port[-dst-port] <interface>\n",
+    program_basename,
+    (int) strlen(program_basename), "",
+    (int) strlen(program_basename), ""
+  );
+}
+
+static int parse_addr_range(const char *str, struct range *r) {
+  char buf[2 * INET_ADDRSTRLEN];
+  char *dash = NULL;
+  struct in_addr addr;
+
+  if (strlen(str) >= sizeof(buf)) {
+    return -1;
+  }
+  strcpy(buf, str);
+
+  dash = strchr(buf, '-');
+  if (dash) {
+    *dash = '\0';
+  }
+
+  if (inet_pton(AF_INET, buf, &addr) != 1) {
+    return -1;
+  }
+  r->first = ntohl(addr.s_addr);
+  r->last = r->first;
+
+  if (dash) {
+    if (inet_pton(AF_INET, dash + 1, &addr) != 1) {
+      return -1;
+    }
+    r->last = ntohl(addr.s_addr);
+  }
+
+  return r->first <= r->last ? 0 : -1;
+}
+
+static int parse_port_range(const char *str, struct range *r) {
+  char *end = NULL;
+  unsigned long first = 0;
+  unsigned long last = 0;
+
+  first = strtoul(str, &end, 10);
+  last = first;
+  if (*end == '-') {
+    last = strtoul(end + 1, &end, 10);
+  }
+
+  if (*end || first > 65535 || last > 65535 || first > last) {
+    return -1;
+  }
+
+  r->first = first;
+  r->last = last;
+
+  return 0;
+}
+
+static int parse_mac(const char *str, unsigned char *mac) {
+  unsigned int b[MAC_ADDR_LEN];
+  char trailing;
+
+  if (
+    sscanf(
+      str,
+      "%x:%x:%x:%x:%x:%x%c",
+      &b[0], &b[1], &b[2], &b[3], &b[4], &b[5], &trailing
+    ) != MAC_ADDR_LEN
+  ) {
+    return -1;
+  }
+
+  for (int i = 0; i < MAC_ADDR_LEN; i++) {
+    if (b[i] > 0xff) {
+      return -1;
+    }
+    mac[i] = b[i];
+  }
+
+  return 0;
+}
+
+static uint32_t checksum_add(uint32_t sum, const unsigned char *p,
+                                                            unsigned int len) {
+  unsigned int i;
+
+  for (i = 0; i + 1 < len; i += 2) {
+    sum += ((uint32_t) p[i] << 8) | p[i + 1];
+  }
+  if (i < len) {
+    sum += (uint32_t) p[i] << 8;
+  }
+
+  return sum;
+}
+
+static void checksum_store(unsigned char *p, uint32_t sum) {
+  while (sum >> 16) {
+    sum = (sum & 0xffff) + (sum >> 16);
+  }
+  sum = ~sum & 0xffff;
+  p[0] = sum >> 8;
+  p[1] = sum & 0xff;
+}
+
+static void put16(unsigned char *p, uint32_t v) {
+  p[0] = (v >> 8) & 0xff;
+  p[1] = v & 0xff;
+}
+
+static void put32(unsigned char *p, uint32_t v) {
+  put16(p, v >> 16);
+  put16(p + 2, v);
+}
+
+/*
+ * Fill in everything which doesn't vary between flows; build_frame() only
+ * rewrites addresses, ports, the ip id, and checksums.
+ */
+static unsigned int build_template(unsigned char *frame,
+                                       const unsigned char *src_mac,
+                                       const unsigned char *dst_mac,
+                                       int tcp, unsigned int payload_len) {
+  unsigned int l4_len = (tcp ? TCP_HEADER_LEN : UDP_HEADER_LEN) + payload_len;
+  unsigned char *ip = &frame[IPV4_HEADER_OFFSET];
+  unsigned char *l4 = &frame[L4_HEADER_OFFSET];
+
+  memset(frame, 0, L4_HEADER_OFFSET + l4_len);
+
+  memcpy(&frame[0], dst_mac, MAC_ADDR_LEN);
+  memcpy(&frame[MAC_ADDR_LEN], src_mac, MAC_ADDR_LEN);
+  put16(&frame[2 * MAC_ADDR_LEN], 0x0800);
+
+  ip[0] = 0x45;
+  put16(&frame[IPV4_TOTAL_LEN_OFFSET], IPV4_HEADER_LEN + l4_len);
+  ip[6] = 0x40; // don't fragment
+  ip[8] = 64;
+  ip[9] = tcp ? IPPROTO_TCP : IPPROTO_UDP;
+
+  if (tcp) {
+    put32(&l4[4], 1);   // sequence number
+    l4[12] = 5 << 4;    // data offset
+    l4[13] = 0x02;      // SYN
+    put16(&l4[14], 65535);
+  } else {
+    put16(&frame[UDP_LEN_OFFSET], l4_len);
+  }
+
+  for (unsigned int i = 0; i < payload_len; i++) {
+    frame[L4_HEADER_OFFSET + l4_len - payload_len + i] = 'x';
+  }
+
+  return L4_HEADER_OFFSET + l4_len;
+}
+
+static void build_frame(unsigned char *frame, unsigned int len, int tcp,
+                               uint32_t saddr, uint32_t sport,
+                               uint32_t daddr, uint32_t dport, uint16_t id) {
+  unsigned int l4_len = len - L4_HEADER_OFFSET;
+  unsigned char pseudo[4];
+  uint32_t sum = 0;
+
+  put16(&frame[IPV4_IDENT_OFFSET], id);
+  put32(&frame[IPV4_SADDR_OFFSET], saddr);
+  put32(&frame[IPV4_DADDR_OFFSET], daddr);
+  put16(&frame[IPV4_CKSM_OFFSET], 0);
+  checksum_store(
+    &frame[IPV4_CKSM_OFFSET],
+    checksum_add(0, &frame[IPV4_HEADER_OFFSET], IPV4_HEADER_LEN)
+  );
+
+  put16(&frame[L4_SPORT_OFFSET], sport);
+  put16(&frame[L4_DPORT_OFFSET], dport);
+
+  /*
+   * A zero udp checksum means "none" over ipv4; tcp has no such escape, so
+   * sum the pseudo header and segment.
+   */
+  if (tcp) {
+    put16(&frame[TCP_CKSM_OFFSET], 0);
+    sum = checksum_add(sum, &frame[IPV4_SADDR_OFFSET], 8);
+    pseudo[0] = 0;
+    pseudo[1] = IPPROTO_TCP;
+    put16(&pseudo[2], l4_len);
+    sum = checksum_add(sum, pseudo, sizeof(pseudo));
+    sum = checksum_add(sum, &frame[L4_HEADER_OFFSET], l4_len);
+    checksum_store(&frame[TCP_CKSM_OFFSET], sum);
+  } else {
+    put16(&frame[UDP_CKSM_OFFSET], 0);
+  }
+}
+
+/*
+ * Sleep until packets would have been sent at rate packets per second since
+ * start; pacing against the start makes up for slow batches instead of
+ * letting the error compound.
+ */
+static void pace(const struct timespec *start, uintmax_t packets,
+                                                          unsigned long rate) {
+  double seconds = (double) packets / rate;
+  struct timespec deadline;
+
+  deadline.tv_sec = start->tv_sec + (time_t) seconds;
+  deadline.tv_nsec = start->tv_nsec
+                          + (long) ((seconds - (time_t) seconds) * 1000000000);
+  if (deadline.tv_nsec >= 1000000000) {
+    deadline.tv_sec++;
+    deadline.tv_nsec -= 1000000000;
+  }
+
+  while (
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL)
+      && keep_running
+  ) {
+  }
+}
+
+static int get_if_mac(const char *ifname, unsigned char *mac) {
+  struct ifreq ifr;
+  int fd = socket(AF_INET, SOCK_DGRAM, 0);
+  if (fd < 0) {
+    return -1;
+  }
+
+  memset(&ifr, 0, sizeof(ifr));
+  strncpy(ifr.ifr_name, ifname, IFNAMSIZ - 1);
+  if (ioctl(fd, SIOCGIFHWADDR, &ifr) < 0) {
+    close(fd);
+    return -1;
+  }
+  close(fd);
+
+  memcpy(mac, ifr.ifr_hwaddr.sa_data, MAC_ADDR_LEN);
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  program_basename = basename(argv[0]);
+
+  struct range src = {0, 0};
+  struct range dst = {0, 0};
+  struct range sport = {0, 0};
+  struct range dport = {0, 0};
+  int have_src = 0, have_dst = 0, have_sport = 0, have_dport = 0;
+  int have_src_mac = 0;
+  int tcp = 0;
+  int verbose = 0;
+  unsigned long count = 1;
+  unsigned long rate = 0;
+  unsigned int batch = BATCH_SIZE;
+  unsigned long payload_len = PAYLOAD_LEN_DEFAULT;
+  unsigned char src_mac[MAC_ADDR_LEN];
+  unsigned char dst_mac[MAC_ADDR_LEN] = {0xff, 0xff, 0xff, 0xff, 0xff, 0xff};
+  char *end = NULL;
+  int c;
+
+  while ((c = getopt(argc, argv, "d:D:l:m:M:n:r:s:S:tv")) != -1) {
+    switch (c) {
+      case 'd':
+        have_dst = !parse_addr_range(optarg, &dst);
+        if (!have_dst) {
+          fprintf(stderr, "%s: Invalid address range '%s'.\n",
+                                                     program_basename, optarg);
+          usage_short();
+          return EXIT_FAIL_OPTION;
+        }
+        break;
+      case 'D':
+        have_dport = !parse_port_range(optarg, &dport);
+        if (!have_dport) {
+          fprintf(stderr, "%s: Invalid port range '%s'.\n",
+                                                     program_basename, optarg);
+          usage_short();
+          return EXIT_FAIL_OPTION;
+        }
+        break;
+      case 'l':
+        payload_len = strtoul(optarg, &end, 10);
+        if (*end || payload_len > PAYLOAD_LEN_MAX) {
+          fprintf(stderr, "%s: Invalid payload length '%s'.\n",
+                                                     program_basename, optarg);
+          usage_short();
+          return EXIT_FAIL_OPTION;
+        }
+        break;
+      case 'm':
+        have_src_mac = !parse_mac(optarg, src_mac);
+        if (!have_src_mac) {
+          fprintf(stderr, "%s: Invalid mac '%s'.\n", program_basename, optarg);
+          usage_short();
+          return EXIT_FAIL_OPTION;
+        }
+        break;
+      case 'M':
+        if (parse_mac(optarg, dst_mac)) {
+          fprintf(stderr, "%s: Invalid mac '%s'.\n", program_basename, optarg);
+          usage_short();
+          return EXIT_FAIL_OPTION;
+        }
+        break;
+      case 'n':
+        count = strtoul(optarg, &end, 10);
+        if (*end) {
+          fprintf(stderr, "%s: Invalid count '%s'.\n", program_basename,
+                                                                       optarg);
+          usage_short();
+          return EXIT_FAIL_OPTION;
+        }
+        break;
+      case 'r':
+        rate = strtoul(optarg, &end, 10);
+        if (*end) {
+          fprintf(stderr, "%s: Invalid rate '%s'.\n", program_basename,
+                                                                       optarg);
+          usage_short();
+          return EXIT_FAIL_OPTION;
+        }
+        break;
+      case 's':
+        have_src = !parse_addr_range(optarg, &src);
+        if (!have_src) {
+          fprintf(stderr, "%s: Invalid address range '%s'.\n",
+                                                     program_basename, optarg);
+          usage_short();
+          return EXIT_FAIL_OPTION;
+        }
+        break;
+      case 'S':
+        have_sport = !parse_port_range(optarg, &sport);
+        if (!have_sport) {
+          fprintf(stderr, "%s: Invalid port range '%s'.\n",
+                                                     program_basename, optarg);
+          usage_short();
+          return EXIT_FAIL_OPTION;
+        }
+        break;
+      case 't':
+        tcp = 1;
+        break;
+      case 'v':
+        verbose = 1;
+        break;
+      default:
+        usage_short();
+        return EXIT_FAIL_OPTION;
+    }
+  }
+
+  if (
+    optind + 1 != argc
+      || !have_src || !have_dst || !have_sport || !have_dport
+  ) {
+    fprintf(
+      stderr,
+      "%s: Invalid number of arguments supplied.\n",
+      program_basename
+    );
+    usage_short();
+    return EXIT_FAIL_OPTION;
+  }
+
+  char *ifname = argv[optind];
+
+  unsigned int ifindex = if_nametoindex(ifname);
+  if (!ifindex) {
+    fprintf(stderr, "%s: Invalid interface '%s'.\n", program_basename, ifname);
+    return EXIT_FAIL;
+  }
+
+  if (!have_src_mac && get_if_mac(ifname, src_mac)) {
+    fprintf(stderr, "%s: Failed to get mac of '%s'.\n", program_basename,
+                                                                       ifname);
+    return EXIT_FAIL;
+  }
+
+  char errbuf[RXTX_ERRBUF_SIZE] = "";
+  struct tx_ring ring;
+  if (tx_ring_open(&ring, ifindex, 0, errbuf) == RXTX_ERROR) {
+    fprintf(stderr, "%s: %s\n", program_basename, errbuf);
+    return EXIT_FAIL;
+  }
+
+  unsigned char frame[ETHERNET_HEADER_LEN + IPV4_HEADER_LEN + TCP_HEADER_LEN
+                                                          + PAYLOAD_LEN_MAX];
+  unsigned int len = build_template(frame, src_mac, dst_mac, tcp,
+                                                                 payload_len);
+
+  /*
+   * When paced, flush about once a millisecond so slow rates don't go out as
+   * bursts of a full batch.
+   */
+  if (rate && rate / 1000 < batch) {
+    batch = rate / 1000 ? rate / 1000 : 1;
+  }
+
+  setup_signals();
+
+  /*
+   * Flows are walked with the source port varying fastest, so a short run
+   * still covers many 4-tuples. With -v each flow is printed once, in the
+   * argument order contrib/rss-hash takes, so the two can be compared.
+   */
+  uintmax_t flows = 0;
+  uintmax_t packets = 0;
+  uint16_t id = 0;
+  struct timespec start, stop;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+
+  for (unsigned long n = 0; keep_running && (!count || n < count); n++) {
+    uint64_t d, s, dp, sp;
+    for (d = dst.first; keep_running && d <= dst.last; d++) {
+      for (s = src.first; keep_running && s <= src.last; s++) {
+        for (dp = dport.first; keep_running && dp <= dport.last; dp++) {
+          for (sp = sport.first; keep_running && sp <= sport.last; sp++) {
+            build_frame(frame, len, tcp, s, sp, d, dp, id++);
+
+            while (tx_ring_enqueue(&ring, frame, len) == TX_RING_FULL) {
+              if (tx_ring_flush(&ring) == RXTX_ERROR) {
+                fprintf(stderr, "%s: %s\n", program_basename, errbuf);
+                return EXIT_FAIL;
+              }
+            }
+            packets++;
+
+            if (tx_ring_get_queued(&ring) >= batch) {
+              if (tx_ring_flush(&ring) == RXTX_ERROR) {
+                fprintf(stderr, "%s: %s\n", program_basename, errbuf);
+                return EXIT_FAIL;
+              }
+              if (rate) {
+                pace(&start, packets, rate);
+              }
+            }
+
+            if (n == 0) {
+              flows++;
+              if (verbose) {
+                struct in_addr sa = { htonl(s) };
+                struct in_addr da = { htonl(d) };
+                char sbuf[INET_ADDRSTRLEN], dbuf[INET_ADDRSTRLEN];
+                printf(
+                  "%s %u %s %u\n",
+                  inet_ntop(AF_INET, &sa, sbuf, sizeof(sbuf)), (unsigned) sp,
+                  inet_ntop(AF_INET, &da, dbuf, sizeof(dbuf)), (unsigned) dp
+                );
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+
+  if (tx_ring_flush(&ring) == RXTX_ERROR) {
+    fprintf(stderr, "%s: %s\n", program_basename, errbuf);
+    return EXIT_FAIL;
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &stop);
+  double seconds = (stop.tv_sec - start.tv_sec)
+                              + (stop.tv_nsec - start.tv_nsec) / 1000000000.0;
+
+  tx_ring_close(&ring);
+
+  fprintf(
+    stderr,
+    "%ju packets sent for %ju flows in %.3f seconds (%.0f pps).\n",
+    packets, flows, seconds, seconds > 0 ? packets / seconds : 0
+  );
+
+  return EXIT_OK;
+}
@@ -6,14 +6,217 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#define _GNU_SOURCE // for ffsl()
+
 #include "ring_set.h"
 
+#include <errno.h>  // for EINVAL, errno
+#include <sched.h>  // for CPU_ALLOC(), CPU_ALLOC_SIZE(), CPU_FREE(),
+                    //     CPU_SET_S()
+#include <string.h> // for ffsl(), memcpy()
+
+#define RING_SET_OP_AND 0
+#define RING_SET_OP_OR  1
+#define RING_SET_OP_XOR 2
+
+/*
+ * CPU_ALLOC_SIZE() always rounds up to a whole number of longs, so we're able
+ * to walk ring sets a word at a time.
+ */
+#define RING_SET_WORD_BITS (8 * sizeof(unsigned long))
+
+#define ring_set_words(ring_set) ((ring_set)->size / sizeof(unsigned long))
+
+/* ========================================================================= */
+static unsigned long ring_set_word(const ring_set_t *ring_set, size_t word) {
+  if (word >= ring_set_words(ring_set)) {
+    return 0;
+  }
+  return ((const unsigned long *)ring_set->set)[word];
+}
+
+/* ========================================================================= */
+int ring_set_init(ring_set_t *ring_set, int setsize) {
+  ring_set->set = NULL;
+  ring_set->size = 0;
+
+  if (setsize > 0) {
+    return ring_set_resize(ring_set, setsize);
+  }
+
+  return 0;
+}
+
+/* ========================================================================= */
+void ring_set_destroy(ring_set_t *ring_set) {
+  if (ring_set->set) {
+    CPU_FREE(ring_set->set);
+  }
+  ring_set->set = NULL;
+  ring_set->size = 0;
+}
+
+/* ========================================================================= */
+int ring_set_resize(ring_set_t *ring_set, int setsize) {
+  cpu_set_t *set = NULL;
+  size_t size = 0;
+
+  if (setsize < 0 || setsize > RING_SETSIZE_MAX) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  /*
+   * Ring sets only ever grow; shrinking would silently drop members.
+   */
+  size = CPU_ALLOC_SIZE(setsize);
+  if (size <= ring_set->size) {
+    return 0;
+  }
+
+  set = CPU_ALLOC(setsize);
+  if (!set) {
+    return -1;
+  }
+  CPU_ZERO_S(size, set);
+
+  if (ring_set->set) {
+    memcpy(set, ring_set->set, ring_set->size);
+    CPU_FREE(ring_set->set);
+  }
+
+  ring_set->set = set;
+  ring_set->size = size;
+
+  return 0;
+}
+
+/* ========================================================================= */
+int ring_set_add(int ring, ring_set_t *ring_set) {
+  if (ring < 0 || ring >= RING_SETSIZE_MAX) {
+    return 0;
+  }
+
+  if (ring_set_resize(ring_set, ring + 1) == -1) {
+    return -1;
+  }
+
+  CPU_SET_S(ring, ring_set->size, ring_set->set);
+
+  return 0;
+}
+
+/* ========================================================================= */
+int ring_set_copy(ring_set_t *dest, const ring_set_t *src) {
+  if (dest == src) {
+    return 0;
+  }
+
+  if (ring_set_resize(dest, RING_SETSIZE(src)) == -1) {
+    return -1;
+  }
+
+  RING_ZERO(dest);
+
+  if (src->set) {
+    memcpy(dest->set, src->set, src->size);
+  }
+
+  return 0;
+}
+
 /* ========================================================================= */
-int find_next_set_ring(int ring, ring_set_t *ring_set) {
-  for (; ring < RING_SETSIZE; ring++) {
-    if (RING_ISSET(ring, ring_set)) {
-      return ring;
+static int ring_set_combine(ring_set_t *dest, const ring_set_t *a,
+                                               const ring_set_t *b, int op) {
+  size_t i = 0;
+  size_t size = a->size > b->size ? a->size : b->size;
+
+  /*
+   * dest may alias a or b, so resize before reading either of them.
+   */
+  if (ring_set_resize(dest, size * 8) == -1) {
+    return -1;
+  }
+
+  unsigned long *words = (unsigned long *)dest->set;
+
+  for (i = 0; i < ring_set_words(dest); i++) {
+    unsigned long x = ring_set_word(a, i);
+    unsigned long y = ring_set_word(b, i);
+
+    switch (op) {
+      case RING_SET_OP_AND:
+        words[i] = x & y;
+        break;
+      case RING_SET_OP_OR:
+        words[i] = x | y;
+        break;
+      case RING_SET_OP_XOR:
+        words[i] = x ^ y;
+        break;
     }
   }
-  return RING_SETSIZE;
+
+  return 0;
+}
+
+/* ========================================================================= */
+int ring_set_and(ring_set_t *dest, const ring_set_t *a, const ring_set_t *b) {
+  return ring_set_combine(dest, a, b, RING_SET_OP_AND);
+}
+
+/* ========================================================================= */
+int ring_set_equal(const ring_set_t *a, const ring_set_t *b) {
+  size_t i = 0;
+  size_t words = ring_set_words(a) > ring_set_words(b) ? ring_set_words(a)
+                                                       : ring_set_words(b);
+
+  for (i = 0; i < words; i++) {
+    if (ring_set_word(a, i) != ring_set_word(b, i)) {
+      return 0;
+    }
+  }
+
+  return 1;
+}
+
+/* ========================================================================= */
+int ring_set_or(ring_set_t *dest, const ring_set_t *a, const ring_set_t *b) {
+  return ring_set_combine(dest, a, b, RING_SET_OP_OR);
+}
+
+/* ========================================================================= */
+int ring_set_xor(ring_set_t *dest, const ring_set_t *a, const ring_set_t *b) {
+  return ring_set_combine(dest, a, b, RING_SET_OP_XOR);
+}
+
+/* ========================================================================= */
+int find_next_set_ring(int ring, const ring_set_t *ring_set) {
+  size_t word = 0;
+  unsigned long bits = 0;
+
+  if (ring < 0) {
+    ring = 0;
+  }
+
+  word = ring / RING_SET_WORD_BITS;
+  if (word >= ring_set_words(ring_set)) {
+    return RING_SETSIZE(ring_set);
+  }
+
+  /*
+   * Mask off the members below ring in the first word, then skip whole empty
+   * words; the cost is proportional to the number of words, not members.
+   */
+  bits = ring_set_word(ring_set, word) & (~0UL << (ring % RING_SET_WORD_BITS));
+
+  while (!bits) {
+    word++;
+    if (word >= ring_set_words(ring_set)) {
+      return RING_SETSIZE(ring_set);
+    }
+    bits = ring_set_word(ring_set, word);
+  }
+
+  return word * RING_SET_WORD_BITS + ffsl((long)bits) - 1;
 }
@@ -11,41 +11,75 @@
 
 #define _GNU_SOURCE
 
-#include <sched.h> // for CPU_AND(), CPU_CLR(), CPU_COUNT(), CPU_EQUAL(),
-                   //     CPU_ISSET(), CPU_OR(), CPU_SET(), CPU_SETSIZE,
-                   //     cpu_set_t, CPU_XOR(), CPU_ZERO()
+#include <sched.h>  // for CPU_CLR_S(), CPU_COUNT_S(), CPU_ISSET_S(),
+                    //     cpu_set_t, CPU_ZERO_S()
+#include <stddef.h> // for size_t
 
-#define ring_set_t      cpu_set_t
+/*
+ * Ring sets are dynamically sized cpu sets (see CPU_ALLOC(3)) so they are not
+ * bound by CPU_SETSIZE. A set grows as members are added; members at or
+ * beyond RING_SETSIZE_MAX are silently ignored, the same as CPU_SET() does
+ * for members at or beyond CPU_SETSIZE.
+ */
+struct ring_set {
+  cpu_set_t *set;
+  size_t    size; // in bytes, as expected by the CPU_*_S() macros
+};
+
+#define ring_set_t      struct ring_set
+
+#define RING_SETSIZE_MAX 65536
+
+#define RING_SETSIZE(ring_set) ((int)((ring_set)->size * 8))
+
+#define RING_CLR(ring, ring_set) \
+  CPU_CLR_S((ring), (ring_set)->size, (ring_set)->set)
+#define RING_COUNT(ring_set) \
+  CPU_COUNT_S((ring_set)->size, (ring_set)->set)
+#define RING_ISSET(ring, ring_set) \
+  CPU_ISSET_S((ring), (ring_set)->size, (ring_set)->set)
+#define RING_SET(ring, ring_set) \
+  ring_set_add((ring), (ring_set))
+#define RING_ZERO(ring_set)                               \
+  do {                                                    \
+    if ((ring_set)->set) {                                \
+      CPU_ZERO_S((ring_set)->size, (ring_set)->set);      \
+    }                                                     \
+  } while (0)
+
+#define RING_AND(...)   ring_set_and(__VA_ARGS__)
+#define RING_EQUAL(...) ring_set_equal(__VA_ARGS__)
+#define RING_OR(...)    ring_set_or(__VA_ARGS__)
+#define RING_XOR(...)   ring_set_xor(__VA_ARGS__)
 
-#define RING_SETSIZE    CPU_SETSIZE
+int ring_set_init(ring_set_t *ring_set, int setsize);
+void ring_set_destroy(ring_set_t *ring_set);
+int ring_set_resize(ring_set_t *ring_set, int setsize);
 
-#define RING_CLR(...)   CPU_CLR(__VA_ARGS__)
-#define RING_COUNT(...) CPU_COUNT(__VA_ARGS__)
-#define RING_ISSET(...) CPU_ISSET(__VA_ARGS__)
-#define RING_SET(...)   CPU_SET(__VA_ARGS__)
-#define RING_ZERO(...)  CPU_ZERO(__VA_ARGS__)
+int ring_set_add(int ring, ring_set_t *ring_set);
+int ring_set_copy(ring_set_t *dest, const ring_set_t *src);
 
-#define RING_AND(...)   CPU_AND(__VA_ARGS__)
-#define RING_EQUAL(...) CPU_EQUAL(__VA_ARGS__)
-#define RING_OR(...)    CPU_OR(__VA_ARGS__)
-#define RING_XOR(...)   CPU_XOR(__VA_ARGS__)
+int ring_set_and(ring_set_t *dest, const ring_set_t *a, const ring_set_t *b);
+int ring_set_equal(const ring_set_t *a, const ring_set_t *b);
+int ring_set_or(ring_set_t *dest, const ring_set_t *a, const ring_set_t *b);
+int ring_set_xor(ring_set_t *dest, const ring_set_t *a, const ring_set_t *b);
 
 #define for_each_ring_in_range(ring, first, last) \
   for (                                           \
     (ring) = (first);                             \
-    (ring) <= (last) && (ring) < RING_SETSIZE;    \
+    (ring) <= (last);                             \
     (ring)++                                      \
   )
 
 #define for_each_ring_in_size(ring, cardinality) \
   for_each_ring_in_range((ring), 0, (cardinality) - 1)
 
-int find_next_set_ring(int ring, ring_set_t *ring_set);
+int find_next_set_ring(int ring, const ring_set_t *ring_set);
 
 #define for_each_set_ring_in_range(ring, ring_set, first, last) \
   for (                                                         \
     (ring) = find_next_set_ring((first), (ring_set));           \
-    (ring) <= (last) && (ring) < RING_SETSIZE;                  \
+    (ring) <= (last) && (ring) < RING_SETSIZE(ring_set);        \
     (ring) = find_next_set_ring((ring) + 1, (ring_set))         \
   )
 
@@ -0,0 +1,824 @@
+/*
+ * Copyright (c) 2019-present StackPath, LLC
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ * rss.c -- predict toeplitz rss queue selection with an ebpf fanout program
+ */
+
+#define _GNU_SOURCE
+
+#include "rss.h"
+
+#include "ebpf.h"       // for EBPF_LOG_BUF_SIZE, ebpf_map_create(),
+                        //     ebpf_map_update_elem(), ebpf_prog_load()
+#include "ethtool.h"    // for ETHTOOL_RSS_HASH_TOP, ethtool_rss,
+                        //     ethtool_rss_destroy(), ethtool_rss_get(),
+                        //     ethtool_rx_flow_hash_get()
+#include "rxtx_error.h" // for RXTX_ERROR, rxtx_fill_errbuf()
+
+#include <linux/bpf.h>       // for __sk_buff, bpf_insn, BPF_*,
+                             //     BPF_FUNC_map_lookup_elem,
+                             //     BPF_MAP_TYPE_ARRAY, BPF_PSEUDO_MAP_FD
+#include <linux/ethtool.h>   // for RXH_L4_B_0_1, RXH_L4_B_2_3, UDP_V4_FLOW
+#include <linux/filter.h>    // for SKF_NET_OFF
+#include <linux/if_ether.h>  // for ETH_HLEN, ETH_P_8021AD, ETH_P_8021Q,
+                             //     ETH_P_IP, ETH_P_IPV6
+#include <netinet/in.h>      // for IPPROTO_DSTOPTS, IPPROTO_HOPOPTS,
+                             //     IPPROTO_ROUTING, IPPROTO_TCP, IPPROTO_UDP
+#include <arpa/inet.h>       // for htons()
+
+#include <ctype.h>   // for isspace(), isxdigit()
+#include <errno.h>   // for errno
+#include <stdbool.h> // for bool, false, true
+#include <stddef.h>  // for offsetof()
+#include <stdio.h>   // for FILE, ferror(), getline(), sscanf()
+#include <stdlib.h>  // for calloc(), free(), malloc(), strtoul()
+#include <string.h>  // for memcpy(), memset(), strchr(), strcmp(), strcspn(),
+                     //     strerror(), strlen(), strncmp()
+#include <unistd.h>  // for close()
+
+#define RSS_LICENSE "Dual MIT/GPL"
+
+#define RSS_HASH_KEY_LINE "RSS hash key:"
+#define RSS_HASH_FUNCTION_LINE "RSS hash function:"
+#define RSS_INDIR_LINE "RX flow hash indirection table for %*s with %d RX ring"
+
+/*
+ * The generated program is around 11 instructions per hashed input byte; an
+ * ipv4 and an ipv6 path together stay well under this.
+ */
+#define RSS_PROG_MAX 1024
+
+/*
+ * ipv6 extension headers followed before giving up on finding the ports.
+ */
+#define RSS_IPV6_EXT_MAX 8
+
+/*
+ * Registers used by the generated program. LD_ABS and LD_IND require the
+ * context in r6 and clobber r0 through r5, so everything we keep across
+ * packet loads and helper calls lives in r6 through r9.
+ */
+#define RSS_REG_CTX  6
+#define RSS_REG_IHL  7
+#define RSS_REG_HASH 8
+#define RSS_REG_L4   9
+
+#define RSS_INSN(code, dst, src, off, imm) \
+  ((struct bpf_insn){ (code), (dst), (src), (off), (imm) })
+
+struct rss_prog {
+  struct bpf_insn insns[RSS_PROG_MAX];
+  int             len;
+};
+
+/* ========================================================================= */
+static int hex2int(char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  }
+  return c - 'A' + 10;
+}
+
+/* ========================================================================= */
+int rss_parse_key(const char *str, uint8_t *key, int *key_len) {
+  int len = 0;
+
+  while (isspace(*str)) {
+    str++;
+  }
+
+  while (*str && !isspace(*str)) {
+    if (!isxdigit(str[0]) || !isxdigit(str[1])) {
+      return -1;
+    }
+    if (len == RSS_KEY_MAX) {
+      return -1;
+    }
+
+    key[len++] = (hex2int(str[0]) << 4) | hex2int(str[1]);
+    str += 2;
+
+    if (*str == ':') {
+      str++;
+      if (!isxdigit(*str)) {
+        return -1;
+      }
+    }
+  }
+
+  if (!len) {
+    return -1;
+  }
+
+  *key_len = len;
+
+  return 0;
+}
+
+/* ========================================================================= */
+uint32_t rss_toeplitz_hash(const uint8_t *key, int key_len,
+                                             const uint8_t *data, int len) {
+  uint32_t hash = 0;
+  uint32_t v = 0;
+  int i, b;
+
+  /*
+   * Key bits past the end of the key are taken to be zero, so short keys
+   * still produce a (weaker) hash for long inputs.
+   */
+  for (i = 0; i < 4; i++) {
+    v <<= 8;
+    if (i < key_len) {
+      v |= key[i];
+    }
+  }
+
+  for (i = 0; i < len; i++) {
+    for (b = 0; b < 8; b++) {
+      if (data[i] & (0x80 >> b)) {
+        hash ^= v;
+      }
+      v <<= 1;
+      if (i + 4 < key_len && (key[i + 4] & (0x80 >> b))) {
+        v |= 1;
+      }
+    }
+  }
+
+  return hash;
+}
+
+/* ========================================================================= */
+void rss_table_fill(const uint8_t *key, int key_len, uint32_t *table) {
+  uint8_t data[RSS_INPUT_MAX];
+  int pos, byte;
+
+  /*
+   * toeplitz() is linear in its input, so table[pos * 256 + byte] (the hash
+   * of byte at position pos with every other byte zero) is all it takes to
+   * hash any input a byte at a time.
+   */
+  memset(data, 0, sizeof(data));
+  for (pos = 0; pos < RSS_INPUT_MAX; pos++) {
+    for (byte = 0; byte < 256; byte++) {
+      data[pos] = byte;
+      table[pos * 256 + byte] = rss_toeplitz_hash(key, key_len, data, pos + 1);
+    }
+    data[pos] = 0;
+  }
+}
+
+/* ========================================================================= */
+uint32_t rss_table_hash(const uint32_t *table, const uint8_t *data, int len) {
+  uint32_t hash = 0;
+  int pos;
+
+  for (pos = 0; pos < len; pos++) {
+    hash ^= table[pos * 256 + data[pos]];
+  }
+
+  return hash;
+}
+
+/* ========================================================================= */
+int rss_input_from_frame(const uint8_t *frame, int len, int flags,
+                                                              uint8_t *input) {
+  const uint8_t *ip = NULL;
+  int proto = 0;
+  int ihl = 0;
+  int off = ETH_HLEN;
+  int type = 0;
+  int i = 0;
+
+  if (len < ETH_HLEN) {
+    return 0;
+  }
+  type = (frame[off - 2] << 8) | frame[off - 1];
+
+  /*
+   * Tags are usually stripped on receive, but a capture from a device which
+   * doesn't offload vlans still hashes by the inner header.
+   */
+  while ((type == ETH_P_8021Q || type == ETH_P_8021AD) && len >= off + 4) {
+    type = (frame[off + 2] << 8) | frame[off + 3];
+    off += 4;
+  }
+
+  ip = frame + off;
+  len -= off;
+
+  /*
+   * This follows rss_prog_build() exactly; ports are hashed for tcp (and udp
+   * without RSS_FLAG_UDP_2TUPLE) but never for fragments, and up to
+   * RSS_IPV6_EXT_MAX hop-by-hop, routing, and destination options headers
+   * are skipped to find them.
+   */
+  if (type == ETH_P_IP && len >= 20) {
+    memcpy(input, ip + 12, 8);
+    if (((ip[6] << 8) | ip[7]) & 0x3fff) {
+      return 8;
+    }
+    proto = ip[9];
+    ihl = (ip[0] & 0x0f) << 2;
+    if ((proto == IPPROTO_TCP ||
+           (proto == IPPROTO_UDP && !(flags & RSS_FLAG_UDP_2TUPLE))) &&
+                                                          len >= ihl + 4) {
+      memcpy(input + 8, ip + ihl, 4);
+      return 12;
+    }
+    return 8;
+  }
+
+  if (type == ETH_P_IPV6 && len >= 40) {
+    memcpy(input, ip + 8, 32);
+    proto = ip[6];
+    ihl = 40;
+    for (i = 0; i < RSS_IPV6_EXT_MAX && len >= ihl + 8; i++) {
+      if (proto != IPPROTO_HOPOPTS && proto != IPPROTO_ROUTING &&
+                                                 proto != IPPROTO_DSTOPTS) {
+        break;
+      }
+      proto = ip[ihl];
+      ihl += (ip[ihl + 1] + 1) * 8;
+    }
+    if ((proto == IPPROTO_TCP ||
+           (proto == IPPROTO_UDP && !(flags & RSS_FLAG_UDP_2TUPLE))) &&
+                                                          len >= ihl + 4) {
+      memcpy(input + 32, ip + ihl, 4);
+      return 36;
+    }
+    return 32;
+  }
+
+  return 0;
+}
+
+/* ========================================================================= */
+static int rss_config_read_indir(struct rss_config *p, const char *line) {
+  char *end = NULL;
+  unsigned long queue = 0;
+
+  line = strchr(line, ':') + 1;
+
+  while (1) {
+    while (isspace(*line)) {
+      line++;
+    }
+    if (!*line) {
+      break;
+    }
+
+    queue = strtoul(line, &end, 10);
+    if (end == line || p->indir_size == RSS_INDIR_MAX) {
+      return -1;
+    }
+
+    p->indir[p->indir_size++] = queue;
+    line = end;
+  }
+
+  return 0;
+}
+
+/* ========================================================================= */
+int rss_config_read(struct rss_config *p, FILE *in, const char *name,
+                                                                char *errbuf) {
+  char *line = NULL;
+  size_t cap = 0;
+  char function[32];
+  char state[4];
+  int rings = 0;
+  int index = 0;
+  int i = 0;
+  int status = RXTX_ERROR;
+
+  bool want_key = false;
+  bool in_function = false;
+
+  memset(p, 0, sizeof(*p));
+  p->errbuf = errbuf;
+
+  p->indir = calloc(RSS_INDIR_MAX, sizeof(*(p->indir)));
+  if (!p->indir) {
+    rxtx_fill_errbuf(p->errbuf, "error reading rss config '%s': %s", name,
+                                                              strerror(errno));
+    return RXTX_ERROR;
+  }
+
+  /*
+   * The format is that of 'ethtool -x', e.g.
+   *
+   *   RX flow hash indirection table for eth0 with 4 RX ring(s):
+   *       0:      0     1     2     3     0     1     2     3
+   *       8:      0     1     2     3     0     1     2     3
+   *   RSS hash key:
+   *   6d:5a:56:da:25:5b:0e:c2:41:67:25:3d:43:a3:8f:b0:d0:ca:2b:cb
+   *   RSS hash function:
+   *       toeplitz: on
+   *       xor: off
+   *
+   * Older ethtool versions print no hash function section. A key line which
+   * doesn't parse (e.g. 'Operation not supported') leaves key_len at zero so
+   * the caller can insist on a key from elsewhere.
+   */
+  while (getline(&line, &cap, in) != -1) {
+    line[strcspn(line, "\r\n")] = '\0';
+
+    if (want_key) {
+      want_key = false;
+      if (rss_parse_key(line, p->key, &(p->key_len))) {
+        p->key_len = 0;
+      }
+      continue;
+    }
+
+    if (strncmp(line, RSS_HASH_KEY_LINE, strlen(RSS_HASH_KEY_LINE)) == 0) {
+      want_key = true;
+      in_function = false;
+      continue;
+    }
+
+    if (strncmp(line, RSS_HASH_FUNCTION_LINE,
+                                       strlen(RSS_HASH_FUNCTION_LINE)) == 0) {
+      in_function = true;
+      continue;
+    }
+
+    if (sscanf(line, RSS_INDIR_LINE, &rings) == 1) {
+      in_function = false;
+      continue;
+    }
+
+    if (in_function) {
+      if (sscanf(line, " %31[^:]: %3s", function, state) == 2 &&
+                                                   strcmp(state, "on") == 0 &&
+                                              strcmp(function, "toeplitz")) {
+        rxtx_fill_errbuf(p->errbuf, "error reading rss config '%s': hash"
+                 " function '%s' is not supported, only toeplitz", name,
+                                                                    function);
+        goto out;
+      }
+      continue;
+    }
+
+    if (isspace(line[0]) && sscanf(line, " %d:", &index) == 1) {
+      if (index != p->indir_size || rss_config_read_indir(p, line)) {
+        rxtx_fill_errbuf(p->errbuf, "error reading rss config '%s': invalid"
+                                  " indirection table line '%s'", name, line);
+        goto out;
+      }
+    }
+  }
+
+  if (ferror(in)) {
+    rxtx_fill_errbuf(p->errbuf, "error reading rss config '%s': %s", name,
+                                                              strerror(errno));
+    goto out;
+  }
+
+  if (!p->indir_size) {
+    rxtx_fill_errbuf(p->errbuf, "error reading rss config '%s': no"
+                                          " indirection table found", name);
+    goto out;
+  }
+
+  /*
+   * Nics index the table with the low bits of the hash, which only covers
+   * every entry when the size is a power of two.
+   */
+  if (p->indir_size & (p->indir_size - 1)) {
+    rxtx_fill_errbuf(p->errbuf, "error reading rss config '%s': indirection"
+          " table size '%d' is not a power of two", name, p->indir_size);
+    goto out;
+  }
+
+  p->queue_count = rings;
+  for (i = 0; i < p->indir_size; i++) {
+    if ((int)p->indir[i] >= p->queue_count) {
+      p->queue_count = p->indir[i] + 1;
+    }
+  }
+
+  status = 0;
+
+out:
+  free(line);
+
+  return status;
+}
+
+/* ========================================================================= */
+int rss_config_set_key(struct rss_config *p, const char *str) {
+  if (rss_parse_key(str, p->key, &(p->key_len))) {
+    p->key_len = 0;
+    rxtx_fill_errbuf(p->errbuf, "invalid rss hash key '%s'", str);
+    return RXTX_ERROR;
+  }
+
+  return 0;
+}
+
+/* ========================================================================= */
+int rss_config_query(struct rss_config *p, const char *ifname, char *errbuf) {
+  struct ethtool_rss rss;
+  uint32_t i = 0;
+
+  memset(p, 0, sizeof(*p));
+  p->errbuf = errbuf;
+
+  if (ethtool_rss_get(&rss, ifname, errbuf) == RXTX_ERROR) {
+    return RXTX_ERROR;
+  }
+
+  /*
+   * Same checks as rss_config_read(), against what 'ethtool -x' would have
+   * printed. A nic which doesn't report its key leaves key_len at zero.
+   */
+  if (rss.hfunc && !(rss.hfunc & ETHTOOL_RSS_HASH_TOP)) {
+    rxtx_fill_errbuf(p->errbuf, "error reading rss config of '%s': hash"
+                         " function is not supported, only toeplitz", ifname);
+    ethtool_rss_destroy(&rss);
+    return RXTX_ERROR;
+  }
+
+  if (!rss.indir_size) {
+    rxtx_fill_errbuf(p->errbuf, "error reading rss config of '%s': no"
+                                        " indirection table reported", ifname);
+    ethtool_rss_destroy(&rss);
+    return RXTX_ERROR;
+  }
+
+  if (rss.indir_size > RSS_INDIR_MAX ||
+                                   (rss.indir_size & (rss.indir_size - 1))) {
+    rxtx_fill_errbuf(p->errbuf, "error reading rss config of '%s':"
+                    " indirection table size '%u' is not a power of two",
+                                                     ifname, rss.indir_size);
+    ethtool_rss_destroy(&rss);
+    return RXTX_ERROR;
+  }
+
+  p->indir = calloc(RSS_INDIR_MAX, sizeof(*(p->indir)));
+  if (!p->indir) {
+    rxtx_fill_errbuf(p->errbuf, "error reading rss config of '%s': %s",
+                                                     ifname, strerror(errno));
+    ethtool_rss_destroy(&rss);
+    return RXTX_ERROR;
+  }
+
+  memcpy(p->indir, rss.indir, rss.indir_size * sizeof(*(p->indir)));
+  p->indir_size = rss.indir_size;
+  memcpy(p->key, rss.key, rss.key_len);
+  p->key_len = rss.key_len;
+
+  p->queue_count = rss.ring_count;
+  for (i = 0; i < rss.indir_size; i++) {
+    if ((int)p->indir[i] >= p->queue_count) {
+      p->queue_count = p->indir[i] + 1;
+    }
+  }
+
+  ethtool_rss_destroy(&rss);
+
+  return 0;
+}
+
+/* ========================================================================= */
+int rss_flags_query(const char *ifname, int *flags, char *errbuf) {
+  uint64_t fields = 0;
+
+  /*
+   * Nics hash udp by its 4-tuple only when both port fields are enabled;
+   * 'ethtool -N IFACE rx-flow-hash udp4 sdfn'.
+   */
+  if (ethtool_rx_flow_hash_get(ifname, UDP_V4_FLOW, &fields, errbuf)
+                                                             == RXTX_ERROR) {
+    return RXTX_ERROR;
+  }
+
+  if ((fields & (RXH_L4_B_0_1 | RXH_L4_B_2_3))
+                                          != (RXH_L4_B_0_1 | RXH_L4_B_2_3)) {
+    *flags |= RSS_FLAG_UDP_2TUPLE;
+  } else {
+    *flags &= ~RSS_FLAG_UDP_2TUPLE;
+  }
+
+  return 0;
+}
+
+/* ========================================================================= */
+void rss_config_destroy(struct rss_config *p) {
+  free(p->indir);
+  p->indir = NULL;
+  p->indir_size = 0;
+}
+
+/* ========================================================================= */
+static void rss_prog_emit(struct rss_prog *p, struct bpf_insn insn) {
+  p->insns[p->len++] = insn;
+}
+
+/* ========================================================================= */
+static int rss_prog_jump(struct rss_prog *p, int op, int reg, int imm) {
+  rss_prog_emit(p, RSS_INSN(BPF_JMP | op | BPF_K, reg, 0, 0, imm));
+  return p->len - 1;
+}
+
+/* ========================================================================= */
+static void rss_prog_land(struct rss_prog *p, int jump) {
+  p->insns[jump].off = p->len - jump - 1;
+}
+
+/* ========================================================================= */
+static void rss_prog_emit_lookup(struct rss_prog *p, int map_fd) {
+  /* r1 = map, r2 = fp - 4, r0 = bpf_map_lookup_elem(r1, r2) */
+  rss_prog_emit(p, RSS_INSN(BPF_LD | BPF_DW | BPF_IMM, 1, BPF_PSEUDO_MAP_FD,
+                                                                  0, map_fd));
+  rss_prog_emit(p, RSS_INSN(0, 0, 0, 0, 0));
+  rss_prog_emit(p, RSS_INSN(BPF_ALU64 | BPF_MOV | BPF_X, 2, BPF_REG_10, 0,
+                                                                          0));
+  rss_prog_emit(p, RSS_INSN(BPF_ALU64 | BPF_ADD | BPF_K, 2, 0, 0, -4));
+  rss_prog_emit(p, RSS_INSN(BPF_JMP | BPF_CALL, 0, 0, 0,
+                                                  BPF_FUNC_map_lookup_elem));
+}
+
+/* ========================================================================= */
+static void rss_prog_emit_byte(struct rss_prog *p, int table_fd, int pos,
+                                                     int mode, int offset) {
+  /*
+   *   r0 = packet byte
+   *   key = pos * 256 + r0
+   *   if ((v = lookup(table, key)))
+   *     hash ^= *v
+   */
+  rss_prog_emit(p, RSS_INSN(BPF_LD | mode | BPF_B, 0,
+                          mode == BPF_IND ? RSS_REG_IHL : 0, 0, offset));
+  rss_prog_emit(p, RSS_INSN(BPF_ALU64 | BPF_ADD | BPF_K, 0, 0, 0, pos * 256));
+  rss_prog_emit(p, RSS_INSN(BPF_STX | BPF_MEM | BPF_W, BPF_REG_10, 0, -4, 0));
+  rss_prog_emit_lookup(p, table_fd);
+  rss_prog_emit(p, RSS_INSN(BPF_JMP | BPF_JEQ | BPF_K, 0, 0, 2, 0));
+  rss_prog_emit(p, RSS_INSN(BPF_LDX | BPF_MEM | BPF_W, 0, 0, 0, 0));
+  rss_prog_emit(p, RSS_INSN(BPF_ALU64 | BPF_XOR | BPF_X, RSS_REG_HASH, 0, 0,
+                                                                          0));
+}
+
+/* ========================================================================= */
+static void rss_prog_build(struct rss_prog *p, int table_fd, int indir_fd,
+                                                  int indir_size, int flags) {
+  int to_ipv4, to_ipv6, to_hashed[4], to_v4_addrs, to_v4_ports[2],
+                                                              to_v6_ports[2];
+  int to_v6_ext[3], to_v6_addrs[RSS_IPV6_EXT_MAX];
+  int hashed = 0;
+  int pos, i;
+
+  p->len = 0;
+
+  /*
+   * The program reproduces what a toeplitz rss nic does on receive:
+   *
+   *   hash = toeplitz(key, saddr . daddr [. sport . dport])
+   *   return indir[hash & (indir_size - 1)]
+   *
+   * toeplitz() is linear in its input, so the hash is the xor of one
+   * precomputed value per input byte; table[pos * 256 + byte] holds the hash
+   * of byte at position pos with every other byte zero. Packets are read
+   * relative to the network header (SKF_NET_OFF) so tx packets work too.
+   *
+   * Ports are hashed for tcp, and for udp unless RSS_FLAG_UDP_2TUPLE is set,
+   * but never for fragments. For ipv6, up to RSS_IPV6_EXT_MAX hop-by-hop,
+   * routing, and destination options headers are skipped to find them.
+   * Anything which isn't ip hashes to zero, as it would on the nic.
+   */
+  rss_prog_emit(p, RSS_INSN(BPF_ALU64 | BPF_MOV | BPF_X, RSS_REG_CTX, 1, 0,
+                                                                          0));
+  rss_prog_emit(p, RSS_INSN(BPF_ALU64 | BPF_MOV | BPF_K, RSS_REG_HASH, 0, 0,
+                                                                          0));
+  rss_prog_emit(p, RSS_INSN(BPF_ALU64 | BPF_MOV | BPF_K, RSS_REG_L4, 0, 0,
+                                                                          0));
+  rss_prog_emit(p, RSS_INSN(BPF_LDX | BPF_MEM | BPF_W, 0, RSS_REG_CTX,
+                                   offsetof(struct __sk_buff, protocol), 0));
+  to_ipv4 = rss_prog_jump(p, BPF_JEQ, 0, htons(ETH_P_IP));
+  to_ipv6 = rss_prog_jump(p, BPF_JEQ, 0, htons(ETH_P_IPV6));
+  to_hashed[hashed++] = rss_prog_jump(p, BPF_JA, 0, 0);
+
+  /* ipv4 */
+  rss_prog_land(p, to_ipv4);
+  rss_prog_emit(p, RSS_INSN(BPF_LD | BPF_ABS | BPF_H, 0, 0, 0,
+                                                           SKF_NET_OFF + 6));
+  rss_prog_emit(p, RSS_INSN(BPF_ALU64 | BPF_AND | BPF_K, 0, 0, 0, 0x3fff));
+  to_v4_addrs = rss_prog_jump(p, BPF_JNE, 0, 0);
+  rss_prog_emit(p, RSS_INSN(BPF_LD | BPF_ABS | BPF_B, 0, 0, 0,
+                                                           SKF_NET_OFF + 9));
+  rss_prog_emit(p, RSS_INSN(BPF_ALU64 | BPF_MOV | BPF_X, RSS_REG_L4, 0, 0,
+                                                                          0));
+  rss_prog_land(p, to_v4_addrs);
+  for (pos = 0; pos < 8; pos++) {
+    rss_prog_emit_byte(p, table_fd, pos, BPF_ABS, SKF_NET_OFF + 12 + pos);
+  }
+  to_v4_ports[0] = rss_prog_jump(p, BPF_JEQ, RSS_REG_L4, IPPROTO_TCP);
+  to_v4_ports[1] = -1;
+  if (!(flags & RSS_FLAG_UDP_2TUPLE)) {
+    to_v4_ports[1] = rss_prog_jump(p, BPF_JEQ, RSS_REG_L4, IPPROTO_UDP);
+  }
+  to_hashed[hashed++] = rss_prog_jump(p, BPF_JA, 0, 0);
+  for (i = 0; i < 2; i++) {
+    if (to_v4_ports[i] >= 0) {
+      rss_prog_land(p, to_v4_ports[i]);
+    }
+  }
+  rss_prog_emit(p, RSS_INSN(BPF_LD | BPF_ABS | BPF_B, 0, 0, 0, SKF_NET_OFF));
+  rss_prog_emit(p, RSS_INSN(BPF_ALU64 | BPF_AND | BPF_K, 0, 0, 0, 0x0f));
+  rss_prog_emit(p, RSS_INSN(BPF_ALU64 | BPF_LSH | BPF_K, 0, 0, 0, 2));
+  rss_prog_emit(p, RSS_INSN(BPF_ALU64 | BPF_MOV | BPF_X, RSS_REG_IHL, 0, 0,
+                                                                          0));
+  for (pos = 8; pos < 12; pos++) {
+    rss_prog_emit_byte(p, table_fd, pos, BPF_IND, SKF_NET_OFF + pos - 8);
+  }
+  to_hashed[hashed++] = rss_prog_jump(p, BPF_JA, 0, 0);
+
+  /* ipv6 */
+  rss_prog_land(p, to_ipv6);
+  rss_prog_emit(p, RSS_INSN(BPF_LD | BPF_ABS | BPF_B, 0, 0, 0,
+                                                           SKF_NET_OFF + 6));
+  rss_prog_emit(p, RSS_INSN(BPF_ALU64 | BPF_MOV | BPF_X, RSS_REG_L4, 0, 0,
+                                                                          0));
+  rss_prog_emit(p, RSS_INSN(BPF_ALU64 | BPF_MOV | BPF_K, RSS_REG_IHL, 0, 0,
+                                                                         40));
+
+  /*
+   * The walk is unrolled since the verifier won't take a loop. Each step
+   * reads the next header and length before moving past the current one.
+   */
+  for (i = 0; i < RSS_IPV6_EXT_MAX; i++) {
+    to_v6_ext[0] = rss_prog_jump(p, BPF_JEQ, RSS_REG_L4, IPPROTO_HOPOPTS);
+    to_v6_ext[1] = rss_prog_jump(p, BPF_JEQ, RSS_REG_L4, IPPROTO_ROUTING);
+    to_v6_ext[2] = rss_prog_jump(p, BPF_JEQ, RSS_REG_L4, IPPROTO_DSTOPTS);
+    to_v6_addrs[i] = rss_prog_jump(p, BPF_JA, 0, 0);
+    for (pos = 0; pos < 3; pos++) {
+      rss_prog_land(p, to_v6_ext[pos]);
+    }
+    rss_prog_emit(p, RSS_INSN(BPF_LD | BPF_IND | BPF_B, 0, RSS_REG_IHL, 0,
+                                                               SKF_NET_OFF));
+    rss_prog_emit(p, RSS_INSN(BPF_ALU64 | BPF_MOV | BPF_X, RSS_REG_L4, 0, 0,
+                                                                          0));
+    rss_prog_emit(p, RSS_INSN(BPF_LD | BPF_IND | BPF_B, 0, RSS_REG_IHL, 0,
+                                                           SKF_NET_OFF + 1));
+    rss_prog_emit(p, RSS_INSN(BPF_ALU64 | BPF_ADD | BPF_K, 0, 0, 0, 1));
+    rss_prog_emit(p, RSS_INSN(BPF_ALU64 | BPF_LSH | BPF_K, 0, 0, 0, 3));
+    rss_prog_emit(p, RSS_INSN(BPF_ALU64 | BPF_ADD | BPF_X, RSS_REG_IHL, 0, 0,
+                                                                          0));
+  }
+  for (i = 0; i < RSS_IPV6_EXT_MAX; i++) {
+    rss_prog_land(p, to_v6_addrs[i]);
+  }
+
+  for (pos = 0; pos < 32; pos++) {
+    rss_prog_emit_byte(p, table_fd, pos, BPF_ABS, SKF_NET_OFF + 8 + pos);
+  }
+  to_v6_ports[0] = rss_prog_jump(p, BPF_JEQ, RSS_REG_L4, IPPROTO_TCP);
+  to_v6_ports[1] = -1;
+  if (!(flags & RSS_FLAG_UDP_2TUPLE)) {
+    to_v6_ports[1] = rss_prog_jump(p, BPF_JEQ, RSS_REG_L4, IPPROTO_UDP);
+  }
+  to_hashed[hashed++] = rss_prog_jump(p, BPF_JA, 0, 0);
+  for (i = 0; i < 2; i++) {
+    if (to_v6_ports[i] >= 0) {
+      rss_prog_land(p, to_v6_ports[i]);
+    }
+  }
+  for (pos = 32; pos < 36; pos++) {
+    rss_prog_emit_byte(p, table_fd, pos, BPF_IND, SKF_NET_OFF + pos - 32);
+  }
+
+  /* r0 = indir[hash & (indir_size - 1)] */
+  for (i = 0; i < hashed; i++) {
+    rss_prog_land(p, to_hashed[i]);
+  }
+  rss_prog_emit(p, RSS_INSN(BPF_ALU64 | BPF_AND | BPF_K, RSS_REG_HASH, 0, 0,
+                                                              indir_size - 1));
+  rss_prog_emit(p, RSS_INSN(BPF_STX | BPF_MEM | BPF_W, BPF_REG_10,
+                                                       RSS_REG_HASH, -4, 0));
+  rss_prog_emit_lookup(p, indir_fd);
+  rss_prog_emit(p, RSS_INSN(BPF_JMP | BPF_JEQ | BPF_K, 0, 0, 2, 0));
+  rss_prog_emit(p, RSS_INSN(BPF_LDX | BPF_MEM | BPF_W, 0, 0, 0, 0));
+  rss_prog_emit(p, RSS_INSN(BPF_JMP | BPF_EXIT, 0, 0, 0, 0));
+  rss_prog_emit(p, RSS_INSN(BPF_ALU64 | BPF_MOV | BPF_K, 0, 0, 0, 0));
+  rss_prog_emit(p, RSS_INSN(BPF_JMP | BPF_EXIT, 0, 0, 0, 0));
+}
+
+/* ========================================================================= */
+int rss_fanout_load(struct rss_fanout *p, const struct rss_config *config,
+                                                     int flags, char *errbuf) {
+  uint32_t key = 0;
+  uint32_t value = 0;
+  int status = RXTX_ERROR;
+
+  uint32_t *table = NULL;
+  struct rss_prog *prog = NULL;
+
+  p->errbuf = errbuf;
+  p->table_fd = -1;
+  p->indir_fd = -1;
+  p->prog_fd = -1;
+  p->insn_cnt = 0;
+
+  p->log_buf = malloc(EBPF_LOG_BUF_SIZE);
+  prog = malloc(sizeof(*prog));
+  table = malloc(RSS_INPUT_MAX * 256 * sizeof(*table));
+  if (!p->log_buf || !prog || !table) {
+    rxtx_fill_errbuf(p->errbuf, "error loading rss program: %s",
+                                                              strerror(errno));
+    goto out;
+  }
+  p->log_buf[0] = '\0';
+
+  p->table_fd = ebpf_map_create(BPF_MAP_TYPE_ARRAY, sizeof(key),
+                                 sizeof(value), RSS_INPUT_MAX * 256, 0);
+  if (p->table_fd < 0) {
+    rxtx_fill_errbuf(p->errbuf, "error loading rss program: failed to create"
+                                       " hash table map: %s", strerror(errno));
+    goto out;
+  }
+
+  rss_table_fill(config->key, config->key_len, table);
+  for (key = 0; key < RSS_INPUT_MAX * 256; key++) {
+    if (ebpf_map_update_elem(p->table_fd, &key, &table[key], BPF_ANY)) {
+      rxtx_fill_errbuf(p->errbuf, "error loading rss program: failed to"
+                              " fill hash table map: %s", strerror(errno));
+      goto out;
+    }
+  }
+
+  p->indir_fd = ebpf_map_create(BPF_MAP_TYPE_ARRAY, sizeof(key),
+                                      sizeof(value), config->indir_size, 0);
+  if (p->indir_fd < 0) {
+    rxtx_fill_errbuf(p->errbuf, "error loading rss program: failed to create"
+                               " indirection table map: %s", strerror(errno));
+    goto out;
+  }
+
+  for (key = 0; key < (uint32_t)config->indir_size; key++) {
+    if (ebpf_map_update_elem(p->indir_fd, &key, &(config->indir[key]),
+                                                                  BPF_ANY)) {
+      rxtx_fill_errbuf(p->errbuf, "error loading rss program: failed to fill"
+                          " indirection table map: %s", strerror(errno));
+      goto out;
+    }
+  }
+
+  rss_prog_build(prog, p->table_fd, p->indir_fd, config->indir_size, flags);
+  p->insn_cnt = prog->len;
+
+  p->prog_fd = ebpf_prog_load(prog->insns, prog->len, RSS_LICENSE,
+                                               p->log_buf, EBPF_LOG_BUF_SIZE);
+  if (p->prog_fd < 0) {
+    rxtx_fill_errbuf(p->errbuf, "error loading rss program: %s",
+                                                              strerror(errno));
+    goto out;
+  }
+
+  status = 0;
+
+out:
+  free(table);
+  free(prog);
+
+  return status;
+}
+
+/* ========================================================================= */
+int rss_fanout_get_prog_fd(struct rss_fanout *p) {
+  return p->prog_fd;
+}
+
+/* ========================================================================= */
+int rss_fanout_close(struct rss_fanout *p) {
+  /*
+   * The program holds its own references to the maps, and the fanout group
+   * one to the program, so these can be closed as soon as it's attached.
+   */
+  if (p->prog_fd >= 0) {
+    close(p->prog_fd);
+    p->prog_fd = -1;
+  }
+  if (p->indir_fd >= 0) {
+    close(p->indir_fd);
+    p->indir_fd = -1;
+  }
+  if (p->table_fd >= 0) {
+    close(p->table_fd);
+    p->table_fd = -1;
+  }
+
+  free(p->log_buf);
+  p->log_buf = NULL;
+  p->errbuf = NULL;
+
+  return 0;
+}
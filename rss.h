@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2019-present StackPath, LLC
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ * rss.h -- header file to use rss.c
+ */
+
+#ifndef _RSS_H_
+#define _RSS_H_
+
+#include <stdint.h> // for uint8_t, uint32_t
+#include <stdio.h>  // for FILE
+
+#define RSS_KEY_MAX 256
+#define RSS_INDIR_MAX 65536
+
+/*
+ * The longest hash input we model; an ipv6 4-tuple (i.e. two 16 byte
+ * addresses and two 2 byte ports).
+ */
+#define RSS_INPUT_MAX 36
+
+/*
+ * Hash udp by addresses only, as many nics do unless 4-tuple hashing has been
+ * enabled for udp (e.g. 'ethtool -N eth0 rx-flow-hash udp4 sdfn').
+ */
+#define RSS_FLAG_UDP_2TUPLE 0x1
+
+struct rss_config {
+  uint8_t  key[RSS_KEY_MAX];
+  int      key_len;
+  uint32_t *indir;
+  int      indir_size;
+  int      queue_count;
+  char     *errbuf;
+};
+
+struct rss_fanout {
+  int  table_fd;
+  int  indir_fd;
+  int  prog_fd;
+  int  insn_cnt;
+  char *log_buf;
+  char *errbuf;
+};
+
+int rss_parse_key(const char *str, uint8_t *key, int *key_len);
+uint32_t rss_toeplitz_hash(const uint8_t *key, int key_len,
+                                             const uint8_t *data, int len);
+void rss_table_fill(const uint8_t *key, int key_len, uint32_t *table);
+uint32_t rss_table_hash(const uint32_t *table, const uint8_t *data, int len);
+int rss_input_from_frame(const uint8_t *frame, int len, int flags,
+                                                               uint8_t *input);
+
+int rss_config_read(struct rss_config *p, FILE *in, const char *name,
+                                                                char *errbuf);
+int rss_config_query(struct rss_config *p, const char *ifname, char *errbuf);
+int rss_config_set_key(struct rss_config *p, const char *str);
+int rss_flags_query(const char *ifname, int *flags, char *errbuf);
+void rss_config_destroy(struct rss_config *p);
+
+int rss_fanout_load(struct rss_fanout *p, const struct rss_config *config,
+                                                     int flags, char *errbuf);
+int rss_fanout_get_prog_fd(struct rss_fanout *p);
+int rss_fanout_close(struct rss_fanout *p);
+
+#endif // _RSS_H_
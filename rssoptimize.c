@@ -0,0 +1,1462 @@
+/*
+ * Copyright (c) 2019-present StackPath, LLC
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#define _GNU_SOURCE // for GNU basename()
+
+#include "rss.h"        // for RSS_FLAG_UDP_2TUPLE, RSS_INDIR_MAX,
+                        //     RSS_INPUT_MAX, RSS_KEY_MAX, rss_config,
+                        //     rss_config_destroy(), rss_config_query(),
+                        //     rss_config_read(), rss_config_set_key(),
+                        //     rss_flags_query(), rss_input_from_frame(),
+                        //     rss_table_fill(), rss_table_hash()
+#include "rxtx.h"       // for program_basename
+#include "rxtx_error.h" // for RXTX_ERRBUF_SIZE, RXTX_ERROR,
+                        //     rxtx_fill_errbuf()
+
+#include <arpa/inet.h>  // for htons(), inet_pton()
+#include <netinet/in.h> // for AF_INET, AF_INET6
+
+#include <ctype.h>    // for isspace()
+#include <errno.h>    // for ENOMEM, errno
+#include <getopt.h>   // for getopt_long(), optarg, optind, option, optopt
+#include <inttypes.h> // for strtoumax()
+#include <limits.h>   // for INT_MAX
+#include <pcap.h>     // for pcap_close(), PCAP_ERROR, PCAP_ERRBUF_SIZE,
+                      //     pcap_geterr(), pcap_next_ex(),
+                      //     pcap_open_offline(), pcap_pkthdr, pcap_t
+#include <pthread.h>  // for pthread_create(), pthread_join(), pthread_t
+#include <stdbool.h>  // for bool, false, true
+#include <stdint.h>   // for intptr_t, uint8_t, uint16_t, uint32_t,
+                      //     uint64_t, uintmax_t
+#include <stdio.h>    // for asprintf(), fclose(), FILE, fflush(), ferror(),
+                      //     fopen(), fprintf(), fputs(), getline(), NULL,
+                      //     printf(), putchar(), puts(), sscanf(), stderr,
+                      //     stdin, stdout
+#include <stdlib.h>   // for calloc(), free(), qsort(), rand_r()
+#include <string.h>   // for GNU basename(), memcmp(), memcpy(), memset(),
+                      //     strcmp(), strerror(), strlen()
+#include <unistd.h>   // for _SC_NPROCESSORS_ONLN, sysconf()
+
+#define EXIT_OK          0
+#define EXIT_FAIL        1
+#define EXIT_FAIL_OPTION 2
+
+#define OPTION_COUNT_BASE 10
+
+/*
+ * Moves and swaps between the busiest and idlest queue stop once neither
+ * helps; swaps are quadratic in entries per queue, so huge tables only get
+ * moves.
+ */
+#define OPTIMIZE_SWAP_ENTRIES_MAX 4096
+
+/*
+ * Packets are merged into flows as they're read, in an open addressed table
+ * which starts this big and doubles whenever it gets half full.
+ */
+#define OPTIMIZE_FLOW_SLOTS_MIN 1024
+
+#define USAGE_PRINT_OPT_COL_SEP "# "
+#define USAGE_PRINT_OPT_COL_IND "  "
+
+#define USAGE_PRINT_OPT_COL_SEP_LEN (strlen(USAGE_PRINT_OPT_COL_SEP))
+#define USAGE_PRINT_OPT_COL_IND_LEN (strlen(USAGE_PRINT_OPT_COL_IND))
+
+#define USAGE_PRINT_OPT_TOTAL_LEN     79
+#define USAGE_PRINT_OPT_FIRST_COL_LEN 31
+#define USAGE_PRINT_OPT_SECOND_COL_LEN (USAGE_PRINT_OPT_TOTAL_LEN \
+                 - USAGE_PRINT_OPT_FIRST_COL_LEN - USAGE_PRINT_OPT_COL_SEP_LEN)
+#define USAGE_PRINT_OPT_IND_SECOND_COL_LEN (USAGE_PRINT_OPT_SECOND_COL_LEN \
+                                                 - USAGE_PRINT_OPT_COL_IND_LEN)
+
+#define HCONFIG "rss config"
+
+static const struct option long_options[] = {
+  {"bytes",       no_argument,       NULL, 'b'},
+  {"help",        no_argument,       NULL, 'h'},
+  {"interface",   required_argument, NULL, 'i'},
+  {"key",         required_argument, NULL, 'k'},
+  {"flow-list",   no_argument,       NULL, 'L'},
+  {"queues",      required_argument, NULL, 'q'},
+  {"symmetric",   required_argument, NULL, 's'},
+  {"threads",     required_argument, NULL, 't'},
+  {"udp-2-tuple", no_argument,       NULL, 'u'},
+  {"verbose",     no_argument,       NULL, 'v'},
+  {"version",     no_argument,       NULL, 'V'},
+  {"write",       required_argument, NULL, 'w'},
+  {"rss-config",  required_argument, NULL, 'x'},
+  {0, 0, NULL, 0}
+};
+
+struct usage_opt {
+  int        val;
+  const char *arg;
+  char *description;
+};
+
+static const struct usage_opt usage_options[] = {
+  {'b', NULL,   "Balance bytes rather than packets."},
+  {'h', NULL,   "Display this help and exit."},
+  {'i', "IFACE", "Read the " HCONFIG " (and, unless -u is given, how udp is"
+                      " hashed) straight from IFACE with ethtool ioctls, as"
+                    " 'ethtool -x IFACE' would. Either -i or -x is required."},
+  {'k', "KEY",  "Use KEY (e.g. '6d:5a:56:da:...') as the toeplitz hash key"
+                          " instead of the one in the " HCONFIG " (e.g. for"
+                                       " nics which don't report their key)."},
+  {'L', NULL,   "Read each FILE as a flow list rather than a pcap; one"
+                      " 'src-ip src-port dst-ip dst-port [packets [bytes]]'"
+                       " flow per line, as printed by flow-gen -v. Packets"
+                                     " and bytes default to 1 and 0."},
+  {'q', "N",    "Spread the indirection table over N queues instead of the"
+                                " queues in the " HCONFIG "."},
+  {'s', "N",    "Also try N random symmetric keys (a 16 bit pattern"
+                 " repeated, so both directions of a flow hash alike),"
+                    " starting with 6d:5a, and report the best one."},
+  {'t', "N",    "Evaluate symmetric keys with N threads. Default is the"
+                                               " number of online cpus."},
+  {'u', NULL,   "Hash udp by addresses only, as nics do unless udp 4-tuple"
+                     " hashing is enabled (i.e. when 'ethtool -n IFACE"
+                                " rx-flow-hash udp4' doesn't list L4 bytes)."
+                                     " With -i, this is read from the nic."},
+  {'v', NULL,   "Display more verbose output."},
+  {'V', NULL,   "Display the version and exit."},
+  {'w', "FILE", "Write the optimized table (or, when -s is given and it"
+                   " balances better, the best symmetric key and its"
+                       " table) to FILE in 'ethtool -x' format, which"
+                         " rxtxrss and rssvalidate read with -x. FILE '-'"
+                                                       " writes to stdout."},
+  {'x', "FILE", "Read the nic's " HCONFIG " (i.e. its toeplitz key and"
+                           " indirection table) from FILE, which holds the"
+                          " output of 'ethtool -x IFACE'. FILE '-' reads"
+                        " stdin. Either -x or -i is required."},
+  {0, NULL, NULL}
+};
+
+static char *usage_short_opt_order = "h:xi:k:u:q:b:L:s:t:w:v:V";
+
+struct optimize_flow {
+  uint8_t   input[RSS_INPUT_MAX];
+  int       len;
+  bool      used;
+  uintmax_t packets;
+  uintmax_t bytes;
+};
+
+struct optimize_flows {
+  struct optimize_flow *slots;
+  size_t               slot_count;
+  size_t               count;
+};
+
+struct optimize_plan {
+  uint8_t  key[RSS_KEY_MAX];
+  int      key_len;
+  uint32_t *indir;
+  double   imbalance;
+};
+
+struct optimize_ctx {
+  const struct optimize_flow *flows;
+  size_t   flow_count;
+  int      indir_size;
+  int      queue_count;
+  bool     bytes;
+};
+
+struct optimize_worker {
+  const struct optimize_ctx *ctx;
+  int                  idx;
+  int                  thread_count;
+  int                  candidates;
+  struct optimize_plan best;
+};
+
+struct optimize_bucket {
+  uint64_t load;
+  int      idx;
+};
+
+/* ========================================================================= */
+static void usage_print_opt(int val, const char *name, const char *arg,
+                                                           char *description) {
+  int consumed = 0;
+  int padding = 0;
+  int remaining = 0;
+
+  char *start = NULL;
+  char *end = NULL;
+
+  consumed = printf("  -%c, [--%s%s%s]  ", val, name, arg ? "=" : "",
+                                                               arg ? arg : "");
+
+  if (consumed < 0) {
+    /* no point in continuing */
+    return;
+  }
+
+  padding = USAGE_PRINT_OPT_FIRST_COL_LEN - consumed;
+
+  if (padding < 0) {
+    padding = 0;
+  }
+
+  printf("%*s%s", padding, "", USAGE_PRINT_OPT_COL_SEP);
+
+  start = description;
+
+  remaining = USAGE_PRINT_OPT_SECOND_COL_LEN;
+
+  while(1) {
+    while(isspace(*start)) {
+      start++;
+    }
+
+    int len = strlen(start);
+
+    if (len < remaining) {
+      printf("%s\n", start);
+      break;
+    }
+
+    end = start + remaining;
+
+    while(!isspace(*end) && end > start) {
+      end--;
+    }
+
+    if (start == end) {
+      /* no whitespace found in second column width, bail */
+      printf("%s\n", start);
+      break;
+    }
+
+    while(start < end) {
+      putchar(*start);
+      start++;
+    }
+
+    printf("\n%*s%s%s", USAGE_PRINT_OPT_FIRST_COL_LEN, "",
+                             USAGE_PRINT_OPT_COL_SEP, USAGE_PRINT_OPT_COL_IND);
+
+    remaining = USAGE_PRINT_OPT_IND_SECOND_COL_LEN;
+  }
+}
+
+/* ========================================================================= */
+static const char *usage_opt_get_arg(int val) {
+  int i = 0;
+  int v = 0;
+
+  for (i = 0; i < INT_MAX; i++) {
+    v = usage_options[i].val;
+
+    if (!v) {
+      return NULL;
+    }
+
+    if (v == val) {
+      return usage_options[i].arg;
+    }
+  }
+
+  return NULL;
+}
+
+/* ========================================================================= */
+static const char * usage_opt_get_name(int val) {
+  int i = 0;
+  int v = 0;
+
+  for (i = 0; i < INT_MAX; i++) {
+    v = long_options[i].val;
+
+    if (!v) {
+      return NULL;
+    }
+
+    if (v == val) {
+      return long_options[i].name;
+    }
+  }
+
+  return NULL;
+}
+
+/* ========================================================================= */
+static void usage(void) {
+  int i = 0;
+  int val = 0;
+  const char *name;
+
+  puts("Usage:");
+  printf("  %s [OPTIONS] {-x FILE|-i IFACE} FILE...\n\n", program_basename);
+
+  puts("Options:");
+
+  for (i = 0; i < INT_MAX; i++) {
+    val = usage_options[i].val;
+
+    if (!val) {
+      break;
+    }
+
+    name = usage_opt_get_name(val);
+
+    if (name) {
+      usage_print_opt(val, name, usage_options[i].arg,
+                                                 usage_options[i].description);
+    }
+  }
+}
+
+/* ========================================================================= */
+static void usage_short(void) {
+  int i = 0;
+  int indent = 0;
+  int lookahead = 0;
+  int projected = 0;
+  int remaining = 0;
+  int val = 0;
+
+  char *p = NULL;
+
+  const char *arg;
+  const char *name;
+
+  indent = fprintf(stderr, "Usage: %s", program_basename);
+
+  if (indent < 0) {
+    /* no point in continuing */
+    return;
+  }
+
+  remaining = USAGE_PRINT_OPT_TOTAL_LEN - indent;
+
+  p = usage_short_opt_order;
+
+  while (*p) {
+    lookahead = 0;
+    projected = 0;
+
+    while (p[lookahead] && p[lookahead] != ':') {
+      val = p[lookahead];
+
+      name = usage_opt_get_name(val);
+      arg = usage_opt_get_arg(val);
+
+      if (name) {
+        if (!lookahead) {
+          projected += 4; // ' [--'
+        } else {
+          projected += 3; // '|--'
+        }
+
+        projected += strlen(name);
+
+        if (arg) {
+          projected += 1; // '='
+          projected += strlen(arg);
+        }
+      }
+
+      lookahead++;
+    }
+
+    projected += 1; // ']'
+
+    if (projected > remaining) {
+      fprintf(stderr, "\n%*s", indent, "");
+      remaining = USAGE_PRINT_OPT_TOTAL_LEN - indent;
+    }
+
+    for (i = 0; i < lookahead; i++) {
+      val = p[i];
+
+      name = usage_opt_get_name(val);
+      arg = usage_opt_get_arg(val);
+
+      if (name) {
+        if (!i) {
+          remaining -= fprintf(stderr, " [--");
+        } else {
+          remaining -= fprintf(stderr, "|--");
+        }
+
+        remaining -= fprintf(stderr, "%s", name);
+
+        if (arg) {
+          remaining -= fprintf(stderr, "=%s", arg);
+        }
+      }
+    }
+
+    p += lookahead;
+
+    remaining -= fprintf(stderr, "]");
+
+    if (*p == ':') {
+      p++;
+    }
+  }
+
+  fprintf(stderr, "\n");
+}
+
+
+
+/* ========================================================================= */
+static size_t flows_slot(const uint8_t *input, int len) {
+  uint32_t hash = 2166136261u;
+  int i = 0;
+
+  /*
+   * fnv-1a; the slot only needs to be cheap and spread well, and the flows
+   * aren't hashed with any rss key until a candidate is tried.
+   */
+  for (i = 0; i < len; i++) {
+    hash = (hash ^ input[i]) * 16777619u;
+  }
+
+  return hash;
+}
+
+/* ========================================================================= */
+static int flows_grow(struct optimize_flows *p) {
+  struct optimize_flow *old = p->slots;
+  size_t old_count = p->slot_count;
+  size_t i, slot;
+
+  p->slot_count = old_count ? old_count * 2 : OPTIMIZE_FLOW_SLOTS_MIN;
+  p->slots = calloc(p->slot_count, sizeof(*p->slots));
+  if (!p->slots) {
+    p->slots = old;
+    p->slot_count = old_count;
+    return RXTX_ERROR;
+  }
+
+  for (i = 0; i < old_count; i++) {
+    if (!old[i].used) {
+      continue;
+    }
+    slot = flows_slot(old[i].input, old[i].len);
+    while (p->slots[slot & (p->slot_count - 1)].used) {
+      slot++;
+    }
+    p->slots[slot & (p->slot_count - 1)] = old[i];
+  }
+
+  free(old);
+
+  return 0;
+}
+
+/* ========================================================================= */
+static int flows_add(struct optimize_flows *p, const uint8_t *input, int len,
+                                        uintmax_t packets, uintmax_t bytes) {
+  struct optimize_flow *f = NULL;
+  size_t slot = 0;
+
+  if ((p->count + 1) * 2 > p->slot_count) {
+    if (flows_grow(p) == RXTX_ERROR) {
+      return RXTX_ERROR;
+    }
+  }
+
+  for (slot = flows_slot(input, len);; slot++) {
+    f = &p->slots[slot & (p->slot_count - 1)];
+
+    if (!f->used) {
+      memcpy(f->input, input, len);
+      f->len = len;
+      f->used = true;
+      p->count++;
+      break;
+    }
+
+    if (f->len == len && memcmp(f->input, input, len) == 0) {
+      break;
+    }
+  }
+
+  f->packets += packets;
+  f->bytes += bytes;
+
+  return 0;
+}
+
+/* ========================================================================= */
+static void flows_pack(struct optimize_flows *p) {
+  size_t i = 0, j = 0;
+
+  /*
+   * Every key candidate rehashes every flow, so once reading is done the
+   * flows are packed to the front of the table for a dense walk.
+   */
+  for (i = 0; i < p->slot_count; i++) {
+    if (p->slots[i].used) {
+      p->slots[j++] = p->slots[i];
+    }
+  }
+}
+
+/* ========================================================================= */
+static int flows_read_pcap(const char *path, int flags,
+                                 struct optimize_flows *flows, char *errbuf) {
+  uint8_t input[RSS_INPUT_MAX];
+  int len = 0;
+  int status = 0;
+
+  const u_char *data = NULL;
+  struct pcap_pkthdr *header = NULL;
+  char pcap_errbuf[PCAP_ERRBUF_SIZE] = "";
+  pcap_t *pd = NULL;
+
+  pd = pcap_open_offline(path, pcap_errbuf);
+  if (!pd) {
+    rxtx_fill_errbuf(errbuf, "error opening '%s': %s", path, pcap_errbuf);
+    return RXTX_ERROR;
+  }
+
+  while ((status = pcap_next_ex(pd, &header, &data)) == 1) {
+    len = rss_input_from_frame(data, header->caplen, flags, input);
+    if (flows_add(flows, input, len, 1, header->len)) {
+      rxtx_fill_errbuf(errbuf, "error reading '%s': %s", path,
+                                                              strerror(errno));
+      pcap_close(pd);
+      return RXTX_ERROR;
+    }
+  }
+
+  if (status == PCAP_ERROR) {
+    rxtx_fill_errbuf(errbuf, "error reading '%s': %s", path, pcap_geterr(pd));
+    pcap_close(pd);
+    return RXTX_ERROR;
+  }
+
+  pcap_close(pd);
+
+  return 0;
+}
+
+/* ========================================================================= */
+static int flows_read_list(const char *path, int flags,
+                                 struct optimize_flows *flows, char *errbuf) {
+  char src[64], dst[64];
+  unsigned int sport = 0, dport = 0;
+  uintmax_t packets = 0, bytes = 0;
+  uint16_t port = 0;
+  uint8_t input[RSS_INPUT_MAX];
+  int alen = 0;
+  int fields = 0;
+  int len = 0;
+  int status = 0;
+  size_t lineno = 0;
+
+  char *line = NULL;
+  size_t linecap = 0;
+  FILE *in = NULL;
+
+  if (strcmp(path, "-") == 0) {
+    in = stdin;
+  } else {
+    in = fopen(path, "r");
+    if (!in) {
+      rxtx_fill_errbuf(errbuf, "error opening '%s': %s", path,
+                                                              strerror(errno));
+      return RXTX_ERROR;
+    }
+  }
+
+  while (getline(&line, &linecap, in) != -1) {
+    lineno++;
+
+    packets = 1;
+    bytes = 0;
+    fields = sscanf(line, "%63s %u %63s %u %ju %ju", src, &sport, dst,
+                                                 &dport, &packets, &bytes);
+    if (fields == -1 || src[0] == '#') {
+      continue;
+    }
+
+    if (inet_pton(AF_INET, src, input) == 1 &&
+                                        inet_pton(AF_INET, dst, input + 4)) {
+      alen = 4;
+    } else if (inet_pton(AF_INET6, src, input) == 1 &&
+                                      inet_pton(AF_INET6, dst, input + 16)) {
+      alen = 16;
+    } else {
+      alen = 0;
+    }
+
+    if (fields < 4 || !alen || sport > 0xffff || dport > 0xffff) {
+      rxtx_fill_errbuf(errbuf, "error reading '%s': invalid flow on line"
+                                                   " %zu", path, lineno);
+      status = RXTX_ERROR;
+      break;
+    }
+
+    /*
+     * The input is laid out as the nic hashes it; addresses, then ports,
+     * all in network byte order.
+     */
+    len = 2 * alen;
+    if (!(flags & RSS_FLAG_UDP_2TUPLE)) {
+      port = htons(sport);
+      memcpy(input + len, &port, sizeof(port));
+      port = htons(dport);
+      memcpy(input + len + 2, &port, sizeof(port));
+      len += 4;
+    }
+
+    if (flows_add(flows, input, len, packets, bytes)) {
+      rxtx_fill_errbuf(errbuf, "error reading '%s': %s", path,
+                                                              strerror(errno));
+      status = RXTX_ERROR;
+      break;
+    }
+  }
+
+  if (!status && ferror(in)) {
+    rxtx_fill_errbuf(errbuf, "error reading '%s': %s", path, strerror(errno));
+    status = RXTX_ERROR;
+  }
+
+  free(line);
+  if (in != stdin) {
+    fclose(in);
+  }
+
+  return status;
+}
+
+/* ========================================================================= */
+static void bucket_loads(const struct optimize_ctx *ctx,
+                                 const uint32_t *table, uint64_t *loads) {
+  const struct optimize_flow *f = NULL;
+  uint32_t hash = 0;
+  size_t i = 0;
+
+  memset(loads, 0, ctx->indir_size * sizeof(*loads));
+
+  for (i = 0; i < ctx->flow_count; i++) {
+    f = &ctx->flows[i];
+    hash = f->len ? rss_table_hash(table, f->input, f->len) : 0;
+    loads[hash & (ctx->indir_size - 1)] += ctx->bytes ? f->bytes : f->packets;
+  }
+}
+
+/* ========================================================================= */
+static double queue_loads(const struct optimize_ctx *ctx,
+                    const uint64_t *loads, const uint32_t *indir,
+                                                       uint64_t *qloads) {
+  uint64_t max = 0;
+  uint64_t total = 0;
+  int i = 0;
+
+  memset(qloads, 0, ctx->queue_count * sizeof(*qloads));
+
+  for (i = 0; i < ctx->indir_size; i++) {
+    if ((int)indir[i] < ctx->queue_count) {
+      qloads[indir[i]] += loads[i];
+    }
+    total += loads[i];
+  }
+
+  for (i = 0; i < ctx->queue_count; i++) {
+    if (qloads[i] > max) {
+      max = qloads[i];
+    }
+  }
+
+  /*
+   * The imbalance is the busiest queue over the mean; 1.00 is perfectly
+   * even and N.00 is everything on one of N queues.
+   */
+  return total ? (double)max * ctx->queue_count / total : 1.0;
+}
+
+/* ========================================================================= */
+static bool weights_fit(const uint64_t *loads, int size, int queues,
+                                                             uint64_t limit) {
+  uint64_t sum = 0;
+  int blocks = 1;
+  int i = 0;
+
+  for (i = 0; i < size; i++) {
+    if (sum + loads[i] > limit) {
+      if (++blocks > queues) {
+        return false;
+      }
+      sum = 0;
+    }
+    sum += loads[i];
+  }
+
+  return true;
+}
+
+/* ========================================================================= */
+static void plan_weights(const struct optimize_ctx *ctx,
+                   const uint64_t *loads, uint32_t *indir, int *weights) {
+  uint64_t lo = 0, hi = 0, mid = 0;
+  uint64_t sum = 0;
+  int size = ctx->indir_size;
+  int queues = ctx->queue_count;
+  int q = 0;
+  int i = 0;
+
+  /*
+   * 'ethtool -X IFACE weight W0 W1 ...' can only give each queue one run of
+   * consecutive entries, W0 entries for queue 0 and so on. Weights summing
+   * to the table size make those runs exact, so the best weights are the
+   * partition of the buckets into runs with the lightest heaviest run; a
+   * binary search on that load finds it.
+   */
+  for (i = 0; i < size; i++) {
+    if (loads[i] > lo) {
+      lo = loads[i];
+    }
+    hi += loads[i];
+  }
+
+  while (lo < hi) {
+    mid = lo + (hi - lo) / 2;
+    if (weights_fit(loads, size, queues, mid)) {
+      hi = mid;
+    } else {
+      lo = mid + 1;
+    }
+  }
+
+  /*
+   * Fill queues in order up to that load, but leave at least one entry for
+   * each queue still to come so none is left out of the table entirely.
+   */
+  memset(weights, 0, queues * sizeof(*weights));
+
+  for (i = 0, q = 0; i < size; i++) {
+    if (q < queues - 1 && weights[q] &&
+                 (sum + loads[i] > lo || size - i == queues - q - 1)) {
+      q++;
+      sum = 0;
+    }
+    sum += loads[i];
+    weights[q]++;
+    indir[i] = q;
+  }
+}
+
+/* ========================================================================= */
+static int bucket_cmp(const void *a, const void *b) {
+  const struct optimize_bucket *ba = a;
+  const struct optimize_bucket *bb = b;
+
+  if (ba->load != bb->load) {
+    return ba->load < bb->load ? 1 : -1;
+  }
+  return ba->idx - bb->idx;
+}
+
+/* ========================================================================= */
+static bool plan_refine(const struct optimize_ctx *ctx,
+                 const uint64_t *loads, uint32_t *indir, uint64_t *qloads) {
+  int size = ctx->indir_size;
+  int qmax = 0, qmin = 0;
+  int from = -1, to = -1;
+  int i = 0, j = 0;
+
+  uint64_t gap = 0;
+  uint64_t d = 0;
+  uint64_t best = 0;
+  uint64_t miss = 0;
+
+  for (i = 0; i < ctx->queue_count; i++) {
+    if (qloads[i] > qloads[qmax]) {
+      qmax = i;
+    }
+    if (qloads[i] < qloads[qmin]) {
+      qmin = i;
+    }
+  }
+
+  gap = qloads[qmax] - qloads[qmin];
+  if (!gap) {
+    return false;
+  }
+
+  /*
+   * Shifting d from the busiest to the idlest queue helps whenever 0 < d <
+   * gap, most so at d = gap / 2. Look for the entry (move) or pair of
+   * entries (swap) closest to that.
+   */
+  best = gap;
+  for (i = 0; i < size; i++) {
+    if ((int)indir[i] != qmax || !loads[i] || loads[i] >= gap) {
+      continue;
+    }
+    d = loads[i];
+    miss = 2 * d > gap ? 2 * d - gap : gap - 2 * d;
+    if (miss < best) {
+      best = miss;
+      from = i;
+      to = -1;
+    }
+  }
+
+  if (size <= OPTIMIZE_SWAP_ENTRIES_MAX) {
+    for (i = 0; i < size; i++) {
+      if ((int)indir[i] != qmax) {
+        continue;
+      }
+      for (j = 0; j < size; j++) {
+        if ((int)indir[j] != qmin || loads[j] >= loads[i] ||
+                                             loads[i] - loads[j] >= gap) {
+          continue;
+        }
+        d = loads[i] - loads[j];
+        miss = 2 * d > gap ? 2 * d - gap : gap - 2 * d;
+        if (miss < best) {
+          best = miss;
+          from = i;
+          to = j;
+        }
+      }
+    }
+  }
+
+  if (from == -1) {
+    return false;
+  }
+
+  d = loads[from] - (to == -1 ? 0 : loads[to]);
+  indir[from] = qmin;
+  if (to != -1) {
+    indir[to] = qmax;
+  }
+  qloads[qmax] -= d;
+  qloads[qmin] += d;
+
+  return true;
+}
+
+/* ========================================================================= */
+static int plan_optimize(const struct optimize_ctx *ctx,
+                  const uint64_t *loads, uint32_t *indir, uint64_t *qloads) {
+  struct optimize_bucket *buckets = NULL;
+  int *entries = NULL;
+  int size = ctx->indir_size;
+  int queues = ctx->queue_count;
+  int i = 0, q = 0, best = 0;
+  long rounds = 0;
+
+  buckets = calloc(size, sizeof(*buckets));
+  entries = calloc(queues, sizeof(*entries));
+  if (!buckets || !entries) {
+    free(buckets);
+    free(entries);
+    return RXTX_ERROR;
+  }
+
+  for (i = 0; i < size; i++) {
+    buckets[i].load = loads[i];
+    buckets[i].idx = i;
+  }
+  qsort(buckets, size, sizeof(*buckets), bucket_cmp);
+
+  memset(qloads, 0, queues * sizeof(*qloads));
+
+  /*
+   * Start from longest processing time first; heaviest entry to the least
+   * loaded queue. Entries no traffic hashed to go to the queue with fewest
+   * entries instead, so flows not in the sample still spread evenly.
+   */
+  for (i = 0; i < size; i++) {
+    best = 0;
+    for (q = 1; q < queues; q++) {
+      if (buckets[i].load ? qloads[q] < qloads[best]
+                          : entries[q] < entries[best]) {
+        best = q;
+      }
+    }
+    indir[buckets[i].idx] = best;
+    qloads[best] += buckets[i].load;
+    entries[best]++;
+  }
+
+  /*
+   * Every step strictly shrinks the sum of squared queue loads so this ends
+   * on its own; the bound only caps pathological inputs.
+   */
+  for (rounds = 0; rounds < (long)size * queues; rounds++) {
+    if (!plan_refine(ctx, loads, indir, qloads)) {
+      break;
+    }
+  }
+
+  free(buckets);
+  free(entries);
+
+  return 0;
+}
+
+/* ========================================================================= */
+static void *optimize_loop(void *arg) {
+  struct optimize_worker *w = arg;
+  const struct optimize_ctx *ctx = w->ctx;
+
+  uint32_t *table = NULL;
+  uint32_t *indir = NULL;
+  uint64_t *loads = NULL;
+  uint64_t *qloads = NULL;
+  uint8_t key[RSS_KEY_MAX];
+  unsigned int seed = w->idx + 1;
+  unsigned int pattern = 0;
+  double imbalance = 0;
+  int c = 0, i = 0;
+  int status = RXTX_ERROR;
+
+  table = calloc(RSS_INPUT_MAX * 256, sizeof(*table));
+  indir = calloc(ctx->indir_size, sizeof(*indir));
+  loads = calloc(ctx->indir_size, sizeof(*loads));
+  qloads = calloc(ctx->queue_count, sizeof(*qloads));
+  w->best.indir = calloc(ctx->indir_size, sizeof(*w->best.indir));
+  if (!table || !indir || !loads || !qloads || !w->best.indir) {
+    goto out;
+  }
+
+  w->best.imbalance = 0;
+
+  /*
+   * A key made of one 16 bit pattern hashes a flow and its reply alike, as
+   * swapping addresses and ports shifts the input by a multiple of 16 bits.
+   * Candidates are dealt round robin across threads; 6d:5a is the first.
+   */
+  for (c = w->idx; c < w->candidates; c += w->thread_count) {
+    pattern = c ? (rand_r(&seed) & 0xffff) : 0x6d5a;
+    for (i = 0; i < w->best.key_len; i++) {
+      key[i] = i & 1 ? pattern & 0xff : pattern >> 8;
+    }
+
+    rss_table_fill(key, w->best.key_len, table);
+    bucket_loads(ctx, table, loads);
+    if (plan_optimize(ctx, loads, indir, qloads) == RXTX_ERROR) {
+      goto out;
+    }
+    imbalance = queue_loads(ctx, loads, indir, qloads);
+
+    if (!w->best.imbalance || imbalance < w->best.imbalance) {
+      w->best.imbalance = imbalance;
+      memcpy(w->best.key, key, w->best.key_len);
+      memcpy(w->best.indir, indir, ctx->indir_size * sizeof(*indir));
+    }
+  }
+
+  status = 0;
+
+out:
+  free(table);
+  free(indir);
+  free(loads);
+  free(qloads);
+
+  return (void *)(intptr_t)status;
+}
+
+/* ========================================================================= */
+static void print_key(FILE *out, const uint8_t *key, int key_len) {
+  int i = 0;
+
+  for (i = 0; i < key_len; i++) {
+    fprintf(out, "%s%02x", i ? ":" : "", key[i]);
+  }
+}
+
+/* ========================================================================= */
+static void print_queue_loads(const struct optimize_ctx *ctx,
+                                                    const uint64_t *qloads) {
+  int i = 0;
+
+  for (i = 0; i < ctx->queue_count; i++) {
+    printf("  queue %d: %ju %s\n", i, (uintmax_t)qloads[i],
+                                           ctx->bytes ? "bytes" : "packets");
+  }
+}
+
+/* ========================================================================= */
+static int write_config(const char *path, const uint8_t *key, int key_len,
+                         const uint32_t *indir, int indir_size, int queues,
+                                                               char *errbuf) {
+  FILE *out = NULL;
+  int i = 0;
+
+  if (strcmp(path, "-") == 0) {
+    out = stdout;
+  } else {
+    out = fopen(path, "w");
+    if (!out) {
+      rxtx_fill_errbuf(errbuf, "error opening '%s': %s", path,
+                                                              strerror(errno));
+      return RXTX_ERROR;
+    }
+  }
+
+  /*
+   * Mirror 'ethtool -x' so rss_config_read() (and people) take it as is.
+   */
+  fprintf(out, "RX flow hash indirection table for %s with %d RX ring(s):\n",
+                                                  program_basename, queues);
+  for (i = 0; i < indir_size; i++) {
+    if (i % 8 == 0) {
+      fprintf(out, "%5d: ", i);
+    }
+    fprintf(out, " %5u", indir[i]);
+    if (i % 8 == 7 || i == indir_size - 1) {
+      fputs("\n", out);
+    }
+  }
+  fputs("RSS hash key:\n", out);
+  print_key(out, key, key_len);
+  fputs("\nRSS hash function:\n    toeplitz: on\n", out);
+
+  if (out == stdout) {
+    fflush(out);
+  } else if (fclose(out)) {
+    rxtx_fill_errbuf(errbuf, "error writing '%s': %s", path,
+                                                              strerror(errno));
+    return RXTX_ERROR;
+  }
+
+  return 0;
+}
+
+/* ========================================================================= */
+int main(int argc, char **argv) {
+  program_basename = basename(argv[0]);
+
+  int c = 0;
+  int flags = 0;
+  int i = 0;
+  int status = 0;
+  int thread_count = 0;
+
+  uintmax_t candidates = 0;
+  uintmax_t queues = 0;
+  uintmax_t threads = 0;
+  uintmax_t packets = 0;
+  uintmax_t bytes = 0;
+
+  bool balance_bytes = false;
+  bool help = false;
+  bool udp_2tuple_set = false;
+  bool flow_list = false;
+  bool verbose = false;
+
+  char *badopt = NULL;
+  char *config_path = NULL;
+  char *config_name = NULL;
+  char *endptr = NULL;
+  char *ifname = NULL;
+  char *key = NULL;
+  char *write_path = NULL;
+
+  char errbuf[RXTX_ERRBUF_SIZE] = "";
+  FILE *in = NULL;
+
+  struct optimize_flows flows = {NULL, 0, 0};
+
+  struct rss_config config;
+  struct optimize_ctx ctx;
+
+  uint32_t *table = NULL;
+  uint32_t *weighted = NULL;
+  uint32_t *optimized = NULL;
+  uint64_t *loads = NULL;
+  uint64_t *qloads = NULL;
+  int *weights = NULL;
+
+  double imbalance = 0;
+  double optimized_imbalance = 0;
+
+  struct optimize_worker *workers = NULL;
+  struct optimize_plan *best = NULL;
+
+  void *vpstatus = NULL;
+
+  /*
+   * optstring must start with ":" so ':' is returned for a missing option
+   * argument. Otherwise '?' is returned for both invalid option and missing
+   * option argument.
+   */
+  while ((c = getopt_long(argc, argv, ":bhi:k:Lq:s:t:uvVw:x:", long_options,
+                                                                  0)) != -1) {
+    switch (c) {
+      case 'b':
+        balance_bytes = true;
+        break;
+
+      case 'h':
+        help = true;
+        break;
+
+      case 'i':
+        ifname = optarg;
+        break;
+
+      case 'k':
+        key = optarg;
+        break;
+
+      case 'L':
+        flow_list = true;
+        break;
+
+      case 'q':
+        queues = strtoumax(optarg, &endptr, OPTION_COUNT_BASE);
+        if (*endptr || !queues || queues > RSS_INDIR_MAX) {
+          fprintf(stderr, "%s: Invalid queue count '%s'.\n",
+                                                    program_basename, optarg);
+          usage_short();
+          return EXIT_FAIL_OPTION;
+        }
+        break;
+
+      case 's':
+        candidates = strtoumax(optarg, &endptr, OPTION_COUNT_BASE);
+        if (*endptr || candidates > INT_MAX) {
+          fprintf(stderr, "%s: Invalid key count '%s'.\n", program_basename,
+                                                                       optarg);
+          usage_short();
+          return EXIT_FAIL_OPTION;
+        }
+        break;
+
+      case 't':
+        threads = strtoumax(optarg, &endptr, OPTION_COUNT_BASE);
+        if (*endptr || !threads || threads > INT_MAX) {
+          fprintf(stderr, "%s: Invalid thread count '%s'.\n",
+                                                    program_basename, optarg);
+          usage_short();
+          return EXIT_FAIL_OPTION;
+        }
+        break;
+
+      case 'u':
+        flags |= RSS_FLAG_UDP_2TUPLE;
+        udp_2tuple_set = true;
+        break;
+
+      case 'v':
+        verbose = true;
+        break;
+
+      case 'V':
+        printf("%s version %s\n", program_basename, RXTXUTILS_VERSION);
+        return EXIT_OK;
+
+      case 'w':
+        write_path = optarg;
+        break;
+
+      case 'x':
+        config_path = optarg;
+        break;
+
+      case ':':  /* missing option argument */
+        fprintf(stderr, "%s: Option '%s' requires an argument.\n",
+                                             program_basename, argv[optind-1]);
+        usage_short();
+        return EXIT_FAIL_OPTION;
+
+      case '?':  /* invalid option */
+      default:   /* invalid option in optstring */
+        /*
+         * optopt is NULL for long options and reliable for short ones as
+         * long as optstring is kept clean (see rxtxcpu.c for the details).
+         */
+        if (optopt) {
+          asprintf(&badopt, "-%c", optopt);
+        } else {
+          badopt = argv[optind-1];
+        }
+        fprintf(stderr, "%s: Unrecognized option '%s'.\n", program_basename,
+                                                                       badopt);
+        if (optopt) {
+          free(badopt);
+        }
+        usage_short();
+        return EXIT_FAIL_OPTION;
+    }
+  }
+
+  if (help) {
+    usage();
+    return EXIT_OK;
+  }
+
+  if (!config_path == !ifname) {
+    fprintf(stderr, "%s: Exactly one of -x [--rss-config] or -i"
+                            " [--interface] is required.\n", program_basename);
+    usage_short();
+    return EXIT_FAIL_OPTION;
+  }
+
+  if (optind == argc) {
+    fprintf(stderr, "%s: At least one pcap or flow list file is required.\n",
+                                                            program_basename);
+    usage_short();
+    return EXIT_FAIL_OPTION;
+  }
+
+  if (ifname) {
+    /*
+     * Not every driver reports how udp is hashed, in which case we stick
+     * with the 4-tuple.
+     */
+    config_name = ifname;
+    status = rss_config_query(&config, ifname, errbuf);
+    if (status == RXTX_ERROR) {
+      fprintf(stderr, "%s: %s\n", program_basename, errbuf);
+      return EXIT_FAIL;
+    }
+
+    if (!udp_2tuple_set) {
+      status = rss_flags_query(ifname, &flags, errbuf);
+      if (status == RXTX_ERROR && verbose) {
+        fprintf(stderr, "%s: %s\n", program_basename, errbuf);
+      }
+    }
+  } else {
+    config_name = config_path;
+    if (strcmp(config_path, "-") == 0) {
+      in = stdin;
+    } else {
+      in = fopen(config_path, "r");
+      if (!in) {
+        fprintf(stderr, "%s: error opening " HCONFIG " '%s': %s\n",
+                              program_basename, config_path, strerror(errno));
+        return EXIT_FAIL;
+      }
+    }
+
+    status = rss_config_read(&config, in, config_path, errbuf);
+    if (in != stdin) {
+      fclose(in);
+    }
+    if (status == RXTX_ERROR) {
+      fprintf(stderr, "%s: %s\n", program_basename, errbuf);
+      return EXIT_FAIL;
+    }
+  }
+
+  if (key) {
+    status = rss_config_set_key(&config, key);
+    if (status == RXTX_ERROR) {
+      fprintf(stderr, "%s: %s\n", program_basename, errbuf);
+      usage_short();
+      return EXIT_FAIL_OPTION;
+    }
+  }
+
+  if (!config.key_len) {
+    fprintf(stderr, "%s: No valid hash key in " HCONFIG " '%s'; use -k"
+                          " [--key].\n", program_basename, config_name);
+    usage_short();
+    return EXIT_FAIL_OPTION;
+  }
+
+  if (queues) {
+    config.queue_count = queues;
+  }
+
+  for (i = optind; i < argc; i++) {
+    if (verbose) {
+      fprintf(stderr, "Reading '%s'.\n", argv[i]);
+    }
+    if (flow_list) {
+      status = flows_read_list(argv[i], flags, &flows, errbuf);
+    } else {
+      status = flows_read_pcap(argv[i], flags, &flows, errbuf);
+    }
+    if (status == RXTX_ERROR) {
+      fprintf(stderr, "%s: %s\n", program_basename, errbuf);
+      return EXIT_FAIL;
+    }
+  }
+
+  flows_pack(&flows);
+  for (i = 0; i < (int)flows.count; i++) {
+    packets += flows.slots[i].packets;
+    bytes += flows.slots[i].bytes;
+  }
+
+  ctx.flows = flows.slots;
+  ctx.flow_count = flows.count;
+  ctx.indir_size = config.indir_size;
+  ctx.queue_count = config.queue_count;
+  ctx.bytes = balance_bytes;
+
+  if (ctx.bytes && !bytes) {
+    fprintf(stderr, "%s: No byte counts to balance; flow lists need a"
+                                 " bytes column for -b.\n", program_basename);
+    return EXIT_FAIL;
+  }
+
+  table = calloc(RSS_INPUT_MAX * 256, sizeof(*table));
+  weighted = calloc(ctx.indir_size, sizeof(*weighted));
+  optimized = calloc(ctx.indir_size, sizeof(*optimized));
+  loads = calloc(ctx.indir_size, sizeof(*loads));
+  qloads = calloc(ctx.queue_count, sizeof(*qloads));
+  weights = calloc(ctx.queue_count, sizeof(*weights));
+  if (!table || !weighted || !optimized || !loads || !qloads || !weights) {
+    fprintf(stderr, "%s: %s\n", program_basename, strerror(errno));
+    return EXIT_FAIL;
+  }
+
+  /*
+   * The table only depends on how much traffic lands in each entry, so the
+   * flows are hashed once per key and every plan works on those loads.
+   */
+  rss_table_fill(config.key, config.key_len, table);
+  bucket_loads(&ctx, table, loads);
+
+  printf("Read %ju packets (%ju bytes) in %zu flows from %d file%s.\n",
+                                  packets, bytes, flows.count, argc - optind,
+                                                argc - optind == 1 ? "" : "s");
+  printf("Balancing %s over %d queues with a %d entry indirection table.\n",
+                    ctx.bytes ? "bytes" : "packets", ctx.queue_count,
+                                                              ctx.indir_size);
+
+  imbalance = queue_loads(&ctx, loads, config.indir, qloads);
+  printf("Current table: busiest queue at %.2fx the mean.\n", imbalance);
+  if (verbose) {
+    print_queue_loads(&ctx, qloads);
+  }
+
+  plan_weights(&ctx, loads, weighted, weights);
+  imbalance = queue_loads(&ctx, loads, weighted, qloads);
+  printf("Weighted table: busiest queue at %.2fx the mean.\n", imbalance);
+  printf("  ethtool -X IFACE weight");
+  for (i = 0; i < ctx.queue_count; i++) {
+    printf(" %d", weights[i]);
+  }
+  putchar('\n');
+  if (verbose) {
+    print_queue_loads(&ctx, qloads);
+  }
+
+  if (plan_optimize(&ctx, loads, optimized, qloads) == RXTX_ERROR) {
+    fprintf(stderr, "%s: %s\n", program_basename, strerror(errno));
+    return EXIT_FAIL;
+  }
+  optimized_imbalance = queue_loads(&ctx, loads, optimized, qloads);
+  printf("Optimized table: busiest queue at %.2fx the mean.\n",
+                                                          optimized_imbalance);
+  if (verbose) {
+    print_queue_loads(&ctx, qloads);
+  }
+
+  if (candidates) {
+    thread_count = threads ? (int)threads : sysconf(_SC_NPROCESSORS_ONLN);
+    if (thread_count < 1) {
+      thread_count = 1;
+    }
+    if ((uintmax_t)thread_count > candidates) {
+      thread_count = candidates;
+    }
+
+    workers = calloc(thread_count, sizeof(*workers));
+    if (!workers) {
+      fprintf(stderr, "%s: %s\n", program_basename, strerror(errno));
+      return EXIT_FAIL;
+    }
+
+    pthread_t thread_ids[thread_count];
+
+    for (i = 0; i < thread_count; i++) {
+      workers[i].ctx = &ctx;
+      workers[i].idx = i;
+      workers[i].thread_count = thread_count;
+      workers[i].candidates = candidates;
+      workers[i].best.key_len = config.key_len;
+
+      status = pthread_create(&thread_ids[i], NULL, optimize_loop,
+                                                          (void *)&workers[i]);
+      if (status) {
+        fprintf(stderr, "%s: error creating threads: %s\n", program_basename,
+                                                            strerror(status));
+        return EXIT_FAIL;
+      }
+    }
+
+    status = EXIT_OK;
+
+    for (i = 0; i < thread_count; i++) {
+      pthread_join(thread_ids[i], &vpstatus);
+      if ((intptr_t)vpstatus == (intptr_t)RXTX_ERROR) {
+        fprintf(stderr, "%s: error optimizing keys: %s\n",
+                                          program_basename, strerror(ENOMEM));
+        status = EXIT_FAIL;
+      } else if (!best || workers[i].best.imbalance < best->imbalance) {
+        best = &workers[i].best;
+      }
+    }
+
+    if (status == EXIT_FAIL) {
+      return EXIT_FAIL;
+    }
+
+    printf("Symmetric key ");
+    print_key(stdout, best->key, best->key_len);
+    printf(": busiest queue at %.2fx the mean.\n", best->imbalance);
+    if (verbose) {
+      rss_table_fill(best->key, best->key_len, table);
+      bucket_loads(&ctx, table, loads);
+      queue_loads(&ctx, loads, best->indir, qloads);
+      print_queue_loads(&ctx, qloads);
+    }
+  }
+
+  /*
+   * A symmetric key only replaces the nic's key when it actually balances
+   * better than the optimized table does with the current one.
+   */
+  if (best && best->imbalance > optimized_imbalance) {
+    printf("Symmetric key doesn't beat the optimized table; keeping the"
+                                                        " current key.\n");
+    best = NULL;
+  }
+
+  if (write_path) {
+    if (best) {
+      status = write_config(write_path, best->key, best->key_len,
+                   best->indir, ctx.indir_size, ctx.queue_count, errbuf);
+    } else {
+      status = write_config(write_path, config.key, config.key_len,
+                     optimized, ctx.indir_size, ctx.queue_count, errbuf);
+    }
+    if (status == RXTX_ERROR) {
+      fprintf(stderr, "%s: %s\n", program_basename, errbuf);
+      return EXIT_FAIL;
+    }
+  }
+
+  for (i = 0; workers && i < thread_count; i++) {
+    free(workers[i].best.indir);
+  }
+  free(workers);
+  free(weights);
+  free(qloads);
+  free(loads);
+  free(optimized);
+  free(weighted);
+  free(table);
+  free(flows.slots);
+  rss_config_destroy(&config);
+
+  return EXIT_OK;
+}
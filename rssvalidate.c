@@ -0,0 +1,878 @@
+/*
+ * Copyright (c) 2019-present StackPath, LLC
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#define _GNU_SOURCE // for GNU basename()
+
+#include "ext.h"        // for noext_copy()
+#include "rss.h"        // for RSS_FLAG_UDP_2TUPLE, RSS_INPUT_MAX,
+                        //     rss_config, rss_config_destroy(),
+                        //     rss_config_query(), rss_config_read(),
+                        //     rss_config_set_key(), rss_flags_query(),
+                        //     rss_input_from_frame(), rss_table_fill(),
+                        //     rss_table_hash()
+#include "rxtx.h"       // for program_basename
+#include "rxtx_error.h" // for RXTX_ERRBUF_SIZE, RXTX_ERROR,
+                        //     rxtx_fill_errbuf()
+
+#include <arpa/inet.h>  // for inet_ntop()
+#include <netinet/in.h> // for INET6_ADDRSTRLEN
+
+#include <ctype.h>    // for isdigit(), isspace()
+#include <errno.h>    // for errno
+#include <getopt.h>   // for getopt_long(), optarg, optind, option, optopt
+#include <inttypes.h> // for strtoumax()
+#include <limits.h>   // for INT_MAX
+#include <pcap.h>     // for DLT_EN10MB, pcap_close(), pcap_datalink(),
+                      //     PCAP_ERROR, PCAP_ERRBUF_SIZE, pcap_geterr(),
+                      //     pcap_next_ex(), pcap_open_offline(),
+                      //     pcap_pkthdr, pcap_t
+#include <pthread.h>  // for pthread_create(), pthread_join(), pthread_t
+#include <stdbool.h>  // for bool, false, true
+#include <stdint.h>   // for intptr_t, uint8_t, uint32_t, uintmax_t
+#include <stdio.h>    // for asprintf(), fclose(), FILE, fopen(), fprintf(),
+                      //     fputs(), NULL, printf(), putchar(), puts(),
+                      //     stderr, stdin, stdout
+#include <stdlib.h>   // for calloc(), free(), qsort(), strtol()
+#include <string.h>   // for GNU basename(), memcmp(), memcpy(), strcmp(),
+                      //     strerror(), strlen(), strrchr()
+
+#define EXIT_OK          0
+#define EXIT_FAIL        1
+#define EXIT_FAIL_OPTION 2
+#define EXIT_MISMATCH    3
+
+#define OPTION_COUNT_BASE 10
+
+#define VALIDATE_FLOWS_DEFAULT 10
+
+/*
+ * Offending flows are tracked per file in an open addressed table which
+ * doubles up to this many slots; mismatches from flows beyond that are still
+ * counted, just not listed.
+ */
+#define VALIDATE_FLOW_SLOTS_MIN 1024
+#define VALIDATE_FLOW_SLOTS_MAX (1 << 20)
+
+#define USAGE_PRINT_OPT_COL_SEP "# "
+#define USAGE_PRINT_OPT_COL_IND "  "
+
+#define USAGE_PRINT_OPT_COL_SEP_LEN (strlen(USAGE_PRINT_OPT_COL_SEP))
+#define USAGE_PRINT_OPT_COL_IND_LEN (strlen(USAGE_PRINT_OPT_COL_IND))
+
+#define USAGE_PRINT_OPT_TOTAL_LEN     79
+#define USAGE_PRINT_OPT_FIRST_COL_LEN 31
+#define USAGE_PRINT_OPT_SECOND_COL_LEN (USAGE_PRINT_OPT_TOTAL_LEN \
+                 - USAGE_PRINT_OPT_FIRST_COL_LEN - USAGE_PRINT_OPT_COL_SEP_LEN)
+#define USAGE_PRINT_OPT_IND_SECOND_COL_LEN (USAGE_PRINT_OPT_SECOND_COL_LEN \
+                                                 - USAGE_PRINT_OPT_COL_IND_LEN)
+
+#define HCONFIG "rss config"
+
+static const struct option long_options[] = {
+  {"flows",       required_argument, NULL, 'f'},
+  {"help",        no_argument,       NULL, 'h'},
+  {"interface",   required_argument, NULL, 'i'},
+  {"key",         required_argument, NULL, 'k'},
+  {"udp-2-tuple", no_argument,       NULL, 'u'},
+  {"verbose",     no_argument,       NULL, 'v'},
+  {"version",     no_argument,       NULL, 'V'},
+  {"rss-config",  required_argument, NULL, 'x'},
+  {0, 0, NULL, 0}
+};
+
+struct usage_opt {
+  int        val;
+  const char *arg;
+  char *description;
+};
+
+static const struct usage_opt usage_options[] = {
+  {'f', "N",    "List up to N offending flows per PCAP, most packets first."
+                                                        " Default is 10."},
+  {'h', NULL,   "Display this help and exit."},
+  {'i', "IFACE", "Read the " HCONFIG " (and, unless -u is given, how udp is"
+                      " hashed) straight from IFACE with ethtool ioctls, as"
+                    " 'ethtool -x IFACE' would. Either -i or -x is required."},
+  {'k', "KEY",  "Use KEY (e.g. '6d:5a:56:da:...') as the toeplitz hash key"
+                          " instead of the one in the " HCONFIG " (e.g. for"
+                                       " nics which don't report their key)."},
+  {'u', NULL,   "Hash udp by addresses only, as nics do unless udp 4-tuple"
+                     " hashing is enabled (i.e. when 'ethtool -n IFACE"
+                                " rx-flow-hash udp4' doesn't list L4 bytes)."
+                                     " With -i, this is read from the nic."},
+  {'v', NULL,   "Display more verbose output."},
+  {'V', NULL,   "Display the version and exit."},
+  {'x', "FILE", "Read the nic's " HCONFIG " (i.e. its toeplitz key and"
+                           " indirection table) from FILE, which holds the"
+                          " output of 'ethtool -x IFACE'. FILE '-' reads"
+                        " stdin. Either -x or -i is required."},
+  {0, NULL, NULL}
+};
+
+static char *usage_short_opt_order = "h:xi:k:u:f:v:V";
+
+struct validate_flow {
+  uint8_t   input[RSS_INPUT_MAX];
+  int       len;
+  uint32_t  expected;
+  uintmax_t packets;
+};
+
+struct validate_worker {
+  const char           *path;
+  int                  queue;
+  const struct rss_config *config;
+  const uint32_t       *table;
+  int                  flags;
+  uintmax_t            packets;
+  uintmax_t            mismatched;
+  uintmax_t            untracked;
+  struct validate_flow *flows;
+  unsigned int         flow_slots;
+  unsigned int         flow_count;
+  char                 errbuf[RXTX_ERRBUF_SIZE];
+};
+
+/* ========================================================================= */
+static void usage_print_opt(int val, const char *name, const char *arg,
+                                                           char *description) {
+  int consumed = 0;
+  int padding = 0;
+  int remaining = 0;
+
+  char *start = NULL;
+  char *end = NULL;
+
+  consumed = printf("  -%c, [--%s%s%s]  ", val, name, arg ? "=" : "",
+                                                               arg ? arg : "");
+
+  if (consumed < 0) {
+    /* no point in continuing */
+    return;
+  }
+
+  padding = USAGE_PRINT_OPT_FIRST_COL_LEN - consumed;
+
+  if (padding < 0) {
+    padding = 0;
+  }
+
+  printf("%*s%s", padding, "", USAGE_PRINT_OPT_COL_SEP);
+
+  start = description;
+
+  remaining = USAGE_PRINT_OPT_SECOND_COL_LEN;
+
+  while(1) {
+    while(isspace(*start)) {
+      start++;
+    }
+
+    int len = strlen(start);
+
+    if (len < remaining) {
+      printf("%s\n", start);
+      break;
+    }
+
+    end = start + remaining;
+
+    while(!isspace(*end) && end > start) {
+      end--;
+    }
+
+    if (start == end) {
+      /* no whitespace found in second column width, bail */
+      printf("%s\n", start);
+      break;
+    }
+
+    while(start < end) {
+      putchar(*start);
+      start++;
+    }
+
+    printf("\n%*s%s%s", USAGE_PRINT_OPT_FIRST_COL_LEN, "",
+                             USAGE_PRINT_OPT_COL_SEP, USAGE_PRINT_OPT_COL_IND);
+
+    remaining = USAGE_PRINT_OPT_IND_SECOND_COL_LEN;
+  }
+}
+
+/* ========================================================================= */
+static const char *usage_opt_get_arg(int val) {
+  int i = 0;
+  int v = 0;
+
+  for (i = 0; i < INT_MAX; i++) {
+    v = usage_options[i].val;
+
+    if (!v) {
+      return NULL;
+    }
+
+    if (v == val) {
+      return usage_options[i].arg;
+    }
+  }
+
+  return NULL;
+}
+
+/* ========================================================================= */
+static const char * usage_opt_get_name(int val) {
+  int i = 0;
+  int v = 0;
+
+  for (i = 0; i < INT_MAX; i++) {
+    v = long_options[i].val;
+
+    if (!v) {
+      return NULL;
+    }
+
+    if (v == val) {
+      return long_options[i].name;
+    }
+  }
+
+  return NULL;
+}
+
+/* ========================================================================= */
+static void usage(void) {
+  int i = 0;
+  int val = 0;
+  const char *name;
+
+  puts("Usage:");
+  printf("  %s [OPTIONS] {-x FILE|-i IFACE} PCAP...\n\n", program_basename);
+
+  puts("Options:");
+
+  for (i = 0; i < INT_MAX; i++) {
+    val = usage_options[i].val;
+
+    if (!val) {
+      break;
+    }
+
+    name = usage_opt_get_name(val);
+
+    if (name) {
+      usage_print_opt(val, name, usage_options[i].arg,
+                                                 usage_options[i].description);
+    }
+  }
+}
+
+/* ========================================================================= */
+static void usage_short(void) {
+  int i = 0;
+  int indent = 0;
+  int lookahead = 0;
+  int projected = 0;
+  int remaining = 0;
+  int val = 0;
+
+  char *p = NULL;
+
+  const char *arg;
+  const char *name;
+
+  indent = fprintf(stderr, "Usage: %s", program_basename);
+
+  if (indent < 0) {
+    /* no point in continuing */
+    return;
+  }
+
+  remaining = USAGE_PRINT_OPT_TOTAL_LEN - indent;
+
+  p = usage_short_opt_order;
+
+  while (*p) {
+    lookahead = 0;
+    projected = 0;
+
+    while (p[lookahead] && p[lookahead] != ':') {
+      val = p[lookahead];
+
+      name = usage_opt_get_name(val);
+      arg = usage_opt_get_arg(val);
+
+      if (name) {
+        if (!lookahead) {
+          projected += 4; // ' [--'
+        } else {
+          projected += 3; // '|--'
+        }
+
+        projected += strlen(name);
+
+        if (arg) {
+          projected += 1; // '='
+          projected += strlen(arg);
+        }
+      }
+
+      lookahead++;
+    }
+
+    projected += 1; // ']'
+
+    if (projected > remaining) {
+      fprintf(stderr, "\n%*s", indent, "");
+      remaining = USAGE_PRINT_OPT_TOTAL_LEN - indent;
+    }
+
+    for (i = 0; i < lookahead; i++) {
+      val = p[i];
+
+      name = usage_opt_get_name(val);
+      arg = usage_opt_get_arg(val);
+
+      if (name) {
+        if (!i) {
+          remaining -= fprintf(stderr, " [--");
+        } else {
+          remaining -= fprintf(stderr, "|--");
+        }
+
+        remaining -= fprintf(stderr, "%s", name);
+
+        if (arg) {
+          remaining -= fprintf(stderr, "=%s", arg);
+        }
+      }
+    }
+
+    p += lookahead;
+
+    remaining -= fprintf(stderr, "]");
+
+    if (*p == ':') {
+      p++;
+    }
+  }
+
+  fprintf(stderr, "\n");
+}
+
+
+/* ========================================================================= */
+static int queue_from_path(const char *path) {
+  char *noext = NULL;
+  char *dash = NULL;
+  char *end = NULL;
+  long queue = -1;
+
+  /*
+   * rxtxqueue names per-ring files '<template>-<queue>.<ext>' and rxtxmatrix
+   * '<template>-<cpu>-<queue>.<ext>'; either way the queue is the number
+   * after the last dash.
+   */
+  noext = noext_copy(basename(path));
+  if (!noext) {
+    return -1;
+  }
+
+  dash = strrchr(noext, '-');
+  if (dash && isdigit(dash[1])) {
+    queue = strtol(dash + 1, &end, 10);
+    if (*end || queue > INT_MAX) {
+      queue = -1;
+    }
+  }
+
+  free(noext);
+
+  return (int)queue;
+}
+
+/* ========================================================================= */
+static int validate_flows_grow(struct validate_worker *w) {
+  struct validate_flow *old = w->flows;
+  unsigned int old_slots = w->flow_slots;
+  unsigned int i, slot;
+
+  w->flow_slots = old_slots ? old_slots * 2 : VALIDATE_FLOW_SLOTS_MIN;
+  w->flows = calloc(w->flow_slots, sizeof(*w->flows));
+  if (!w->flows) {
+    rxtx_fill_errbuf(w->errbuf, "error validating '%s': %s", w->path,
+                                                              strerror(errno));
+    w->flows = old;
+    return RXTX_ERROR;
+  }
+
+  for (i = 0; i < old_slots; i++) {
+    if (!old[i].packets) {
+      continue;
+    }
+    slot = rss_table_hash(w->table, old[i].input, old[i].len);
+    while (w->flows[slot & (w->flow_slots - 1)].packets) {
+      slot++;
+    }
+    w->flows[slot & (w->flow_slots - 1)] = old[i];
+  }
+
+  free(old);
+
+  return 0;
+}
+
+/* ========================================================================= */
+static int validate_flows_add(struct validate_worker *w, const uint8_t *input,
+                                      int len, uint32_t hash, uint32_t queue) {
+  struct validate_flow *f = NULL;
+  unsigned int slot = 0;
+
+  /*
+   * Keep the table at most half full. The toeplitz hash of the flow is
+   * already in hand and spreads flows well, so it doubles as the slot hash.
+   */
+  if ((w->flow_count + 1) * 2 > w->flow_slots &&
+                                   w->flow_slots < VALIDATE_FLOW_SLOTS_MAX) {
+    if (validate_flows_grow(w) == RXTX_ERROR) {
+      return RXTX_ERROR;
+    }
+  }
+
+  for (slot = hash;; slot++) {
+    f = &w->flows[slot & (w->flow_slots - 1)];
+
+    if (!f->packets) {
+      if ((w->flow_count + 1) * 2 > w->flow_slots) {
+        w->untracked++;
+        return 0;
+      }
+      memcpy(f->input, input, len);
+      f->len = len;
+      f->expected = queue;
+      w->flow_count++;
+      break;
+    }
+
+    if (f->len == len && memcmp(f->input, input, len) == 0) {
+      break;
+    }
+  }
+
+  f->packets++;
+
+  return 0;
+}
+
+/* ========================================================================= */
+static void *validate_loop(void *arg) {
+  struct validate_worker *w = arg;
+  const struct rss_config *config = w->config;
+
+  uint8_t input[RSS_INPUT_MAX];
+  uint32_t hash = 0;
+  uint32_t queue = 0;
+  int len = 0;
+  int status = 0;
+
+  const u_char *data = NULL;
+  struct pcap_pkthdr *header = NULL;
+  char pcap_errbuf[PCAP_ERRBUF_SIZE] = "";
+  pcap_t *pd = NULL;
+
+  pd = pcap_open_offline(w->path, pcap_errbuf);
+  if (!pd) {
+    rxtx_fill_errbuf(w->errbuf, "error opening '%s': %s", w->path,
+                                                                 pcap_errbuf);
+    return (void *)(intptr_t)RXTX_ERROR;
+  }
+
+  /*
+   * Packets are streamed one at a time, so files of any size validate in
+   * constant memory (bar the offending flow table).
+   */
+  while ((status = pcap_next_ex(pd, &header, &data)) == 1) {
+    w->packets++;
+
+    len = rss_input_from_frame(data, header->caplen, w->flags, input);
+    hash = len ? rss_table_hash(w->table, input, len) : 0;
+    queue = config->indir[hash & (config->indir_size - 1)];
+
+    if (queue == (uint32_t)w->queue) {
+      continue;
+    }
+
+    w->mismatched++;
+
+    if (validate_flows_add(w, input, len, hash, queue) == RXTX_ERROR) {
+      pcap_close(pd);
+      return (void *)(intptr_t)RXTX_ERROR;
+    }
+  }
+
+  if (status == PCAP_ERROR) {
+    rxtx_fill_errbuf(w->errbuf, "error reading '%s': %s", w->path,
+                                                              pcap_geterr(pd));
+    pcap_close(pd);
+    return (void *)(intptr_t)RXTX_ERROR;
+  }
+
+  pcap_close(pd);
+
+  return NULL;
+}
+
+/* ========================================================================= */
+static int validate_flow_cmp(const void *a, const void *b) {
+  const struct validate_flow *fa = a;
+  const struct validate_flow *fb = b;
+
+  if (fa->packets != fb->packets) {
+    return fa->packets < fb->packets ? 1 : -1;
+  }
+  return 0;
+}
+
+/* ========================================================================= */
+static void validate_flow_print(const struct validate_flow *f) {
+  char src[INET6_ADDRSTRLEN] = "";
+  char dst[INET6_ADDRSTRLEN] = "";
+  int alen = 0;
+  int family = 0;
+
+  switch (f->len) {
+    case 8:
+    case 12:
+      alen = 4;
+      family = AF_INET;
+      break;
+    case 32:
+    case 36:
+      alen = 16;
+      family = AF_INET6;
+      break;
+    default:
+      printf("  non-ip packets expected on queue %u (%ju packets).\n",
+                                                    f->expected, f->packets);
+      return;
+  }
+
+  inet_ntop(family, f->input, src, sizeof(src));
+  inet_ntop(family, f->input + alen, dst, sizeof(dst));
+
+  if (f->len == 2 * alen) {
+    printf("  %s > %s expected on queue %u (%ju packets).\n", src, dst,
+                                                    f->expected, f->packets);
+  } else {
+    printf("  %s %u > %s %u expected on queue %u (%ju packets).\n", src,
+                 (f->input[2 * alen] << 8) | f->input[2 * alen + 1], dst,
+             (f->input[2 * alen + 2] << 8) | f->input[2 * alen + 3],
+                                                    f->expected, f->packets);
+  }
+}
+
+/* ========================================================================= */
+int main(int argc, char **argv) {
+  program_basename = basename(argv[0]);
+
+  int c = 0;
+  int flags = 0;
+  int i = 0;
+  int status = 0;
+  int worker_count = 0;
+  unsigned int j = 0;
+  unsigned int k = 0;
+
+  uintmax_t flows = VALIDATE_FLOWS_DEFAULT;
+  uintmax_t packets = 0;
+  uintmax_t mismatched = 0;
+
+  bool help = false;
+  bool udp_2tuple_set = false;
+  bool verbose = false;
+
+  char *badopt = NULL;
+  char *config_path = NULL;
+  char *config_name = NULL;
+  char *endptr = NULL;
+  char *ifname = NULL;
+  char *key = NULL;
+
+  char errbuf[RXTX_ERRBUF_SIZE] = "";
+  FILE *in = NULL;
+
+  uint32_t *table = NULL;
+  struct rss_config config;
+
+  struct validate_worker *workers = NULL;
+  struct validate_worker *w = NULL;
+
+  void *vpstatus = NULL;
+
+  /*
+   * optstring must start with ":" so ':' is returned for a missing option
+   * argument. Otherwise '?' is returned for both invalid option and missing
+   * option argument.
+   */
+  while ((c = getopt_long(argc, argv, ":f:hi:k:uvVx:", long_options, 0))
+                                                                       != -1) {
+    switch (c) {
+      case 'f':
+        flows = strtoumax(optarg, &endptr, OPTION_COUNT_BASE);
+        if (*endptr) {
+          fprintf(stderr, "%s: Invalid flow count '%s'.\n", program_basename,
+                                                                       optarg);
+          usage_short();
+          return EXIT_FAIL_OPTION;
+        }
+        break;
+
+      case 'h':
+        help = true;
+        break;
+
+      case 'i':
+        ifname = optarg;
+        break;
+
+      case 'k':
+        key = optarg;
+        break;
+
+      case 'u':
+        flags |= RSS_FLAG_UDP_2TUPLE;
+        udp_2tuple_set = true;
+        break;
+
+      case 'v':
+        verbose = true;
+        break;
+
+      case 'V':
+        printf("%s version %s\n", program_basename, RXTXUTILS_VERSION);
+        return EXIT_OK;
+
+      case 'x':
+        config_path = optarg;
+        break;
+
+      case ':':  /* missing option argument */
+        fprintf(stderr, "%s: Option '%s' requires an argument.\n",
+                                             program_basename, argv[optind-1]);
+        usage_short();
+        return EXIT_FAIL_OPTION;
+
+      case '?':  /* invalid option */
+      default:   /* invalid option in optstring */
+        /*
+         * optopt is NULL for long options and reliable for short ones as
+         * long as optstring is kept clean (see rxtxcpu.c for the details).
+         */
+        if (optopt) {
+          asprintf(&badopt, "-%c", optopt);
+        } else {
+          badopt = argv[optind-1];
+        }
+        fprintf(stderr, "%s: Unrecognized option '%s'.\n", program_basename,
+                                                                       badopt);
+        if (optopt) {
+          free(badopt);
+        }
+        usage_short();
+        return EXIT_FAIL_OPTION;
+    }
+  }
+
+  if (help) {
+    usage();
+    return EXIT_OK;
+  }
+
+  if (!config_path == !ifname) {
+    fprintf(stderr, "%s: Exactly one of -x [--rss-config] or -i"
+                            " [--interface] is required.\n", program_basename);
+    usage_short();
+    return EXIT_FAIL_OPTION;
+  }
+
+  if (optind == argc) {
+    fprintf(stderr, "%s: At least one pcap file is required.\n",
+                                                            program_basename);
+    usage_short();
+    return EXIT_FAIL_OPTION;
+  }
+
+  if (ifname) {
+    /*
+     * Not every driver reports how udp is hashed, in which case we stick
+     * with the 4-tuple.
+     */
+    config_name = ifname;
+    status = rss_config_query(&config, ifname, errbuf);
+    if (status == RXTX_ERROR) {
+      fprintf(stderr, "%s: %s\n", program_basename, errbuf);
+      return EXIT_FAIL;
+    }
+
+    if (!udp_2tuple_set) {
+      status = rss_flags_query(ifname, &flags, errbuf);
+      if (status == RXTX_ERROR && verbose) {
+        fprintf(stderr, "%s: %s\n", program_basename, errbuf);
+      }
+    }
+  } else {
+    config_name = config_path;
+    if (strcmp(config_path, "-") == 0) {
+      in = stdin;
+    } else {
+      in = fopen(config_path, "r");
+      if (!in) {
+        fprintf(stderr, "%s: error opening " HCONFIG " '%s': %s\n",
+                              program_basename, config_path, strerror(errno));
+        return EXIT_FAIL;
+      }
+    }
+
+    status = rss_config_read(&config, in, config_path, errbuf);
+    if (in != stdin) {
+      fclose(in);
+    }
+    if (status == RXTX_ERROR) {
+      fprintf(stderr, "%s: %s\n", program_basename, errbuf);
+      return EXIT_FAIL;
+    }
+  }
+
+  if (key) {
+    status = rss_config_set_key(&config, key);
+    if (status == RXTX_ERROR) {
+      fprintf(stderr, "%s: %s\n", program_basename, errbuf);
+      usage_short();
+      return EXIT_FAIL_OPTION;
+    }
+  }
+
+  if (!config.key_len) {
+    fprintf(stderr, "%s: No valid hash key in " HCONFIG " '%s'; use -k"
+                          " [--key].\n", program_basename, config_name);
+    usage_short();
+    return EXIT_FAIL_OPTION;
+  }
+
+  /*
+   * Every worker hashes with the same table; it's read only once filled.
+   */
+  table = calloc(RSS_INPUT_MAX * 256, sizeof(*table));
+  worker_count = argc - optind;
+  workers = calloc(worker_count, sizeof(*workers));
+  if (!table || !workers) {
+    fprintf(stderr, "%s: %s\n", program_basename, strerror(errno));
+    return EXIT_FAIL;
+  }
+  rss_table_fill(config.key, config.key_len, table);
+
+  for (i = 0; i < worker_count; i++) {
+    w = &workers[i];
+    w->path = argv[optind + i];
+    w->config = &config;
+    w->table = table;
+    w->flags = flags;
+
+    w->queue = queue_from_path(w->path);
+    if (w->queue < 0) {
+      fprintf(stderr, "%s: No queue in file name '%s'; expected"
+                " '<name>-<queue>.pcap' as written by rxtxqueue -w.\n",
+                                                   program_basename, w->path);
+      return EXIT_FAIL;
+    }
+
+    if (w->queue >= config.queue_count) {
+      fprintf(stderr, "%s: Queue %d of '%s' isn't in the %d queue"
+                    " indirection table.\n", program_basename, w->queue,
+                                                 w->path, config.queue_count);
+      return EXIT_FAIL;
+    }
+
+    if (verbose) {
+      fprintf(stderr, "Validating '%s' as queue %d.\n", w->path, w->queue);
+    }
+  }
+
+  /*
+   * One thread per file; files are independent and each thread streams its
+   * own, so they scale with however many files (and cpus) there are.
+   */
+  pthread_t threads[worker_count];
+
+  for (i = 0; i < worker_count; i++) {
+    status = pthread_create(&threads[i], NULL, validate_loop,
+                                                          (void *)&workers[i]);
+    if (status) {
+      fprintf(stderr, "%s: error creating threads: %s\n", program_basename,
+                                                            strerror(status));
+      return EXIT_FAIL;
+    }
+  }
+
+  status = EXIT_OK;
+
+  for (i = 0; i < worker_count; i++) {
+    pthread_join(threads[i], &vpstatus);
+    if ((intptr_t)vpstatus == (intptr_t)RXTX_ERROR) {
+      fprintf(stderr, "%s: %s\n", program_basename, workers[i].errbuf);
+      status = EXIT_FAIL;
+    }
+  }
+
+  if (status == EXIT_FAIL) {
+    return EXIT_FAIL;
+  }
+
+  for (i = 0; i < worker_count; i++) {
+    w = &workers[i];
+
+    printf("%ju of %ju packets on queue %d mismatched (%.2f%%) in '%s'.\n",
+                        w->mismatched, w->packets, w->queue,
+                        w->packets ? 100.0 * w->mismatched / w->packets : 0,
+                                                                      w->path);
+
+    /*
+     * Compact the table in place before sorting; the slots are no longer
+     * needed for lookups.
+     */
+    for (j = 0, k = 0; j < w->flow_slots; j++) {
+      if (w->flows[j].packets) {
+        w->flows[k++] = w->flows[j];
+      }
+    }
+    qsort(w->flows, k, sizeof(*w->flows), validate_flow_cmp);
+
+    for (j = 0; j < k && j < flows; j++) {
+      validate_flow_print(&w->flows[j]);
+    }
+    if (k > flows) {
+      printf("  %u more offending flows.\n", k - (unsigned int)flows);
+    }
+    if (w->untracked) {
+      printf("  %ju more packets from untracked flows.\n", w->untracked);
+    }
+
+    packets += w->packets;
+    mismatched += w->mismatched;
+
+    free(w->flows);
+  }
+
+  printf("%ju of %ju packets mismatched total (%.2f%%).\n", mismatched,
+                     packets, packets ? 100.0 * mismatched / packets : 0);
+
+  free(workers);
+  free(table);
+  rss_config_destroy(&config);
+
+  return mismatched ? EXIT_MISMATCH : EXIT_OK;
+}
@@ -24,8 +24,10 @@
                         //     rxtx_stats_init_with_mutex()
 
 #include "interface.h" // for interface_set_promisc_on()
-#include "ring_set.h"  // for RING_COUNT(), RING_ISSET(), RING_SET(),
-                       //     RING_SETSIZE, RING_ZERO()
+#include "ring_set.h"  // for for_each_set_ring_in_range(), RING_CLR(),
+                       //     RING_COUNT(), RING_ISSET(), RING_SET(),
+                       //     ring_set_copy(), ring_set_destroy(),
+                       //     ring_set_init(), RING_SETSIZE()
 #include "sig.h"       // for keep_running
 
 #include <net/if.h>     // for if_indextoname(), if_nametoindex(), IF_NAMESIZE
@@ -36,7 +38,7 @@
 #include <pcap.h>   // for PCAP_D_IN, PCAP_D_INOUT, PCAP_D_OUT
 #include <stdio.h>  // for fprintf(), NULL, stderr
 #include <stdlib.h> // for calloc(), free()
-#include <string.h> // for memcpy(), strdup(), strerror(), strlen()
+#include <string.h> // for strcmp(), strcpy(), strdup(), strerror(), strlen()
 #include <unistd.h> // for getpid()
 
 #define INCREMENT_STEP 1
@@ -59,10 +61,15 @@ void rxtx_init(struct rxtx_desc *p, char *errbuf) {
   p->stats             = NULL;
 
   p->breakloop       = 0;
+  p->burst_resolution = 0;
+  p->burst_threshold = 0;
   p->direction       = PCAP_D_INOUT;
   p->fanout_data_fd  = 0;
+  p->fanout_flags    = 0;
   p->fanout_group_id = getpid() & 0xffff;
-  p->fanout_mode     = 0;
+  p->fanout_mode     = -1;
+  p->flow_check      = 0;
+  p->flow_estimate   = 0;
   p->ifindex         = 0;
   p->initialized_ring_count = 0;
   p->is_active       = RXTX_INACTIVE;
@@ -70,9 +77,12 @@ void rxtx_init(struct rxtx_desc *p, char *errbuf) {
   p->packet_count    = 0;
   p->promiscuous     = 0;
   p->ring_count      = 0;
+  p->sample_rate     = 1;
+  p->savefile_columns = 0;
+  p->top_flows       = 0;
   p->verbose         = 0;
 
-  RING_ZERO(&(p->ring_set));
+  ring_set_init(&(p->ring_set), 0);
 }
 
 /* ========================================================================= */
@@ -107,7 +117,10 @@ int rxtx_activate(struct rxtx_desc *p) {
     fprintf(stderr, "using fanout group id '%i'\n", p->fanout_group_id);
   }
 
-  if (!p->fanout_mode) {
+  /*
+   * PACKET_FANOUT_HASH is 0, so unset is tracked as -1.
+   */
+  if (p->fanout_mode < 0) {
     rxtx_fill_errbuf(p->errbuf, "error activating descriptor: fanout mode is"
                                                        " required, but unset");
     return RXTX_ERROR;
@@ -117,6 +130,10 @@ int rxtx_activate(struct rxtx_desc *p) {
     fprintf(stderr, "using fanout mode '%i'\n", p->fanout_mode);
   }
 
+  if (p->verbose) {
+    fprintf(stderr, "using fanout flags '0x%04x'\n", p->fanout_flags);
+  }
+
   if (p->verbose) {
     if (!p->ifindex) {
       fprintf(stderr, "using ifindex '%u' for any interface\n", p->ifindex);
@@ -186,7 +203,12 @@ int rxtx_activate(struct rxtx_desc *p) {
 
   if (!RING_COUNT(&(p->ring_set))) {
     for_each_ring(i, p) {
-      RING_SET(i, &(p->ring_set));
+      status = RING_SET(i, &(p->ring_set));
+      if (status == -1) {
+        rxtx_fill_errbuf(p->errbuf, "error activating descriptor: %s",
+                                                              strerror(errno));
+        return RXTX_ERROR;
+      }
     }
   }
 
@@ -195,13 +217,12 @@ int rxtx_activate(struct rxtx_desc *p) {
     int count = RING_COUNT(&(p->ring_set));
     fprintf(stderr, "using ring set '");
     status = 0;
-    for (i = 0; i < RING_SETSIZE; i++) {
-      if (RING_ISSET(i, &(p->ring_set))) {
-        fprintf(stderr, "%i", i);
-        status++;
-        if ((status) < count) {
-          fprintf(stderr, ",");
-        }
+    for_each_set_ring_in_range(i, &(p->ring_set), 0,
+                                            RING_SETSIZE(&(p->ring_set)) - 1) {
+      fprintf(stderr, "%i", i);
+      status++;
+      if ((status) < count) {
+        fprintf(stderr, ",");
       }
     }
     fprintf(stderr, "'\n");
@@ -306,6 +327,8 @@ int rxtx_close(struct rxtx_desc *p) {
   }
   p->ifname = NULL;
 
+  ring_set_destroy(&(p->ring_set));
+
   status = rxtx_stats_destroy_with_mutex(p->stats);
   if (status == RXTX_ERROR) {
     return RXTX_ERROR;
@@ -329,6 +352,103 @@ int rxtx_close(struct rxtx_desc *p) {
   return 0;
 }
 
+/* ========================================================================= */
+int rxtx_disable_ring(struct rxtx_desc *p, unsigned int idx) {
+  if (p->is_active != RXTX_ACTIVE) {
+    rxtx_fill_errbuf(p->errbuf, "error disabling ring: disabling a ring on"
+                    " an inactive or activating descriptor is not permitted");
+    return RXTX_ERROR;
+  }
+
+  if (idx >= p->ring_count) {
+    rxtx_fill_errbuf(p->errbuf, "error disabling ring: ring idx '%u' is"
+                                                        " out-of-bounds", idx);
+    return RXTX_ERROR;
+  }
+
+  if (!RING_ISSET(idx, &(p->ring_set))) {
+    rxtx_fill_errbuf(p->errbuf, "error disabling ring: ring idx '%u' is not"
+                                                             " enabled", idx);
+    return RXTX_ERROR;
+  }
+
+  /*
+   * The socket stays in the fanout group so kernel ring indices don't shift;
+   * the worker drains what is already queued and then exits.
+   */
+  RING_CLR(idx, &(p->ring_set));
+  p->rings[idx].stop = 1;
+
+  return 0;
+}
+
+/* ========================================================================= */
+int rxtx_enable_ring(struct rxtx_desc *p, unsigned int idx) {
+  int status = 0;
+  struct rxtx_ring *ring = NULL;
+
+  /*
+   * The caller must have joined any worker previously handling this ring.
+   */
+
+  if (p->is_active != RXTX_ACTIVE) {
+    rxtx_fill_errbuf(p->errbuf, "error enabling ring: enabling a ring on an"
+                        " inactive or activating descriptor is not permitted");
+    return RXTX_ERROR;
+  }
+
+  if (idx >= p->ring_count) {
+    rxtx_fill_errbuf(p->errbuf, "error enabling ring: ring idx '%u' is"
+                                                        " out-of-bounds", idx);
+    return RXTX_ERROR;
+  }
+
+  if (RING_ISSET(idx, &(p->ring_set))) {
+    rxtx_fill_errbuf(p->errbuf, "error enabling ring: ring idx '%u' is already"
+                                                             " enabled", idx);
+    return RXTX_ERROR;
+  }
+
+  if (p->savefile_template && strcmp(p->savefile_template, "-") == 0 &&
+                                              RING_COUNT(&(p->ring_set)) > 0) {
+    rxtx_fill_errbuf(p->errbuf, "error enabling ring: writing to stdout is"
+                                " only permitted with a single enabled ring");
+    return RXTX_ERROR;
+  }
+
+  ring = &(p->rings[idx]);
+
+  /*
+   * Anything which queued up while the ring was disabled doesn't belong in
+   * the capture; see rxtx_activate() for the initial case.
+   */
+  status = rxtx_ring_mark_packets_in_buffer_as_unreliable(ring);
+  if (status == RXTX_ERROR) {
+    return RXTX_ERROR;
+  }
+
+  /*
+   * Savefiles are opened the first time a ring is enabled and kept open
+   * across disable/enable cycles.
+   */
+  if (p->savefile_template && !ring->savefile) {
+    status = rxtx_ring_savefile_open(ring, p->savefile_template);
+    if (status == RXTX_ERROR) {
+      return RXTX_ERROR;
+    }
+  }
+
+  status = RING_SET(idx, &(p->ring_set));
+  if (status == -1) {
+    rxtx_fill_errbuf(p->errbuf, "error enabling ring: %s", strerror(errno));
+    return RXTX_ERROR;
+  }
+
+  ring->stop = 0;
+
+  return 0;
+}
+
 /* ---------------------------- start of getters --------------------------- */
 /* ========================================================================= */
 int rxtx_breakloop_isset(struct rxtx_desc *p) {
@@ -338,6 +458,21 @@ int rxtx_breakloop_isset(struct rxtx_desc *p) {
   return p->breakloop;
 }
 
+/* ========================================================================= */
+int rxtx_flow_estimate_isset(struct rxtx_desc *p) {
+  return p->flow_estimate;
+}
+
+/* ========================================================================= */
+unsigned int rxtx_get_burst_resolution(struct rxtx_desc *p) {
+  return p->burst_resolution;
+}
+
+/* ========================================================================= */
+uintmax_t rxtx_get_burst_threshold(struct rxtx_desc *p) {
+  return p->burst_threshold;
+}
+
 /* ========================================================================= */
 pcap_direction_t rxtx_get_direction(struct rxtx_desc *p) {
   return p->direction;
@@ -346,7 +481,7 @@ pcap_direction_t rxtx_get_direction(struct rxtx_desc *p) {
 /* ========================================================================= */
 int rxtx_get_fanout_arg(struct rxtx_desc *p) {
   assert((p->fanout_group_id >> 16) == 0);
-  return p->fanout_group_id | (p->fanout_mode << 16);
+  return p->fanout_group_id | ((p->fanout_mode | p->fanout_flags) << 16);
 }
 
 /* ========================================================================= */
@@ -354,6 +489,11 @@ int rxtx_get_fanout_data_fd(struct rxtx_desc *p) {
   return p->fanout_data_fd;
 }
 
+/* ========================================================================= */
+int rxtx_get_fanout_flags(struct rxtx_desc *p) {
+  return p->fanout_flags;
+}
+
 /* ========================================================================= */
 int rxtx_get_fanout_group_id(struct rxtx_desc *p) {
   return p->fanout_group_id;
@@ -364,6 +504,11 @@ int rxtx_get_fanout_mode(struct rxtx_desc *p) {
   return p->fanout_mode;
 }
 
+/* ========================================================================= */
+size_t rxtx_get_flow_check(struct rxtx_desc *p) {
+  return p->flow_check;
+}
+
 /* ========================================================================= */
 unsigned int rxtx_get_ifindex(struct rxtx_desc *p) {
   return p->ifindex;
@@ -418,11 +563,26 @@ const ring_set_t *rxtx_get_ring_set(struct rxtx_desc *p) {
   return &(p->ring_set);
 }
 
+/* ========================================================================= */
+unsigned int rxtx_get_sample_rate(struct rxtx_desc *p) {
+  return p->sample_rate;
+}
+
+/* ========================================================================= */
+int rxtx_get_savefile_columns(struct rxtx_desc *p) {
+  return p->savefile_columns;
+}
+
 /* ========================================================================= */
 const char *rxtx_get_savefile_template(struct rxtx_desc *p) {
   return p->savefile_template;
 }
 
+/* ========================================================================= */
+size_t rxtx_get_top_flows(struct rxtx_desc *p) {
+  return p->top_flows;
+}
+
 /* ========================================================================= */
 int rxtx_packet_buffered_isset(struct rxtx_desc *p) {
   return p->packet_buffered;
@@ -512,6 +672,21 @@ void rxtx_set_breakloop_global(void) {
   rxtx_breakloop = 1;
 }
 
+/* ========================================================================= */
+int rxtx_set_bursts(struct rxtx_desc *p, unsigned int resolution,
+                                                         uintmax_t threshold) {
+  if (p->is_active) {
+    rxtx_fill_errbuf(p->errbuf, "error setting bursts: changing bursts on an"
+                                        " active descriptor is not permitted");
+    return RXTX_ERROR;
+  }
+
+  p->burst_resolution = resolution;
+  p->burst_threshold = threshold;
+
+  return 0;
+}
+
 /* ========================================================================= */
 int rxtx_set_direction(struct rxtx_desc *p, pcap_direction_t direction) {
   if (p->is_active) {
@@ -538,6 +713,19 @@ int rxtx_set_fanout_data_fd(struct rxtx_desc *p, int fd) {
   return 0;
 }
 
+/* ========================================================================= */
+int rxtx_set_fanout_flags(struct rxtx_desc *p, int flags) {
+  if (p->is_active) {
+    rxtx_fill_errbuf(p->errbuf, "error setting fanout flags: changing fanout"
+                            " flags on an active descriptor is not permitted");
+    return RXTX_ERROR;
+  }
+
+  p->fanout_flags = flags;
+
+  return 0;
+}
+
 /* ========================================================================= */
 int rxtx_set_fanout_group_id(struct rxtx_desc *p, int group_id) {
   if (p->is_active) {
@@ -564,6 +752,32 @@ int rxtx_set_fanout_mode(struct rxtx_desc *p, int mode) {
   return 0;
 }
 
+/* ========================================================================= */
+int rxtx_set_flow_check(struct rxtx_desc *p, size_t flows) {
+  if (p->is_active) {
+    rxtx_fill_errbuf(p->errbuf, "error setting flow check: changing flow"
+                            " check on an active descriptor is not permitted");
+    return RXTX_ERROR;
+  }
+
+  p->flow_check = flows;
+
+  return 0;
+}
+
+/* ========================================================================= */
+int rxtx_set_flow_estimate(struct rxtx_desc *p) {
+  if (p->is_active) {
+    rxtx_fill_errbuf(p->errbuf, "error setting flow estimate: changing flow"
+                         " estimate on an active descriptor is not permitted");
+    return RXTX_ERROR;
+  }
+
+  p->flow_estimate = 1;
+
+  return 0;
+}
+
 /* ========================================================================= */
 int rxtx_set_ifindex(struct rxtx_desc *p, unsigned int ifindex) {
   char ifname[IF_NAMESIZE] = "";
@@ -669,7 +883,49 @@ int rxtx_set_ring_set(struct rxtx_desc *p, const ring_set_t *set) {
     return RXTX_ERROR;
   }
 
-  memcpy(&(p->ring_set), set, sizeof(p->ring_set));
+  if (ring_set_copy(&(p->ring_set), set) == -1) {
+    rxtx_fill_errbuf(p->errbuf, "error setting ring set: %s",
+                                                              strerror(errno));
+    return RXTX_ERROR;
+  }
+
+  return 0;
+}
+
+/* ========================================================================= */
+int rxtx_set_sample_rate(struct rxtx_desc *p, unsigned int rate) {
+  if (p->is_active) {
+    rxtx_fill_errbuf(p->errbuf, "error setting sample rate: changing sample"
+                             " rate on an active descriptor is not permitted");
+    return RXTX_ERROR;
+  }
+
+  if (rate == 0) {
+    rxtx_fill_errbuf(p->errbuf, "error setting sample rate: invalid rate"
+                                                                " '%u'", rate);
+    return RXTX_ERROR;
+  }
+
+  p->sample_rate = rate;
+
+  return 0;
+}
+
+/* ========================================================================= */
+int rxtx_set_savefile_columns(struct rxtx_desc *p, int columns) {
+  if (p->is_active) {
+    rxtx_fill_errbuf(p->errbuf, "error setting savefile columns: changing"
+                 " savefile columns on an active descriptor is not permitted");
+    return RXTX_ERROR;
+  }
+
+  if (columns < 0) {
+    rxtx_fill_errbuf(p->errbuf, "error setting savefile columns: invalid"
+                                                     " columns '%d'", columns);
+    return RXTX_ERROR;
+  }
+
+  p->savefile_columns = columns;
 
   return 0;
 }
@@ -696,6 +952,19 @@ int rxtx_set_savefile_template(struct rxtx_desc *p, const char *template) {
   return 0;
 }
 
+/* ========================================================================= */
+int rxtx_set_top_flows(struct rxtx_desc *p, size_t k) {
+  if (p->is_active) {
+    rxtx_fill_errbuf(p->errbuf, "error setting top flows: changing top"
+                            " flows on an active descriptor is not permitted");
+    return RXTX_ERROR;
+  }
+
+  p->top_flows = k;
+
+  return 0;
+}
+
 /* ========================================================================= */
 int rxtx_set_packet_buffered(struct rxtx_desc *p) {
   if (p->is_active) {
@@ -727,6 +996,19 @@ void rxtx_set_verbose(struct rxtx_desc *p) {
   p->verbose = 1;
 }
 
+/* ========================================================================= */
+int rxtx_unset_flow_estimate(struct rxtx_desc *p) {
+  if (p->is_active) {
+    rxtx_fill_errbuf(p->errbuf, "error unsetting flow estimate: changing flow"
+                         " estimate on an active descriptor is not permitted");
+    return RXTX_ERROR;
+  }
+
+  p->flow_estimate = 0;
+
+  return 0;
+}
+
 /* ========================================================================= */
 int rxtx_unset_packet_buffered(struct rxtx_desc *p) {
   if (p->is_active) {
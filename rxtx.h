@@ -18,13 +18,13 @@ struct rxtx_ring;
 #include "rxtx_stats.h" // for rxtx_stats
 
 #include "ring_set.h" // for for_each_ring_in_size(),
-                      //     for_each_set_ring_in_size()
+                      //     for_each_set_ring_in_size(), ring_set_t
 
 #include <pcap.h>    // for pcap_direction_t
 #include <pthread.h> // for pthread_mutex_t
-#include <sched.h>   // for cpu_set_t
 #include <signal.h>  // for sig_atomic_t
 #include <stdbool.h> // for bool
+#include <stddef.h>  // for size_t
 #include <stdint.h>  // for uintmax_t
 
 #define for_each_ring(ring, rtd) \
@@ -44,16 +44,24 @@ struct rxtx_desc {
   char *savefile_template;
 
   int              breakloop;
+  unsigned int     burst_resolution;
+  uintmax_t        burst_threshold;
   pcap_direction_t direction;
   int              fanout_data_fd;
+  int              fanout_flags;
   int              fanout_group_id;
   int              fanout_mode;
+  size_t           flow_check;
+  int              flow_estimate;
   unsigned int     ifindex;
   int              initialized_ring_count;
   int              is_active;
   uintmax_t        packet_count;
   int              ring_count;
-  cpu_set_t        ring_set;
+  ring_set_t       ring_set;
+  unsigned int     sample_rate;
+  int              savefile_columns;
+  size_t           top_flows;
   int              packet_buffered;
   int              promiscuous;
   int              verbose;
@@ -64,13 +72,20 @@ struct rxtx_desc {
 void rxtx_init(struct rxtx_desc *p, char *errbuf);
 int rxtx_activate(struct rxtx_desc *p);
 int rxtx_close(struct rxtx_desc *p);
+int rxtx_disable_ring(struct rxtx_desc *p, unsigned int idx);
+int rxtx_enable_ring(struct rxtx_desc *p, unsigned int idx);
 
 int rxtx_breakloop_isset(struct rxtx_desc *p);
+int rxtx_flow_estimate_isset(struct rxtx_desc *p);
+unsigned int rxtx_get_burst_resolution(struct rxtx_desc *p);
+uintmax_t rxtx_get_burst_threshold(struct rxtx_desc *p);
 pcap_direction_t rxtx_get_direction(struct rxtx_desc *p);
 int rxtx_get_fanout_arg(struct rxtx_desc *p);
 int rxtx_get_fanout_data_fd(struct rxtx_desc *p);
+int rxtx_get_fanout_flags(struct rxtx_desc *p);
 int rxtx_get_fanout_group_id(struct rxtx_desc *p);
 int rxtx_get_fanout_mode(struct rxtx_desc *p);
+size_t rxtx_get_flow_check(struct rxtx_desc *p);
 unsigned int rxtx_get_ifindex(struct rxtx_desc *p);
 const char *rxtx_get_ifname(struct rxtx_desc *p);
 int rxtx_get_initialized_ring_count(struct rxtx_desc *p);
@@ -79,7 +94,10 @@ uintmax_t rxtx_get_packets_received(struct rxtx_desc *p);
 struct rxtx_ring *rxtx_get_ring(struct rxtx_desc *p, unsigned int idx);
 int rxtx_get_ring_count(struct rxtx_desc *p);
 const ring_set_t *rxtx_get_ring_set(struct rxtx_desc *p);
+unsigned int rxtx_get_sample_rate(struct rxtx_desc *p);
+int rxtx_get_savefile_columns(struct rxtx_desc *p);
 const char *rxtx_get_savefile_template(struct rxtx_desc *p);
+size_t rxtx_get_top_flows(struct rxtx_desc *p);
 int rxtx_packet_buffered_isset(struct rxtx_desc *p);
 int rxtx_packet_count_reached(struct rxtx_desc *p);
 int rxtx_promiscuous_isset(struct rxtx_desc *p);
@@ -89,19 +107,28 @@ int rxtx_increment_initialized_ring_count(struct rxtx_desc *p);
 int rxtx_increment_packets_received(struct rxtx_desc *p);
 int rxtx_set_breakloop(struct rxtx_desc *p);
 void rxtx_set_breakloop_global(void);
+int rxtx_set_bursts(struct rxtx_desc *p, unsigned int resolution,
+                                                          uintmax_t threshold);
 int rxtx_set_direction(struct rxtx_desc *p, pcap_direction_t direction);
 int rxtx_set_fanout_data_fd(struct rxtx_desc *p, int fd);
+int rxtx_set_fanout_flags(struct rxtx_desc *p, int flags);
 int rxtx_set_fanout_group_id(struct rxtx_desc *p, int group_id);
 int rxtx_set_fanout_mode(struct rxtx_desc *p, int mode);
+int rxtx_set_flow_check(struct rxtx_desc *p, size_t flows);
+int rxtx_set_flow_estimate(struct rxtx_desc *p);
 int rxtx_set_ifindex(struct rxtx_desc *p, unsigned int ifindex);
 int rxtx_set_ifname(struct rxtx_desc *p, const char *ifname);
 int rxtx_set_packet_count(struct rxtx_desc *p, uintmax_t count);
 int rxtx_set_ring_count(struct rxtx_desc *p, unsigned int count);
 int rxtx_set_ring_set(struct rxtx_desc *p, const ring_set_t *set);
+int rxtx_set_sample_rate(struct rxtx_desc *p, unsigned int rate);
+int rxtx_set_savefile_columns(struct rxtx_desc *p, int columns);
 int rxtx_set_savefile_template(struct rxtx_desc *p, const char *template);
+int rxtx_set_top_flows(struct rxtx_desc *p, size_t k);
 int rxtx_set_packet_buffered(struct rxtx_desc *p);
 int rxtx_set_promiscuous(struct rxtx_desc *p);
 void rxtx_set_verbose(struct rxtx_desc *p);
+int rxtx_unset_flow_estimate(struct rxtx_desc *p);
 int rxtx_unset_packet_buffered(struct rxtx_desc *p);
 int rxtx_unset_promiscuous(struct rxtx_desc *p);
 void rxtx_unset_verbose(struct rxtx_desc *p);
@@ -0,0 +1,187 @@
+/*
+ * Copyright (c) 2019-present StackPath, LLC
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ * rxtx_bursts.c -- fixed width rate windows for finding a ring's microbursts
+ */
+
+#include "rxtx_bursts.h"
+
+#include <inttypes.h> // for PRIu64
+#include <stdio.h>    // for fprintf()
+#include <stdlib.h>   // for qsort()
+#include <string.h>   // for memcpy(), memset()
+#include <time.h>     // for localtime_r(), strftime(), time_t, tm
+
+#define USEC_PER_SEC 1000000
+
+/*
+ * "%Y-%m-%d %H:%M:%S" plus ".%06u" and the terminator, with room to spare.
+ */
+#define BURSTS_TIMESTAMP_SIZE 40
+
+/* ========================================================================= */
+void rxtx_bursts_init(struct rxtx_bursts *p, unsigned int resolution,
+                                                         uintmax_t threshold) {
+  memset(p, 0, sizeof(*p));
+  p->resolution = resolution;
+  p->threshold = threshold;
+}
+
+/* ========================================================================= */
+static void bursts_log(struct rxtx_bursts *p) {
+  int smallest = 0;
+  int i = 0;
+
+  p->count++;
+  p->in_burst = 0;
+
+  if (p->logged < RXTX_BURSTS_LOG_SIZE) {
+    memcpy(&p->log[p->logged++], &p->current, sizeof(p->current));
+    return;
+  }
+
+  /*
+   * The log is full, so the new burst only displaces the smallest one and
+   * only if it's bigger.
+   */
+  for (i = 1; i < RXTX_BURSTS_LOG_SIZE; i++) {
+    if (p->log[i].packets < p->log[smallest].packets) {
+      smallest = i;
+    }
+  }
+  if (p->current.packets > p->log[smallest].packets) {
+    memcpy(&p->log[smallest], &p->current, sizeof(p->current));
+  }
+}
+
+/* ========================================================================= */
+static void bursts_close_bucket(struct rxtx_bursts *p) {
+  if (p->packets > p->peak_packets) {
+    p->peak_bucket = p->bucket;
+    p->peak_packets = p->packets;
+    p->peak_bytes = p->bytes;
+  }
+
+  /*
+   * An idle bucket never gets closed, so a burst only carries on when this
+   * bucket directly follows the last one in it.
+   */
+  if (p->packets >= p->threshold) {
+    if (p->in_burst &&
+               p->current.first + p->current.buckets == p->bucket) {
+      p->current.buckets++;
+      p->current.packets += p->packets;
+      p->current.bytes += p->bytes;
+    } else {
+      if (p->in_burst) {
+        bursts_log(p);
+      }
+      p->in_burst = 1;
+      p->current.first = p->bucket;
+      p->current.buckets = 1;
+      p->current.packets = p->packets;
+      p->current.bytes = p->bytes;
+    }
+  } else if (p->in_burst) {
+    bursts_log(p);
+  }
+
+  p->packets = 0;
+  p->bytes = 0;
+}
+
+/* ========================================================================= */
+void rxtx_bursts_add(struct rxtx_bursts *p, const struct timeval *ts,
+                                                          unsigned int bytes) {
+  uint64_t usec = (uint64_t)ts->tv_sec * USEC_PER_SEC + ts->tv_usec;
+  uint64_t bucket = usec / p->resolution;
+
+  /*
+   * A timestamp from before the current bucket (e.g. the clock was stepped
+   * back) is counted in the current bucket rather than reopening an old one.
+   */
+  if (bucket > p->bucket) {
+    if (p->packets) {
+      bursts_close_bucket(p);
+    }
+    p->bucket = bucket;
+  }
+
+  p->packets++;
+  p->bytes += bytes;
+}
+
+/* ========================================================================= */
+void rxtx_bursts_finish(struct rxtx_bursts *p) {
+  if (p->packets) {
+    bursts_close_bucket(p);
+  }
+  if (p->in_burst) {
+    bursts_log(p);
+  }
+}
+
+/* ========================================================================= */
+static void bursts_timestamp(const struct rxtx_bursts *p, uint64_t bucket,
+                                                                   char *str) {
+  uint64_t usec = bucket * p->resolution;
+  time_t sec = usec / USEC_PER_SEC;
+  struct tm tm;
+  size_t len = 0;
+
+  localtime_r(&sec, &tm);
+  len = strftime(str, BURSTS_TIMESTAMP_SIZE, "%Y-%m-%d %H:%M:%S", &tm);
+  snprintf(str + len, BURSTS_TIMESTAMP_SIZE - len, ".%06u",
+                                          (unsigned int)(usec % USEC_PER_SEC));
+}
+
+/* ========================================================================= */
+static int bursts_compare(const void *a, const void *b) {
+  const struct rxtx_burst *x = a;
+  const struct rxtx_burst *y = b;
+
+  return (x->first > y->first) - (x->first < y->first);
+}
+
+/* ========================================================================= */
+void rxtx_bursts_print(const struct rxtx_bursts *p, FILE *out) {
+  struct rxtx_burst log[RXTX_BURSTS_LOG_SIZE];
+  char timestamp[BURSTS_TIMESTAMP_SIZE] = "";
+  int i = 0;
+
+  if (!p->peak_packets) {
+    fprintf(out, "  no packets.\n");
+    return;
+  }
+
+  /*
+   * Rates are what the busiest bucket would amount to over a full second.
+   */
+  bursts_timestamp(p, p->peak_bucket, timestamp);
+  fprintf(out, "  peak of %ju packets, %ju bytes in %" PRIu64 " us at %s"
+               " (%ju pps, %ju bps).\n", p->peak_packets, p->peak_bytes,
+               p->resolution, timestamp,
+               p->peak_packets * USEC_PER_SEC / p->resolution,
+               p->peak_bytes * 8 * USEC_PER_SEC / p->resolution);
+
+  fprintf(out, "  %ju bursts of at least %ju packets in %" PRIu64 " us.\n",
+                                        p->count, p->threshold, p->resolution);
+
+  memcpy(log, p->log, sizeof(log));
+  qsort(log, p->logged, sizeof(*log), bursts_compare);
+
+  if (p->count > (uintmax_t)p->logged) {
+    fprintf(out, "  largest %d:\n", p->logged);
+  }
+
+  for (i = 0; i < p->logged; i++) {
+    bursts_timestamp(p, log[i].first, timestamp);
+    fprintf(out, "  %s for %" PRIu64 " us, %ju packets, %ju bytes.\n",
+                            timestamp, log[i].buckets * p->resolution,
+                            log[i].packets, log[i].bytes);
+  }
+}
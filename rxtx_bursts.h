@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) 2019-present StackPath, LLC
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ * rxtx_bursts.h -- header file to use rxtx_bursts.c
+ */
+
+#ifndef _RXTX_BURSTS_H_
+#define _RXTX_BURSTS_H_
+
+#include <stdint.h>   // for uint64_t, uintmax_t
+#include <stdio.h>    // for FILE
+#include <sys/time.h> // for timeval
+
+#define RXTX_BURSTS_RESOLUTION_MAX 1000000
+
+/*
+ * Only the largest bursts are kept for the report; the rest are counted.
+ */
+#define RXTX_BURSTS_LOG_SIZE 8
+
+/*
+ * A burst is a run of consecutive buckets which each reached the threshold.
+ * Buckets are numbered by microseconds since the epoch over the resolution.
+ */
+struct rxtx_burst {
+  uint64_t  first;
+  uint64_t  buckets;
+  uintmax_t packets;
+  uintmax_t bytes;
+};
+
+struct rxtx_bursts {
+  uint64_t          resolution;
+  uintmax_t         threshold;
+  uint64_t          bucket;
+  uintmax_t         packets;
+  uintmax_t         bytes;
+  uint64_t          peak_bucket;
+  uintmax_t         peak_packets;
+  uintmax_t         peak_bytes;
+  uintmax_t         count;
+  int               in_burst;
+  struct rxtx_burst current;
+  struct rxtx_burst log[RXTX_BURSTS_LOG_SIZE];
+  int               logged;
+};
+
+void rxtx_bursts_init(struct rxtx_bursts *p, unsigned int resolution,
+                                                          uintmax_t threshold);
+void rxtx_bursts_add(struct rxtx_bursts *p, const struct timeval *ts,
+                                                           unsigned int bytes);
+void rxtx_bursts_finish(struct rxtx_bursts *p);
+void rxtx_bursts_print(const struct rxtx_bursts *p, FILE *out);
+
+#endif // _RXTX_BURSTS_H_
@@ -0,0 +1,202 @@
+/*
+ * Copyright (c) 2019-present StackPath, LLC
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ * rxtx_control.c -- line based command channel over a unix socket
+ */
+
+#define _GNU_SOURCE
+
+#include "rxtx_control.h"
+#include "rxtx_error.h" // for RXTX_ERROR, rxtx_fill_errbuf()
+
+#include <sys/socket.h> // for accept4(), AF_UNIX, bind(), listen(),
+                        //     MSG_NOSIGNAL, recv(), send(), setsockopt(),
+                        //     SO_RCVTIMEO, SOCK_CLOEXEC, SOCK_NONBLOCK,
+                        //     SOCK_STREAM, sockaddr, socket(), SOL_SOCKET
+#include <sys/time.h>   // for timeval
+#include <sys/un.h>     // for sockaddr_un
+
+#include <errno.h>  // for EAGAIN, errno, EWOULDBLOCK
+#include <stdio.h>  // for fclose(), FILE, open_memstream()
+#include <stdlib.h> // for free()
+#include <string.h> // for memchr(), memset(), strcspn(), strdup(),
+                    //     strerror(), strlen(), strncpy()
+#include <unistd.h> // for close(), unlink()
+
+#define CONTROL_BACKLOG 4
+#define CONTROL_COMMAND_MAX 4096
+#define CONTROL_RECEIVE_TIMEOUT_SEC 1
+
+/* ========================================================================= */
+int rxtx_control_open(struct rxtx_control *p, const char *path, char *errbuf) {
+  int status = 0;
+  struct sockaddr_un sun;
+
+  p->errbuf = errbuf;
+  p->fd = -1;
+  p->path = NULL;
+
+  memset(&sun, 0, sizeof(sun));
+  sun.sun_family = AF_UNIX;
+
+  if (strlen(path) >= sizeof(sun.sun_path)) {
+    rxtx_fill_errbuf(p->errbuf, "error opening control socket '%s': path is"
+                                                            " too long", path);
+    return RXTX_ERROR;
+  }
+  strncpy(sun.sun_path, path, sizeof(sun.sun_path) - 1);
+
+  p->path = strdup(path);
+  if (!p->path) {
+    rxtx_fill_errbuf(p->errbuf, "error opening control socket '%s': %s", path,
+                                                              strerror(errno));
+    return RXTX_ERROR;
+  }
+
+  /*
+   * The listening socket is non-blocking so the main loop can poll it between
+   * worker joins without stalling.
+   */
+  p->fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (p->fd == -1) {
+    rxtx_fill_errbuf(p->errbuf, "error opening control socket '%s': %s", path,
+                                                              strerror(errno));
+    return RXTX_ERROR;
+  }
+
+  /*
+   * We deliberately don't unlink() an existing path first; a stale socket
+   * from a previous run must be removed by the user, and we never want to
+   * clobber some other file.
+   */
+  status = bind(p->fd, (struct sockaddr *)&sun, sizeof(sun));
+  if (status == -1) {
+    rxtx_fill_errbuf(p->errbuf, "error opening control socket '%s': %s", path,
+                                                              strerror(errno));
+    close(p->fd);
+    p->fd = -1;
+    return RXTX_ERROR;
+  }
+
+  status = listen(p->fd, CONTROL_BACKLOG);
+  if (status == -1) {
+    rxtx_fill_errbuf(p->errbuf, "error opening control socket '%s': %s", path,
+                                                              strerror(errno));
+    close(p->fd);
+    p->fd = -1;
+    unlink(path);
+    return RXTX_ERROR;
+  }
+
+  return 0;
+}
+
+/* ========================================================================= */
+int rxtx_control_poll(struct rxtx_control *p, rxtx_control_handler_t handler,
+                                                                   void *arg) {
+  char command[CONTROL_COMMAND_MAX];
+  char *reply = NULL;
+  size_t reply_len = 0;
+  size_t len = 0;
+  ssize_t count = 0;
+  int fd = -1;
+  FILE *out = NULL;
+
+  fd = accept4(p->fd, NULL, NULL, SOCK_CLOEXEC);
+  if (fd == -1) {
+    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      return 0;
+    }
+    rxtx_fill_errbuf(p->errbuf, "error accepting control connection: %s",
+                                                              strerror(errno));
+    return RXTX_ERROR;
+  }
+
+  /*
+   * A client which connects but never finishes its command line shouldn't be
+   * able to wedge the main loop.
+   */
+  struct timeval receive_timeout;
+  receive_timeout.tv_sec = CONTROL_RECEIVE_TIMEOUT_SEC;
+  receive_timeout.tv_usec = 0;
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &receive_timeout,
+                                                      sizeof(receive_timeout));
+
+  /*
+   * One command per connection; read up to the first newline or EOF.
+   */
+  while (len < sizeof(command) - 1) {
+    count = recv(fd, command + len, sizeof(command) - 1 - len, 0);
+    if (count <= 0) {
+      break;
+    }
+    len += count;
+    if (memchr(command, '\n', len)) {
+      break;
+    }
+  }
+  command[len] = '\0';
+  command[strcspn(command, "\r\n")] = '\0';
+
+  if (count < 0 && len == 0) {
+    /* timed out or reset; nothing to answer */
+    close(fd);
+    return 0;
+  }
+
+  out = open_memstream(&reply, &reply_len);
+  if (!out) {
+    rxtx_fill_errbuf(p->errbuf, "error handling control command: %s",
+                                                              strerror(errno));
+    close(fd);
+    return RXTX_ERROR;
+  }
+
+  handler(command, out, arg);
+
+  fclose(out);
+
+  /*
+   * MSG_NOSIGNAL keeps a client that hung up early from killing us with
+   * SIGPIPE.
+   */
+  len = 0;
+  while (len < reply_len) {
+    count = send(fd, reply + len, reply_len - len, MSG_NOSIGNAL);
+    if (count <= 0) {
+      break;
+    }
+    len += count;
+  }
+
+  free(reply);
+  close(fd);
+
+  return 1;
+}
+
+/* ========================================================================= */
+int rxtx_control_close(struct rxtx_control *p) {
+  int status = 0;
+
+  if (p->fd != -1) {
+    close(p->fd);
+    p->fd = -1;
+
+    if (p->path && unlink(p->path) == -1) {
+      rxtx_fill_errbuf(p->errbuf, "error removing control socket '%s': %s",
+                                                     p->path, strerror(errno));
+      status = RXTX_ERROR;
+    }
+  }
+
+  free(p->path);
+  p->path = NULL;
+  p->errbuf = NULL;
+
+  return status;
+}
@@ -0,0 +1,32 @@
+/*
+ * Copyright (c) 2019-present StackPath, LLC
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#ifndef _RXTX_CONTROL_H_
+#define _RXTX_CONTROL_H_
+
+#include <stdio.h> // for FILE
+
+/*
+ * A handler receives one command line (without the trailing newline) and
+ * writes its reply to reply.
+ */
+typedef void (*rxtx_control_handler_t)(const char *command, FILE *reply,
+                                                                    void *arg);
+
+struct rxtx_control {
+  char *path;
+  int  fd;
+  char *errbuf;
+};
+
+int rxtx_control_open(struct rxtx_control *p, const char *path, char *errbuf);
+int rxtx_control_poll(struct rxtx_control *p, rxtx_control_handler_t handler,
+                                                                    void *arg);
+int rxtx_control_close(struct rxtx_control *p);
+
+#endif // _RXTX_CONTROL_H_
@@ -0,0 +1,376 @@
+/*
+ * Copyright (c) 2019-present StackPath, LLC
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ * rxtx_flows.c -- per-ring flow tables for checking flow to ring consistency
+ */
+
+#include "rxtx_flows.h"
+
+#include "rxtx_error.h" // for RXTX_ERROR, rxtx_fill_errbuf()
+
+#include <arpa/inet.h>      // for inet_ntop(), ntohs()
+#include <linux/if_ether.h> // for ETH_HLEN, ETH_P_8021AD, ETH_P_8021Q,
+                            //     ETH_P_IP, ETH_P_IPV6
+#include <netinet/in.h>     // for INET6_ADDRSTRLEN, IPPROTO_DSTOPTS,
+                            //     IPPROTO_FRAGMENT, IPPROTO_HOPOPTS,
+                            //     IPPROTO_ROUTING, IPPROTO_SCTP, IPPROTO_TCP,
+                            //     IPPROTO_UDP, IPPROTO_UDPLITE
+#include <sys/socket.h>     // for AF_INET, AF_INET6
+
+#include <errno.h>  // for errno
+#include <stdio.h>  // for fprintf(), snprintf()
+#include <stdlib.h> // for calloc(), free(), qsort()
+#include <string.h> // for memcmp(), memcpy(), memset(), strerror()
+
+#define FNV_OFFSET_BASIS 14695981039346656037ull
+#define FNV_PRIME        1099511628211ull
+
+/*
+ * Enough for a bracketed ipv6 address, a port, and the terminator.
+ */
+#define ENDPOINT_STR_LEN (INET6_ADDRSTRLEN + 8)
+
+/*
+ * More than this many ipv6 extension headers and we stop looking for ports.
+ */
+#define IPV6_EXT_MAX 8
+
+struct flow_entry {
+  const struct rxtx_flow *flow;
+  int                    ring;
+};
+
+/* ========================================================================= */
+int rxtx_flows_init(struct rxtx_flows *p, size_t flow_max, char *errbuf) {
+  p->errbuf = errbuf;
+  p->slots = NULL;
+  p->flow_max = flow_max;
+  p->flow_count = 0;
+  p->untracked = 0;
+
+  /*
+   * Keeping the table at most half full keeps linear probes short, and a
+   * power of two lets us mask instead of divide.
+   */
+  p->slot_count = 2;
+  while (p->slot_count < flow_max * 2) {
+    p->slot_count <<= 1;
+  }
+
+  p->slots = calloc(p->slot_count, sizeof(*p->slots));
+  if (!p->slots) {
+    rxtx_fill_errbuf(p->errbuf, "error initializing flow table: %s",
+                                                              strerror(errno));
+    return RXTX_ERROR;
+  }
+
+  return 0;
+}
+
+/* ========================================================================= */
+void rxtx_flows_destroy(struct rxtx_flows *p) {
+  free(p->slots);
+  p->slots = NULL;
+  p->slot_count = 0;
+  p->flow_max = 0;
+  p->flow_count = 0;
+  p->untracked = 0;
+  p->errbuf = NULL;
+}
+
+/* ========================================================================= */
+static int flow_key_from_frame(const uint8_t *frame, int len,
+                                                       struct rxtx_flow *key) {
+  const uint8_t *ip = NULL;
+  int off = ETH_HLEN;
+  int type = 0;
+  int hlen = 0;
+  int i = 0;
+
+  if (len < ETH_HLEN) {
+    return -1;
+  }
+  type = (frame[off - 2] << 8) | frame[off - 1];
+
+  while ((type == ETH_P_8021Q || type == ETH_P_8021AD) && len >= off + 4) {
+    type = (frame[off + 2] << 8) | frame[off + 3];
+    off += 4;
+  }
+
+  ip = frame + off;
+  len -= off;
+
+  if (type == ETH_P_IP && len >= 20) {
+    key->family = AF_INET;
+    key->proto = ip[9];
+    memcpy(key->saddr, ip + 12, 4);
+    memcpy(key->daddr, ip + 16, 4);
+
+    /*
+     * Only the first fragment carries ports, so every fragment is keyed by
+     * addresses alone rather than splitting one datagram across two keys.
+     */
+    if (((ip[6] << 8) | ip[7]) & 0x3fff) {
+      return 0;
+    }
+    hlen = (ip[0] & 0x0f) << 2;
+  } else if (type == ETH_P_IPV6 && len >= 40) {
+    key->family = AF_INET6;
+    key->proto = ip[6];
+    memcpy(key->saddr, ip + 8, 16);
+    memcpy(key->daddr, ip + 24, 16);
+    hlen = 40;
+
+    for (i = 0; i < IPV6_EXT_MAX; i++) {
+      if (key->proto == IPPROTO_FRAGMENT) {
+        if (len >= hlen + 8) {
+          key->proto = ip[hlen];
+        }
+        return 0;
+      }
+      if (key->proto != IPPROTO_HOPOPTS && key->proto != IPPROTO_ROUTING &&
+                                             key->proto != IPPROTO_DSTOPTS) {
+        break;
+      }
+      if (len < hlen + 8) {
+        return 0;
+      }
+      key->proto = ip[hlen];
+      hlen += (ip[hlen + 1] + 1) * 8;
+    }
+  } else {
+    return -1;
+  }
+
+  if ((key->proto == IPPROTO_TCP || key->proto == IPPROTO_UDP ||
+           key->proto == IPPROTO_SCTP || key->proto == IPPROTO_UDPLITE) &&
+                                                          len >= hlen + 4) {
+    memcpy(&key->sport, ip + hlen, 2);
+    memcpy(&key->dport, ip + hlen + 2, 2);
+  }
+
+  return 0;
+}
+
+/* ========================================================================= */
+static uint64_t flow_key_hash(const struct rxtx_flow *key) {
+  const uint8_t *data = (const uint8_t *)key;
+  uint64_t hash = FNV_OFFSET_BASIS;
+  size_t i = 0;
+
+  for (i = 0; i < RXTX_FLOW_KEY_LEN; i++) {
+    hash = (hash ^ data[i]) * FNV_PRIME;
+  }
+
+  /*
+   * fnv-1a leaves the high bits poorly mixed, which matters to anything
+   * indexing by them (e.g. a hyperloglog); murmur3's finalizer fixes that.
+   */
+  hash ^= hash >> 33;
+  hash *= 0xff51afd7ed558ccdull;
+  hash ^= hash >> 33;
+  hash *= 0xc4ceb9fe1a85ec53ull;
+  hash ^= hash >> 33;
+
+  return hash;
+}
+
+/* ========================================================================= */
+int rxtx_flow_parse(struct rxtx_flow *flow, const uint8_t *frame, int len) {
+  memset(flow, 0, sizeof(*flow));
+
+  if (flow_key_from_frame(frame, len, flow) == -1) {
+    return -1;
+  }
+  flow->hash = flow_key_hash(flow);
+
+  return 0;
+}
+
+/* ========================================================================= */
+void rxtx_flows_add(struct rxtx_flows *p, const struct rxtx_flow *flow) {
+  struct rxtx_flow *slot = NULL;
+  size_t mask = p->slot_count - 1;
+  size_t idx = 0;
+
+  /*
+   * An empty slot has never counted a packet. Once flow_max flows are in the
+   * table new ones are only tallied, so the probe below always terminates.
+   */
+  for (idx = flow->hash & mask; ; idx = (idx + 1) & mask) {
+    slot = &p->slots[idx];
+
+    if (!slot->packets) {
+      if (p->flow_count == p->flow_max) {
+        p->untracked++;
+        return;
+      }
+      memcpy(slot, flow, sizeof(*slot));
+      slot->packets = 1;
+      p->flow_count++;
+      return;
+    }
+
+    if (slot->hash == flow->hash &&
+                                 memcmp(slot, flow, RXTX_FLOW_KEY_LEN) == 0) {
+      slot->packets++;
+      return;
+    }
+  }
+}
+
+/* ========================================================================= */
+static int flow_entry_compare(const void *a, const void *b) {
+  const struct flow_entry *x = a;
+  const struct flow_entry *y = b;
+  int diff = memcmp(x->flow, y->flow, RXTX_FLOW_KEY_LEN);
+
+  if (diff) {
+    return diff;
+  }
+
+  return x->ring - y->ring;
+}
+
+/* ========================================================================= */
+static void flow_endpoint_str(const struct rxtx_flow *flow,
+                               const uint8_t *addr, uint16_t port, char *str) {
+  char ip[INET6_ADDRSTRLEN] = "";
+
+  inet_ntop(flow->family, addr, ip, sizeof(ip));
+
+  if (!flow->sport && !flow->dport) {
+    snprintf(str, ENDPOINT_STR_LEN, "%s", ip);
+  } else if (flow->family == AF_INET6) {
+    snprintf(str, ENDPOINT_STR_LEN, "[%s]:%u", ip, ntohs(port));
+  } else {
+    snprintf(str, ENDPOINT_STR_LEN, "%s:%u", ip, ntohs(port));
+  }
+}
+
+/* ========================================================================= */
+void rxtx_flow_str(const struct rxtx_flow *flow, char *str) {
+  char src[ENDPOINT_STR_LEN] = "";
+  char dst[ENDPOINT_STR_LEN] = "";
+  char proto[16] = "";
+
+  flow_endpoint_str(flow, flow->saddr, flow->sport, src);
+  flow_endpoint_str(flow, flow->daddr, flow->dport, dst);
+
+  switch (flow->proto) {
+    case IPPROTO_TCP:
+      snprintf(proto, sizeof(proto), "tcp");
+      break;
+    case IPPROTO_UDP:
+      snprintf(proto, sizeof(proto), "udp");
+      break;
+    case IPPROTO_SCTP:
+      snprintf(proto, sizeof(proto), "sctp");
+      break;
+    case IPPROTO_UDPLITE:
+      snprintf(proto, sizeof(proto), "udplite");
+      break;
+    default:
+      snprintf(proto, sizeof(proto), "proto %u", flow->proto);
+      break;
+  }
+
+  snprintf(str, RXTX_FLOW_STR_LEN, "%s %s > %s", proto, src, dst);
+}
+
+/* ========================================================================= */
+static void flow_print(const struct flow_entry *entries, size_t count,
+                                              const char *subject, FILE *out) {
+  char str[RXTX_FLOW_STR_LEN] = "";
+  size_t i = 0;
+
+  rxtx_flow_str(entries[0].flow, str);
+  fprintf(out, "Flow %s seen on %zu %ss:", str, count, subject);
+
+  for (i = 0; i < count; i++) {
+    fprintf(out, "%s %s %d (%ju packets)", i ? "," : "", subject,
+                                entries[i].ring, entries[i].flow->packets);
+  }
+
+  fprintf(out, ".\n");
+}
+
+/* ========================================================================= */
+int rxtx_flows_report(struct rxtx_flows *const *tables, int count,
+                          const char *subject, FILE *out, char *errbuf) {
+  struct flow_entry *entries = NULL;
+  size_t entry_count = 0;
+  size_t flows = 0;
+  size_t split = 0;
+  size_t first = 0;
+  size_t i = 0;
+  uintmax_t untracked = 0;
+  int ring = 0;
+
+  for (ring = 0; ring < count; ring++) {
+    if (tables[ring]) {
+      entry_count += tables[ring]->flow_count;
+      untracked += tables[ring]->untracked;
+    }
+  }
+
+  if (entry_count) {
+    entries = calloc(entry_count, sizeof(*entries));
+    if (!entries) {
+      rxtx_fill_errbuf(errbuf, "error reporting flows: %s", strerror(errno));
+      return RXTX_ERROR;
+    }
+  }
+
+  entry_count = 0;
+  for (ring = 0; ring < count; ring++) {
+    if (!tables[ring]) {
+      continue;
+    }
+    for (i = 0; i < tables[ring]->slot_count; i++) {
+      if (tables[ring]->slots[i].packets) {
+        entries[entry_count].flow = &tables[ring]->slots[i];
+        entries[entry_count].ring = ring;
+        entry_count++;
+      }
+    }
+  }
+
+  /*
+   * Sorting by key brings every ring's view of a flow together, in ring
+   * order, so one pass finds the flows which landed on more than one ring.
+   */
+  if (entry_count) {
+    qsort(entries, entry_count, sizeof(*entries), flow_entry_compare);
+  }
+
+  for (first = 0; first < entry_count; first = i) {
+    for (i = first + 1; i < entry_count; i++) {
+      if (memcmp(entries[first].flow, entries[i].flow,
+                                                   RXTX_FLOW_KEY_LEN) != 0) {
+        break;
+      }
+    }
+
+    flows++;
+    if (i - first > 1) {
+      flow_print(&entries[first], i - first, subject, out);
+      split++;
+    }
+  }
+
+  fprintf(out, "%zu of %zu flows seen on more than one %s.\n", split, flows,
+                                                                     subject);
+
+  if (untracked) {
+    fprintf(out, "%ju packets not checked; flow table full.\n", untracked);
+  }
+
+  free(entries);
+
+  return 0;
+}
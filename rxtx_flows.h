@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2019-present StackPath, LLC
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ * rxtx_flows.h -- header file to use rxtx_flows.c
+ */
+
+#ifndef _RXTX_FLOWS_H_
+#define _RXTX_FLOWS_H_
+
+#include <stddef.h> // for offsetof(), size_t
+#include <stdint.h> // for uint8_t, uint16_t, uint64_t, uintmax_t
+#include <stdio.h>  // for FILE
+
+#define RXTX_FLOWS_MAX (1 << 24)
+
+/*
+ * Long enough for "proto 255" and two bracketed ipv6 addresses with ports.
+ */
+#define RXTX_FLOW_STR_LEN 128
+
+/*
+ * Everything before hash is the flow key and is compared with memcmp(), so
+ * keys are always built in zeroed memory. Ports are in network byte order
+ * and are zero for fragments and protocols without them. The hash is mixed
+ * well enough for any of its bits to be used on their own.
+ */
+struct rxtx_flow {
+  uint8_t   family;
+  uint8_t   proto;
+  uint16_t  sport;
+  uint16_t  dport;
+  uint8_t   saddr[16];
+  uint8_t   daddr[16];
+  uint64_t  hash;
+  uintmax_t packets;
+};
+
+#define RXTX_FLOW_KEY_LEN (offsetof(struct rxtx_flow, hash))
+
+/*
+ * One table per ring, only ever touched by that ring's worker while it runs,
+ * so none of this needs a lock.
+ */
+struct rxtx_flows {
+  struct rxtx_flow *slots;
+  size_t           slot_count;
+  size_t           flow_max;
+  size_t           flow_count;
+  uintmax_t        untracked;
+  char             *errbuf;
+};
+
+int rxtx_flow_parse(struct rxtx_flow *flow, const uint8_t *frame, int len);
+void rxtx_flow_str(const struct rxtx_flow *flow, char *str);
+
+int rxtx_flows_init(struct rxtx_flows *p, size_t flow_max, char *errbuf);
+void rxtx_flows_destroy(struct rxtx_flows *p);
+void rxtx_flows_add(struct rxtx_flows *p, const struct rxtx_flow *flow);
+int rxtx_flows_report(struct rxtx_flows *const *tables, int count,
+                          const char *subject, FILE *out, char *errbuf);
+
+#endif // _RXTX_FLOWS_H_
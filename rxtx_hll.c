@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2019-present StackPath, LLC
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ * rxtx_hll.c -- hyperloglog sketches for counting distinct flows per ring
+ */
+
+#include "rxtx_hll.h"
+
+#include <math.h>   // for log()
+#include <string.h> // for memset()
+
+/*
+ * Flajolet et al.'s bias correction for m >= 128 registers.
+ */
+#define HLL_ALPHA (0.7213 / (1.0 + 1.079 / RXTX_HLL_REGISTERS))
+
+/* ========================================================================= */
+void rxtx_hll_init(struct rxtx_hll *p) {
+  memset(p->registers, 0, sizeof(p->registers));
+}
+
+/* ========================================================================= */
+void rxtx_hll_add(struct rxtx_hll *p, uint64_t hash) {
+  unsigned int idx = hash >> (64 - RXTX_HLL_PRECISION);
+  uint8_t rank = 0;
+
+  /*
+   * The rank is the position of the first set bit after the index bits. The
+   * sentinel bit caps it for a hash whose remaining bits are all zero, and
+   * keeps __builtin_clzll() away from zero.
+   */
+  hash = (hash << RXTX_HLL_PRECISION) | (1ull << (RXTX_HLL_PRECISION - 1));
+  rank = __builtin_clzll(hash) + 1;
+
+  if (rank > p->registers[idx]) {
+    p->registers[idx] = rank;
+  }
+}
+
+/* ========================================================================= */
+void rxtx_hll_merge(struct rxtx_hll *p, const struct rxtx_hll *other) {
+  int i = 0;
+
+  for (i = 0; i < RXTX_HLL_REGISTERS; i++) {
+    if (other->registers[i] > p->registers[i]) {
+      p->registers[i] = other->registers[i];
+    }
+  }
+}
+
+/* ========================================================================= */
+uintmax_t rxtx_hll_estimate(const struct rxtx_hll *p) {
+  double sum = 0.0;
+  double estimate = 0.0;
+  int zeros = 0;
+  int i = 0;
+
+  for (i = 0; i < RXTX_HLL_REGISTERS; i++) {
+    sum += 1.0 / (double)(1ull << p->registers[i]);
+    if (!p->registers[i]) {
+      zeros++;
+    }
+  }
+
+  estimate = HLL_ALPHA * RXTX_HLL_REGISTERS * RXTX_HLL_REGISTERS / sum;
+
+  /*
+   * The raw estimate is biased upward for small cardinalities, where linear
+   * counting over the empty registers does much better. With a 64 bit hash
+   * there are no collisions to correct for at the top end.
+   */
+  if (estimate <= 2.5 * RXTX_HLL_REGISTERS && zeros) {
+    estimate = RXTX_HLL_REGISTERS
+                      * log((double)RXTX_HLL_REGISTERS / (double)zeros);
+  }
+
+  return (uintmax_t)(estimate + 0.5);
+}
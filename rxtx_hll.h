@@ -0,0 +1,31 @@
+/*
+ * Copyright (c) 2019-present StackPath, LLC
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ * rxtx_hll.h -- header file to use rxtx_hll.c
+ */
+
+#ifndef _RXTX_HLL_H_
+#define _RXTX_HLL_H_
+
+#include <stdint.h> // for uint8_t, uint64_t, uintmax_t
+
+/*
+ * 2^12 one byte registers per sketch, for a standard error of about 1.6%.
+ */
+#define RXTX_HLL_PRECISION 12
+#define RXTX_HLL_REGISTERS (1 << RXTX_HLL_PRECISION)
+
+struct rxtx_hll {
+  uint8_t registers[RXTX_HLL_REGISTERS];
+};
+
+void rxtx_hll_init(struct rxtx_hll *p);
+void rxtx_hll_add(struct rxtx_hll *p, uint64_t hash);
+void rxtx_hll_merge(struct rxtx_hll *p, const struct rxtx_hll *other);
+uintmax_t rxtx_hll_estimate(const struct rxtx_hll *p);
+
+#endif // _RXTX_HLL_H_
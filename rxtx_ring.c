@@ -10,37 +10,65 @@
 
 #include "rxtx_ring.h"
 #include "rxtx.h" // for rxtx_desc, rxtx_breakloop_isset(),
-                  //     rxtx_get_direction(), rxtx_get_fanout_arg(),
+                  //     rxtx_get_burst_resolution(),
+                  //     rxtx_get_burst_threshold(), rxtx_get_direction(),
+                  //     rxtx_get_fanout_arg(),
                   //     rxtx_get_fanout_data_fd(), rxtx_get_fanout_mode(),
-                  //     rxtx_get_ifindex(), rxtx_get_initialized_ring_count(),
+                  //     rxtx_get_flow_check(), rxtx_get_ifindex(),
+                  //     rxtx_get_initialized_ring_count(),
+                  //     rxtx_flow_estimate_isset(),
+                  //     rxtx_get_sample_rate(), rxtx_get_savefile_columns(),
+                  //     rxtx_get_top_flows(),
                   //     rxtx_increment_packets_received(),
                   //     rxtx_increment_initialized_ring_count(),
                   //     rxtx_packet_buffered_isset(),
                   //     rxtx_packet_count_reached()
+#include "rxtx_bursts.h"   // for rxtx_bursts_add(), rxtx_bursts_init()
 #include "rxtx_error.h"    // for RXTX_ERROR, rxtx_fill_errbuf(), RXTX_TIMEOUT
+#include "rxtx_flows.h"    // for rxtx_flow, rxtx_flow_parse(),
+                           //     rxtx_flows_add(), rxtx_flows_destroy(),
+                           //     rxtx_flows_init()
+#include "rxtx_hll.h"      // for rxtx_hll_add(), rxtx_hll_init()
 #include "rxtx_savefile.h" // for rxtx_savefile_close(), rxtx_savefile_dump(),
-                           //     rxtx_savefile_open()
+                           //     rxtx_savefile_flush(), rxtx_savefile_open()
 #include "rxtx_stats.h"    // for rxtx_stats_destroy(),
                            //     rxtx_stats_get_packets_unreliable(),
+                           //     rxtx_stats_get_tp_rollovers(),
+                           //     rxtx_stats_get_tp_rollovers_failed(),
+                           //     rxtx_stats_get_tp_rollovers_huge(),
                            //     rxtx_stats_increment_packets_received(),
                            //     rxtx_stats_increment_packets_unreliable(),
                            //     rxtx_stats_increment_tp_packets(),
-                           //     rxtx_stats_increment_tp_drops()
+                           //     rxtx_stats_increment_tp_drops(),
+                           //     rxtx_stats_increment_tp_rollovers(),
+                           //     rxtx_stats_increment_tp_rollovers_failed(),
+                           //     rxtx_stats_increment_tp_rollovers_huge()
+#include "rxtx_topk.h"     // for rxtx_topk_add(), rxtx_topk_destroy(),
+                           //     rxtx_topk_init(), RXTX_TOPK_BY_BYTES,
+                           //     RXTX_TOPK_BY_PACKETS
 
 #include "ext.h" // for ext(), noext_copy()
 
 #include <arpa/inet.h>       // for htons()
+#include <linux/filter.h>    // for BPF_JUMP(), BPF_STMT(), SKF_AD_OFF,
+                             //     SKF_AD_RANDOM, sock_filter, sock_fprog
 #include <linux/if_packet.h> // for PACKET_FANOUT, PACKET_FANOUT_DATA,
                              //     PACKET_FANOUT_EBPF, PACKET_OUTGOING,
-                             //     PACKET_RX_RING, PACKET_STATISTICS,
-                             //     PACKET_TX_RING, sockaddr_ll, tpacket_req,
-                             //     tpacket_stats
+                             //     PACKET_ROLLOVER_STATS, PACKET_RX_RING,
+                             //     PACKET_STATISTICS, PACKET_TX_RING,
+                             //     sockaddr_ll, tpacket_req,
+                             //     tpacket_rollover_stats, tpacket_stats
 #include <net/ethernet.h>    // for ETH_P_ALL
-#include <sys/socket.h>      // for AF_PACKET, bind(), getsockopt(),
-                             //     recv(), recvfrom(), setsockopt(),
-                             //     SO_RCVTIMEO, SOCK_RAW, sockaddr, socket(),
-                             //     socklen_t, SOL_PACKET, SOL_SOCKET
+#include <sys/socket.h>      // for AF_PACKET, bind(), CMSG_DATA(),
+                             //     CMSG_FIRSTHDR(), CMSG_NXTHDR(),
+                             //     CMSG_SPACE(), cmsghdr, getsockopt(),
+                             //     MSG_DONTWAIT, mmsghdr, msghdr, recvmsg(),
+                             //     recvmmsg(), SCM_TIMESTAMPNS, setsockopt(),
+                             //     SO_ATTACH_FILTER, SO_RCVTIMEO,
+                             //     SO_TIMESTAMPNS, SOCK_RAW, sockaddr,
+                             //     socket(), socklen_t, SOL_PACKET, SOL_SOCKET
 #include <sys/time.h>        // for timeval
+#include <sys/uio.h>         // for iovec
 
 #include <errno.h>   // for errno
 #include <pcap.h>    // for bpf_u_int32, PCAP_D_IN, PCAP_D_OUT, pcap_pkthdr
@@ -48,13 +76,16 @@
 #include <sched.h>   // for sched_getcpu()
 #include <stdio.h>   // for asprintf(), fprintf(), NULL, stderr
 #include <stdlib.h>  // for calloc(), exit(), free()
-#include <string.h>  // for memset(), strcmp(), strdup(), strerror()
-#include <time.h>    // for time()
+#include <string.h>  // for memcpy(), memset(), strcmp(), strdup(),
+                     //     strerror()
+#include <time.h>    // for time(), timespec
 
 #define INCREMENT_STEP 1
 
 #define PACKET_BUFFER_SIZE 65535
 
+#define UNRELIABLE_BATCH_SIZE 256
+
 #define packet_direction_is_rx(sll) (!packet_direction_is_tx(sll))
 #define packet_direction_is_tx(sll) ((sll)->sll_pkttype == PACKET_OUTGOING)
 
@@ -73,9 +104,73 @@ int rxtx_ring_init(struct rxtx_ring *p, struct rxtx_desc *rtd, char *errbuf) {
   }
   rxtx_stats_init(p->stats, errbuf);
 
+  if (rxtx_get_burst_resolution(rtd)) {
+    p->bursts = calloc(1, sizeof(*p->bursts));
+    if (!p->bursts) {
+      rxtx_fill_errbuf(p->errbuf, "error initializing ring: %s",
+                                                              strerror(errno));
+      return RXTX_ERROR;
+    }
+    rxtx_bursts_init(p->bursts, rxtx_get_burst_resolution(rtd),
+                                               rxtx_get_burst_threshold(rtd));
+  }
+
+  /*
+   * The flow table, sketch, and top flow summaries are sized up front so the
+   * worker never allocates, and they live as long as the ring so a ring which
+   * is disabled and enabled again keeps adding to them.
+   */
+  if (rxtx_get_flow_check(rtd)) {
+    p->flows = calloc(1, sizeof(*p->flows));
+    if (!p->flows) {
+      rxtx_fill_errbuf(p->errbuf, "error initializing ring: %s",
+                                                              strerror(errno));
+      return RXTX_ERROR;
+    }
+
+    status = rxtx_flows_init(p->flows, rxtx_get_flow_check(rtd), errbuf);
+    if (status == RXTX_ERROR) {
+      return RXTX_ERROR;
+    }
+  }
+
+  if (rxtx_flow_estimate_isset(rtd)) {
+    p->hll = calloc(1, sizeof(*p->hll));
+    if (!p->hll) {
+      rxtx_fill_errbuf(p->errbuf, "error initializing ring: %s",
+                                                              strerror(errno));
+      return RXTX_ERROR;
+    }
+    rxtx_hll_init(p->hll);
+  }
+
+  if (rxtx_get_top_flows(rtd)) {
+    p->top_packets = calloc(1, sizeof(*p->top_packets));
+    p->top_bytes = calloc(1, sizeof(*p->top_bytes));
+    if (!p->top_packets || !p->top_bytes) {
+      rxtx_fill_errbuf(p->errbuf, "error initializing ring: %s",
+                                                              strerror(errno));
+      return RXTX_ERROR;
+    }
+
+    status = rxtx_topk_init(p->top_packets, rxtx_get_top_flows(rtd),
+                                                 RXTX_TOPK_BY_PACKETS, errbuf);
+    if (status == RXTX_ERROR) {
+      return RXTX_ERROR;
+    }
+
+    status = rxtx_topk_init(p->top_bytes, rxtx_get_top_flows(rtd),
+                                                   RXTX_TOPK_BY_BYTES, errbuf);
+    if (status == RXTX_ERROR) {
+      return RXTX_ERROR;
+    }
+  }
+
   p->idx = rxtx_get_initialized_ring_count(rtd);
   p->fd = -1;
+  p->dequeued = 0;
   p->unreliable = 0;
+  p->stop = 0;
 
   /*
    * The AF_PACKET address family gives us a packet socket at layer 2. The
@@ -136,6 +231,51 @@ int rxtx_ring_init(struct rxtx_ring *p, struct rxtx_desc *rtd, char *errbuf) {
     return RXTX_ERROR;
   }
 
+  /*
+   * Burst detection needs to know when each packet arrived rather than when
+   * we got to it, so we ask the kernel to timestamp packets as it queues them
+   * on the socket.
+   */
+  if (p->bursts) {
+    int timestamp = 1;
+    status = setsockopt(p->fd, SOL_SOCKET, SO_TIMESTAMPNS, &timestamp,
+                                                            sizeof(timestamp));
+    if (status == -1) {
+      rxtx_fill_errbuf(p->errbuf, "error setting socket option: %s",
+                                                              strerror(errno));
+      return RXTX_ERROR;
+    }
+  }
+
+  /*
+   * When sampling, a classic bpf filter keeps 1-in-N packets using the
+   * kernel's prandom. The filter runs after fanout has picked this socket, so
+   * each ring is sampled independently and the packets it drops are never
+   * copied to userspace.
+   */
+  unsigned int sample_rate = rxtx_get_sample_rate(rtd);
+  if (sample_rate > 1) {
+    struct sock_filter sample_insns[] = {
+      BPF_STMT(BPF_LD | BPF_W | BPF_ABS, SKF_AD_OFF + SKF_AD_RANDOM),
+      BPF_STMT(BPF_ALU | BPF_MOD | BPF_K, sample_rate),
+      BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 0, 0, 1),
+      BPF_STMT(BPF_RET | BPF_K, 0xffffffff),
+      BPF_STMT(BPF_RET | BPF_K, 0),
+    };
+    struct sock_fprog sample_prog;
+    /* no need for memset(), we're initializing every member */
+    sample_prog.len = sizeof(sample_insns) / sizeof(sample_insns[0]);
+    sample_prog.filter = sample_insns;
+
+    status = setsockopt(p->fd, SOL_SOCKET, SO_ATTACH_FILTER, &sample_prog,
+                                                          sizeof(sample_prog));
+    if (status == -1) {
+      rxtx_fill_errbuf(p->errbuf, "error attaching sample filter: %s",
+                                                              strerror(errno));
+      return RXTX_ERROR;
+    }
+  }
+
   /*
    * Per packet(7), we need to set sll_family, sll_protocol, and sll_ifindex
    * in the sockaddr_ll we're passing to bind(). The values for sll_family
@@ -194,6 +334,30 @@ int rxtx_ring_destroy(struct rxtx_ring *p) {
 
   p->rtd = NULL;
 
+  free(p->bursts);
+  p->bursts = NULL;
+
+  if (p->flows) {
+    rxtx_flows_destroy(p->flows);
+    free(p->flows);
+  }
+  p->flows = NULL;
+
+  free(p->hll);
+  p->hll = NULL;
+
+  if (p->top_packets) {
+    rxtx_topk_destroy(p->top_packets);
+    free(p->top_packets);
+  }
+  p->top_packets = NULL;
+
+  if (p->top_bytes) {
+    rxtx_topk_destroy(p->top_bytes);
+    free(p->top_bytes);
+  }
+  p->top_bytes = NULL;
+
   if (p->savefile) {
     int status = rxtx_savefile_close(p->savefile);
     free(p->savefile);
@@ -211,40 +375,95 @@ int rxtx_ring_destroy(struct rxtx_ring *p) {
 
 /* ========================================================================= */
 void rxtx_ring_clear_unreliable_packets_in_buffer(struct rxtx_ring *p) {
-  unsigned char packet[PACKET_BUFFER_SIZE];
-  int length = 0;
+  /*
+   * We never look at unreliable packets, so there is no need to copy them out
+   * of the kernel. Each message gets a zero length iovec; the kernel still
+   * dequeues the whole packet (flagging it with MSG_TRUNC) which lets us
+   * discard a full batch per recvmmsg() call instead of one packet per
+   * recv() call.
+   */
+  struct mmsghdr msgs[UNRELIABLE_BATCH_SIZE];
+  memset(msgs, 0, sizeof(msgs));
+
+  uintmax_t cleared = 0;
+  unsigned int batch = 0;
+  int count = 0;
 
   while (!rxtx_breakloop_isset(p->rtd)) {
+    cleared = rxtx_stats_get_packets_unreliable(p->stats);
 
     /*
      * If we've directly processed all unreliable packets, we know all
      * unreliable packets have been cleared.
      */
-    if (rxtx_stats_get_packets_unreliable(p->stats) >= p->unreliable) {
+    if (cleared >= p->unreliable) {
       break;
     }
 
-    length = recv(p->fd, packet, sizeof(packet), 0);
+    /*
+     * Never ask for more than the remaining unreliable packets; anything
+     * beyond them is reliable and belongs to the worker loop.
+     */
+    batch = UNRELIABLE_BATCH_SIZE;
+    if (p->unreliable - cleared < batch) {
+      batch = p->unreliable - cleared;
+    }
+
+    count = recvmmsg(p->fd, msgs, batch, MSG_DONTWAIT, NULL);
 
     /*
      * If we see the ring buffer go empty, we know all unreliable packets have
      * been cleared.
      */
-    if (length == -1) {
+    if (count <= 0) {
       break;
     }
 
     /*
-     * Otherwise, this packet should be treated as unreliable.
+     * Otherwise, these packets should be treated as unreliable.
      *
      * NOTE: We don't check return here because ring stats should never have a
      *       mutex and should therefore always return 0.
      *
      */
-    rxtx_stats_increment_packets_unreliable(p->stats, INCREMENT_STEP);
+    rxtx_stats_increment_packets_unreliable(p->stats, count);
+    p->dequeued += count;
   }
 }
 
+/* ========================================================================= */
+int rxtx_ring_count_packets_in_buffer(struct rxtx_ring *p, uintmax_t *count) {
+  int status = rxtx_ring_update_tpacket_stats(p);
+  if (status == RXTX_ERROR) {
+    return RXTX_ERROR;
+  }
+
+  /*
+   * tp_packets counts every packet handed to our socket, including the ones
+   * it had to drop. Whatever was enqueued but hasn't been dequeued by us yet
+   * is still sitting in the socket buffer.
+   */
+  *count = rxtx_stats_get_tp_packets(p->stats)
+             - rxtx_stats_get_tp_drops(p->stats) - p->dequeued;
+
+  return 0;
+}
+
+/* ========================================================================= */
+struct rxtx_bursts *rxtx_ring_get_bursts(struct rxtx_ring *p) {
+  return p->bursts;
+}
+
+/* ========================================================================= */
+struct rxtx_flows *rxtx_ring_get_flows(struct rxtx_ring *p) {
+  return p->flows;
+}
+
+/* ========================================================================= */
+struct rxtx_hll *rxtx_ring_get_hll(struct rxtx_ring *p) {
+  return p->hll;
+}
+
 /* ========================================================================= */
 int rxtx_ring_get_idx(struct rxtx_ring *p) {
   return p->idx;
@@ -255,6 +474,36 @@ uintmax_t rxtx_ring_get_packets_received(struct rxtx_ring *p) {
   return rxtx_stats_get_packets_received(p->stats);
 }
 
+/* ========================================================================= */
+uintmax_t rxtx_ring_get_packets_unreliable(struct rxtx_ring *p) {
+  return rxtx_stats_get_packets_unreliable(p->stats);
+}
+
+/* ========================================================================= */
+uintmax_t rxtx_ring_get_rollovers(struct rxtx_ring *p) {
+  return rxtx_stats_get_tp_rollovers(p->stats);
+}
+
+/* ========================================================================= */
+uintmax_t rxtx_ring_get_rollovers_huge(struct rxtx_ring *p) {
+  return rxtx_stats_get_tp_rollovers_huge(p->stats);
+}
+
+/* ========================================================================= */
+uintmax_t rxtx_ring_get_rollovers_failed(struct rxtx_ring *p) {
+  return rxtx_stats_get_tp_rollovers_failed(p->stats);
+}
+
+/* ========================================================================= */
+struct rxtx_topk *rxtx_ring_get_top_bytes(struct rxtx_ring *p) {
+  return p->top_bytes;
+}
+
+/* ========================================================================= */
+struct rxtx_topk *rxtx_ring_get_top_packets(struct rxtx_ring *p) {
+  return p->top_packets;
+}
+
 /* ========================================================================= */
 void *rxtx_ring_loop(void *ring) {
   struct rxtx_ring *p = ring;
@@ -264,9 +513,14 @@ void *rxtx_ring_loop(void *ring) {
   struct pcap_pkthdr header;
   memset(&header, 0, sizeof(header));
 
+  struct rxtx_flow flow;
+
   int length = 0;
   int status = 0;
 
+  int stopping = 0;
+  uintmax_t drain = 0;
+
   if (rxtx_verbose_isset(p->rtd)) {
     fprintf(stderr, "Worker '%lu' handling ring '%d' running on cpu '%d'.\n",
                          pthread_self(), rxtx_ring_get_idx(p), sched_getcpu());
@@ -274,15 +528,41 @@ void *rxtx_ring_loop(void *ring) {
 
   rxtx_ring_clear_unreliable_packets_in_buffer(p);
 
+  if (rxtx_verbose_isset(p->rtd)) {
+    fprintf(stderr, "Worker '%lu' discarded '%ju' unreliable packets on ring"
+                    " '%d'.\n", pthread_self(),
+                    rxtx_ring_get_packets_unreliable(p), rxtx_ring_get_idx(p));
+  }
+
   while (!rxtx_breakloop_isset(p->rtd)) {
 
     if (rxtx_packet_count_reached(p->rtd)) {
       break;
     }
 
+    /*
+     * Capture on this ring was disabled. Packets already in the socket buffer
+     * arrived while we were enabled, so we drain exactly those and leave the
+     * rest to be marked unreliable if the ring is enabled again.
+     */
+    if (p->stop && !stopping) {
+      status = rxtx_ring_count_packets_in_buffer(p, &drain);
+      if (status == RXTX_ERROR) {
+        return (void *)RXTX_ERROR;
+      }
+      stopping = 1;
+    }
+
+    if (stopping && !drain) {
+      break;
+    }
+
     status = length = rxtx_ring_next_packet(p, &header, packet);
 
     if (status == RXTX_TIMEOUT) {
+      if (stopping) {
+        break;
+      }
       continue;
     }
 
@@ -290,6 +570,10 @@ void *rxtx_ring_loop(void *ring) {
       return (void *)RXTX_ERROR;
     }
 
+    if (stopping) {
+      drain--;
+    }
+
     if (length == 0) {
       continue;
     }
@@ -299,6 +583,27 @@ void *rxtx_ring_loop(void *ring) {
       return (void *)RXTX_ERROR;
     }
 
+    if (p->bursts) {
+      rxtx_bursts_add(p->bursts, &header.ts, length);
+    }
+
+    /*
+     * Non-ip packets have no flow and are left out of all of these.
+     */
+    if ((p->flows || p->hll || p->top_packets) &&
+                                 rxtx_flow_parse(&flow, packet, length) == 0) {
+      if (p->flows) {
+        rxtx_flows_add(p->flows, &flow);
+      }
+      if (p->hll) {
+        rxtx_hll_add(p->hll, flow.hash);
+      }
+      if (p->top_packets) {
+        rxtx_topk_add(p->top_packets, &flow, length);
+        rxtx_topk_add(p->top_bytes, &flow, length);
+      }
+    }
+
     if (p->savefile) {
       status = rxtx_savefile_dump(p->savefile, &header, packet,
                                            rxtx_packet_buffered_isset(p->rtd));
@@ -309,18 +614,34 @@ void *rxtx_ring_loop(void *ring) {
     }
   }
 
+  if (stopping) {
+    if (p->savefile && rxtx_savefile_flush(p->savefile) == RXTX_ERROR) {
+      return (void *)RXTX_ERROR;
+    }
+
+    if (rxtx_verbose_isset(p->rtd)) {
+      fprintf(stderr, "Worker '%lu' stopped handling ring '%d'.\n",
+                                         pthread_self(), rxtx_ring_get_idx(p));
+    }
+  }
+
   return NULL;
 }
 
 /* ========================================================================= */
 int rxtx_ring_mark_packets_in_buffer_as_unreliable(struct rxtx_ring *p) {
-  int status = rxtx_ring_update_tpacket_stats(p);
+  uintmax_t count = 0;
+
+  int status = rxtx_ring_count_packets_in_buffer(p, &count);
   if (status == RXTX_ERROR) {
     return RXTX_ERROR;
   }
 
-  p->unreliable = rxtx_stats_get_tp_packets(p->stats)
-                    - rxtx_stats_get_tp_drops(p->stats);
+  /*
+   * p->unreliable is cumulative so a ring which is enabled, disabled, and
+   * enabled again only discards what queued up while it was disabled.
+   */
+  p->unreliable = rxtx_stats_get_packets_unreliable(p->stats) + count;
 
   return 0;
 }
@@ -329,18 +650,41 @@ int rxtx_ring_mark_packets_in_buffer_as_unreliable(struct rxtx_ring *p) {
 int rxtx_ring_next_packet(struct rxtx_ring *p, struct pcap_pkthdr *header,
                                                               u_char *packet) {
   struct sockaddr_ll sll;
-  unsigned int sll_len = sizeof(sll);
+  char control[CMSG_SPACE(sizeof(struct timespec))];
+  struct cmsghdr *cmsg = NULL;
+  struct timespec ts;
+  struct msghdr msg;
+  struct iovec iov;
 
   int length = 0;
   int status = 0;
 
-  length = recvfrom(p->fd, packet, PACKET_BUFFER_SIZE, 0,
-                                          (struct sockaddr *)&sll, &sll_len);
+  iov.iov_base = packet;
+  iov.iov_len = PACKET_BUFFER_SIZE;
+
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_name = &sll;
+  msg.msg_namelen = sizeof(sll);
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+
+  /*
+   * Kernel timestamps only come with SO_TIMESTAMPNS, which is only set when
+   * detecting bursts.
+   */
+  if (p->bursts) {
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+  }
+
+  length = recvmsg(p->fd, &msg, 0);
 
   if (length == -1) {
     return RXTX_TIMEOUT;
   }
 
+  p->dequeued++;
+
   if (rxtx_get_direction(p->rtd) == PCAP_D_OUT &&
                                                 packet_direction_is_rx(&sll)) {
     return 0;
@@ -361,12 +705,22 @@ int rxtx_ring_next_packet(struct rxtx_ring *p, struct pcap_pkthdr *header,
   header->ts.tv_sec  = time(NULL);
   header->ts.tv_usec = 0;
 
+  for (cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+    if (cmsg->cmsg_level == SOL_SOCKET &&
+                                      cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+      memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+      header->ts.tv_sec  = ts.tv_sec;
+      header->ts.tv_usec = ts.tv_nsec / 1000;
+    }
+  }
+
   return length;
 }
 
 /* ========================================================================= */
 int rxtx_ring_savefile_open(struct rxtx_ring *p, const char *template) {
   int status = 0;
+  int columns = 0;
   char *filename = NULL;
   char *noext = NULL;
 
@@ -396,7 +750,17 @@ int rxtx_ring_savefile_open(struct rxtx_ring *p, const char *template) {
       return RXTX_ERROR;
     }
 
-    status = asprintf(&filename, "%s-%d.%s", noext, p->idx, ext(template));
+    /*
+     * Rings laid out as a grid (e.g. cpu by queue) are named by row and
+     * column rather than by index.
+     */
+    columns = rxtx_get_savefile_columns(p->rtd);
+    if (columns) {
+      status = asprintf(&filename, "%s-%d-%d.%s", noext, p->idx / columns,
+                                             p->idx % columns, ext(template));
+    } else {
+      status = asprintf(&filename, "%s-%d.%s", noext, p->idx, ext(template));
+    }
     if (status == -1) {
       rxtx_fill_errbuf(p->errbuf, "error opening savefile: %s",
                                                               strerror(errno));
@@ -436,3 +800,42 @@ int rxtx_ring_update_tpacket_stats(struct rxtx_ring *p) {
 
   return rxtx_stats_increment_tp_drops(p->stats, tp_stats.tp_drops);
 }
+
+/* ========================================================================= */
+int rxtx_ring_update_rollover_stats(struct rxtx_ring *p) {
+  int status = 0;
+  struct tpacket_rollover_stats rollover_stats;
+  socklen_t len = sizeof(rollover_stats);
+  uintmax_t all = 0;
+  uintmax_t huge = 0;
+  uintmax_t failed = 0;
+
+  status = getsockopt(p->fd, SOL_PACKET, PACKET_ROLLOVER_STATS,
+                                                     &rollover_stats, &len);
+  if (status < 0) {
+    rxtx_fill_errbuf(p->errbuf, "error collecting rollover statistics: %s",
+                                                              strerror(errno));
+    return RXTX_ERROR;
+  }
+
+  /*
+   * Unlike PACKET_STATISTICS, the kernel doesn't reset these counters when we
+   * read them, so we only add what accrued since the last call.
+   */
+  all = rollover_stats.tp_all - rxtx_stats_get_tp_rollovers(p->stats);
+  huge = rollover_stats.tp_huge - rxtx_stats_get_tp_rollovers_huge(p->stats);
+  failed = rollover_stats.tp_failed
+             - rxtx_stats_get_tp_rollovers_failed(p->stats);
+
+  status = rxtx_stats_increment_tp_rollovers(p->stats, all);
+  if (status == RXTX_ERROR) {
+    return RXTX_ERROR;
+  }
+
+  status = rxtx_stats_increment_tp_rollovers_huge(p->stats, huge);
+  if (status == RXTX_ERROR) {
+    return RXTX_ERROR;
+  }
+
+  return rxtx_stats_increment_tp_rollovers_failed(p->stats, failed);
+}
@@ -13,29 +13,54 @@ struct rxtx_desc;
 struct rxtx_ring;
 
 #include "rxtx.h"          // for rxtx_desc
+#include "rxtx_bursts.h"   // for rxtx_bursts
+#include "rxtx_flows.h"    // for rxtx_flows
+#include "rxtx_hll.h"      // for rxtx_hll
 #include "rxtx_savefile.h" // for rxtx_savefile
 #include "rxtx_stats.h"    // for rxtx_stats
+#include "rxtx_topk.h"     // for rxtx_topk
+
+#include <signal.h> // for sig_atomic_t
+#include <stdint.h> // for uintmax_t
 
 struct rxtx_ring {
   struct rxtx_desc  *rtd;
+  struct rxtx_bursts *bursts;
+  struct rxtx_flows *flows;
+  struct rxtx_hll   *hll;
   struct rxtx_savefile *savefile;
   struct rxtx_stats *stats;
+  struct rxtx_topk  *top_bytes;
+  struct rxtx_topk  *top_packets;
   int               idx;
   int               fd;
-  unsigned int      unreliable;
+  uintmax_t         dequeued;
+  uintmax_t         unreliable;
+  volatile sig_atomic_t stop;
   char              *errbuf;
 };
 
 int rxtx_ring_init(struct rxtx_ring *p, struct rxtx_desc *rtd, char *errbuf);
 int rxtx_ring_destroy(struct rxtx_ring *p);
 void rxtx_ring_clear_unreliable_packets_in_buffer(struct rxtx_ring *p);
+int rxtx_ring_count_packets_in_buffer(struct rxtx_ring *p, uintmax_t *count);
+struct rxtx_bursts *rxtx_ring_get_bursts(struct rxtx_ring *p);
+struct rxtx_flows *rxtx_ring_get_flows(struct rxtx_ring *p);
+struct rxtx_hll *rxtx_ring_get_hll(struct rxtx_ring *p);
 int rxtx_ring_get_idx(struct rxtx_ring *p);
 uintmax_t rxtx_ring_get_packets_received(struct rxtx_ring *p);
+uintmax_t rxtx_ring_get_packets_unreliable(struct rxtx_ring *p);
+uintmax_t rxtx_ring_get_rollovers(struct rxtx_ring *p);
+uintmax_t rxtx_ring_get_rollovers_failed(struct rxtx_ring *p);
+uintmax_t rxtx_ring_get_rollovers_huge(struct rxtx_ring *p);
+struct rxtx_topk *rxtx_ring_get_top_bytes(struct rxtx_ring *p);
+struct rxtx_topk *rxtx_ring_get_top_packets(struct rxtx_ring *p);
 void *rxtx_ring_loop(void *ring);
 int rxtx_ring_mark_packets_in_buffer_as_unreliable(struct rxtx_ring *p);
 int rxtx_ring_next_packet(struct rxtx_ring *p, struct pcap_pkthdr *header,
                                                                u_char *packet);
 int rxtx_ring_savefile_open(struct rxtx_ring *p, const char *template);
+int rxtx_ring_update_rollover_stats(struct rxtx_ring *p);
 int rxtx_ring_update_tpacket_stats(struct rxtx_ring *p);
 
 #endif // _RXTX_RING_H_
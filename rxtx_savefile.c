@@ -66,6 +66,21 @@ int rxtx_savefile_dump(struct rxtx_savefile *p, struct pcap_pkthdr *header,
   return 0;
 }
 
+/* ========================================================================= */
+int rxtx_savefile_flush(struct rxtx_savefile *p) {
+  if (pcap_dump_flush(p->pdd) == PCAP_ERROR) {
+    /*
+     * pcap_dump_flush() only returns PCAP_ERROR when fflush() returns EOF;
+     * errno should be set.
+     */
+    rxtx_fill_errbuf(p->errbuf, "error writing to savefile '%s': %s", p->name,
+                                                              strerror(errno));
+    return RXTX_ERROR;
+  }
+
+  return 0;
+}
+
 /* ========================================================================= */
 int rxtx_savefile_close(struct rxtx_savefile *p) {
   int status = 0;
@@ -24,11 +24,17 @@ void rxtx_stats_init(struct rxtx_stats *p, char *errbuf) {
   p->packets_unreliable = 0;
   p->tp_packets = 0;
   p->tp_drops = 0;
+  p->tp_rollovers = 0;
+  p->tp_rollovers_huge = 0;
+  p->tp_rollovers_failed = 0;
 
 }
 
 /* ========================================================================= */
 void rxtx_stats_destroy(struct rxtx_stats *p) {
+  p->tp_rollovers_failed = 0;
+  p->tp_rollovers_huge = 0;
+  p->tp_rollovers = 0;
   p->tp_drops = 0;
   p->tp_packets = 0;
   p->packets_unreliable = 0;
@@ -103,6 +109,21 @@ uintmax_t rxtx_stats_get_tp_drops(struct rxtx_stats *p) {
   return p->tp_drops;
 }
 
+/* ========================================================================= */
+uintmax_t rxtx_stats_get_tp_rollovers(struct rxtx_stats *p) {
+  return p->tp_rollovers;
+}
+
+/* ========================================================================= */
+uintmax_t rxtx_stats_get_tp_rollovers_huge(struct rxtx_stats *p) {
+  return p->tp_rollovers_huge;
+}
+
+/* ========================================================================= */
+uintmax_t rxtx_stats_get_tp_rollovers_failed(struct rxtx_stats *p) {
+  return p->tp_rollovers_failed;
+}
+
 /* ========================================================================= */
 int rxtx_stats_increment_packets_received(struct rxtx_stats *p, int step) {
   int status;
@@ -210,3 +231,87 @@ int rxtx_stats_increment_tp_drops(struct rxtx_stats *p, int step) {
 
   return 0;
 }
+
+/* ========================================================================= */
+int rxtx_stats_increment_tp_rollovers(struct rxtx_stats *p,
+                                                              uintmax_t step) {
+  int status;
+
+  if (p->mutex) {
+    status = pthread_mutex_lock(p->mutex);
+    if (status) {
+      rxtx_fill_errbuf(p->errbuf, "error locking stats mutex: %s",
+                                                             strerror(status));
+      return RXTX_ERROR;
+    }
+  }
+
+  p->tp_rollovers += step;
+
+  if (p->mutex) {
+    status = pthread_mutex_unlock(p->mutex);
+    if (status) {
+      rxtx_fill_errbuf(p->errbuf, "error unlocking stats mutex: %s",
+                                                             strerror(status));
+      return RXTX_ERROR;
+    }
+  }
+
+  return 0;
+}
+
+/* ========================================================================= */
+int rxtx_stats_increment_tp_rollovers_huge(struct rxtx_stats *p,
+                                                              uintmax_t step) {
+  int status;
+
+  if (p->mutex) {
+    status = pthread_mutex_lock(p->mutex);
+    if (status) {
+      rxtx_fill_errbuf(p->errbuf, "error locking stats mutex: %s",
+                                                             strerror(status));
+      return RXTX_ERROR;
+    }
+  }
+
+  p->tp_rollovers_huge += step;
+
+  if (p->mutex) {
+    status = pthread_mutex_unlock(p->mutex);
+    if (status) {
+      rxtx_fill_errbuf(p->errbuf, "error unlocking stats mutex: %s",
+                                                             strerror(status));
+      return RXTX_ERROR;
+    }
+  }
+
+  return 0;
+}
+
+/* ========================================================================= */
+int rxtx_stats_increment_tp_rollovers_failed(struct rxtx_stats *p,
+                                                              uintmax_t step) {
+  int status;
+
+  if (p->mutex) {
+    status = pthread_mutex_lock(p->mutex);
+    if (status) {
+      rxtx_fill_errbuf(p->errbuf, "error locking stats mutex: %s",
+                                                             strerror(status));
+      return RXTX_ERROR;
+    }
+  }
+
+  p->tp_rollovers_failed += step;
+
+  if (p->mutex) {
+    status = pthread_mutex_unlock(p->mutex);
+    if (status) {
+      rxtx_fill_errbuf(p->errbuf, "error unlocking stats mutex: %s",
+                                                             strerror(status));
+      return RXTX_ERROR;
+    }
+  }
+
+  return 0;
+}
@@ -17,6 +17,9 @@ struct rxtx_stats {
   uintmax_t packets_unreliable;
   uintmax_t tp_packets;
   uintmax_t tp_drops;
+  uintmax_t tp_rollovers;
+  uintmax_t tp_rollovers_huge;
+  uintmax_t tp_rollovers_failed;
   pthread_mutex_t *mutex;
   char *errbuf;
 };
@@ -34,10 +37,19 @@ uintmax_t rxtx_stats_get_packets_received(struct rxtx_stats *p);
 uintmax_t rxtx_stats_get_packets_unreliable(struct rxtx_stats *p);
 uintmax_t rxtx_stats_get_tp_packets(struct rxtx_stats *p);
 uintmax_t rxtx_stats_get_tp_drops(struct rxtx_stats *p);
+uintmax_t rxtx_stats_get_tp_rollovers(struct rxtx_stats *p);
+uintmax_t rxtx_stats_get_tp_rollovers_huge(struct rxtx_stats *p);
+uintmax_t rxtx_stats_get_tp_rollovers_failed(struct rxtx_stats *p);
 
 int rxtx_stats_increment_packets_received(struct rxtx_stats *p, int step);
 int rxtx_stats_increment_packets_unreliable(struct rxtx_stats *p, int step);
 int rxtx_stats_increment_tp_packets(struct rxtx_stats *p, int step);
 int rxtx_stats_increment_tp_drops(struct rxtx_stats *p, int step);
+int rxtx_stats_increment_tp_rollovers(struct rxtx_stats *p,
+                                                              uintmax_t step);
+int rxtx_stats_increment_tp_rollovers_huge(struct rxtx_stats *p,
+                                                              uintmax_t step);
+int rxtx_stats_increment_tp_rollovers_failed(struct rxtx_stats *p,
+                                                              uintmax_t step);
 
 #endif // _RXTX_STATS_H_
@@ -0,0 +1,262 @@
+/*
+ * Copyright (c) 2019-present StackPath, LLC
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ * rxtx_topk.c -- space-saving heavy hitter summaries of a ring's flows
+ */
+
+#include "rxtx_topk.h"
+
+#include "rxtx_error.h" // for RXTX_ERROR, rxtx_fill_errbuf()
+#include "rxtx_flows.h" // for rxtx_flow, RXTX_FLOW_KEY_LEN,
+                        //     RXTX_FLOW_STR_LEN, rxtx_flow_str()
+
+#include <errno.h>  // for errno
+#include <stdio.h>  // for fprintf()
+#include <stdlib.h> // for calloc(), free(), qsort()
+#include <string.h> // for memcmp(), memcpy(), strerror()
+
+#define INDEX_EMPTY 0
+
+#define topk_home(p, e) ((size_t)(p)->entries[(e)].flow.hash \
+                                                            & (p)->index_mask)
+
+/* ========================================================================= */
+int rxtx_topk_init(struct rxtx_topk *p, size_t k, int by, char *errbuf) {
+  size_t index_size = 2;
+
+  p->errbuf = errbuf;
+  p->by = by;
+  p->capacity = k * RXTX_TOPK_SLACK;
+  p->used = 0;
+  p->entries = NULL;
+  p->heap = NULL;
+  p->index = NULL;
+
+  /*
+   * As with the flow table, at most half full and a power of two.
+   */
+  while (index_size < p->capacity * 2) {
+    index_size <<= 1;
+  }
+  p->index_mask = index_size - 1;
+
+  p->entries = calloc(p->capacity, sizeof(*p->entries));
+  p->heap = calloc(p->capacity, sizeof(*p->heap));
+  p->index = calloc(index_size, sizeof(*p->index));
+  if (!p->entries || !p->heap || !p->index) {
+    rxtx_fill_errbuf(p->errbuf, "error initializing top flows: %s",
+                                                              strerror(errno));
+    return RXTX_ERROR;
+  }
+
+  return 0;
+}
+
+/* ========================================================================= */
+void rxtx_topk_destroy(struct rxtx_topk *p) {
+  free(p->entries);
+  free(p->heap);
+  free(p->index);
+  p->entries = NULL;
+  p->heap = NULL;
+  p->index = NULL;
+  p->capacity = 0;
+  p->used = 0;
+  p->index_mask = 0;
+  p->errbuf = NULL;
+}
+
+/* ========================================================================= */
+static void topk_heap_swap(struct rxtx_topk *p, size_t a, size_t b) {
+  size_t tmp = p->heap[a];
+
+  p->heap[a] = p->heap[b];
+  p->heap[b] = tmp;
+  p->entries[p->heap[a]].heap_pos = a;
+  p->entries[p->heap[b]].heap_pos = b;
+}
+
+/* ========================================================================= */
+static void topk_sift_up(struct rxtx_topk *p, size_t pos) {
+  size_t parent = 0;
+
+  while (pos) {
+    parent = (pos - 1) / 2;
+    if (p->entries[p->heap[parent]].count <= p->entries[p->heap[pos]].count) {
+      break;
+    }
+    topk_heap_swap(p, pos, parent);
+    pos = parent;
+  }
+}
+
+/* ========================================================================= */
+static void topk_sift_down(struct rxtx_topk *p, size_t pos) {
+  size_t child = 0;
+
+  while ((child = pos * 2 + 1) < p->used) {
+    if (child + 1 < p->used && p->entries[p->heap[child + 1]].count
+                                        < p->entries[p->heap[child]].count) {
+      child++;
+    }
+    if (p->entries[p->heap[pos]].count <= p->entries[p->heap[child]].count) {
+      break;
+    }
+    topk_heap_swap(p, pos, child);
+    pos = child;
+  }
+}
+
+/* ========================================================================= */
+static size_t *topk_index_find(struct rxtx_topk *p,
+                                                const struct rxtx_flow *flow) {
+  size_t i = 0;
+  size_t e = 0;
+
+  for (i = flow->hash & p->index_mask; ; i = (i + 1) & p->index_mask) {
+    if (p->index[i] == INDEX_EMPTY) {
+      return &p->index[i];
+    }
+    e = p->index[i] - 1;
+    if (p->entries[e].flow.hash == flow->hash &&
+               memcmp(&p->entries[e].flow, flow, RXTX_FLOW_KEY_LEN) == 0) {
+      return &p->index[i];
+    }
+  }
+}
+
+/* ========================================================================= */
+static void topk_index_remove(struct rxtx_topk *p, size_t *slot) {
+  size_t i = slot - p->index;
+  size_t j = i;
+  size_t home = 0;
+
+  /*
+   * Backward shift deletion; anything later in the probe run which could
+   * live in the hole moves into it, so lookups never need tombstones.
+   */
+  while (1) {
+    j = (j + 1) & p->index_mask;
+    if (p->index[j] == INDEX_EMPTY) {
+      break;
+    }
+    home = topk_home(p, p->index[j] - 1);
+    if (((j - home) & p->index_mask) >= ((j - i) & p->index_mask)) {
+      p->index[i] = p->index[j];
+      i = j;
+    }
+  }
+
+  p->index[i] = INDEX_EMPTY;
+}
+
+/* ========================================================================= */
+void rxtx_topk_add(struct rxtx_topk *p, const struct rxtx_flow *flow,
+                                                          unsigned int bytes) {
+  struct rxtx_topk_entry *entry = NULL;
+  uintmax_t weight = p->by == RXTX_TOPK_BY_BYTES ? bytes : 1;
+  size_t *slot = topk_index_find(p, flow);
+  size_t e = 0;
+
+  if (*slot != INDEX_EMPTY) {
+    entry = &p->entries[*slot - 1];
+    entry->count += weight;
+    topk_sift_down(p, entry->heap_pos);
+    return;
+  }
+
+  if (p->used < p->capacity) {
+    e = p->used;
+    entry = &p->entries[e];
+    memcpy(&entry->flow, flow, sizeof(entry->flow));
+    entry->count = weight;
+    entry->error = 0;
+    entry->heap_pos = p->used;
+    p->heap[p->used++] = e;
+    *slot = e + 1;
+    topk_sift_up(p, entry->heap_pos);
+    return;
+  }
+
+  /*
+   * Every counter is taken, so the new flow inherits the smallest one. Its
+   * old count becomes the new flow's error since some or all of it may
+   * belong to flows evicted earlier.
+   */
+  e = p->heap[0];
+  entry = &p->entries[e];
+  topk_index_remove(p, topk_index_find(p, &entry->flow));
+
+  entry->error = entry->count;
+  entry->count += weight;
+  memcpy(&entry->flow, flow, sizeof(entry->flow));
+
+  /*
+   * The removal may have shifted the run our lookup ended in, so find the
+   * empty slot again.
+   */
+  *topk_index_find(p, flow) = e + 1;
+  topk_sift_down(p, 0);
+}
+
+/* ========================================================================= */
+static int topk_entry_compare(const void *a, const void *b) {
+  const struct rxtx_topk_entry *x = *(const struct rxtx_topk_entry *const *)a;
+  const struct rxtx_topk_entry *y = *(const struct rxtx_topk_entry *const *)b;
+
+  if (x->count != y->count) {
+    return x->count < y->count ? 1 : -1;
+  }
+
+  return (x->error > y->error) - (x->error < y->error);
+}
+
+/* ========================================================================= */
+int rxtx_topk_print(struct rxtx_topk *p, size_t k, FILE *out) {
+  const struct rxtx_topk_entry **sorted = NULL;
+  const struct rxtx_topk_entry *entry = NULL;
+  const char *unit = p->by == RXTX_TOPK_BY_BYTES ? "bytes" : "packets";
+  char str[RXTX_FLOW_STR_LEN] = "";
+  size_t i = 0;
+
+  if (!p->used) {
+    fprintf(out, "  no flows.\n");
+    return 0;
+  }
+
+  sorted = calloc(p->used, sizeof(*sorted));
+  if (!sorted) {
+    rxtx_fill_errbuf(p->errbuf, "error reporting top flows: %s",
+                                                              strerror(errno));
+    return RXTX_ERROR;
+  }
+
+  for (i = 0; i < p->used; i++) {
+    sorted[i] = &p->entries[i];
+  }
+  qsort(sorted, p->used, sizeof(*sorted), topk_entry_compare);
+
+  /*
+   * A flow's true total is somewhere between count - error and count; both
+   * ends are shown when they differ.
+   */
+  for (i = 0; i < k && i < p->used; i++) {
+    entry = sorted[i];
+    rxtx_flow_str(&entry->flow, str);
+
+    if (entry->error) {
+      fprintf(out, "  %zu. %s, %ju to %ju %s.\n", i + 1, str,
+                       entry->count - entry->error, entry->count, unit);
+    } else {
+      fprintf(out, "  %zu. %s, %ju %s.\n", i + 1, str, entry->count, unit);
+    }
+  }
+
+  free(sorted);
+
+  return 0;
+}
@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2019-present StackPath, LLC
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ * rxtx_topk.h -- header file to use rxtx_topk.c
+ */
+
+#ifndef _RXTX_TOPK_H_
+#define _RXTX_TOPK_H_
+
+#include "rxtx_flows.h" // for rxtx_flow
+
+#include <stddef.h> // for size_t
+#include <stdint.h> // for uintmax_t
+#include <stdio.h>  // for FILE
+
+#define RXTX_TOPK_MAX 1024
+
+/*
+ * Space-Saving only guarantees the top k for flows above total/counters, so
+ * we keep a few counters for every flow we're asked to report.
+ */
+#define RXTX_TOPK_SLACK 4
+
+#define RXTX_TOPK_BY_PACKETS 0
+#define RXTX_TOPK_BY_BYTES   1
+
+/*
+ * count overestimates the flow's packets (or bytes) by at most error.
+ */
+struct rxtx_topk_entry {
+  struct rxtx_flow flow;
+  uintmax_t        count;
+  uintmax_t        error;
+  size_t           heap_pos;
+};
+
+/*
+ * A min-heap on count finds the counter to evict and an open addressing
+ * index finds a flow's counter. Like the flow table, each summary belongs to
+ * a single ring worker and needs no lock.
+ */
+struct rxtx_topk {
+  struct rxtx_topk_entry *entries;
+  size_t                 *heap;
+  size_t                 *index;
+  size_t                 capacity;
+  size_t                 used;
+  size_t                 index_mask;
+  int                    by;
+  char                   *errbuf;
+};
+
+int rxtx_topk_init(struct rxtx_topk *p, size_t k, int by, char *errbuf);
+void rxtx_topk_destroy(struct rxtx_topk *p);
+void rxtx_topk_add(struct rxtx_topk *p, const struct rxtx_flow *flow,
+                                                           unsigned int bytes);
+int rxtx_topk_print(struct rxtx_topk *p, size_t k, FILE *out);
+
+#endif // _RXTX_TOPK_H_
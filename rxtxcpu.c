@@ -10,51 +10,97 @@
 
 #include "cpu.h"       // for get_online_cpu_set(), parse_cpu_list(),
                        //     parse_cpu_mask()
-#include "ring_set.h"  // for for_each_ring_in_size(), RING_CLR(),
-                       //     RING_COUNT(), RING_ISSET(), RING_SET()
+#include "ring_set.h"  // for for_each_ring_in_size(),
+                       //     for_each_set_ring_in_range(), RING_CLR(),
+                       //     RING_COUNT(), RING_ISSET(), RING_SET(),
+                       //     ring_set_copy(), ring_set_destroy(),
+                       //     ring_set_init(), RING_SETSIZE(), ring_set_t,
+                       //     RING_ZERO()
 #include "rxtx.h"      // for for_each_ring(), for_each_set_ring(),
-                       //     program_basename, rxtx_activate(), rxtx_close(),
-                       //     rxtx_desc, rxtx_get_packets_received(),
-                       //     rxtx_get_ring(), rxtx_get_ring_count(),
-                       //     rxtx_get_savefile_template(), rxtx_init(),
-                       //     rxtx_set_direction(), rxtx_set_fanout_mode(),
+                       //     program_basename, rxtx_activate(),
+                       //     rxtx_breakloop_isset(), rxtx_close(),
+                       //     rxtx_desc, rxtx_disable_ring(),
+                       //     rxtx_enable_ring(), rxtx_flow_estimate_isset(),
+                       //     rxtx_get_burst_resolution(),
+                       //     rxtx_get_packets_received(),
+                       //     rxtx_get_fanout_flags(), rxtx_get_flow_check(),
+                       //     rxtx_get_ring(),
+                       //     rxtx_get_ring_count(), rxtx_get_ring_set(),
+                       //     rxtx_get_sample_rate(),
+                       //     rxtx_get_savefile_template(),
+                       //     rxtx_get_top_flows(), rxtx_init(),
+                       //     rxtx_packet_count_reached(),
+                       //     rxtx_set_bursts(), rxtx_set_direction(),
+                       //     rxtx_set_fanout_flags(),
+                       //     rxtx_set_fanout_mode(), rxtx_set_flow_check(),
+                       //     rxtx_set_flow_estimate(),
                        //     rxtx_set_ifname(), rxtx_set_packet_buffered(),
                        //     rxtx_set_promiscuous(), rxtx_set_ring_count(),
-                       //     rxtx_set_ring_set(),
-                       //     rxtx_set_savefile_template(), rxtx_set_verbose(),
+                       //     rxtx_set_ring_set(), rxtx_set_sample_rate(),
+                       //     rxtx_set_savefile_template(),
+                       //     rxtx_set_top_flows(), rxtx_set_verbose(),
                        //     rxtx_verbose_isset()
+#include "rxtx_control.h" // for rxtx_control, rxtx_control_close(),
+                          //     rxtx_control_open(), rxtx_control_poll()
+#include "rxtx_bursts.h" // for rxtx_bursts_finish(), rxtx_bursts_print(),
+                         //     RXTX_BURSTS_RESOLUTION_MAX
 #include "rxtx_error.h" // for RXTX_ERRBUF_SIZE, RXTX_ERROR
-#include "rxtx_ring.h" // for rxtx_ring, rxtx_ring_get_packets_received(),
-                       //     rxtx_ring_loop()
+#include "rxtx_flows.h" // for rxtx_flows, rxtx_flows_report(),
+                        //     RXTX_FLOWS_MAX
+#include "rxtx_hll.h"   // for rxtx_hll, rxtx_hll_estimate(), rxtx_hll_init(),
+                        //     rxtx_hll_merge()
+#include "rxtx_ring.h" // for rxtx_ring, rxtx_ring_get_bursts(),
+                       //     rxtx_ring_get_flows(),
+                       //     rxtx_ring_get_hll(),
+                       //     rxtx_ring_get_packets_received(),
+                       //     rxtx_ring_get_top_bytes(),
+                       //     rxtx_ring_get_top_packets(),
+                       //     rxtx_ring_get_rollovers(),
+                       //     rxtx_ring_get_rollovers_failed(),
+                       //     rxtx_ring_get_rollovers_huge(),
+                       //     rxtx_ring_loop(),
+                       //     rxtx_ring_update_rollover_stats()
+#include "rxtx_topk.h"  // for rxtx_topk_print(), RXTX_TOPK_MAX
 #include "sig.h"       // for setup_signals()
+#include "softnet.h"   // for get_softnet_stats(), softnet_stat
 
-#include <linux/if_packet.h> // for PACKET_FANOUT_CPU
+#include <linux/if_packet.h> // for PACKET_FANOUT_CPU,
+                             //     PACKET_FANOUT_FLAG_ROLLOVER
 
 #include <ctype.h>    // for isspace()
 #include <errno.h>    // for EBUSY
 #include <getopt.h>   // for getopt_long(), optarg, optind, option, optopt
-#include <inttypes.h> // for strtoumax()
-#include <limits.h>   // for INT_MAX
+#include <inttypes.h> // for PRIu32, strtoumax()
+#include <limits.h>   // for INT_MAX, UINT_MAX
 #include <pcap.h>     // for PCAP_D_IN, PCAP_D_INOUT, PCAP_D_OUT
 #include <pthread.h>  // for pthread_attr_destroy(), pthread_attr_init(),
                       //     pthread_attr_setaffinity_np(), pthread_attr_t,
-                      //     pthread_create(), pthread_t, pthread_tryjoin_np()
-#include <sched.h>    // for CPU_COUNT(), CPU_ISSET(), CPU_SET(), cpu_set_t,
-                      //     CPU_ZERO()
+                      //     pthread_create(), pthread_join(), pthread_t,
+                      //     pthread_tryjoin_np()
 #include <stdbool.h>  // for bool, false, true
-#include <stdint.h>   // for intptr_t
+#include <stdint.h>   // for intmax_t, intptr_t, uint32_t, uintmax_t
 #include <stdio.h>    // for asprintf(), FILE, fprintf(), fputs(), NULL,
-                      //     printf(), putchar(), puts(), stderr, stdout
+                      //     printf(), putchar(), puts(), snprintf(), stderr,
+                      //     stdout
 #include <stdlib.h>   // for malloc()
 #include <string.h>   // for GNU basename(), memset(), strcmp(), strerror(),
-                      //     strlen()
+                      //     strlen(), strncmp()
+#include <time.h>     // for clock_gettime(), CLOCK_MONOTONIC, localtime_r(),
+                      //     strftime(), time(), time_t, timespec, tm
 #include <unistd.h>   // for _SC_NPROCESSORS_CONF, sysconf(), usleep()
 
 #define EXIT_OK          0
 #define EXIT_FAIL        1
 #define EXIT_FAIL_OPTION 2
 
+#define OPTION_BURSTS_BASE 10
 #define OPTION_COUNT_BASE 10
+#define OPTION_FLOW_CHECK_BASE 10
+#define OPTION_TOP_FLOWS_BASE 10
+#define OPTION_SAMPLE_BASE 10
+
+#define HOTPLUG_CHECK_INTERVAL_MS 250
+#define HOTPLUG_TIMESTAMP_SIZE 32
 
 #define USAGE_PRINT_OPT_COL_SEP "# "
 #define USAGE_PRINT_OPT_COL_IND "  "
@@ -85,12 +131,20 @@
 #define UMASK USUBJECT "MASK"
 
 static const struct option long_options[] = {
+  {"bursts",          required_argument, NULL, 'B'},
   {"count",           required_argument, NULL, 'c'},
+  {"control",         required_argument, NULL, 'C'},
   {"direction",       required_argument, NULL, 'd'},
+  {"estimate-flows",  no_argument,       NULL, 'E'},
+  {"flow-check",      required_argument, NULL, 'F'},
   {"help",            no_argument,       NULL, 'h'},
   {HLIST,             required_argument, NULL, 'l'},
   {HMASK,             required_argument, NULL, 'm'},
   {"promiscuous",     no_argument,       NULL, 'p'},
+  {"rollover",        no_argument,       NULL, 'R'},
+  {"sample",          required_argument, NULL, 's'},
+  {"softnet-stat",    no_argument,       NULL, 'S'},
+  {"top-flows",       required_argument, NULL, 'T'},
   {"packet-buffered", no_argument,       NULL, 'U'},
   {"verbose",         no_argument,       NULL, 'v'},
   {"version",         no_argument,       NULL, 'V'},
@@ -105,12 +159,35 @@ struct usage_opt {
 };
 
 static const struct usage_opt usage_options[] = {
+  {'B', "USEC,N",    "Count each " FSUBJECT "'s packets in USEC microsecond"
+                          " windows by kernel timestamp and, on exit, report"
+                          " the busiest window on each " FSUBJECT " and its"
+                       " bursts, runs of consecutive windows with at least N"
+                                                          " packets each."},
   {'c', "N",         "Exit after receiving N packets."},
+  {'C', "PATH",      "Accept commands on a unix socket created at PATH. The"
+                      " commands 'enable " ULIST "' and 'disable " ULIST "'"
+                       " start and stop capturing on " FSUBJECTS " at runtime"
+                     " and 'status' reports per-" HSUBJECT " state and counts"
+                       " (e.g. 'echo disable 0-3 | nc -U PATH'). When set, "
+                       RXTXSELF " keeps running with no " FSUBJECTS " enabled"
+                                           " until interrupted or signaled."},
   {'d', "DIRECTION", "Capture only packets matching DIRECTION. DIRECTION can"
                         " be 'rx', 'tx', or 'rxtx'. Default matches invocation"
                          " (i.e. DIRECTION defaults to 'rx' when invocation is"
                        " '" RXSELF "', 'tx' when '" TXSELF "', and 'rxtx' when"
                                                           " '" RXTXSELF "')."},
+  {'E', NULL,        "Estimate the number of distinct flows on each "
+                         FSUBJECT " and in total, using a fixed size sketch"
+                  " per " FSUBJECT " (accurate to within a few percent). Flows"
+                      " are directional and keyed by protocol, addresses, and"
+                                                                  " ports."},
+  {'F', "N",         "Track up to N flows per " FSUBJECT " and, on exit,"
+                         " report every flow seen on more than one " FSUBJECT
+                       " with its per-" HSUBJECT " packet counts. Flows are"
+                          " directional and keyed by protocol, addresses, and"
+                         " ports. Packets from flows beyond the first N on a "
+                               FSUBJECT " are counted but not checked."},
   {'h', NULL,        "Display this help and exit."},
   {'l', ULIST,       "Capture only on " FSUBJECTS " in " ULIST " (e.g. if "
                         ULIST " is '0,2-4,6', only packets on " FSUBJECTS " 0,"
@@ -119,6 +196,24 @@ static const struct usage_opt usage_options[] = {
                        UMASK " is '5d', only packets on " FSUBJECTS " 0, 2, 3,"
                                                " 4, and 6 will be captured)."},
   {'p', NULL,        "Put the interface into promiscuous mode."},
+  {'R', NULL,        "When a " FSUBJECT "'s socket is full, let the kernel"
+                         " hand the packet to the next " FSUBJECT "'s socket"
+                        " instead of dropping it, and report per-" HSUBJECT
+                      " rollover counts. Rolled over packets are counted on"
+                      " the " FSUBJECT " which captured them, not the one"
+                                                       " they arrived on."},
+  {'s', "N",         "Pass only 1 in N packets, chosen at random, from the"
+                        " kernel to each " FSUBJECT "'s socket, and report"
+                          " per-" HSUBJECT " totals estimated by scaling the"
+                        " captured counts by N. --count applies to sampled"
+                                                               " packets."},
+  {'S', NULL,        "Report how many packets each " FSUBJECT "'s softnet"
+                         " processed, dropped, time squeezed, and received via"
+                         " rps while capturing, per /proc/net/softnet_stat."},
+  {'T', "K",         "Report the top K flows on each " FSUBJECT " by"
+                      " packets and by bytes, using a fixed size summary per "
+                   FSUBJECT ". A flow's total is shown as a range when other"
+                                            " flows may have added to it."},
   {'U', NULL,        "When writing to a pcap file, the write buffer will be"
                            " flushed just after each packet is placed in it."},
   {'v', NULL,        "Display more verbose output."},
@@ -135,7 +230,21 @@ static const struct usage_opt usage_options[] = {
   {0, NULL, NULL}
 };
 
-static char *usage_short_opt_order = "h:c:lm:d:U:p:v:V:w";
+static char *usage_short_opt_order = "h:c:C:lm:d:B:E:F:T:U:p:R:s:S:v:V:w";
+
+struct workers {
+  struct rxtx_desc *rtd;
+  pthread_attr_t   *attr;
+  ring_set_t       *cpu_set;
+  ring_set_t       *captured;
+  ring_set_t       *online;
+  ring_set_t       *parked;
+  pthread_t        *threads;
+  int              *running;
+  int              failed;
+  int              hotplug_events;
+  char             *errbuf;
+};
 
 /* ========================================================================= */
 static void usage_print_opt(int val, const char *name, const char *arg,
@@ -363,6 +472,322 @@ static void usage_short(void) {
   fprintf(stderr, "\n");
 }
 
+/* ========================================================================= */
+static int worker_start(struct workers *w, int i) {
+  struct rxtx_ring *ring = rxtx_get_ring(w->rtd, (unsigned int)i);
+  if (!ring) {
+    return RXTX_ERROR;
+  }
+
+  RING_ZERO(w->cpu_set);
+  if (RING_SET(i, w->cpu_set) == -1) {
+    return RXTX_ERROR;
+  }
+  pthread_attr_setaffinity_np(w->attr, w->cpu_set->size, w->cpu_set->set);
+
+  if (pthread_create(&(w->threads[i]), w->attr, rxtx_ring_loop,
+                                                              (void *)ring)) {
+    return RXTX_ERROR;
+  }
+
+  w->running[i] = 1;
+
+  return 0;
+}
+
+/* ========================================================================= */
+static int worker_join(struct workers *w, int i, bool block) {
+  int status = 0;
+  void *vpstatus = NULL;
+
+  if (block) {
+    status = pthread_join(w->threads[i], &vpstatus);
+  } else {
+    status = pthread_tryjoin_np(w->threads[i], &vpstatus);
+  }
+
+  if (status == EBUSY) {
+    return EBUSY;
+  }
+
+  if (status) {
+    fprintf(stderr, "%s: error joining ring threads: %s\n", program_basename,
+                                                             strerror(status));
+    w->failed = 1;
+    return RXTX_ERROR;
+  }
+
+  w->running[i] = 0;
+
+  if ((intptr_t)vpstatus == (intptr_t)RXTX_ERROR) {
+    w->failed = 1;
+    return RXTX_ERROR;
+  }
+
+  return 0;
+}
+
+/* ========================================================================= */
+static void hotplug_timestamp(char *buf, size_t size) {
+  time_t now = time(NULL);
+  struct tm tm;
+
+  if (!localtime_r(&now, &tm) ||
+                        !strftime(buf, size, "%Y-%m-%d %H:%M:%S", &tm)) {
+    snprintf(buf, size, "%jd", (intmax_t)now);
+  }
+}
+
+/* ========================================================================= */
+static int hotplug_check(struct workers *w) {
+  int i = 0;
+  char when[HOTPLUG_TIMESTAMP_SIZE];
+  struct rxtx_ring *ring;
+
+  ring_set_t now;
+  ring_set_init(&now, 0);
+
+  /*
+   * A failed read is most likely a race with sysfs; we'll try again on the
+   * next check.
+   */
+  if (get_online_cpu_set(&now) != 0) {
+    ring_set_destroy(&now);
+    return 0;
+  }
+
+  for_each_ring(i, w->rtd) {
+    if (RING_ISSET(i, w->online) == RING_ISSET(i, &now)) {
+      continue;
+    }
+
+    /*
+     * Only cpus we're capturing on (or parked and waiting to resume) count as
+     * events for this capture. Going offline, that's one in the ring set;
+     * coming online, one we parked. A cpu which was offline at start (or
+     * disabled over the control socket) stays uncaptured.
+     */
+    if (!RING_ISSET(i, &now) ? !RING_ISSET(i, rxtx_get_ring_set(w->rtd))
+                                                : !RING_ISSET(i, w->parked)) {
+      continue;
+    }
+
+    w->hotplug_events++;
+    hotplug_timestamp(when, sizeof(when));
+
+    ring = rxtx_get_ring(w->rtd, (unsigned int)i);
+    if (!ring) {
+      goto fail;
+    }
+
+    if (!RING_ISSET(i, &now)) {
+      /*
+       * The kernel has already migrated the worker off its cpu. Park it; it
+       * drains what was queued while the cpu was still online.
+       */
+      if (rxtx_disable_ring(w->rtd, i) == RXTX_ERROR ||
+                                              RING_SET(i, w->parked) == -1) {
+        goto fail;
+      }
+
+      fprintf(stderr, "%s: %s " FSUBJECT " '%d' went offline after %ju"
+                           " packets; parking its worker.\n", program_basename,
+                                when, i, rxtx_ring_get_packets_received(ring));
+    } else {
+      if (w->running[i] && worker_join(w, i, true) == RXTX_ERROR) {
+        goto fail;
+      }
+
+      if (rxtx_enable_ring(w->rtd, i) == RXTX_ERROR ||
+                                              worker_start(w, i) == -1) {
+        goto fail;
+      }
+
+      RING_CLR(i, w->parked);
+
+      fprintf(stderr, "%s: %s " FSUBJECT " '%d' came online; resuming"
+                           " capture.\n", program_basename, when, i);
+    }
+  }
+
+  if (ring_set_copy(w->online, &now) == -1) {
+    goto fail;
+  }
+
+  ring_set_destroy(&now);
+  return 0;
+
+fail:
+  w->failed = 1;
+  ring_set_destroy(&now);
+  return RXTX_ERROR;
+}
+
+/* ========================================================================= */
+static void control_enable(struct workers *w, const char *list, FILE *reply) {
+  int i = 0;
+  int count = 0;
+  const char *template = rxtx_get_savefile_template(w->rtd);
+
+  ring_set_t set;
+  ring_set_t online;
+  ring_set_init(&set, 0);
+  ring_set_init(&online, 0);
+
+  if (parse_cpu_list(list, &set)) {
+    fprintf(reply, "error: invalid " FLIST " '%s'\n", list);
+    goto out;
+  }
+
+  if (get_online_cpu_set(&online) != 0) {
+    fprintf(reply, "error: failed to get online " FSUBJECT " set\n");
+    goto out;
+  }
+
+  /*
+   * Validate the whole list before touching any ring so a bad command leaves
+   * the capture as it was.
+   */
+  count = RING_COUNT(rxtx_get_ring_set(w->rtd));
+  for_each_set_ring_in_range(i, &set, 0, RING_SETSIZE(&set) - 1) {
+    if (i >= rxtx_get_ring_count(w->rtd)) {
+      fprintf(reply, "error: " FSUBJECT " '%d' does not exist\n", i);
+      goto out;
+    }
+    if (!RING_ISSET(i, &online)) {
+      fprintf(reply, "error: " FSUBJECT " '%d' is offline\n", i);
+      goto out;
+    }
+    if (!RING_ISSET(i, rxtx_get_ring_set(w->rtd))) {
+      count++;
+    }
+  }
+
+  if (template && strcmp(template, "-") == 0 && count > 1) {
+    fprintf(reply, "error: write file '-' (stdout) is only permitted when"
+                                    " capturing on a single " FSUBJECT "\n");
+    goto out;
+  }
+
+  for_each_set_ring_in_range(i, &set, 0, RING_SETSIZE(&set) - 1) {
+    if (RING_ISSET(i, rxtx_get_ring_set(w->rtd))) {
+      continue;
+    }
+
+    /*
+     * A worker for a recently disabled ring may still be draining.
+     */
+    if (w->running[i] && worker_join(w, i, true) == RXTX_ERROR) {
+      fprintf(reply, "error: %s\n", w->errbuf);
+      goto out;
+    }
+
+    if (rxtx_enable_ring(w->rtd, i) == RXTX_ERROR ||
+                                          RING_SET(i, w->captured) == -1 ||
+                                                worker_start(w, i) == -1) {
+      fprintf(reply, "error: %s\n", w->errbuf);
+      w->failed = 1;
+      goto out;
+    }
+
+    if (rxtx_verbose_isset(w->rtd)) {
+      fprintf(stderr, "Enabled capture on " FSUBJECT " '%d'.\n", i);
+    }
+  }
+
+  fprintf(reply, "ok\n");
+
+out:
+  ring_set_destroy(&online);
+  ring_set_destroy(&set);
+}
+
+/* ========================================================================= */
+static void control_disable(struct workers *w, const char *list,
+                                                                 FILE *reply) {
+  int i = 0;
+
+  ring_set_t set;
+  ring_set_init(&set, 0);
+
+  if (parse_cpu_list(list, &set)) {
+    fprintf(reply, "error: invalid " FLIST " '%s'\n", list);
+    ring_set_destroy(&set);
+    return;
+  }
+
+  for_each_set_ring_in_range(i, &set, 0, RING_SETSIZE(&set) - 1) {
+    if (i >= rxtx_get_ring_count(w->rtd)) {
+      fprintf(reply, "error: " FSUBJECT " '%d' does not exist\n", i);
+      ring_set_destroy(&set);
+      return;
+    }
+  }
+
+  for_each_set_ring_in_range(i, &set, 0, RING_SETSIZE(&set) - 1) {
+    /*
+     * A parked ring is disabled already; forget it so it isn't resumed when
+     * its cpu comes back online.
+     */
+    RING_CLR(i, w->parked);
+
+    if (!RING_ISSET(i, rxtx_get_ring_set(w->rtd))) {
+      continue;
+    }
+
+    if (rxtx_disable_ring(w->rtd, i) == RXTX_ERROR) {
+      fprintf(reply, "error: %s\n", w->errbuf);
+      ring_set_destroy(&set);
+      return;
+    }
+
+    if (rxtx_verbose_isset(w->rtd)) {
+      fprintf(stderr, "Disabled capture on " FSUBJECT " '%d'.\n", i);
+    }
+  }
+
+  fprintf(reply, "ok\n");
+
+  ring_set_destroy(&set);
+}
+
+/* ========================================================================= */
+static void control_status(struct workers *w, FILE *reply) {
+  int i = 0;
+  struct rxtx_ring *ring;
+
+  for_each_ring(i, w->rtd) {
+    ring = rxtx_get_ring(w->rtd, (unsigned int)i);
+    if (!ring) {
+      fprintf(reply, "error: %s\n", w->errbuf);
+      return;
+    }
+
+    fprintf(reply, FSUBJECT "%d %s %ju packets captured\n", i,
+                     RING_ISSET(i, rxtx_get_ring_set(w->rtd)) ? "enabled" :
+                                  RING_ISSET(i, w->parked) ? "parked" :
+                            "disabled", rxtx_ring_get_packets_received(ring));
+  }
+
+  fprintf(reply, "%ju packets captured total\n",
+                                            rxtx_get_packets_received(w->rtd));
+}
+
+/* ========================================================================= */
+static void control_handler(const char *command, FILE *reply, void *arg) {
+  struct workers *w = arg;
+
+  if (strncmp(command, "enable ", strlen("enable ")) == 0) {
+    control_enable(w, command + strlen("enable "), reply);
+  } else if (strncmp(command, "disable ", strlen("disable ")) == 0) {
+    control_disable(w, command + strlen("disable "), reply);
+  } else if (strcmp(command, "status") == 0) {
+    control_status(w, reply);
+  } else {
+    fprintf(reply, "error: unknown command '%s'\n", command);
+  }
+}
+
 /* ========================================================================= */
 int main(int argc, char **argv) {
   program_basename = basename(argv[0]);
@@ -374,11 +799,19 @@ int main(int argc, char **argv) {
   int worker_count = 0;
 
   bool help = false;
+  bool softnet = false;
 
   char *badopt = NULL;
+  char *control_path = NULL;
   char *list = NULL;
   char *mask = NULL;
   char *endptr = NULL;
+  uintmax_t burst_resolution = 0;
+  uintmax_t burst_threshold = 0;
+  uintmax_t flow_check = 0;
+  uintmax_t rollovers = 0;
+  uintmax_t sample_rate = 0;
+  uintmax_t top_flows = 0;
 
   FILE *out = stdout;
 
@@ -428,16 +861,38 @@ int main(int argc, char **argv) {
   }
 
   ring_set_t ring_set;
-  RING_ZERO(&ring_set);
+  ring_set_init(&ring_set, 0);
 
   /*
    * optstring must start with ":" so ':' is returned for a missing option
    * argument. Otherwise '?' is returned for both invalid option and missing
    * option argument.
    */
-  while ((c = getopt_long(argc, argv, ":c:d:hl:m:pUvVw:", long_options, 0))
-                                                                       != -1) {
+  while ((c = getopt_long(argc, argv, ":B:c:C:d:EF:hl:m:pRs:ST:UvVw:",
+                                                long_options, 0)) != -1) {
     switch (c) {
+      case 'B':
+        burst_threshold = 0;
+        burst_resolution = strtoumax(optarg, &endptr, OPTION_BURSTS_BASE);
+        if (*endptr == ',') {
+          burst_threshold = strtoumax(endptr + 1, &endptr,
+                                                          OPTION_BURSTS_BASE);
+        }
+        if (*endptr || burst_resolution == 0 || burst_threshold == 0 ||
+                          burst_resolution > RXTX_BURSTS_RESOLUTION_MAX) {
+          fprintf(stderr, "%s: Invalid bursts '%s'.\n", program_basename,
+                                                                       optarg);
+          usage_short();
+          return EXIT_FAIL_OPTION;
+        }
+        status = rxtx_set_bursts(&rtd, (unsigned int)burst_resolution,
+                                                              burst_threshold);
+        if (status == RXTX_ERROR) {
+          fprintf(stderr, "%s: %s\n", program_basename, errbuf);
+          return EXIT_FAIL;
+        }
+        break;
+
       case 'c':
         status = rxtx_set_packet_count(&rtd, strtoumax(optarg, &endptr,
                                                            OPTION_COUNT_BASE));
@@ -453,6 +908,10 @@ int main(int argc, char **argv) {
         }
         break;
 
+      case 'C':
+        control_path = optarg;
+        break;
+
       case 'd':
         if (strcmp(optarg, "rx") == 0) {
           status = rxtx_set_direction(&rtd, PCAP_D_IN);
@@ -472,6 +931,29 @@ int main(int argc, char **argv) {
         }
         break;
 
+      case 'E':
+        status = rxtx_set_flow_estimate(&rtd);
+        if (status == RXTX_ERROR) {
+          fprintf(stderr, "%s: %s\n", program_basename, errbuf);
+          return EXIT_FAIL;
+        }
+        break;
+
+      case 'F':
+        flow_check = strtoumax(optarg, &endptr, OPTION_FLOW_CHECK_BASE);
+        if (*endptr || flow_check == 0 || flow_check > RXTX_FLOWS_MAX) {
+          fprintf(stderr, "%s: Invalid flow count '%s'.\n", program_basename,
+                                                                       optarg);
+          usage_short();
+          return EXIT_FAIL_OPTION;
+        }
+        status = rxtx_set_flow_check(&rtd, (size_t)flow_check);
+        if (status == RXTX_ERROR) {
+          fprintf(stderr, "%s: %s\n", program_basename, errbuf);
+          return EXIT_FAIL;
+        }
+        break;
+
       case 'h':
         help = true;
         break;
@@ -504,6 +986,49 @@ int main(int argc, char **argv) {
         }
         break;
 
+      case 'R':
+        status = rxtx_set_fanout_flags(&rtd, rxtx_get_fanout_flags(&rtd)
+                                               | PACKET_FANOUT_FLAG_ROLLOVER);
+        if (status == RXTX_ERROR) {
+          fprintf(stderr, "%s: %s\n", program_basename, errbuf);
+          return EXIT_FAIL;
+        }
+        break;
+
+      case 's':
+        sample_rate = strtoumax(optarg, &endptr, OPTION_SAMPLE_BASE);
+        if (*endptr || sample_rate == 0 || sample_rate > UINT_MAX) {
+          fprintf(stderr, "%s: Invalid sample rate '%s'.\n", program_basename,
+                                                                       optarg);
+          usage_short();
+          return EXIT_FAIL_OPTION;
+        }
+        status = rxtx_set_sample_rate(&rtd, (unsigned int)sample_rate);
+        if (status == RXTX_ERROR) {
+          fprintf(stderr, "%s: %s\n", program_basename, errbuf);
+          return EXIT_FAIL;
+        }
+        break;
+
+      case 'S':
+        softnet = true;
+        break;
+
+      case 'T':
+        top_flows = strtoumax(optarg, &endptr, OPTION_TOP_FLOWS_BASE);
+        if (*endptr || top_flows == 0 || top_flows > RXTX_TOPK_MAX) {
+          fprintf(stderr, "%s: Invalid top flow count '%s'.\n",
+                                                     program_basename, optarg);
+          usage_short();
+          return EXIT_FAIL_OPTION;
+        }
+        status = rxtx_set_top_flows(&rtd, (size_t)top_flows);
+        if (status == RXTX_ERROR) {
+          fprintf(stderr, "%s: %s\n", program_basename, errbuf);
+          return EXIT_FAIL;
+        }
+        break;
+
       case 'U':
         status = rxtx_set_packet_buffered(&rtd);
         if (status == RXTX_ERROR) {
@@ -652,16 +1177,17 @@ int main(int argc, char **argv) {
     return EXIT_FAIL_OPTION;
   }
 
-  cpu_set_t online;
+  ring_set_t online;
+  ring_set_init(&online, 0);
   if (get_online_cpu_set(&online) != 0) {
     fprintf(stderr, "%s: Failed to get online " FSUBJECT " set.\n",
                                                              program_basename);
     return EXIT_FAIL_OPTION;
   }
 
-  if (CPU_COUNT(&online) != rxtx_get_ring_count(&rtd)) {
+  if (RING_COUNT(&online) != rxtx_get_ring_count(&rtd)) {
     for_each_ring(i, &rtd) {
-      if (!CPU_ISSET(i, &online)) {
+      if (!RING_ISSET(i, &online)) {
         RING_CLR(i, &ring_set);
         if (rxtx_verbose_isset(&rtd)) {
           fprintf(stderr, "Skipping " FSUBJECT " '%d' since it is offline.\n",
@@ -705,6 +1231,17 @@ int main(int argc, char **argv) {
     return EXIT_FAIL;
   }
 
+  /*
+   * softnet_stat counts from boot, so we keep a snapshot from before any
+   * worker starts and report the difference on exit.
+   */
+  struct softnet_stat softnet_start[rxtx_get_ring_count(&rtd)];
+  if (softnet &&
+         get_softnet_stats(softnet_start, rxtx_get_ring_count(&rtd)) != 0) {
+    fprintf(stderr, "%s: Failed to read softnet stats.\n", program_basename);
+    return EXIT_FAIL;
+  }
+
   /*
    * Setup our signal handlers before spinning up threads.
    */
@@ -715,71 +1252,129 @@ int main(int argc, char **argv) {
    * processor and is passed the ring containing the socket fd which will
    * receive packets for that processor.
    */
-  cpu_set_t cpu_set;
+  ring_set_t cpu_set;
+  ring_set_t captured;
+  ring_set_t parked;
   pthread_t threads[rxtx_get_ring_count(&rtd)];
+  int running[rxtx_get_ring_count(&rtd)];
   pthread_attr_t attr;
   pthread_attr_init(&attr);
 
+  memset(running, 0, sizeof(int) * rxtx_get_ring_count(&rtd));
+
+  if (ring_set_init(&cpu_set, rxtx_get_ring_count(&rtd)) == -1 ||
+                                      ring_set_init(&captured, 0) == -1 ||
+                                        ring_set_init(&parked, 0) == -1 ||
+                  ring_set_copy(&captured, rxtx_get_ring_set(&rtd)) == -1) {
+    fprintf(stderr, "%s: Failed to allocate " FSUBJECT " set.\n",
+                                                             program_basename);
+    return EXIT_FAIL;
+  }
+
+  struct workers workers = {
+    .rtd      = &rtd,
+    .attr     = &attr,
+    .cpu_set  = &cpu_set,
+    .captured = &captured,
+    .online   = &online,
+    .parked   = &parked,
+    .threads  = threads,
+    .running  = running,
+    .failed   = 0,
+    .hotplug_events = 0,
+    .errbuf   = errbuf,
+  };
+
   for_each_set_ring(i, &rtd) {
-    CPU_ZERO(&cpu_set);
-    CPU_SET(i, &cpu_set);
-    pthread_attr_setaffinity_np(&attr, sizeof(cpu_set), &cpu_set);
+    if (worker_start(&workers, i) == RXTX_ERROR) {
+      fprintf(stderr, "%s: %s\n", program_basename, errbuf);
+      return EXIT_FAIL;
+    }
+  }
 
-    ring = rxtx_get_ring(&rtd, (unsigned int)i);
-    if (!ring) {
+  /*
+   * The control socket is only opened once the initial workers are running,
+   * so every command sees a fully started capture.
+   */
+  struct rxtx_control control;
+  if (control_path) {
+    status = rxtx_control_open(&control, control_path, errbuf);
+    if (status == RXTX_ERROR) {
       fprintf(stderr, "%s: %s\n", program_basename, errbuf);
       return EXIT_FAIL;
     }
-    pthread_create(&threads[i], &attr, rxtx_ring_loop, (void *)ring);
   }
 
   /*
-   * This loop joins our threads.
+   * This loop joins our threads and, when we have a control socket, handles
+   * commands which may stop and start threads along the way. It also watches
+   * for cpu hotplug, parking workers whose cpu goes offline and resuming them
+   * when it comes back. Without a control socket we're done once every
+   * thread is joined and nothing is parked; with one we keep going until
+   * we're interrupted or the packet count is reached.
    */
   int ebusy = 0;
 
-  void *vpstatus = NULL;
-
-  int joined[rxtx_get_ring_count(&rtd)];
-  memset(joined, 0, sizeof(int) * rxtx_get_ring_count(&rtd));
+  struct timespec last_hotplug_check;
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &last_hotplug_check);
 
   while (1) {
-    ebusy = 0;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if ((now.tv_sec - last_hotplug_check.tv_sec) * 1000 +
+            (now.tv_nsec - last_hotplug_check.tv_nsec) / 1000000 >=
+                                                  HOTPLUG_CHECK_INTERVAL_MS) {
+      hotplug_check(&workers);
+      last_hotplug_check = now;
+    }
 
-    for_each_set_ring(i, &rtd) {
-      if (!joined[i]) {
-        status = pthread_tryjoin_np(threads[i], &vpstatus);
+    if (control_path) {
+      status = rxtx_control_poll(&control, control_handler, &workers);
+      if (status == RXTX_ERROR) {
+        fprintf(stderr, "%s: %s\n", program_basename, errbuf);
+        rxtx_control_close(&control);
+        return EXIT_FAIL;
+      }
+    }
 
-        if (status == EBUSY) {
-          ebusy++;
-          continue;
-        }
+    ebusy = 0;
 
-        if (status) {
-          fprintf(stderr, "%s: error joining ring threads: %s\n",
-                                           program_basename, strerror(status));
-          return EXIT_FAIL;
-        }
+    for_each_ring(i, &rtd) {
+      if (running[i] && worker_join(&workers, i, false) == EBUSY) {
+        ebusy++;
+      }
+    }
 
-        joined[i] = 1;
-        if ((intptr_t)vpstatus == (intptr_t)RXTX_ERROR) {
-          fprintf(stderr, "%s: %s\n", program_basename, errbuf);
-          return EXIT_FAIL;
-        }
+    if (workers.failed) {
+      fprintf(stderr, "%s: %s\n", program_basename, errbuf);
+      if (control_path) {
+        rxtx_control_close(&control);
       }
+      return EXIT_FAIL;
     }
 
-    if (ebusy) {
-      usleep(10);
-    } else {
+    if (!ebusy && (rxtx_breakloop_isset(&rtd) ||
+                                           rxtx_packet_count_reached(&rtd) ||
+                              (!control_path && !RING_COUNT(&parked)))) {
       break;
     }
+
+    usleep(10);
+  }
+
+  if (control_path) {
+    status = rxtx_control_close(&control);
+    if (status == RXTX_ERROR) {
+      fprintf(stderr, "%s: %s\n", program_basename, errbuf);
+      return EXIT_FAIL;
+    }
   }
 
   pthread_attr_destroy(&attr);
 
   /*
-   * This loop prints our per-ring results.
+   * This loop prints our per-ring results for every ring we captured on at
+   * some point, including rings which were later disabled.
    */
   out = stdout;
   if (rxtx_get_savefile_template(&rtd) &&
@@ -787,7 +1382,11 @@ int main(int argc, char **argv) {
     out = stderr;
   }
 
-  for_each_set_ring(i, &rtd) {
+  for_each_ring(i, &rtd) {
+    if (!RING_ISSET(i, &captured)) {
+      continue;
+    }
+
     ring = rxtx_get_ring(&rtd, (unsigned int)i);
     if (!ring) {
       fprintf(stderr, "%s: %s\n", program_basename, errbuf);
@@ -801,11 +1400,257 @@ int main(int argc, char **argv) {
   fprintf(out, "%ju packets captured total.\n",
                                               rxtx_get_packets_received(&rtd));
 
+  /*
+   * A cpu which was offline at either snapshot has no meaningful difference,
+   * so it's called out and left out of the total.
+   */
+  if (softnet) {
+    struct softnet_stat softnet_end[rxtx_get_ring_count(&rtd)];
+    struct softnet_stat delta;
+    uintmax_t processed = 0;
+    uintmax_t dropped = 0;
+    uintmax_t time_squeeze = 0;
+    uintmax_t received_rps = 0;
+
+    if (get_softnet_stats(softnet_end, rxtx_get_ring_count(&rtd)) != 0) {
+      fprintf(stderr, "%s: Failed to read softnet stats.\n",
+                                                             program_basename);
+      return EXIT_FAIL;
+    }
+
+    for_each_ring(i, &rtd) {
+      if (!RING_ISSET(i, &captured)) {
+        continue;
+      }
+
+      if (!softnet_start[i].present || !softnet_end[i].present) {
+        fprintf(out, "softnet stats unavailable for " FSUBJECT "%d.\n", i);
+        continue;
+      }
+
+      delta.processed = softnet_end[i].processed - softnet_start[i].processed;
+      delta.dropped = softnet_end[i].dropped - softnet_start[i].dropped;
+      delta.time_squeeze = softnet_end[i].time_squeeze
+                                               - softnet_start[i].time_squeeze;
+      delta.received_rps = softnet_end[i].received_rps
+                                               - softnet_start[i].received_rps;
+
+      fprintf(out, "%" PRIu32 " packets processed, %" PRIu32 " dropped, %"
+                       PRIu32 " time squeezes, %" PRIu32 " rps received by"
+                                              " softnet on " FSUBJECT "%d.\n",
+                                  delta.processed, delta.dropped,
+                                  delta.time_squeeze, delta.received_rps, i);
+
+      processed += delta.processed;
+      dropped += delta.dropped;
+      time_squeeze += delta.time_squeeze;
+      received_rps += delta.received_rps;
+    }
+
+    fprintf(out, "%ju packets processed, %ju dropped, %ju time squeezes, %ju"
+                          " rps received by softnet total.\n", processed,
+                                         dropped, time_squeeze, received_rps);
+  }
+
+  /*
+   * Each ring's sample is independent, so scaling its count by the rate is an
+   * unbiased estimate of what arrived on it.
+   */
+  if (rxtx_get_sample_rate(&rtd) > 1) {
+    fprintf(out, "1 in %u packets sampled.\n", rxtx_get_sample_rate(&rtd));
+
+    for_each_ring(i, &rtd) {
+      if (!RING_ISSET(i, &captured)) {
+        continue;
+      }
+
+      ring = rxtx_get_ring(&rtd, (unsigned int)i);
+      if (!ring) {
+        fprintf(stderr, "%s: %s\n", program_basename, errbuf);
+        return EXIT_FAIL;
+      }
+
+      fprintf(out, "%ju packets estimated on " FSUBJECT "%d.\n",
+                                       rxtx_ring_get_packets_received(ring)
+                                              * rxtx_get_sample_rate(&rtd), i);
+    }
+
+    fprintf(out, "%ju packets estimated total.\n",
+                 rxtx_get_packets_received(&rtd) * rxtx_get_sample_rate(&rtd));
+  }
+
+  /*
+   * The kernel charges a rollover to the socket it was originally steered to,
+   * so these counts say which ring was overwhelmed, not which one absorbed
+   * the excess.
+   */
+  if (rxtx_get_fanout_flags(&rtd) & PACKET_FANOUT_FLAG_ROLLOVER) {
+    rollovers = 0;
+
+    for_each_ring(i, &rtd) {
+      if (!RING_ISSET(i, &captured)) {
+        continue;
+      }
+
+      ring = rxtx_get_ring(&rtd, (unsigned int)i);
+      if (!ring) {
+        fprintf(stderr, "%s: %s\n", program_basename, errbuf);
+        return EXIT_FAIL;
+      }
+
+      status = rxtx_ring_update_rollover_stats(ring);
+      if (status == RXTX_ERROR) {
+        fprintf(stderr, "%s: %s\n", program_basename, errbuf);
+        return EXIT_FAIL;
+      }
+
+      fprintf(out, "%ju packets rolled over from " FSUBJECT "%d (%ju huge"
+                       " flow, %ju failed).\n", rxtx_ring_get_rollovers(ring),
+                                       i, rxtx_ring_get_rollovers_huge(ring),
+                                        rxtx_ring_get_rollovers_failed(ring));
+      rollovers += rxtx_ring_get_rollovers(ring);
+    }
+
+    fprintf(out, "%ju packets rolled over total.\n", rollovers);
+  }
+
+  /*
+   * Merging sketches takes the max of each register, so a flow seen on more
+   * than one ring is still only counted once in the total.
+   */
+  if (rxtx_flow_estimate_isset(&rtd)) {
+    struct rxtx_hll total;
+    rxtx_hll_init(&total);
+
+    for_each_ring(i, &rtd) {
+      if (!RING_ISSET(i, &captured)) {
+        continue;
+      }
+
+      ring = rxtx_get_ring(&rtd, (unsigned int)i);
+      if (!ring) {
+        fprintf(stderr, "%s: %s\n", program_basename, errbuf);
+        return EXIT_FAIL;
+      }
+
+      fprintf(out, "%ju flows estimated on " FSUBJECT "%d.\n",
+                                rxtx_hll_estimate(rxtx_ring_get_hll(ring)), i);
+      rxtx_hll_merge(&total, rxtx_ring_get_hll(ring));
+    }
+
+    fprintf(out, "%ju flows estimated total.\n", rxtx_hll_estimate(&total));
+  }
+
+  /*
+   * The summaries are only exact for flows which never had to share a
+   * counter; rxtx_topk_print() shows a range for the rest.
+   */
+  if (rxtx_get_top_flows(&rtd)) {
+    for_each_ring(i, &rtd) {
+      if (!RING_ISSET(i, &captured)) {
+        continue;
+      }
+
+      ring = rxtx_get_ring(&rtd, (unsigned int)i);
+      if (!ring) {
+        fprintf(stderr, "%s: %s\n", program_basename, errbuf);
+        return EXIT_FAIL;
+      }
+
+      fprintf(out, "Top flows by packets on " FSUBJECT "%d:\n", i);
+      status = rxtx_topk_print(rxtx_ring_get_top_packets(ring),
+                                              rxtx_get_top_flows(&rtd), out);
+      if (status == RXTX_ERROR) {
+        fprintf(stderr, "%s: %s\n", program_basename, errbuf);
+        return EXIT_FAIL;
+      }
+
+      fprintf(out, "Top flows by bytes on " FSUBJECT "%d:\n", i);
+      status = rxtx_topk_print(rxtx_ring_get_top_bytes(ring),
+                                              rxtx_get_top_flows(&rtd), out);
+      if (status == RXTX_ERROR) {
+        fprintf(stderr, "%s: %s\n", program_basename, errbuf);
+        return EXIT_FAIL;
+      }
+    }
+  }
+
+  /*
+   * A burst still going when capture stopped ends with the last window we
+   * saw, so finish each ring's windows before printing them.
+   */
+  if (rxtx_get_burst_resolution(&rtd)) {
+    for_each_ring(i, &rtd) {
+      if (!RING_ISSET(i, &captured)) {
+        continue;
+      }
+
+      ring = rxtx_get_ring(&rtd, (unsigned int)i);
+      if (!ring) {
+        fprintf(stderr, "%s: %s\n", program_basename, errbuf);
+        return EXIT_FAIL;
+      }
+
+      rxtx_bursts_finish(rxtx_ring_get_bursts(ring));
+      fprintf(out, "Bursts on " FSUBJECT "%d:\n", i);
+      rxtx_bursts_print(rxtx_ring_get_bursts(ring), out);
+    }
+  }
+
+  /*
+   * Every worker has been joined, so the flow tables are ours to read.
+   */
+  if (rxtx_get_flow_check(&rtd)) {
+    struct rxtx_flows *flows[rxtx_get_ring_count(&rtd)];
+
+    for_each_ring(i, &rtd) {
+      flows[i] = NULL;
+    }
+
+    for_each_ring(i, &rtd) {
+      if (!RING_ISSET(i, &captured)) {
+        continue;
+      }
+
+      ring = rxtx_get_ring(&rtd, (unsigned int)i);
+      if (!ring) {
+        fprintf(stderr, "%s: %s\n", program_basename, errbuf);
+        return EXIT_FAIL;
+      }
+
+      flows[i] = rxtx_ring_get_flows(ring);
+    }
+
+    status = rxtx_flows_report(flows, rxtx_get_ring_count(&rtd), FSUBJECT,
+                                                                 out, errbuf);
+    if (status == RXTX_ERROR) {
+      fprintf(stderr, "%s: %s\n", program_basename, errbuf);
+      return EXIT_FAIL;
+    }
+  }
+
+  /*
+   * Per-cpu counts only cover the time each cpu was online; say so on stderr
+   * so the report above stays machine readable.
+   */
+  if (workers.hotplug_events) {
+    fprintf(stderr, "%s: %d " FSUBJECT " hotplug event%s during capture;"
+                " per-" HSUBJECT " counts cover only time spent online.\n",
+                                     program_basename, workers.hotplug_events,
+                                     workers.hotplug_events == 1 ? "" : "s");
+  }
+
   status = rxtx_close(&rtd);
   if (status == RXTX_ERROR) {
     fprintf(stderr, "%s: %s\n", program_basename, errbuf);
     return EXIT_FAIL;
   }
 
+  ring_set_destroy(&captured);
+  ring_set_destroy(&cpu_set);
+  ring_set_destroy(&parked);
+  ring_set_destroy(&online);
+  ring_set_destroy(&ring_set);
+
   return EXIT_OK;
 }
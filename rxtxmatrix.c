@@ -0,0 +1,1009 @@
+/*
+ * Copyright (c) 2018-present StackPath, LLC
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#define _GNU_SOURCE // for GNU basename()
+
+#define PCAP_DONT_INCLUDE_PCAP_BPF_H 1
+
+#include "cpu.h"       // for get_online_cpu_set(), parse_cpu_list(),
+                       //     parse_cpu_mask()
+#include "ebpf.h"      // for EBPF_LOG_BUF_SIZE, ebpf_prog_load()
+#include "ring_set.h"  // for for_each_ring_in_size(), RING_CLR(),
+                       //     RING_COUNT(), RING_ISSET(), RING_SET(),
+                       //     ring_set_destroy(), ring_set_init(), ring_set_t
+#include "rxtx.h"      // for for_each_ring(), for_each_set_ring(),
+                       //     program_basename, rxtx_activate(), rxtx_close(),
+                       //     rxtx_desc, rxtx_get_packets_received(),
+                       //     rxtx_get_ring(), rxtx_get_ring_count(),
+                       //     rxtx_get_savefile_template(), rxtx_init(),
+                       //     rxtx_set_direction(), rxtx_set_fanout_data_fd(),
+                       //     rxtx_set_fanout_mode(),
+                       //     rxtx_set_ifname(), rxtx_set_packet_buffered(),
+                       //     rxtx_set_promiscuous(), rxtx_set_ring_count(),
+                       //     rxtx_set_ring_set(), rxtx_set_savefile_columns(),
+                       //     rxtx_set_savefile_template(), rxtx_set_verbose(),
+                       //     rxtx_verbose_isset()
+#include "rxtx_error.h" // for RXTX_ERRBUF_SIZE, RXTX_ERROR
+#include "rxtx_ring.h" // for rxtx_ring, rxtx_ring_get_packets_received(),
+                       //     rxtx_ring_loop()
+#include "sig.h"       // for setup_signals()
+
+#include <linux/bpf.h>       // for __sk_buff, bpf_insn,
+                             //     BPF_FUNC_get_smp_processor_id
+#include <linux/if_packet.h> // for PACKET_FANOUT_EBPF, PACKET_OUTGOING
+
+#include <ctype.h>    // for isspace()
+#include <dirent.h>   // for closedir(), DIR, dirent, opendir(), readdir()
+#include <errno.h>    // for EBUSY
+#include <getopt.h>   // for getopt_long(), optarg, optind, option, optopt
+#include <inttypes.h> // for strtoumax()
+#include <limits.h>   // for INT_MAX
+#include <pcap.h>     // for PCAP_D_IN, PCAP_D_INOUT, PCAP_D_OUT
+#include <pthread.h>  // for pthread_attr_destroy(), pthread_attr_init(),
+                      //     pthread_attr_setaffinity_np(), pthread_attr_t,
+                      //     pthread_create(), pthread_t, pthread_tryjoin_np()
+#include <stddef.h>   // for offsetof()
+#include <stdbool.h>  // for bool, false, true
+#include <stdint.h>   // for intptr_t, uintmax_t
+#include <stdio.h>    // for asprintf(), FILE, fprintf(), fputc(), fputs(),
+                      //     NULL, printf(), putchar(), puts(), snprintf(),
+                      //     stderr, stdout
+#include <stdlib.h>   // for calloc(), free(), malloc()
+#include <string.h>   // for GNU basename(), memset(), strcmp(), strerror(),
+                      //     strlen()
+#include <unistd.h>   // for close(), _SC_NPROCESSORS_CONF, sysconf(),
+                      //     usleep()
+
+#define EXIT_OK          0
+#define EXIT_FAIL        1
+#define EXIT_FAIL_OPTION 2
+
+#define OPTION_COUNT_BASE 10
+
+/*
+ * PACKET_FANOUT_MAX was 256 before linux v5.10 and is 65536 since; every
+ * cell of the matrix is a ring in the fanout group.
+ */
+#define PACKET_FANOUT_RING_MAX 65536
+
+#define USAGE_PRINT_OPT_COL_SEP "# "
+#define USAGE_PRINT_OPT_COL_IND "  "
+
+#define USAGE_PRINT_OPT_COL_SEP_LEN (strlen(USAGE_PRINT_OPT_COL_SEP))
+#define USAGE_PRINT_OPT_COL_IND_LEN (strlen(USAGE_PRINT_OPT_COL_IND))
+
+#define USAGE_PRINT_OPT_TOTAL_LEN     79
+#define USAGE_PRINT_OPT_FIRST_COL_LEN 31
+#define USAGE_PRINT_OPT_SECOND_COL_LEN (USAGE_PRINT_OPT_TOTAL_LEN \
+                 - USAGE_PRINT_OPT_FIRST_COL_LEN - USAGE_PRINT_OPT_COL_SEP_LEN)
+#define USAGE_PRINT_OPT_IND_SECOND_COL_LEN (USAGE_PRINT_OPT_SECOND_COL_LEN \
+                                                 - USAGE_PRINT_OPT_COL_IND_LEN)
+
+#define SUBJECT "matrix"
+#define CSUBJECT "cpu"
+#define UCSUBJECT "CPU"
+#define QSUBJECT "queue"
+#define RXTXSELF "rxtx" SUBJECT
+#define RXSELF "rx" SUBJECT
+#define TXSELF "tx" SUBJECT
+#define FSUBJECT CSUBJECT
+#define HSUBJECT CSUBJECT
+#define FSUBJECTS FSUBJECT "s"
+#define FLIST CSUBJECT " list"
+#define HLIST CSUBJECT "-list"
+#define ULIST UCSUBJECT "LIST"
+#define FMASK CSUBJECT " mask"
+#define HMASK CSUBJECT "-mask"
+#define UMASK UCSUBJECT "MASK"
+
+static const struct option long_options[] = {
+  {"count",           required_argument, NULL, 'c'},
+  {"direction",       required_argument, NULL, 'd'},
+  {"help",            no_argument,       NULL, 'h'},
+  {HLIST,             required_argument, NULL, 'l'},
+  {HMASK,             required_argument, NULL, 'm'},
+  {"promiscuous",     no_argument,       NULL, 'p'},
+  {"packet-buffered", no_argument,       NULL, 'U'},
+  {"verbose",         no_argument,       NULL, 'v'},
+  {"version",         no_argument,       NULL, 'V'},
+  {"write",           required_argument, NULL, 'w'},
+  {0, 0, NULL, 0}
+};
+
+struct usage_opt {
+  int        val;
+  const char *arg;
+  char *description;
+};
+
+static const struct usage_opt usage_options[] = {
+  {'c', "N",         "Exit after receiving N packets."},
+  {'d', "DIRECTION", "Capture only packets matching DIRECTION. DIRECTION can"
+                        " be 'rx', 'tx', or 'rxtx'. Default matches invocation"
+                         " (i.e. DIRECTION defaults to 'rx' when invocation is"
+                       " '" RXSELF "', 'tx' when '" TXSELF "', and 'rxtx' when"
+                                                          " '" RXTXSELF "')."},
+  {'h', NULL,        "Display this help and exit."},
+  {'l', ULIST,       "Capture only on " FSUBJECTS " in " ULIST " (e.g. if "
+                        ULIST " is '0,2-4,6', only packets on " FSUBJECTS " 0,"
+                                         " 2, 3, 4, and 6 will be captured)."},
+  {'m', UMASK,       "Capture only on " FSUBJECTS " in " UMASK " (e.g. if "
+                       UMASK " is '5d', only packets on " FSUBJECTS " 0, 2, 3,"
+                                               " 4, and 6 will be captured)."},
+  {'p', NULL,        "Put the interface into promiscuous mode."},
+  {'U', NULL,        "When writing to a pcap file, the write buffer will be"
+                           " flushed just after each packet is placed in it."},
+  {'v', NULL,        "Display more verbose output."},
+  {'V', NULL,        "Display the version and exit."},
+  {'w', "FILE",      "Write packets to FILE in pcap format. FILE is used as a"
+                        " template for per-cell filenames (e.g. with FILE set"
+                     " to 'out.pcap', packets received on " CSUBJECT " 2 from"
+                      " " QSUBJECT " 5 will be written to 'out-2-5.pcap')."
+                          " Writing to stdout is supported by setting FILE to"
+                             " '-', but only when the matrix has a single"
+                                                                   " cell."},
+  {0, NULL, NULL}
+};
+
+static char *usage_short_opt_order = "h:c:lm:d:U:p:v:V:w";
+
+/* ========================================================================= */
+static void usage_print_opt(int val, const char *name, const char *arg,
+                                                           char *description) {
+  int consumed = 0;
+  int padding = 0;
+  int remaining = 0;
+
+  char *start = NULL;
+  char *end = NULL;
+
+  consumed = printf("  -%c, [--%s%s%s]  ", val, name, arg ? "=" : "",
+                                                               arg ? arg : "");
+
+  if (consumed < 0) {
+    /* no point in continuing */
+    return;
+  }
+
+  padding = USAGE_PRINT_OPT_FIRST_COL_LEN - consumed;
+
+  if (padding < 0) {
+    padding = 0;
+  }
+
+  printf("%*s%s", padding, "", USAGE_PRINT_OPT_COL_SEP);
+
+  start = description;
+
+  remaining = USAGE_PRINT_OPT_SECOND_COL_LEN;
+
+  while(1) {
+    while(isspace(*start)) {
+      start++;
+    }
+
+    int len = strlen(start);
+
+    if (len < remaining) {
+      printf("%s\n", start);
+      break;
+    }
+
+    end = start + remaining;
+
+    while(!isspace(*end) && end > start) {
+      end--;
+    }
+
+    if (start == end) {
+      /* no whitespace found in second column width, bail */
+      printf("%s\n", start);
+      break;
+    }
+
+    while(start < end) {
+      putchar(*start);
+      start++;
+    }
+
+    printf("\n%*s%s%s", USAGE_PRINT_OPT_FIRST_COL_LEN, "",
+                             USAGE_PRINT_OPT_COL_SEP, USAGE_PRINT_OPT_COL_IND);
+
+    remaining = USAGE_PRINT_OPT_IND_SECOND_COL_LEN;
+  }
+}
+
+/* ========================================================================= */
+static const char *usage_opt_get_arg(int val) {
+  int i = 0;
+  int v = 0;
+
+  for (i = 0; i < INT_MAX; i++) {
+    v = usage_options[i].val;
+
+    if (!v) {
+      return NULL;
+    }
+
+    if (v == val) {
+      return usage_options[i].arg;
+    }
+  }
+
+  return NULL;
+}
+
+/* ========================================================================= */
+static const char * usage_opt_get_name(int val) {
+  int i = 0;
+  int v = 0;
+
+  for (i = 0; i < INT_MAX; i++) {
+    v = long_options[i].val;
+
+    if (!v) {
+      return NULL;
+    }
+
+    if (v == val) {
+      return long_options[i].name;
+    }
+  }
+
+  return NULL;
+}
+
+/* ========================================================================= */
+static void usage(void) {
+  int i = 0;
+  int val = 0;
+  const char *name;
+
+  puts("Usage:");
+  printf("  %s [OPTIONS] [INTERFACE]\n\n", program_basename);
+
+  puts("Options:");
+
+  for (i = 0; i < INT_MAX; i++) {
+    val = usage_options[i].val;
+
+    if (!val) {
+      break;
+    }
+
+    name = usage_opt_get_name(val);
+
+    if (name) {
+      usage_print_opt(val, name, usage_options[i].arg,
+                                                 usage_options[i].description);
+    }
+  }
+}
+
+/* ========================================================================= */
+static void usage_short(void) {
+  int i = 0;
+  int indent = 0;
+  int lookahead = 0;
+  int projected = 0;
+  int remaining = 0;
+  int val = 0;
+
+  char *p = NULL;
+
+  const char *arg;
+  const char *name;
+
+  indent = fprintf(stderr, "Usage: %s", program_basename);
+
+  if (indent < 0) {
+    /* no point in continuing */
+    return;
+  }
+
+  remaining = USAGE_PRINT_OPT_TOTAL_LEN - indent;
+
+  p = usage_short_opt_order;
+
+  while (*p) {
+    lookahead = 0;
+    projected = 0;
+
+    while (p[lookahead] && p[lookahead] != ':') {
+      val = p[lookahead];
+
+      name = usage_opt_get_name(val);
+      arg = usage_opt_get_arg(val);
+
+      if (name) {
+        if (!lookahead) {
+          projected += 4; // ' [--'
+        } else {
+          projected += 3; // '|--'
+        }
+
+        projected += strlen(name);
+
+        if (arg) {
+          projected += 1; // '='
+          projected += strlen(arg);
+        }
+      }
+
+      lookahead++;
+    }
+
+    projected += 1; // ']'
+
+    if (projected > remaining) {
+      fprintf(stderr, "\n%*s", indent, "");
+      remaining = USAGE_PRINT_OPT_TOTAL_LEN - indent;
+    }
+
+    for (i = 0; i < lookahead; i++) {
+      val = p[i];
+
+      name = usage_opt_get_name(val);
+      arg = usage_opt_get_arg(val);
+
+      if (name) {
+        if (!i) {
+          remaining -= fprintf(stderr, " [--");
+        } else {
+          remaining -= fprintf(stderr, "|--");
+        }
+
+        remaining -= fprintf(stderr, "%s", name);
+
+        if (arg) {
+          remaining -= fprintf(stderr, "=%s", arg);
+        }
+      }
+    }
+
+    p += lookahead;
+
+    remaining -= fprintf(stderr, "]");
+
+    if (*p == ':') {
+      p++;
+    }
+  }
+
+  fprintf(stderr, "\n");
+}
+
+/* ========================================================================= */
+static int sysfs_count(const char *path, const char *prefix) {
+  int greatest = -1;
+
+  DIR *d = opendir(path);
+  if (!d) {
+    return -1;
+  }
+
+  struct dirent *dir = NULL;
+  while ((dir = readdir(d)) != NULL) {
+    char *endptr = NULL;
+
+    char *p = dir->d_name;
+    if (!p) {
+      continue;
+    }
+
+    if (strncmp(p, prefix, strlen(prefix))) {
+      continue;
+    }
+    p += strlen(prefix);
+
+    int current = strtol(p, &endptr, 10);
+    if (*endptr) {
+      continue;
+    }
+
+    if (greatest < current) {
+      greatest = current;
+    }
+  }
+
+  closedir(d);
+
+  return greatest + 1;
+}
+
+/* ========================================================================= */
+int num_queues(const char *ifname, pcap_direction_t direction) {
+  int status = 0;
+  char *path = NULL;
+
+  status = asprintf(&path, "/sys/class/net/%s/queues/", ifname);
+  if (status == -1) {
+    return -1;
+  }
+
+  int rx = 0;
+  int tx = 0;
+  if (direction == PCAP_D_INOUT || direction == PCAP_D_IN) {
+    rx = sysfs_count(path, "rx-");
+  }
+
+  if (direction == PCAP_D_INOUT || direction == PCAP_D_OUT) {
+    tx = sysfs_count(path, "tx-");
+  }
+
+  return rx > tx ? rx : tx;
+}
+
+/* ========================================================================= */
+static int load_matrix_program(int queues) {
+  static char log_buf[EBPF_LOG_BUF_SIZE];
+
+  int pfd = -1;
+
+  struct bpf_insn prog[] = {
+    /*
+     * PACKET_FANOUT_EBPF_MATRIX - one ring per (cpu, queue) cell, cells laid
+     *                             out row by row.
+     *
+     *   queue = skb->queue_mapping;
+     *   if (skb->pkt_type != PACKET_OUTGOING && queue)
+     *     queue -= 1;
+     *   return smp_processor_id() * queues + queue % queues;
+     *
+     * The program runs on the cpu delivering the packet, which is the cpu
+     * PACKET_FANOUT_CPU would have picked. An rx queue is recorded as queue
+     * + 1, with 0 meaning none was recorded; those are counted as queue 0.
+     */
+    { 0xbf, 0x6, 0x1, 0x0000, 0x00000000 }, // r6 = r1
+    { 0x85, 0x0, 0x0, 0x0000, BPF_FUNC_get_smp_processor_id }, // call
+    { 0x27, 0x0, 0x0, 0x0000, queues },     // r0 *= queues
+    { 0xbf, 0x7, 0x0, 0x0000, 0x00000000 }, // r7 = r0
+    { 0x61, 0x3, 0x6, 0x0004, 0x00000000 }, // r3 = *(u32 *)(r6 + 4)
+    { 0x61, 0x0, 0x6, 0x000c, 0x00000000 }, // r0 = *(u32 *)(r6 + 12)
+    { 0x15, 0x3, 0x0, 0x0002, 0x00000004 }, // if r3 == 4 goto 2
+    { 0x15, 0x0, 0x0, 0x0001, 0x00000000 }, // if r0 == 0 goto 1
+    { 0x17, 0x0, 0x0, 0x0000, 0x00000001 }, // r0 -= 1
+    { 0x97, 0x0, 0x0, 0x0000, queues },     // r0 %= queues
+    { 0x0f, 0x0, 0x7, 0x0000, 0x00000000 }, // r0 += r7
+    { 0x95, 0x0, 0x0, 0x0000, 0x00000000 }  // exit
+  };
+
+  pfd = ebpf_prog_load(prog, sizeof(prog) / sizeof(prog[0]), "Dual MIT/GPL",
+                                                     log_buf, sizeof(log_buf));
+  if (pfd < 0) {
+    fprintf(stderr, "%s: error loading bpf program: bpf verifier:\n%s\n",
+                                                    program_basename, log_buf);
+  }
+
+  return pfd;
+}
+
+/* ========================================================================= */
+static void print_matrix(FILE *out, struct rxtx_desc *rtd,
+                                      const ring_set_t *cpu_set, int queues) {
+  struct rxtx_ring *ring = NULL;
+  uintmax_t count = 0;
+  uintmax_t greatest = 0;
+  int label_width = 0;
+  int width = 0;
+  int cpus = rxtx_get_ring_count(rtd) / queues;
+  int cpu, queue;
+
+  for_each_set_ring(cpu, rtd) {
+    ring = rxtx_get_ring(rtd, (unsigned int)cpu);
+    if (ring && rxtx_ring_get_packets_received(ring) > greatest) {
+      greatest = rxtx_ring_get_packets_received(ring);
+    }
+  }
+
+  label_width = snprintf(NULL, 0, CSUBJECT " %d", cpus - 1);
+  width = snprintf(NULL, 0, QSUBJECT " %d", queues - 1);
+  if (snprintf(NULL, 0, "%ju", greatest) > width) {
+    width = snprintf(NULL, 0, "%ju", greatest);
+  }
+
+  fprintf(out, "%*s", label_width, "");
+  for (queue = 0; queue < queues; queue++) {
+    fprintf(out, "  %*s" QSUBJECT " %d",
+            width - snprintf(NULL, 0, QSUBJECT " %d", queue), "", queue);
+  }
+  fputc('\n', out);
+
+  for (cpu = 0; cpu < cpus; cpu++) {
+    if (!RING_ISSET(cpu, cpu_set)) {
+      continue;
+    }
+
+    fprintf(out, CSUBJECT " %-*d", label_width - (int)strlen(CSUBJECT " "),
+                                                                         cpu);
+    for (queue = 0; queue < queues; queue++) {
+      ring = rxtx_get_ring(rtd, (unsigned int)(cpu * queues + queue));
+      count = ring ? rxtx_ring_get_packets_received(ring) : 0;
+      fprintf(out, "  %*ju", width, count);
+    }
+    fputc('\n', out);
+  }
+}
+
+/* ========================================================================= */
+int main(int argc, char **argv) {
+  program_basename = basename(argv[0]);
+
+  int c = 0;
+  int queues = 0;
+  int i = 0;
+  int j = 0;
+  int pfd = -1;
+  int status = 0;
+
+  bool help = false;
+
+  char *badopt = NULL;
+  char *list = NULL;
+  char *mask = NULL;
+  char *endptr = NULL;
+
+  FILE *out = stdout;
+
+  char errbuf[RXTX_ERRBUF_SIZE] = "";
+
+  struct rxtx_desc rtd;
+  rxtx_init(&rtd, errbuf);
+
+  struct rxtx_ring* ring;
+
+  status = rxtx_set_fanout_mode(&rtd, PACKET_FANOUT_EBPF);
+  if (status == RXTX_ERROR) {
+    fprintf(stderr, "%s: %s\n", program_basename, errbuf);
+    return EXIT_FAIL;
+  }
+
+  /*
+   * direction default is based on the invocation.
+   */
+  if (strcmp(program_basename, RXSELF) == 0) {
+    status = rxtx_set_direction(&rtd, PCAP_D_IN);
+  } else if (strcmp(program_basename, TXSELF) == 0) {
+    status = rxtx_set_direction(&rtd, PCAP_D_OUT);
+  } else {
+    status = rxtx_set_direction(&rtd, PCAP_D_INOUT);
+  }
+  if (status == RXTX_ERROR) {
+    fprintf(stderr, "%s: %s\n", program_basename, errbuf);
+    return EXIT_FAIL;
+  }
+
+  ring_set_t cpu_set;
+  ring_set_init(&cpu_set, 0);
+
+  /*
+   * optstring must start with ":" so ':' is returned for a missing option
+   * argument. Otherwise '?' is returned for both invalid option and missing
+   * option argument.
+   */
+  while ((c = getopt_long(argc, argv, ":c:d:hl:m:pUvVw:", long_options, 0))
+                                                                       != -1) {
+    switch (c) {
+      case 'c':
+        status = rxtx_set_packet_count(&rtd, strtoumax(optarg, &endptr,
+                                                           OPTION_COUNT_BASE));
+        if (status == RXTX_ERROR) {
+          fprintf(stderr, "%s: %s\n", program_basename, errbuf);
+          return EXIT_FAIL;
+        }
+        if (*endptr) {
+          fprintf(stderr, "%s: Invalid count '%s'.\n", program_basename,
+                                                                       optarg);
+          usage_short();
+          return EXIT_FAIL_OPTION;
+        }
+        break;
+
+      case 'd':
+        if (strcmp(optarg, "rx") == 0) {
+          status = rxtx_set_direction(&rtd, PCAP_D_IN);
+        } else if (strcmp(optarg, "tx") == 0) {
+          status = rxtx_set_direction(&rtd, PCAP_D_OUT);
+        } else if (strcmp(optarg, "rxtx") == 0) {
+          status = rxtx_set_direction(&rtd, PCAP_D_INOUT);
+        } else {
+          fprintf(stderr, "%s: Invalid direction '%s'.\n", program_basename,
+                                                                       optarg);
+          usage_short();
+          return EXIT_FAIL_OPTION;
+        }
+        if (status == RXTX_ERROR) {
+          fprintf(stderr, "%s: %s\n", program_basename, errbuf);
+          return EXIT_FAIL;
+        }
+        break;
+
+      case 'h':
+        help = true;
+        break;
+
+      case 'l':
+        list = optarg;
+        if (parse_cpu_list(optarg, &cpu_set)) {
+          fprintf(stderr, "%s: Invalid " FLIST " '%s'.\n", program_basename,
+                                                                       optarg);
+          usage_short();
+          return EXIT_FAIL_OPTION;
+        }
+        break;
+
+      case 'm':
+        mask = optarg;
+        if (parse_cpu_mask(optarg, &cpu_set)) {
+          fprintf(stderr, "%s: Invalid " FMASK " '%s'.\n", program_basename,
+                                                                       optarg);
+          usage_short();
+          return EXIT_FAIL_OPTION;
+        }
+        break;
+
+      case 'p':
+        status = rxtx_set_promiscuous(&rtd);
+        if (status == RXTX_ERROR) {
+          fprintf(stderr, "%s: %s\n", program_basename, errbuf);
+          return EXIT_FAIL;
+        }
+        break;
+
+      case 'U':
+        status = rxtx_set_packet_buffered(&rtd);
+        if (status == RXTX_ERROR) {
+          fprintf(stderr, "%s: %s\n", program_basename, errbuf);
+          return EXIT_FAIL;
+        }
+        break;
+
+      case 'v':
+        rxtx_set_verbose(&rtd);
+        break;
+
+      case 'V':
+        printf("%s version %s\n", program_basename, RXTXUTILS_VERSION);
+        return EXIT_OK;
+
+      case 'w':
+        status = rxtx_set_savefile_template(&rtd, optarg);
+        if (status == RXTX_ERROR) {
+          fprintf(stderr, "%s: %s\n", program_basename, errbuf);
+          return EXIT_FAIL;
+        }
+        break;
+
+      case ':':  /* missing option argument */
+        fprintf(stderr, "%s: Option '%s' requires an argument.\n",
+                                             program_basename, argv[optind-1]);
+        usage_short();
+        return EXIT_FAIL_OPTION;
+
+      case '?':  /* invalid option */
+      default:   /* invalid option in optstring */
+        /*
+         * optopt is NULL for long options. optind is the index of the next
+         * argv to be processed. It is therefore tempting to use
+         * argv[optind-1] to retrieve the invalid option, be it short or long.
+         *
+         * This method works with long options and with non-bundled short
+         * options. However, it fails under certain conditions with bundled
+         * short options.
+         *
+         * When the first invalid option in the bundle is also the last option
+         * in the bundle, argv[optind-1] works.
+         *
+         * When the first invalid option in the bundle is not also the last
+         * option in the bundle, optind is not incremented. This makes sense
+         * since the bundle argv still needs further processing.
+         *
+         * Relying solely on optind leaves us with two difficult to distinguish
+         * possibilities.
+         *   1. The last or only short option in argv[optind-1] was invalid and
+         *      optind was incremented.
+         *   2. Any short option other than the last in argv[optind] was
+         *      invalid and optind was not incremented.
+         *
+         * As previously mentioned, optopt is NULL for long options. It is also
+         * reliable for finding the invalid short option with one caveat; we
+         * need to keep our optstring clean. If we arrive here via the default
+         * case optopt will be NULL and we'll have a corner case for the
+         * invalid short option mistakenly in optstring.
+         *
+         * As long as we keep optstring clean, we can use optopt for short
+         * options and argv[optind-1] for long options.
+         */
+        if (optopt) {
+          asprintf(&badopt, "-%c", optopt);
+        } else {
+          badopt = argv[optind-1];
+        }
+        fprintf(stderr, "%s: Unrecognized option '%s'.\n", program_basename,
+                                                                       badopt);
+        if (optopt) {
+          free(badopt);
+        }
+        usage_short();
+        return EXIT_FAIL_OPTION;
+    }
+  }
+
+  if (help) {
+    usage();
+    return EXIT_OK;
+  }
+
+  if (list && mask) {
+    fprintf(stderr, "%s: -l [--" HLIST "] and -m [--" HMASK "] are mutually"
+                                            " exclusive.\n", program_basename);
+    usage_short();
+    return EXIT_FAIL_OPTION;
+  }
+
+  if ((optind + 1) < argc) {
+    fprintf(stderr, "%s: Only one interface argument is allowed (got [ ",
+                                                             program_basename);
+    for (; optind < argc; optind++) {
+      fprintf(stderr, "'%s'", argv[optind]);
+      if ((optind + 1) < argc)
+        fputs(", ", stderr);
+    }
+    fputs(" ]).\n", stderr);
+    usage_short();
+    return EXIT_FAIL_OPTION;
+  }
+
+  if (optind != argc) {
+    status = rxtx_set_ifname(&rtd, argv[optind]);
+    if (status == RXTX_ERROR) {
+      fprintf(stderr, "%s: %s\n", program_basename, errbuf);
+      return EXIT_FAIL;
+    }
+  }
+
+  int cpus = sysconf(_SC_NPROCESSORS_CONF);
+  if (cpus <= 0) {
+    fprintf(stderr, "%s: Failed to get " CSUBJECT " count.\n",
+                                                             program_basename);
+    return EXIT_FAIL;
+  }
+
+  queues = num_queues(rxtx_get_ifname(&rtd), rxtx_get_direction(&rtd));
+  if (queues <= 0) {
+    fprintf(stderr, "%s: Failed to get " QSUBJECT " count.\n",
+                                                             program_basename);
+    return EXIT_FAIL;
+  }
+
+  if ((long)cpus * queues > PACKET_FANOUT_RING_MAX) {
+    fprintf(stderr, "%s: A matrix of '%d' " CSUBJECT "s by '%d' " QSUBJECT
+                   "s exceeds the '%d' ring fanout limit.\n", program_basename,
+                                         cpus, queues, PACKET_FANOUT_RING_MAX);
+    return EXIT_FAIL;
+  }
+
+  if (rxtx_verbose_isset(&rtd)) {
+    fprintf(stderr, "Found '%d' " CSUBJECT "s and '%d' " QSUBJECT "s.\n",
+                                                                 cpus, queues);
+  }
+
+  if (RING_COUNT(&cpu_set) == 0) {
+    for (i = 0; i < cpus; i++) {
+      RING_SET(i, &cpu_set);
+    }
+  }
+
+  /*
+   * A cell's worker is pinned to the cell's cpu, which can't be done on an
+   * offline cpu. Offline cpus are skipped by default, but asking for one is
+   * an error.
+   */
+  ring_set_t online;
+  ring_set_init(&online, 0);
+  if (get_online_cpu_set(&online) != 0) {
+    fprintf(stderr, "%s: Failed to get online " CSUBJECT " set.\n",
+                                                             program_basename);
+    return EXIT_FAIL;
+  }
+
+  for (i = 0; i < cpus; i++) {
+    if (!RING_ISSET(i, &cpu_set) || RING_ISSET(i, &online)) {
+      continue;
+    }
+
+    if (list || mask) {
+      fprintf(stderr, "%s: " CSUBJECT " '%d' in %s is offline.\n",
+                                 program_basename, i, list ? FLIST : FMASK);
+      usage_short();
+      return EXIT_FAIL_OPTION;
+    }
+
+    RING_CLR(i, &cpu_set);
+    if (rxtx_verbose_isset(&rtd)) {
+      fprintf(stderr, "Skipping " CSUBJECT " '%d' since it is offline.\n", i);
+    }
+  }
+
+  ring_set_destroy(&online);
+
+  /*
+   * Every cell of a selected cpu's row is captured; cells of other rows stay
+   * in the fanout group (so the program's return values keep lining up with
+   * ring indexes) but have no worker.
+   */
+  ring_set_t ring_set;
+  ring_set_init(&ring_set, 0);
+
+  for (i = 0; i < cpus; i++) {
+    if (RING_ISSET(i, &cpu_set)) {
+      for (j = 0; j < queues; j++) {
+        RING_SET(i * queues + j, &ring_set);
+      }
+    }
+  }
+
+  if (!RING_COUNT(&ring_set)) {
+    fprintf(stderr, "%s: No configured " FSUBJECTS " present in %s.\n",
+                                       program_basename, list ? FLIST : FMASK);
+    usage_short();
+    return EXIT_FAIL_OPTION;
+  }
+
+  if (rxtx_get_savefile_template(&rtd) &&
+                          strcmp(rxtx_get_savefile_template(&rtd), "-") == 0 &&
+                                                  RING_COUNT(&ring_set) != 1) {
+    fprintf(stderr, "%s: Write file '-' (stdout) is only permitted when the"
+                             " matrix has a single cell.\n", program_basename);
+    usage_short();
+    return EXIT_FAIL_OPTION;
+  }
+
+  status = rxtx_set_ring_count(&rtd, cpus * queues);
+  if (status == RXTX_ERROR) {
+    fprintf(stderr, "%s: %s\n", program_basename, errbuf);
+    return EXIT_FAIL;
+  }
+
+  status = rxtx_set_ring_set(&rtd, &ring_set);
+  if (status == RXTX_ERROR) {
+    fprintf(stderr, "%s: %s\n", program_basename, errbuf);
+    return EXIT_FAIL;
+  }
+
+  status = rxtx_set_savefile_columns(&rtd, queues);
+  if (status == RXTX_ERROR) {
+    fprintf(stderr, "%s: %s\n", program_basename, errbuf);
+    return EXIT_FAIL;
+  }
+
+  pfd = load_matrix_program(queues);
+  if (pfd < 0) {
+    return EXIT_FAIL;
+  }
+
+  status = rxtx_set_fanout_data_fd(&rtd, pfd);
+  if (status == RXTX_ERROR) {
+    fprintf(stderr, "%s: %s\n", program_basename, errbuf);
+    return EXIT_FAIL;
+  }
+
+  status = rxtx_activate(&rtd);
+  if (status == RXTX_ERROR) {
+    fprintf(stderr, "%s: %s\n", program_basename, errbuf);
+    return EXIT_FAIL;
+  }
+
+  /*
+   * Setup our signal handlers before spinning up threads.
+   */
+  setup_signals();
+
+  /*
+   * This loop spins up our threads. Each thread is passed the ring containing
+   * the socket fd which will receive packets for its cell and is affine to
+   * the cell's cpu, the only cpu those packets arrive on.
+   */
+  pthread_t threads[rxtx_get_ring_count(&rtd)];
+  pthread_attr_t attr;
+  pthread_attr_init(&attr);
+
+  ring_set_t affinity;
+  ring_set_init(&affinity, 0);
+
+  for_each_set_ring(i, &rtd) {
+    ring = rxtx_get_ring(&rtd, (unsigned int)i);
+    if (!ring) {
+      fprintf(stderr, "%s: %s\n", program_basename, errbuf);
+      return EXIT_FAIL;
+    }
+
+    RING_ZERO(&affinity);
+    RING_SET(i / queues, &affinity);
+    pthread_attr_setaffinity_np(&attr, affinity.size, affinity.set);
+
+    status = pthread_create(&threads[i], &attr, rxtx_ring_loop, (void *)ring);
+    if (status) {
+      fprintf(stderr, "%s: error creating ring threads: %s\n",
+                                           program_basename, strerror(status));
+      return EXIT_FAIL;
+    }
+  }
+
+  /*
+   * This loop joins our threads.
+   */
+  int ebusy = 0;
+
+  void *vpstatus = NULL;
+
+  int joined[rxtx_get_ring_count(&rtd)];
+  memset(joined, 0, sizeof(int) * rxtx_get_ring_count(&rtd));
+
+  while (1) {
+    ebusy = 0;
+
+    for_each_set_ring(i, &rtd) {
+      if (!joined[i]) {
+        status = pthread_tryjoin_np(threads[i], &vpstatus);
+
+        if (status == EBUSY) {
+          ebusy++;
+          continue;
+        }
+
+        if (status) {
+          fprintf(stderr, "%s: error joining ring threads: %s\n",
+                                           program_basename, strerror(status));
+          return EXIT_FAIL;
+        }
+
+        joined[i] = 1;
+        if ((intptr_t)vpstatus == (intptr_t)RXTX_ERROR) {
+          fprintf(stderr, "%s: %s\n", program_basename, errbuf);
+          return EXIT_FAIL;
+        }
+      }
+    }
+
+    if (ebusy) {
+      usleep(10);
+    } else {
+      break;
+    }
+  }
+
+  pthread_attr_destroy(&attr);
+
+  /*
+   * Print the cpu by queue matrix of packet counts.
+   */
+  out = stdout;
+  if (rxtx_get_savefile_template(&rtd) &&
+                          strcmp(rxtx_get_savefile_template(&rtd), "-") == 0) {
+    out = stderr;
+  }
+
+  print_matrix(out, &rtd, &cpu_set, queues);
+
+  fprintf(out, "%ju packets captured total.\n",
+                                              rxtx_get_packets_received(&rtd));
+
+  status = rxtx_close(&rtd);
+  if (status == RXTX_ERROR) {
+    fprintf(stderr, "%s: %s\n", program_basename, errbuf);
+    return EXIT_FAIL;
+  }
+
+  close(pfd);
+  ring_set_destroy(&affinity);
+  ring_set_destroy(&ring_set);
+  ring_set_destroy(&cpu_set);
+
+  return EXIT_OK;
+}
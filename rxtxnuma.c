@@ -12,8 +12,10 @@
 
 #include "cpu.h"       // for get_numa_cpu_set(), get_online_cpu_set(),
                        //     parse_cpu_list(), parse_cpu_mask()
-#include "ring_set.h"  // for for_each_ring_in_size(), RING_CLR(),
-                       //     RING_COUNT(), RING_ISSET(), RING_SET()
+#include "ring_set.h"  // for for_each_ring_in_size(), RING_AND(),
+                       //     RING_CLR(), RING_COUNT(), RING_ISSET(),
+                       //     RING_SET(), ring_set_destroy(), ring_set_init(),
+                       //     ring_set_t, RING_ZERO()
 #include "rxtx.h"      // for for_each_ring(), for_each_set_ring(),
                        //     program_basename, rxtx_activate(), rxtx_close(),
                        //     rxtx_desc, rxtx_get_packets_received(),
@@ -45,8 +47,6 @@
 #include <pthread.h>  // for pthread_attr_destroy(), pthread_attr_init(),
                       //     pthread_attr_setaffinity_np(), pthread_attr_t,
                       //     pthread_create(), pthread_t, pthread_tryjoin_np()
-#include <sched.h>    // for CPU_COUNT(), CPU_ISSET(), CPU_SET(), cpu_set_t,
-                      //     CPU_ZERO()
 #include <stdbool.h>  // for bool, false, true
 #include <stdint.h>   // for intptr_t
 #include <stdio.h>    // for asprintf(), FILE, fprintf(), fputs(), NULL,
@@ -413,38 +413,51 @@ int num_numa(void) {
 }
 
 /* ========================================================================= */
-int get_online_numa_set(cpu_set_t *numa_set) {
-  CPU_ZERO(numa_set);
+int get_online_numa_set(ring_set_t *numa_set) {
+  RING_ZERO(numa_set);
 
   int i = 0;
   int n = num_numa();
+  int status = 0;
 
-  cpu_set_t online;
-  cpu_set_t current_numa;
-  cpu_set_t current_numa_online;
+  ring_set_t online;
+  ring_set_t current_numa;
+  ring_set_t current_numa_online;
 
-  CPU_ZERO(&online);
+  ring_set_init(&online, 0);
+  ring_set_init(&current_numa, 0);
+  ring_set_init(&current_numa_online, 0);
 
   if (get_online_cpu_set(&online) != 0) {
-    return -1;
+    status = -1;
   }
 
-  for (i = 0; i < n; i++) {
-    CPU_ZERO(&current_numa);
-    CPU_ZERO(&current_numa_online);
+  for (i = 0; i < n && !status; i++) {
+    RING_ZERO(&current_numa_online);
 
     if (get_numa_cpu_set(&current_numa, i) != 0) {
-      return -1;
+      status = -1;
+      break;
     }
 
-    CPU_AND(&current_numa_online, &online, &current_numa);
+    if (RING_AND(&current_numa_online, &online, &current_numa) == -1) {
+      status = -1;
+      break;
+    }
 
-    if (CPU_COUNT(&current_numa_online) > 0) {
-      CPU_SET(i, numa_set);
+    if (RING_COUNT(&current_numa_online) > 0) {
+      if (RING_SET(i, numa_set) == -1) {
+        status = -1;
+        break;
+      }
     }
   }
 
-  return 0;
+  ring_set_destroy(&current_numa_online);
+  ring_set_destroy(&current_numa);
+  ring_set_destroy(&online);
+
+  return status;
 }
 
 /* ========================================================================= */
@@ -533,7 +546,7 @@ int main(int argc, char **argv) {
   }
 
   ring_set_t ring_set;
-  RING_ZERO(&ring_set);
+  ring_set_init(&ring_set, 0);
 
   /*
    * optstring must start with ":" so ':' is returned for a missing option
@@ -757,16 +770,17 @@ int main(int argc, char **argv) {
     return EXIT_FAIL_OPTION;
   }
 
-  cpu_set_t online;
+  ring_set_t online;
+  ring_set_init(&online, 0);
   if (get_online_numa_set(&online) != 0) {
     fprintf(stderr, "%s: Failed to get online " FSUBJECT " set.\n",
                                                              program_basename);
     return EXIT_FAIL_OPTION;
   }
 
-  if (CPU_COUNT(&online) != rxtx_get_ring_count(&rtd)) {
+  if (RING_COUNT(&online) != rxtx_get_ring_count(&rtd)) {
     for_each_ring(i, &rtd) {
-      if (!CPU_ISSET(i, &online)) {
+      if (!RING_ISSET(i, &online)) {
         RING_CLR(i, &ring_set);
         if (rxtx_verbose_isset(&rtd)) {
           fprintf(stderr, "Skipping " FSUBJECT " '%d' since it is offline.\n",
@@ -820,14 +834,16 @@ int main(int argc, char **argv) {
    * processor and is passed the ring containing the socket fd which will
    * receive packets for that processor.
    */
-  cpu_set_t cpu_set;
+  ring_set_t cpu_set;
   pthread_t threads[rxtx_get_ring_count(&rtd)];
   pthread_attr_t attr;
   pthread_attr_init(&attr);
 
+  ring_set_init(&cpu_set, 0);
+
   for_each_set_ring(i, &rtd) {
     get_numa_cpu_set(&cpu_set, i);
-    pthread_attr_setaffinity_np(&attr, sizeof(cpu_set), &cpu_set);
+    pthread_attr_setaffinity_np(&attr, cpu_set.size, cpu_set.set);
 
     ring = rxtx_get_ring(&rtd, (unsigned int)i);
     if (!ring) {
@@ -911,5 +927,9 @@ int main(int argc, char **argv) {
     return EXIT_FAIL;
   }
 
+  ring_set_destroy(&cpu_set);
+  ring_set_destroy(&online);
+  ring_set_destroy(&ring_set);
+
   return EXIT_OK;
 }
@@ -12,21 +12,41 @@
 
 #include "cpu.h"       // for parse_cpu_list(), parse_cpu_mask()
 #include "ring_set.h"  // for for_each_ring_in_size(), RING_CLR(),
-                       //     RING_COUNT(), RING_ISSET(), RING_SET()
+                       //     RING_COUNT(), RING_ISSET(), RING_SET(),
+                       //     ring_set_destroy(), ring_set_init(), ring_set_t
 #include "rxtx.h"      // for for_each_ring(), for_each_set_ring(),
                        //     program_basename, rxtx_activate(), rxtx_close(),
-                       //     rxtx_desc, rxtx_get_packets_received(),
+                       //     rxtx_desc, rxtx_flow_estimate_isset(),
+                       //     rxtx_get_burst_resolution(),
+                       //     rxtx_get_flow_check(),
+                       //     rxtx_get_packets_received(),
                        //     rxtx_get_ring(), rxtx_get_ring_count(),
-                       //     rxtx_get_savefile_template(), rxtx_init(),
-                       //     rxtx_set_direction(), rxtx_set_fanout_mode(),
+                       //     rxtx_get_savefile_template(),
+                       //     rxtx_get_top_flows(), rxtx_init(),
+                       //     rxtx_set_bursts(), rxtx_set_direction(),
+                       //     rxtx_set_fanout_mode(),
+                       //     rxtx_set_flow_check(), rxtx_set_flow_estimate(),
                        //     rxtx_set_ifname(), rxtx_set_packet_buffered(),
                        //     rxtx_set_promiscuous(), rxtx_set_ring_count(),
                        //     rxtx_set_ring_set(),
-                       //     rxtx_set_savefile_template(), rxtx_set_verbose(),
+                       //     rxtx_set_savefile_template(),
+                       //     rxtx_set_top_flows(), rxtx_set_verbose(),
                        //     rxtx_verbose_isset()
+#include "rxtx_bursts.h" // for rxtx_bursts_finish(), rxtx_bursts_print(),
+                         //     RXTX_BURSTS_RESOLUTION_MAX
 #include "rxtx_error.h" // for RXTX_ERRBUF_SIZE, RXTX_ERROR
-#include "rxtx_ring.h" // for rxtx_ring, rxtx_ring_get_packets_received(),
+#include "rxtx_flows.h" // for rxtx_flows, rxtx_flows_report(),
+                        //     RXTX_FLOWS_MAX
+#include "rxtx_hll.h"   // for rxtx_hll, rxtx_hll_estimate(), rxtx_hll_init(),
+                        //     rxtx_hll_merge()
+#include "rxtx_ring.h" // for rxtx_ring, rxtx_ring_get_bursts(),
+                       //     rxtx_ring_get_flows(),
+                       //     rxtx_ring_get_hll(),
+                       //     rxtx_ring_get_packets_received(),
+                       //     rxtx_ring_get_top_bytes(),
+                       //     rxtx_ring_get_top_packets(),
                        //     rxtx_ring_loop()
+#include "rxtx_topk.h"  // for rxtx_topk_print(), RXTX_TOPK_MAX
 #include "sig.h"       // for setup_signals()
 
 #include <linux/bpf.h>       // for bpf_attr, bpf_insn, BPF_PROG_LOAD,
@@ -44,10 +64,8 @@
 #include <pthread.h>  // for pthread_attr_destroy(), pthread_attr_init(),
                       //     pthread_attr_setaffinity_np(), pthread_attr_t,
                       //     pthread_create(), pthread_t, pthread_tryjoin_np()
-#include <sched.h>    // for CPU_COUNT(), CPU_ISSET(), CPU_SET(), cpu_set_t,
-                      //     CPU_ZERO()
 #include <stdbool.h>  // for bool, false, true
-#include <stdint.h>   // for intptr_t
+#include <stdint.h>   // for intptr_t, uintmax_t
 #include <stdio.h>    // for asprintf(), FILE, fprintf(), fputs(), NULL,
                       //     printf(), putchar(), puts(), stderr, stdout
 #include <stdlib.h>   // for malloc()
@@ -59,7 +77,10 @@
 #define EXIT_FAIL        1
 #define EXIT_FAIL_OPTION 2
 
+#define OPTION_BURSTS_BASE 10
 #define OPTION_COUNT_BASE 10
+#define OPTION_FLOW_CHECK_BASE 10
+#define OPTION_TOP_FLOWS_BASE 10
 
 #define USAGE_PRINT_OPT_COL_SEP "# "
 #define USAGE_PRINT_OPT_COL_IND "  "
@@ -90,12 +111,16 @@
 #define UMASK USUBJECT "MASK"
 
 static const struct option long_options[] = {
+  {"bursts",          required_argument, NULL, 'B'},
   {"count",           required_argument, NULL, 'c'},
   {"direction",       required_argument, NULL, 'd'},
+  {"estimate-flows",  no_argument,       NULL, 'E'},
+  {"flow-check",      required_argument, NULL, 'F'},
   {"help",            no_argument,       NULL, 'h'},
   {HLIST,             required_argument, NULL, 'l'},
   {HMASK,             required_argument, NULL, 'm'},
   {"promiscuous",     no_argument,       NULL, 'p'},
+  {"top-flows",       required_argument, NULL, 'T'},
   {"packet-buffered", no_argument,       NULL, 'U'},
   {"verbose",         no_argument,       NULL, 'v'},
   {"version",         no_argument,       NULL, 'V'},
@@ -110,12 +135,28 @@ struct usage_opt {
 };
 
 static const struct usage_opt usage_options[] = {
+  {'B', "USEC,N",    "Count each " FSUBJECT "'s packets in USEC microsecond"
+                          " windows by kernel timestamp and, on exit, report"
+                          " the busiest window on each " FSUBJECT " and its"
+                       " bursts, runs of consecutive windows with at least N"
+                                                          " packets each."},
   {'c', "N",         "Exit after receiving N packets."},
   {'d', "DIRECTION", "Capture only packets matching DIRECTION. DIRECTION can"
                         " be 'rx', 'tx', or 'rxtx'. Default matches invocation"
                          " (i.e. DIRECTION defaults to 'rx' when invocation is"
                        " '" RXSELF "', 'tx' when '" TXSELF "', and 'rxtx' when"
                                                           " '" RXTXSELF "')."},
+  {'E', NULL,        "Estimate the number of distinct flows on each "
+                         FSUBJECT " and in total, using a fixed size sketch"
+                  " per " FSUBJECT " (accurate to within a few percent). Flows"
+                      " are directional and keyed by protocol, addresses, and"
+                                                                  " ports."},
+  {'F', "N",         "Track up to N flows per " FSUBJECT " and, on exit,"
+                         " report every flow seen on more than one " FSUBJECT
+                       " with its per-" HSUBJECT " packet counts. Flows are"
+                          " directional and keyed by protocol, addresses, and"
+                         " ports. Packets from flows beyond the first N on a "
+                               FSUBJECT " are counted but not checked."},
   {'h', NULL,        "Display this help and exit."},
   {'l', ULIST,       "Capture only on " FSUBJECTS " in " ULIST " (e.g. if "
                         ULIST " is '0,2-4,6', only packets on " FSUBJECTS " 0,"
@@ -124,6 +165,10 @@ static const struct usage_opt usage_options[] = {
                        UMASK " is '5d', only packets on " FSUBJECTS " 0, 2, 3,"
                                                " 4, and 6 will be captured)."},
   {'p', NULL,        "Put the interface into promiscuous mode."},
+  {'T', "K",         "Report the top K flows on each " FSUBJECT " by"
+                      " packets and by bytes, using a fixed size summary per "
+                   FSUBJECT ". A flow's total is shown as a range when other"
+                                            " flows may have added to it."},
   {'U', NULL,        "When writing to a pcap file, the write buffer will be"
                            " flushed just after each packet is placed in it."},
   {'v', NULL,        "Display more verbose output."},
@@ -140,7 +185,7 @@ static const struct usage_opt usage_options[] = {
   {0, NULL, NULL}
 };
 
-static char *usage_short_opt_order = "h:c:lm:d:U:p:v:V:w";
+static char *usage_short_opt_order = "h:c:lm:d:B:E:F:T:U:p:v:V:w";
 
 /* ========================================================================= */
 static void usage_print_opt(int val, const char *name, const char *arg,
@@ -445,6 +490,10 @@ int main(int argc, char **argv) {
   char *list = NULL;
   char *mask = NULL;
   char *endptr = NULL;
+  uintmax_t burst_resolution = 0;
+  uintmax_t burst_threshold = 0;
+  uintmax_t flow_check = 0;
+  uintmax_t top_flows = 0;
 
   FILE *out = stdout;
 
@@ -522,16 +571,38 @@ int main(int argc, char **argv) {
   }
 
   ring_set_t ring_set;
-  RING_ZERO(&ring_set);
+  ring_set_init(&ring_set, 0);
 
   /*
    * optstring must start with ":" so ':' is returned for a missing option
    * argument. Otherwise '?' is returned for both invalid option and missing
    * option argument.
    */
-  while ((c = getopt_long(argc, argv, ":c:d:hl:m:pUvVw:", long_options, 0))
-                                                                       != -1) {
+  while ((c = getopt_long(argc, argv, ":B:c:d:EF:hl:m:pT:UvVw:", long_options,
+                                                                 0)) != -1) {
     switch (c) {
+      case 'B':
+        burst_threshold = 0;
+        burst_resolution = strtoumax(optarg, &endptr, OPTION_BURSTS_BASE);
+        if (*endptr == ',') {
+          burst_threshold = strtoumax(endptr + 1, &endptr,
+                                                          OPTION_BURSTS_BASE);
+        }
+        if (*endptr || burst_resolution == 0 || burst_threshold == 0 ||
+                          burst_resolution > RXTX_BURSTS_RESOLUTION_MAX) {
+          fprintf(stderr, "%s: Invalid bursts '%s'.\n", program_basename,
+                                                                       optarg);
+          usage_short();
+          return EXIT_FAIL_OPTION;
+        }
+        status = rxtx_set_bursts(&rtd, (unsigned int)burst_resolution,
+                                                              burst_threshold);
+        if (status == RXTX_ERROR) {
+          fprintf(stderr, "%s: %s\n", program_basename, errbuf);
+          return EXIT_FAIL;
+        }
+        break;
+
       case 'c':
         status = rxtx_set_packet_count(&rtd, strtoumax(optarg, &endptr,
                                                            OPTION_COUNT_BASE));
@@ -566,6 +637,29 @@ int main(int argc, char **argv) {
         }
         break;
 
+      case 'E':
+        status = rxtx_set_flow_estimate(&rtd);
+        if (status == RXTX_ERROR) {
+          fprintf(stderr, "%s: %s\n", program_basename, errbuf);
+          return EXIT_FAIL;
+        }
+        break;
+
+      case 'F':
+        flow_check = strtoumax(optarg, &endptr, OPTION_FLOW_CHECK_BASE);
+        if (*endptr || flow_check == 0 || flow_check > RXTX_FLOWS_MAX) {
+          fprintf(stderr, "%s: Invalid flow count '%s'.\n", program_basename,
+                                                                       optarg);
+          usage_short();
+          return EXIT_FAIL_OPTION;
+        }
+        status = rxtx_set_flow_check(&rtd, (size_t)flow_check);
+        if (status == RXTX_ERROR) {
+          fprintf(stderr, "%s: %s\n", program_basename, errbuf);
+          return EXIT_FAIL;
+        }
+        break;
+
       case 'h':
         help = true;
         break;
@@ -598,6 +692,21 @@ int main(int argc, char **argv) {
         }
         break;
 
+      case 'T':
+        top_flows = strtoumax(optarg, &endptr, OPTION_TOP_FLOWS_BASE);
+        if (*endptr || top_flows == 0 || top_flows > RXTX_TOPK_MAX) {
+          fprintf(stderr, "%s: Invalid top flow count '%s'.\n",
+                                                     program_basename, optarg);
+          usage_short();
+          return EXIT_FAIL_OPTION;
+        }
+        status = rxtx_set_top_flows(&rtd, (size_t)top_flows);
+        if (status == RXTX_ERROR) {
+          fprintf(stderr, "%s: %s\n", program_basename, errbuf);
+          return EXIT_FAIL;
+        }
+        break;
+
       case 'U':
         status = rxtx_set_packet_buffered(&rtd);
         if (status == RXTX_ERROR) {
@@ -858,11 +967,112 @@ int main(int argc, char **argv) {
   fprintf(out, "%ju packets captured total.\n",
                                               rxtx_get_packets_received(&rtd));
 
+  /*
+   * Merging sketches takes the max of each register, so a flow seen on more
+   * than one ring is still only counted once in the total.
+   */
+  if (rxtx_flow_estimate_isset(&rtd)) {
+    struct rxtx_hll total;
+    rxtx_hll_init(&total);
+
+    for_each_set_ring(i, &rtd) {
+      ring = rxtx_get_ring(&rtd, (unsigned int)i);
+      if (!ring) {
+        fprintf(stderr, "%s: %s\n", program_basename, errbuf);
+        return EXIT_FAIL;
+      }
+
+      fprintf(out, "%ju flows estimated on " FSUBJECT " %d.\n",
+                                rxtx_hll_estimate(rxtx_ring_get_hll(ring)), i);
+      rxtx_hll_merge(&total, rxtx_ring_get_hll(ring));
+    }
+
+    fprintf(out, "%ju flows estimated total.\n", rxtx_hll_estimate(&total));
+  }
+
+  /*
+   * The summaries are only exact for flows which never had to share a
+   * counter; rxtx_topk_print() shows a range for the rest.
+   */
+  if (rxtx_get_top_flows(&rtd)) {
+    for_each_set_ring(i, &rtd) {
+      ring = rxtx_get_ring(&rtd, (unsigned int)i);
+      if (!ring) {
+        fprintf(stderr, "%s: %s\n", program_basename, errbuf);
+        return EXIT_FAIL;
+      }
+
+      fprintf(out, "Top flows by packets on " FSUBJECT " %d:\n", i);
+      status = rxtx_topk_print(rxtx_ring_get_top_packets(ring),
+                                              rxtx_get_top_flows(&rtd), out);
+      if (status == RXTX_ERROR) {
+        fprintf(stderr, "%s: %s\n", program_basename, errbuf);
+        return EXIT_FAIL;
+      }
+
+      fprintf(out, "Top flows by bytes on " FSUBJECT " %d:\n", i);
+      status = rxtx_topk_print(rxtx_ring_get_top_bytes(ring),
+                                              rxtx_get_top_flows(&rtd), out);
+      if (status == RXTX_ERROR) {
+        fprintf(stderr, "%s: %s\n", program_basename, errbuf);
+        return EXIT_FAIL;
+      }
+    }
+  }
+
+  /*
+   * A burst still going when capture stopped ends with the last window we
+   * saw, so finish each ring's windows before printing them.
+   */
+  if (rxtx_get_burst_resolution(&rtd)) {
+    for_each_set_ring(i, &rtd) {
+      ring = rxtx_get_ring(&rtd, (unsigned int)i);
+      if (!ring) {
+        fprintf(stderr, "%s: %s\n", program_basename, errbuf);
+        return EXIT_FAIL;
+      }
+
+      rxtx_bursts_finish(rxtx_ring_get_bursts(ring));
+      fprintf(out, "Bursts on " FSUBJECT " %d:\n", i);
+      rxtx_bursts_print(rxtx_ring_get_bursts(ring), out);
+    }
+  }
+
+  /*
+   * Every worker has been joined, so the flow tables are ours to read.
+   */
+  if (rxtx_get_flow_check(&rtd)) {
+    struct rxtx_flows *flows[rxtx_get_ring_count(&rtd)];
+
+    for_each_ring(i, &rtd) {
+      flows[i] = NULL;
+    }
+
+    for_each_set_ring(i, &rtd) {
+      ring = rxtx_get_ring(&rtd, (unsigned int)i);
+      if (!ring) {
+        fprintf(stderr, "%s: %s\n", program_basename, errbuf);
+        return EXIT_FAIL;
+      }
+
+      flows[i] = rxtx_ring_get_flows(ring);
+    }
+
+    status = rxtx_flows_report(flows, rxtx_get_ring_count(&rtd), FSUBJECT,
+                                                                 out, errbuf);
+    if (status == RXTX_ERROR) {
+      fprintf(stderr, "%s: %s\n", program_basename, errbuf);
+      return EXIT_FAIL;
+    }
+  }
+
   status = rxtx_close(&rtd);
   if (status == RXTX_ERROR) {
     fprintf(stderr, "%s: %s\n", program_basename, errbuf);
     return EXIT_FAIL;
   }
 
+  ring_set_destroy(&ring_set);
+
   return EXIT_OK;
 }
@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2019-present StackPath, LLC
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ * softnet.c -- read per-cpu packet processing counters from procfs.
+ */
+
+#define _GNU_SOURCE
+
+#include "softnet.h"
+
+#include "cpu.h"      // for get_online_cpu_set()
+#include "ring_set.h" // for find_next_set_ring(), RING_EQUAL(),
+                      //     ring_set_destroy(), ring_set_init(),
+                      //     RING_SETSIZE(), ring_set_t
+
+#include <stdio.h>  // for fclose(), FILE, fopen(), getline(), sscanf()
+#include <stdlib.h> // for free()
+#include <string.h> // for memset()
+
+#define RETURN_BAD -1
+#define RETURN_GOOD 0
+
+#define SOFTNET_STAT_PATH "/proc/net/softnet_stat"
+
+/* ========================================================================= */
+int get_softnet_stats(struct softnet_stat *stats, int cpu_count) {
+  memset(stats, 0, sizeof(*stats) * cpu_count);
+
+  char *line = NULL;
+  size_t len = 0;
+  int fields = 0;
+  int cpu = -1;
+  int legacy = 0;
+
+  unsigned int processed = 0;
+  unsigned int dropped = 0;
+  unsigned int time_squeeze = 0;
+  unsigned int received_rps = 0;
+  unsigned int index = 0;
+
+  ring_set_t online, after;
+  ring_set_init(&online, 0);
+  ring_set_init(&after, 0);
+
+  if (get_online_cpu_set(&online) != 0) {
+    ring_set_destroy(&online);
+    return RETURN_BAD;
+  }
+
+  FILE *f = fopen(SOFTNET_STAT_PATH, "r");
+  if (!f) {
+    ring_set_destroy(&online);
+    return RETURN_BAD;
+  }
+
+  /*
+   * There's one row per online cpu. Since linux 5.10 the 13th column is the
+   * cpu the row belongs to; before that rows are in cpu order but offline
+   * cpus are skipped, so row n belongs to the nth online cpu. Columns 4
+   * through 9 and 11 and 12 aren't of interest here.
+   *
+   * A cpu which is offline for either of two snapshots has no row in it and
+   * so is left !present, which keeps callers from taking a difference.
+   */
+  while (getline(&line, &len, f) != -1) {
+    received_rps = 0;
+
+    fields = sscanf(line, "%x %x %x %*x %*x %*x %*x %*x %*x %x %*x %*x %x",
+                       &processed, &dropped, &time_squeeze, &received_rps,
+                                                                      &index);
+    if (fields < 3) {
+      free(line);
+      fclose(f);
+      ring_set_destroy(&online);
+      return RETURN_BAD;
+    }
+
+    if (fields == 5) {
+      cpu = (int)index;
+    } else {
+      legacy = 1;
+      cpu = find_next_set_ring(cpu + 1, &online);
+      if (cpu >= RING_SETSIZE(&online)) {
+        continue;
+      }
+    }
+    if (cpu >= cpu_count) {
+      continue;
+    }
+
+    stats[cpu].present = 1;
+    stats[cpu].processed = processed;
+    stats[cpu].dropped = dropped;
+    stats[cpu].time_squeeze = time_squeeze;
+    stats[cpu].received_rps = received_rps;
+  }
+
+  free(line);
+  fclose(f);
+
+  /*
+   * Without the cpu column, a hotplug while reading may have shifted rows
+   * onto the wrong cpus, so none of them can be trusted.
+   */
+  if (legacy && (get_online_cpu_set(&after) != 0 ||
+                                               !RING_EQUAL(&online, &after))) {
+    memset(stats, 0, sizeof(*stats) * cpu_count);
+  }
+
+  ring_set_destroy(&after);
+  ring_set_destroy(&online);
+
+  return RETURN_GOOD;
+}
@@ -0,0 +1,32 @@
+/*
+ * Copyright (c) 2019-present StackPath, LLC
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ * softnet.h -- header file to use softnet.c
+ */
+
+#ifndef _SOFTNET_H_
+#define _SOFTNET_H_
+
+#define _GNU_SOURCE
+
+#include <stdint.h> // for uint32_t
+
+/*
+ * The kernel keeps these as 32-bit counters which wrap, so differences
+ * between two snapshots must be taken in 32 bits as well.
+ */
+struct softnet_stat {
+  int      present;
+  uint32_t processed;
+  uint32_t dropped;
+  uint32_t time_squeeze;
+  uint32_t received_rps;
+};
+
+int get_softnet_stats(struct softnet_stat *stats, int cpu_count);
+
+#endif // _SOFTNET_H_
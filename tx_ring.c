@@ -0,0 +1,286 @@
+/*
+ * Copyright (c) 2019-present StackPath, LLC
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ * tx_ring.c -- batched transmit through a mmapped PACKET_TX_RING
+ */
+
+#define _GNU_SOURCE
+
+#include "tx_ring.h"
+
+#include "rxtx_error.h" // for RXTX_ERROR, rxtx_fill_errbuf()
+
+#include <linux/if_ether.h>  // for ETH_HLEN, ETH_P_8021Q
+#include <linux/if_packet.h> // for PACKET_LOSS, PACKET_TX_RING,
+                             //     PACKET_VERSION, sockaddr_ll,
+                             //     TP_STATUS_AVAILABLE,
+                             //     TP_STATUS_SEND_REQUEST, TPACKET_ALIGN(),
+                             //     tpacket2_hdr, TPACKET_V2, tpacket_req
+#include <net/if.h>          // for if_indextoname(), ifreq
+#include <sys/ioctl.h>       // for ioctl(), SIOCGIFMTU
+#include <sys/mman.h>        // for MAP_FAILED, MAP_SHARED, mmap(), munmap(),
+                             //     PROT_READ, PROT_WRITE
+#include <sys/socket.h>      // for AF_PACKET, bind(), send(), setsockopt(),
+                             //     SOCK_RAW, sockaddr, socket(), SOL_PACKET
+
+#include <errno.h>  // for EINTR, errno
+#include <string.h> // for memcpy(), memset(), strerror()
+#include <unistd.h> // for close(), getpagesize()
+
+/*
+ * For tx, frame data starts right after the aligned tpacket2_hdr; unlike rx
+ * there is no sockaddr_ll in between.
+ */
+#define TX_RING_DATA_OFFSET (TPACKET_ALIGN(sizeof(struct tpacket2_hdr)))
+
+#define TX_RING_VLAN_HLEN 4
+
+#define tx_ring_frame(p, idx) \
+  ((struct tpacket2_hdr *)((char *)(p)->map + (size_t)(idx) \
+                                                        * TX_RING_FRAME_SIZE))
+
+/* ========================================================================= */
+int tx_ring_open(struct tx_ring *p, unsigned int ifindex,
+                                      unsigned int frame_count, char *errbuf) {
+  int status = 0;
+  int version = TPACKET_V2;
+  int loss = 1;
+  unsigned int block_size = 0;
+  unsigned int frames_per_block = 0;
+
+  p->errbuf = errbuf;
+  p->fd = -1;
+  p->map = NULL;
+  p->map_len = 0;
+  p->frame_count = 0;
+  p->frame_max = TX_RING_FRAME_SIZE - TX_RING_DATA_OFFSET;
+  p->mtu = 0;
+  p->head = 0;
+  p->queued = 0;
+
+  /*
+   * Blocks must be a multiple of the page size and hold a whole number of
+   * frames; round frame_count up so the last block is full too.
+   */
+  block_size = getpagesize();
+  if (block_size < TX_RING_FRAME_SIZE) {
+    block_size = TX_RING_FRAME_SIZE;
+  }
+  frames_per_block = block_size / TX_RING_FRAME_SIZE;
+
+  if (!frame_count) {
+    frame_count = TX_RING_FRAME_COUNT;
+  }
+  frame_count = (frame_count + frames_per_block - 1) / frames_per_block
+                                                           * frames_per_block;
+
+  /*
+   * Protocol 0 keeps the kernel from queueing received packets to a socket
+   * we only ever transmit on.
+   */
+  p->fd = socket(AF_PACKET, SOCK_RAW, 0);
+  if (p->fd == -1) {
+    rxtx_fill_errbuf(p->errbuf, "error creating tx socket: %s",
+                                                              strerror(errno));
+    return RXTX_ERROR;
+  }
+
+  struct ifreq ifr;
+  memset(&ifr, 0, sizeof(ifr));
+
+  if (!if_indextoname(ifindex, ifr.ifr_name) ||
+                                     ioctl(p->fd, SIOCGIFMTU, &ifr) == -1) {
+    rxtx_fill_errbuf(p->errbuf, "error reading interface mtu: %s",
+                                                              strerror(errno));
+    tx_ring_close(p);
+    return RXTX_ERROR;
+  }
+  p->mtu = ifr.ifr_mtu;
+
+  status = setsockopt(p->fd, SOL_PACKET, PACKET_VERSION, &version,
+                                                              sizeof(version));
+  if (status == -1) {
+    rxtx_fill_errbuf(p->errbuf, "error setting tx socket option: %s",
+                                                              strerror(errno));
+    tx_ring_close(p);
+    return RXTX_ERROR;
+  }
+
+  /*
+   * PACKET_LOSS makes the kernel skip malformed frames (e.g. a truncated
+   * capture shorter than the link header) instead of stopping the ring at
+   * them with TP_STATUS_WRONG_FORMAT; tx_ring_sendable() says which those
+   * are.
+   */
+  status = setsockopt(p->fd, SOL_PACKET, PACKET_LOSS, &loss, sizeof(loss));
+  if (status == -1) {
+    rxtx_fill_errbuf(p->errbuf, "error setting tx socket option: %s",
+                                                              strerror(errno));
+    tx_ring_close(p);
+    return RXTX_ERROR;
+  }
+
+  struct tpacket_req req;
+  /* no need for memset(), we're initializing every member */
+  req.tp_block_size = block_size;
+  req.tp_block_nr = frame_count / frames_per_block;
+  req.tp_frame_size = TX_RING_FRAME_SIZE;
+  req.tp_frame_nr = frame_count;
+
+  status = setsockopt(p->fd, SOL_PACKET, PACKET_TX_RING, &req, sizeof(req));
+  if (status == -1) {
+    rxtx_fill_errbuf(p->errbuf, "error setting up tx ring: %s",
+                                                              strerror(errno));
+    tx_ring_close(p);
+    return RXTX_ERROR;
+  }
+
+  p->map_len = (size_t)req.tp_block_size * req.tp_block_nr;
+  p->map = mmap(NULL, p->map_len, PROT_READ | PROT_WRITE, MAP_SHARED, p->fd,
+                                                                            0);
+  if (p->map == MAP_FAILED) {
+    p->map = NULL;
+    rxtx_fill_errbuf(p->errbuf, "error mapping tx ring: %s", strerror(errno));
+    tx_ring_close(p);
+    return RXTX_ERROR;
+  }
+  p->frame_count = frame_count;
+
+  struct sockaddr_ll sll;
+  memset(&sll, 0, sizeof(sll));
+  sll.sll_family = AF_PACKET;
+  sll.sll_protocol = 0;
+  sll.sll_ifindex = ifindex;
+
+  status = bind(p->fd, (struct sockaddr *)&sll, sizeof(sll));
+  if (status == -1) {
+    rxtx_fill_errbuf(p->errbuf, "error binding tx socket: %s",
+                                                              strerror(errno));
+    tx_ring_close(p);
+    return RXTX_ERROR;
+  }
+
+  return 0;
+}
+
+/* ========================================================================= */
+int tx_ring_close(struct tx_ring *p) {
+  if (p->map) {
+    munmap(p->map, p->map_len);
+    p->map = NULL;
+  }
+
+  if (p->fd != -1) {
+    close(p->fd);
+    p->fd = -1;
+  }
+
+  p->map_len = 0;
+  p->frame_count = 0;
+  p->head = 0;
+  p->queued = 0;
+
+  return 0;
+}
+
+/* ========================================================================= */
+int tx_ring_sendable(struct tx_ring *p, const void *data, unsigned int len) {
+  const unsigned char *frame = data;
+  unsigned int max = p->mtu + ETH_HLEN;
+
+  /*
+   * With PACKET_LOSS, frames the kernel refuses come back available just like
+   * sent ones, so callers counting what went out need to hold these back:
+   * runts, and frames longer than the mtu allows (a vlan tag gets the four
+   * bytes it needs).
+   */
+  if (len < ETH_HLEN || len > p->frame_max) {
+    return 0;
+  }
+
+  if ((frame[12] << 8 | frame[13]) == ETH_P_8021Q) {
+    max += TX_RING_VLAN_HLEN;
+  }
+
+  return len <= max;
+}
+
+/* ========================================================================= */
+int tx_ring_enqueue(struct tx_ring *p, const void *data, unsigned int len) {
+  struct tpacket2_hdr *hdr = NULL;
+
+  if (len > p->frame_max) {
+    rxtx_fill_errbuf(p->errbuf, "error queueing packet: %u bytes exceeds the"
+                                 " %u byte tx frame", len, p->frame_max);
+    return RXTX_ERROR;
+  }
+
+  hdr = tx_ring_frame(p, p->head);
+
+  /*
+   * The kernel hands frames back by setting tp_status to TP_STATUS_AVAILABLE
+   * once they're sent; anything else means the ring has wrapped onto frames
+   * still in flight and the caller needs to flush.
+   */
+  if (__atomic_load_n(&hdr->tp_status, __ATOMIC_ACQUIRE)
+                                                      != TP_STATUS_AVAILABLE) {
+    return TX_RING_FULL;
+  }
+
+  memcpy((char *)hdr + TX_RING_DATA_OFFSET, data, len);
+  hdr->tp_len = len;
+
+  __atomic_store_n(&hdr->tp_status, TP_STATUS_SEND_REQUEST,
+                                                            __ATOMIC_RELEASE);
+
+  p->head = (p->head + 1) % p->frame_count;
+  p->queued++;
+
+  return 0;
+}
+
+/* ========================================================================= */
+int tx_ring_flush(struct tx_ring *p) {
+  ssize_t count = 0;
+
+  if (!p->queued) {
+    return 0;
+  }
+
+  /*
+   * One send() walks every frame marked TP_STATUS_SEND_REQUEST. Without
+   * MSG_DONTWAIT it also waits for them to leave, so every frame is ours
+   * again when it returns.
+   */
+  do {
+    count = send(p->fd, NULL, 0, 0);
+  } while (count == -1 && errno == EINTR);
+
+  if (count == -1) {
+    rxtx_fill_errbuf(p->errbuf, "error sending tx ring: %s", strerror(errno));
+    return RXTX_ERROR;
+  }
+
+  p->queued = 0;
+
+  return 0;
+}
+
+/* ========================================================================= */
+unsigned int tx_ring_get_frame_max(struct tx_ring *p) {
+  return p->frame_max;
+}
+
+/* ========================================================================= */
+unsigned int tx_ring_get_mtu(struct tx_ring *p) {
+  return p->mtu;
+}
+
+/* ========================================================================= */
+unsigned int tx_ring_get_queued(struct tx_ring *p) {
+  return p->queued;
+}
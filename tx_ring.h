@@ -0,0 +1,43 @@
+/*
+ * Copyright (c) 2019-present StackPath, LLC
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ * tx_ring.h -- header file to use tx_ring.c
+ */
+
+#ifndef _TX_RING_H_
+#define _TX_RING_H_
+
+#include <stddef.h> // for size_t
+
+#define TX_RING_FULL 1
+
+#define TX_RING_FRAME_SIZE  2048
+#define TX_RING_FRAME_COUNT 1024
+
+struct tx_ring {
+  int          fd;
+  void         *map;
+  size_t       map_len;
+  unsigned int frame_count;
+  unsigned int frame_max;
+  unsigned int mtu;
+  unsigned int head;
+  unsigned int queued;
+  char         *errbuf;
+};
+
+int tx_ring_open(struct tx_ring *p, unsigned int ifindex,
+                                      unsigned int frame_count, char *errbuf);
+int tx_ring_close(struct tx_ring *p);
+int tx_ring_sendable(struct tx_ring *p, const void *data, unsigned int len);
+int tx_ring_enqueue(struct tx_ring *p, const void *data, unsigned int len);
+int tx_ring_flush(struct tx_ring *p);
+unsigned int tx_ring_get_frame_max(struct tx_ring *p);
+unsigned int tx_ring_get_mtu(struct tx_ring *p);
+unsigned int tx_ring_get_queued(struct tx_ring *p);
+
+#endif // _TX_RING_H_
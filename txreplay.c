@@ -0,0 +1,883 @@
+/*
+ * Copyright (c) 2019-present StackPath, LLC
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#define _GNU_SOURCE // for GNU basename()
+
+#include "cpu.h"        // for parse_cpu_list(), parse_cpu_mask()
+#include "ring_set.h"   // for find_next_set_ring(), RING_COUNT(),
+                        //     RING_SET(), ring_set_destroy(),
+                        //     ring_set_init(), RING_SETSIZE(), ring_set_t,
+                        //     RING_ZERO()
+#include "rxtx.h"       // for program_basename, rxtx_breakloop
+#include "rxtx_error.h" // for RXTX_ERRBUF_SIZE, RXTX_ERROR,
+                        //     rxtx_fill_errbuf()
+#include "sig.h"        // for setup_signals()
+#include "tx_ring.h"    // for tx_ring, tx_ring_close(), tx_ring_enqueue(),
+                        //     TX_RING_FRAME_SIZE, TX_RING_FULL,
+                        //     tx_ring_flush(), tx_ring_get_frame_max(),
+                        //     tx_ring_get_mtu(), tx_ring_get_queued(),
+                        //     tx_ring_open(),
+                        //     tx_ring_sendable()
+
+#include <net/if.h> // for if_nametoindex()
+
+#include <ctype.h>    // for isspace()
+#include <errno.h>    // for errno
+#include <getopt.h>   // for getopt_long(), optarg, optind, option, optopt
+#include <inttypes.h> // for strtoumax()
+#include <limits.h>   // for INT_MAX, UINT_MAX
+#include <pcap.h>     // for DLT_EN10MB, pcap_close(), pcap_datalink(),
+                      //     PCAP_ERRBUF_SIZE, pcap_geterr(), pcap_next_ex(),
+                      //     pcap_open_offline(), pcap_pkthdr, pcap_t
+#include <pthread.h>  // for pthread_attr_destroy(), pthread_attr_init(),
+                      //     pthread_attr_setaffinity_np(), pthread_attr_t,
+                      //     pthread_create(), pthread_join(), pthread_t
+#include <sched.h>    // for sched_yield()
+#include <stdbool.h>  // for bool, false, true
+#include <stdint.h>   // for intptr_t, uintmax_t
+#include <stdio.h>    // for asprintf(), fprintf(), fputs(), NULL, printf(),
+                      //     putchar(), puts(), stderr, stdout
+#include <stdlib.h>   // for calloc(), free()
+#include <string.h>   // for GNU basename(), strerror(), strlen()
+#include <time.h>     // for CLOCK_MONOTONIC, clock_gettime(),
+                      //     clock_nanosleep(), TIMER_ABSTIME, timespec
+
+#define EXIT_OK          0
+#define EXIT_FAIL        1
+#define EXIT_FAIL_OPTION 2
+
+#define OPTION_COUNT_BASE 10
+
+#define REPLAY_BATCH_DEFAULT 64
+
+#define NSEC_PER_SEC 1000000000L
+
+/*
+ * Workers don't get the signal themselves, so pacing sleeps are cut into
+ * slices this long to notice rxtx_breakloop promptly.
+ */
+#define REPLAY_PACE_SLICE_NSEC 10000000L
+
+#define USAGE_PRINT_OPT_COL_SEP "# "
+#define USAGE_PRINT_OPT_COL_IND "  "
+
+#define USAGE_PRINT_OPT_COL_SEP_LEN (strlen(USAGE_PRINT_OPT_COL_SEP))
+#define USAGE_PRINT_OPT_COL_IND_LEN (strlen(USAGE_PRINT_OPT_COL_IND))
+
+#define USAGE_PRINT_OPT_TOTAL_LEN     79
+#define USAGE_PRINT_OPT_FIRST_COL_LEN 31
+#define USAGE_PRINT_OPT_SECOND_COL_LEN (USAGE_PRINT_OPT_TOTAL_LEN \
+                 - USAGE_PRINT_OPT_FIRST_COL_LEN - USAGE_PRINT_OPT_COL_SEP_LEN)
+#define USAGE_PRINT_OPT_IND_SECOND_COL_LEN (USAGE_PRINT_OPT_SECOND_COL_LEN \
+                                                 - USAGE_PRINT_OPT_COL_IND_LEN)
+
+#define SUBJECT "worker"
+#define FSUBJECT SUBJECT
+#define FSUBJECTS FSUBJECT "s"
+
+static const struct option long_options[] = {
+  {"batch",    required_argument, NULL, 'b'},
+  {"help",     no_argument,       NULL, 'h'},
+  {"cpu-list", required_argument, NULL, 'l'},
+  {"cpu-mask", required_argument, NULL, 'm'},
+  {"mbps",     required_argument, NULL, 'M'},
+  {"loops",    required_argument, NULL, 'n'},
+  {"pps",      required_argument, NULL, 'P'},
+  {"verbose",  no_argument,       NULL, 'v'},
+  {"version",  no_argument,       NULL, 'V'},
+  {0, 0, NULL, 0}
+};
+
+struct usage_opt {
+  int        val;
+  const char *arg;
+  char *description;
+};
+
+static const struct usage_opt usage_options[] = {
+  {'b', "N",       "Queue up to N packets in the tx ring before handing them"
+                          " to the kernel with a single send(). Default is "
+                       "64. Smaller batches pace more smoothly, larger ones"
+                        " cost fewer calls. Paced replays flush at least once"
+                                                           " a millisecond."},
+  {'h', NULL,      "Display this help and exit."},
+  {'l', "CPULIST", "Pin the " FSUBJECT " for each FILE, in order, to the cpus"
+                       " in CPULIST (e.g. if CPULIST is '0,2-4,6', the first"
+                         " FILE is sent from cpu 0, the second from cpu 2,"
+                     " and so on). Without a list or mask, " FSUBJECTS " are"
+                                                              " not pinned."},
+  {'m', "CPUMASK", "Pin the " FSUBJECT " for each FILE, in order, to the cpus"
+                         " in CPUMASK (e.g. if CPUMASK is '5d', the first"
+                         " FILE is sent from cpu 0, the second from cpu 2,"
+                                                            " and so on)."},
+  {'M', "N",       "Send at most N megabits of frame data per second from"
+                                                      " each " FSUBJECT "."},
+  {'n', "N",       "Replay each FILE N times. 0 replays until interrupted."
+                                                           " Default is 1."},
+  {'P', "N",       "Send at most N packets per second from each "
+                                                               FSUBJECT "."},
+  {'v', NULL,      "Display more verbose output."},
+  {'V', NULL,      "Display the version and exit."},
+  {0, NULL, NULL}
+};
+
+static char *usage_short_opt_order = "h:b:lm:M:n:P:v:V";
+
+struct replay_worker {
+  int            idx;
+  int            cpu;
+  const char     *path;
+  struct tx_ring ring;
+  unsigned int   batch;
+  uintmax_t      loops;
+  uintmax_t      pps;
+  uintmax_t      mbps;
+  uintmax_t      packets;
+  uintmax_t      bytes;
+  uintmax_t      queued_bytes;
+  uintmax_t      skipped;
+  double         seconds;
+  struct timespec start;
+  char           errbuf[RXTX_ERRBUF_SIZE];
+};
+
+/* ========================================================================= */
+static void usage_print_opt(int val, const char *name, const char *arg,
+                                                           char *description) {
+  int consumed = 0;
+  int padding = 0;
+  int remaining = 0;
+
+  char *start = NULL;
+  char *end = NULL;
+
+  consumed = printf("  -%c, [--%s%s%s]  ", val, name, arg ? "=" : "",
+                                                               arg ? arg : "");
+
+  if (consumed < 0) {
+    /* no point in continuing */
+    return;
+  }
+
+  padding = USAGE_PRINT_OPT_FIRST_COL_LEN - consumed;
+
+  if (padding < 0) {
+    padding = 0;
+  }
+
+  printf("%*s%s", padding, "", USAGE_PRINT_OPT_COL_SEP);
+
+  start = description;
+
+  remaining = USAGE_PRINT_OPT_SECOND_COL_LEN;
+
+  while(1) {
+    while(isspace(*start)) {
+      start++;
+    }
+
+    int len = strlen(start);
+
+    if (len < remaining) {
+      printf("%s\n", start);
+      break;
+    }
+
+    end = start + remaining;
+
+    while(!isspace(*end) && end > start) {
+      end--;
+    }
+
+    if (start == end) {
+      /* no whitespace found in second column width, bail */
+      printf("%s\n", start);
+      break;
+    }
+
+    while(start < end) {
+      putchar(*start);
+      start++;
+    }
+
+    printf("\n%*s%s%s", USAGE_PRINT_OPT_FIRST_COL_LEN, "",
+                             USAGE_PRINT_OPT_COL_SEP, USAGE_PRINT_OPT_COL_IND);
+
+    remaining = USAGE_PRINT_OPT_IND_SECOND_COL_LEN;
+  }
+}
+
+/* ========================================================================= */
+static const char *usage_opt_get_arg(int val) {
+  int i = 0;
+  int v = 0;
+
+  for (i = 0; i < INT_MAX; i++) {
+    v = usage_options[i].val;
+
+    if (!v) {
+      return NULL;
+    }
+
+    if (v == val) {
+      return usage_options[i].arg;
+    }
+  }
+
+  return NULL;
+}
+
+/* ========================================================================= */
+static const char * usage_opt_get_name(int val) {
+  int i = 0;
+  int v = 0;
+
+  for (i = 0; i < INT_MAX; i++) {
+    v = long_options[i].val;
+
+    if (!v) {
+      return NULL;
+    }
+
+    if (v == val) {
+      return long_options[i].name;
+    }
+  }
+
+  return NULL;
+}
+
+/* ========================================================================= */
+static void usage(void) {
+  int i = 0;
+  int val = 0;
+  const char *name;
+
+  puts("Usage:");
+  printf("  %s [OPTIONS] INTERFACE FILE...\n\n", program_basename);
+
+  puts("Options:");
+
+  for (i = 0; i < INT_MAX; i++) {
+    val = usage_options[i].val;
+
+    if (!val) {
+      break;
+    }
+
+    name = usage_opt_get_name(val);
+
+    if (name) {
+      usage_print_opt(val, name, usage_options[i].arg,
+                                                 usage_options[i].description);
+    }
+  }
+}
+
+/* ========================================================================= */
+static void usage_short(void) {
+  int i = 0;
+  int indent = 0;
+  int lookahead = 0;
+  int projected = 0;
+  int remaining = 0;
+  int val = 0;
+
+  char *p = NULL;
+
+  const char *arg;
+  const char *name;
+
+  indent = fprintf(stderr, "Usage: %s", program_basename);
+
+  if (indent < 0) {
+    /* no point in continuing */
+    return;
+  }
+
+  remaining = USAGE_PRINT_OPT_TOTAL_LEN - indent;
+
+  p = usage_short_opt_order;
+
+  while (*p) {
+    lookahead = 0;
+    projected = 0;
+
+    while (p[lookahead] && p[lookahead] != ':') {
+      val = p[lookahead];
+
+      name = usage_opt_get_name(val);
+      arg = usage_opt_get_arg(val);
+
+      if (name) {
+        if (!lookahead) {
+          projected += 4; // ' [--'
+        } else {
+          projected += 3; // '|--'
+        }
+
+        projected += strlen(name);
+
+        if (arg) {
+          projected += 1; // '='
+          projected += strlen(arg);
+        }
+      }
+
+      lookahead++;
+    }
+
+    projected += 1; // ']'
+
+    if (projected > remaining) {
+      fprintf(stderr, "\n%*s", indent, "");
+      remaining = USAGE_PRINT_OPT_TOTAL_LEN - indent;
+    }
+
+    for (i = 0; i < lookahead; i++) {
+      val = p[i];
+
+      name = usage_opt_get_name(val);
+      arg = usage_opt_get_arg(val);
+
+      if (name) {
+        if (!i) {
+          remaining -= fprintf(stderr, " [--");
+        } else {
+          remaining -= fprintf(stderr, "|--");
+        }
+
+        remaining -= fprintf(stderr, "%s", name);
+
+        if (arg) {
+          remaining -= fprintf(stderr, "=%s", arg);
+        }
+      }
+    }
+
+    p += lookahead;
+
+    remaining -= fprintf(stderr, "]");
+
+    if (*p == ':') {
+      p++;
+    }
+  }
+
+  fprintf(stderr, "\n");
+}
+
+/* ========================================================================= */
+static double timespec_diff(const struct timespec *end,
+                                                const struct timespec *start) {
+  return (end->tv_sec - start->tv_sec)
+                     + (double)(end->tv_nsec - start->tv_nsec) / NSEC_PER_SEC;
+}
+
+/* ========================================================================= */
+static int replay_flush(struct replay_worker *w) {
+  int status = 0;
+  unsigned int queued = 0;
+  double pace = 0;
+  double seconds = 0;
+  struct timespec deadline;
+  struct timespec now;
+
+  queued = tx_ring_get_queued(&w->ring);
+
+  status = tx_ring_flush(&w->ring);
+  if (status == RXTX_ERROR) {
+    return RXTX_ERROR;
+  }
+
+  w->packets += queued;
+  w->bytes += w->queued_bytes;
+  w->queued_bytes = 0;
+
+  /*
+   * Pace against the start of the replay rather than the previous batch, so
+   * time lost to a slow send() is made up instead of compounding. Whichever
+   * of the two limits is further behind wins.
+   */
+  if (w->pps) {
+    seconds = (double)w->packets / w->pps;
+  }
+  if (w->mbps) {
+    pace = (double)w->bytes * 8 / (w->mbps * 1000000.0);
+    if (pace > seconds) {
+      seconds = pace;
+    }
+  }
+
+  if (seconds <= 0 || rxtx_breakloop) {
+    return 0;
+  }
+
+  deadline.tv_sec = w->start.tv_sec + (time_t)seconds;
+  deadline.tv_nsec = w->start.tv_nsec
+                      + (long)((seconds - (time_t)seconds) * NSEC_PER_SEC);
+  if (deadline.tv_nsec >= NSEC_PER_SEC) {
+    deadline.tv_sec++;
+    deadline.tv_nsec -= NSEC_PER_SEC;
+  }
+
+  while (!rxtx_breakloop) {
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if (timespec_diff(&deadline, &now) <= 0) {
+      break;
+    }
+
+    now.tv_nsec += REPLAY_PACE_SLICE_NSEC;
+    if (now.tv_nsec >= NSEC_PER_SEC) {
+      now.tv_sec++;
+      now.tv_nsec -= NSEC_PER_SEC;
+    }
+    if (timespec_diff(&deadline, &now) < 0) {
+      now = deadline;
+    }
+
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &now, NULL);
+  }
+
+  return 0;
+}
+
+/* ========================================================================= */
+static int replay_file(struct replay_worker *w, uintmax_t *read) {
+  int status = 0;
+  const u_char *data = NULL;
+  struct pcap_pkthdr *header = NULL;
+  char pcap_errbuf[PCAP_ERRBUF_SIZE] = "";
+  pcap_t *pd = NULL;
+
+  pd = pcap_open_offline(w->path, pcap_errbuf);
+  if (!pd) {
+    rxtx_fill_errbuf(w->errbuf, "error opening '%s': %s", w->path,
+                                                                 pcap_errbuf);
+    return RXTX_ERROR;
+  }
+
+  while (!rxtx_breakloop && (status = pcap_next_ex(pd, &header, &data)) == 1) {
+    (*read)++;
+
+    /*
+     * Frames the kernel would discard are held back here so w->packets only
+     * counts what was really sent.
+     */
+    if (!tx_ring_sendable(&w->ring, data, header->caplen)) {
+      w->skipped++;
+      continue;
+    }
+
+    /*
+     * A full ring means frames from the last batch are still in flight;
+     * flushing waits for them. Only spin when there is nothing of ours left
+     * to flush.
+     */
+    while ((status = tx_ring_enqueue(&w->ring, data, header->caplen))
+                                                             == TX_RING_FULL) {
+      if (tx_ring_get_queued(&w->ring)) {
+        if (replay_flush(w) == RXTX_ERROR) {
+          pcap_close(pd);
+          return RXTX_ERROR;
+        }
+      } else {
+        sched_yield();
+      }
+    }
+    if (status == RXTX_ERROR) {
+      pcap_close(pd);
+      return RXTX_ERROR;
+    }
+    w->queued_bytes += header->caplen;
+
+    if (tx_ring_get_queued(&w->ring) >= w->batch) {
+      if (replay_flush(w) == RXTX_ERROR) {
+        pcap_close(pd);
+        return RXTX_ERROR;
+      }
+    }
+  }
+
+  if (status == PCAP_ERROR) {
+    rxtx_fill_errbuf(w->errbuf, "error reading '%s': %s", w->path,
+                                                              pcap_geterr(pd));
+    pcap_close(pd);
+    return RXTX_ERROR;
+  }
+
+  pcap_close(pd);
+
+  return 0;
+}
+
+/* ========================================================================= */
+static void *replay_loop(void *arg) {
+  int status = 0;
+  uintmax_t loop = 0;
+  uintmax_t read = 0;
+  uintmax_t skipped = 0;
+  struct timespec end;
+  struct replay_worker *w = arg;
+
+  clock_gettime(CLOCK_MONOTONIC, &w->start);
+
+  for (loop = 0; !w->loops || loop < w->loops; loop++) {
+    read = 0;
+    skipped = w->skipped;
+
+    status = replay_file(w, &read);
+    if (status == RXTX_ERROR || rxtx_breakloop) {
+      break;
+    }
+
+    /*
+     * A file which is empty, or whose packets are all unsendable, would
+     * otherwise spin forever when looping until interrupted.
+     */
+    if (read == w->skipped - skipped) {
+      break;
+    }
+  }
+
+  if (status != RXTX_ERROR) {
+    status = replay_flush(w);
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  w->seconds = timespec_diff(&end, &w->start);
+
+  return (void *)(intptr_t)status;
+}
+
+/* ========================================================================= */
+int main(int argc, char **argv) {
+  program_basename = basename(argv[0]);
+
+  int c = 0;
+  int cpu = -1;
+  int i = 0;
+  int status = 0;
+  int worker_count = 0;
+  unsigned int ifindex = 0;
+
+  uintmax_t batch = REPLAY_BATCH_DEFAULT;
+  uintmax_t loops = 1;
+  uintmax_t pps = 0;
+  uintmax_t mbps = 0;
+  uintmax_t packets = 0;
+  double rate = 0;
+
+  bool help = false;
+  bool verbose = false;
+
+  char *badopt = NULL;
+  char *list = NULL;
+  char *mask = NULL;
+  char *endptr = NULL;
+
+  pcap_t *pd = NULL;
+  char pcap_errbuf[PCAP_ERRBUF_SIZE] = "";
+
+  struct replay_worker *workers = NULL;
+  struct replay_worker *w = NULL;
+
+  void *vpstatus = NULL;
+
+  ring_set_t cpu_set;
+  ring_set_init(&cpu_set, 0);
+
+  /*
+   * optstring must start with ":" so ':' is returned for a missing option
+   * argument. Otherwise '?' is returned for both invalid option and missing
+   * option argument.
+   */
+  while ((c = getopt_long(argc, argv, ":b:hl:m:M:n:P:vV", long_options, 0))
+                                                                       != -1) {
+    switch (c) {
+      case 'b':
+        batch = strtoumax(optarg, &endptr, OPTION_COUNT_BASE);
+        if (*endptr || batch == 0 || batch > UINT_MAX) {
+          fprintf(stderr, "%s: Invalid batch '%s'.\n", program_basename,
+                                                                       optarg);
+          usage_short();
+          return EXIT_FAIL_OPTION;
+        }
+        break;
+
+      case 'h':
+        help = true;
+        break;
+
+      case 'l':
+        list = optarg;
+        if (parse_cpu_list(optarg, &cpu_set)) {
+          fprintf(stderr, "%s: Invalid cpu list '%s'.\n", program_basename,
+                                                                       optarg);
+          usage_short();
+          return EXIT_FAIL_OPTION;
+        }
+        break;
+
+      case 'm':
+        mask = optarg;
+        if (parse_cpu_mask(optarg, &cpu_set)) {
+          fprintf(stderr, "%s: Invalid cpu mask '%s'.\n", program_basename,
+                                                                       optarg);
+          usage_short();
+          return EXIT_FAIL_OPTION;
+        }
+        break;
+
+      case 'M':
+        mbps = strtoumax(optarg, &endptr, OPTION_COUNT_BASE);
+        if (*endptr) {
+          fprintf(stderr, "%s: Invalid mbps '%s'.\n", program_basename,
+                                                                       optarg);
+          usage_short();
+          return EXIT_FAIL_OPTION;
+        }
+        break;
+
+      case 'n':
+        loops = strtoumax(optarg, &endptr, OPTION_COUNT_BASE);
+        if (*endptr) {
+          fprintf(stderr, "%s: Invalid loops '%s'.\n", program_basename,
+                                                                       optarg);
+          usage_short();
+          return EXIT_FAIL_OPTION;
+        }
+        break;
+
+      case 'P':
+        pps = strtoumax(optarg, &endptr, OPTION_COUNT_BASE);
+        if (*endptr) {
+          fprintf(stderr, "%s: Invalid pps '%s'.\n", program_basename,
+                                                                       optarg);
+          usage_short();
+          return EXIT_FAIL_OPTION;
+        }
+        break;
+
+      case 'v':
+        verbose = true;
+        break;
+
+      case 'V':
+        printf("%s version %s\n", program_basename, RXTXUTILS_VERSION);
+        return EXIT_OK;
+
+      case ':':  /* missing option argument */
+        fprintf(stderr, "%s: Option '%s' requires an argument.\n",
+                                             program_basename, argv[optind-1]);
+        usage_short();
+        return EXIT_FAIL_OPTION;
+
+      case '?':  /* invalid option */
+      default:   /* invalid option in optstring */
+        /*
+         * optopt is NULL for long options and reliable for short ones as
+         * long as optstring is kept clean (see rxtxcpu.c for the details).
+         */
+        if (optopt) {
+          asprintf(&badopt, "-%c", optopt);
+        } else {
+          badopt = argv[optind-1];
+        }
+        fprintf(stderr, "%s: Unrecognized option '%s'.\n", program_basename,
+                                                                       badopt);
+        if (optopt) {
+          free(badopt);
+        }
+        usage_short();
+        return EXIT_FAIL_OPTION;
+    }
+  }
+
+  if (help) {
+    usage();
+    return EXIT_OK;
+  }
+
+  if (list && mask) {
+    fprintf(stderr, "%s: -l [--cpu-list] and -m [--cpu-mask] are mutually"
+                                            " exclusive.\n", program_basename);
+    usage_short();
+    return EXIT_FAIL_OPTION;
+  }
+
+  if (argc - optind < 2) {
+    fprintf(stderr, "%s: An interface and at least one pcap file are"
+                                          " required.\n", program_basename);
+    usage_short();
+    return EXIT_FAIL_OPTION;
+  }
+
+  ifindex = if_nametoindex(argv[optind]);
+  if (!ifindex) {
+    fprintf(stderr, "%s: Invalid interface '%s'.\n", program_basename,
+                                                                 argv[optind]);
+    return EXIT_FAIL;
+  }
+  optind++;
+
+  worker_count = argc - optind;
+
+  /*
+   * When paced, flush about once a millisecond so slow rates don't go out as
+   * bursts of a full batch. Frames are taken to be full size for -M.
+   */
+  if (pps && pps / 1000 < batch) {
+    batch = pps / 1000 ? pps / 1000 : 1;
+  }
+  if (mbps && mbps * 125 / TX_RING_FRAME_SIZE < batch) {
+    batch = mbps * 125 / TX_RING_FRAME_SIZE ? mbps * 125 / TX_RING_FRAME_SIZE
+                                                                         : 1;
+  }
+
+  if ((list || mask) && RING_COUNT(&cpu_set) < worker_count) {
+    fprintf(stderr, "%s: %d files need %d cpus but the cpu %s has %d.\n",
+                         program_basename, worker_count, worker_count,
+                         list ? "list" : "mask", RING_COUNT(&cpu_set));
+    usage_short();
+    return EXIT_FAIL_OPTION;
+  }
+
+  workers = calloc(worker_count, sizeof(*workers));
+  if (!workers) {
+    fprintf(stderr, "%s: %s\n", program_basename, strerror(errno));
+    return EXIT_FAIL;
+  }
+
+  /*
+   * Everything which can fail up front (bad files, ring setup) does so before
+   * any worker starts sending.
+   */
+  for (i = 0; i < worker_count; i++) {
+    w = &workers[i];
+    w->idx = i;
+    w->path = argv[optind + i];
+    w->batch = (unsigned int)batch;
+    w->loops = loops;
+    w->pps = pps;
+    w->mbps = mbps;
+    w->cpu = -1;
+
+    if (list || mask) {
+      cpu = find_next_set_ring(cpu + 1, &cpu_set);
+      w->cpu = cpu;
+    }
+
+    pd = pcap_open_offline(w->path, pcap_errbuf);
+    if (!pd) {
+      fprintf(stderr, "%s: error opening '%s': %s\n", program_basename,
+                                                       w->path, pcap_errbuf);
+      return EXIT_FAIL;
+    }
+    if (pcap_datalink(pd) != DLT_EN10MB) {
+      fprintf(stderr, "%s: error opening '%s': only ethernet captures can be"
+                                  " replayed\n", program_basename, w->path);
+      pcap_close(pd);
+      return EXIT_FAIL;
+    }
+    pcap_close(pd);
+
+    status = tx_ring_open(&w->ring, ifindex, 0, w->errbuf);
+    if (status == RXTX_ERROR) {
+      fprintf(stderr, "%s: %s\n", program_basename, w->errbuf);
+      return EXIT_FAIL;
+    }
+
+    if (verbose) {
+      if (w->cpu != -1) {
+        fprintf(stderr, "Replaying '%s' from cpu %d.\n", w->path, w->cpu);
+      } else {
+        fprintf(stderr, "Replaying '%s'.\n", w->path);
+      }
+    }
+  }
+
+  /*
+   * Setup our signal handlers before spinning up threads.
+   */
+  setup_signals();
+
+  /*
+   * Each worker owns its tx ring, so sends never contend. When pinned, the
+   * kernel picks the tx queue for the sending cpu (e.g. via xps), which is
+   * what lets a per-cpu capture be replayed with its original steering.
+   */
+  pthread_t threads[worker_count];
+  pthread_attr_t attr;
+
+  ring_set_t affinity;
+  ring_set_init(&affinity, 0);
+
+  for (i = 0; i < worker_count; i++) {
+    w = &workers[i];
+
+    pthread_attr_init(&attr);
+    if (w->cpu != -1) {
+      RING_ZERO(&affinity);
+      RING_SET(w->cpu, &affinity);
+      pthread_attr_setaffinity_np(&attr, affinity.size, affinity.set);
+    }
+
+    status = pthread_create(&threads[i], &attr, replay_loop, (void *)w);
+    pthread_attr_destroy(&attr);
+    if (status) {
+      fprintf(stderr, "%s: error creating " FSUBJECT " threads: %s\n",
+                                           program_basename, strerror(status));
+      return EXIT_FAIL;
+    }
+  }
+
+  status = EXIT_OK;
+
+  for (i = 0; i < worker_count; i++) {
+    pthread_join(threads[i], &vpstatus);
+    if ((intptr_t)vpstatus == (intptr_t)RXTX_ERROR) {
+      fprintf(stderr, "%s: %s\n", program_basename, workers[i].errbuf);
+      status = EXIT_FAIL;
+    }
+  }
+
+  ring_set_destroy(&affinity);
+
+  /*
+   * Per-worker rates are summed for the total since the workers send
+   * concurrently.
+   */
+  for (i = 0; i < worker_count; i++) {
+    w = &workers[i];
+
+    fprintf(stdout, "%ju packets sent by " FSUBJECT " %d in %.3f seconds"
+                     " (%.0f pps).\n", w->packets, i, w->seconds,
+                                 w->seconds > 0 ? w->packets / w->seconds : 0);
+
+    if (w->skipped) {
+      fprintf(stderr, "%s: Skipped %ju packets in '%s' shorter than an"
+                  " ethernet header or longer than the %u byte mtu or the %u"
+                  " byte tx frame allow.\n", program_basename, w->skipped,
+                  w->path, tx_ring_get_mtu(&w->ring),
+                  tx_ring_get_frame_max(&w->ring));
+    }
+
+    packets += w->packets;
+    rate += w->seconds > 0 ? w->packets / w->seconds : 0;
+
+    tx_ring_close(&w->ring);
+  }
+
+  fprintf(stdout, "%ju packets sent total (%.0f pps).\n", packets, rate);
+
+  free(workers);
+  ring_set_destroy(&cpu_set);
+
+  return status;
+}